@@ -1,47 +1,479 @@
 #include "first_app.hpp"
 
 #include "simple_render_system.hpp"
+#include "gpu_driven_render_system.hpp"
 
 #define GLM_FORCE_RADIANS // Radians must be radians
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE // Expect depth values to 0 - 1
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <chrono>
 #include <stdexcept>
 
 namespace lve {
 
-    FirstApp::FirstApp() {
-        loadGameObjects();
+    FirstApp::FirstApp(const LveRenderServer::Options &serverOptions, bool headless)
+        : serverOptions{serverOptions}, lveWindow{WIDTH, HEIGHT, "Hello Vulkan!", serverOptions.enabled || headless} {
+        if (serverOptions.enabled) {
+            // Clients bring their own objects, all drawn with the cube
+            cubeModel = createCubeModel(assets, {0.f, 0.f, 0.f});
+            renderServer = std::make_unique<LveRenderServer>(serverOptions.socketPath);
+        } else {
+            loadGameObjects();
+        }
+        setupShadowLights();
+    }
+
+    FirstApp::~FirstApp() {
+        assets.release(cubeModel);
+    }
+
+    void FirstApp::benchmarkDepthPrepass(uint32_t framesPerMode) {
+        if (gpuDrivenRendering) {
+            throw std::runtime_error("the depth pre pass benchmark needs the simple render system!");
+        }
+        benchmark = std::make_unique<LveFrameBenchmark>(
+            "depth pre pass", std::vector<std::string>{"without pre pass", "with pre pass"}, framesPerMode, BENCHMARK_WARMUP_FRAMES,
+            [this](uint32_t mode) {
+                // The next frame rebuilds the graph, nothing may still be using the old one
+                vkDeviceWaitIdle(lveDevice.device());
+                depthPrepassEnabled = mode == 1;
+            });
+    }
+
+    void FirstApp::benchmarkLights(uint32_t framesPerMode) {
+        if (gpuDrivenRendering) {
+            throw std::runtime_error("the light benchmark needs the simple render system!");
+        }
+        static const uint32_t counts[] = {64, 1024, 10240};
+        benchmark = std::make_unique<LveFrameBenchmark>(
+            "clustered lights", std::vector<std::string>{"64 lights", "1024 lights", "10240 lights"}, framesPerMode, BENCHMARK_WARMUP_FRAMES,
+            [this](uint32_t mode) { lightCount = counts[mode]; }); // only the uploaded array changes, no need to wait
     }
 
-    FirstApp::~FirstApp() {}
+    void FirstApp::benchmarkOcclusionCulling(uint32_t framesPerMode) {
+        if (renderServer) {
+            throw std::runtime_error("the occlusion culling benchmark needs the app's own scene!");
+        }
+        gpuDrivenRendering = true;
+        addOccludedObjects();
+        benchmark = std::make_unique<LveFrameBenchmark>(
+            "occlusion culling", std::vector<std::string>{"without hi-z", "with hi-z"}, framesPerMode, BENCHMARK_WARMUP_FRAMES,
+            [this](uint32_t mode) { occlusionCullingEnabled = mode == 1; }); // picked up by the next cull pass
+    }
+
+    void FirstApp::benchmarkReadback(uint32_t framesPerMode) {
+        // A window's size is up to the user, and a render server brings its own sink
+        if (!lveWindow.isHeadless() || renderServer) {
+            throw std::runtime_error("the readback benchmark needs a headless app without the render server!");
+        }
+        static const VkExtent2D extents[] = {{1920, 1080}, {3840, 2160}};
+        benchmark = std::make_unique<LveFrameBenchmark>(
+            "frame readback",
+            std::vector<std::string>{"1920x1080 without readback", "1920x1080 with readback", "3840x2160 without readback", "3840x2160 with readback"},
+            framesPerMode, BENCHMARK_WARMUP_FRAMES,
+            [this](uint32_t mode) {
+                // The next frame rebuilds the graph with or without the readback pass, nothing may still be using the old one
+                vkDeviceWaitIdle(lveDevice.device());
+                // The sink does nothing, so what is measured is the copy and getting it to the CPU, not what a consumer does with it
+                if (mode % 2 == 1) {
+                    frameReadback.setSink([](const LveFrameReadback::Frame &) {});
+                } else {
+                    frameReadback.setSink(nullptr);
+                }
+                // The swap chain is recreated at this size after the next frame, within the warm up
+                lveWindow.setExtent(extents[mode / 2]);
+            });
+    }
 
     void FirstApp::run() {
-        SimpleRenderSystem simpleRenderSystem{lveDevice, lveRenderer.getSwapChainRenderPass()};
+        SimpleRenderSystem simpleRenderSystem{lveDevice, lveRenderer.getSwapChainRenderPass(), descriptorLayoutCache, clusteredLights, shadowMaps, bindlessHeap};
+        std::unique_ptr<GpuDrivenRenderSystem> gpuDrivenRenderSystem;
+        if (gpuDrivenRendering) {
+            gpuDrivenRenderSystem = std::make_unique<GpuDrivenRenderSystem>(lveDevice, lveRenderer.getSwapChainRenderPass(), descriptorLayoutCache);
+        }
+        if (renderServer) {
+            if (!lveRenderer.isReadbackSupported()) {
+                throw std::runtime_error("render server needs swap chain images that can be read back!");
+            }
+            // Consumers get one copy in shared memory, straight from the readback buffer
+            frameReadback.setSink([this](const LveFrameReadback::Frame &frame) {
+                uint64_t frameBytes = static_cast<uint64_t>(frame.rowPitch) * frame.height;
+                // The window can grow, then the ring is replaced by one the frame fits in and readers open that
+                // It is never shrunk, smaller frames fit in the slots as they are
+                if (!frameWriter || frameBytes > frameWriter->getMaxFrameBytes()) {
+                    frameWriter.reset(); // closes and unlinks the old ring before the new one takes its name
+                    frameWriter = std::make_unique<LveSharedFrameWriter>(serverOptions.frameRingName, serverOptions.frameRingSlots, frameBytes);
+                    profiler.addCounter("server.frame_ring_resizes", 1);
+                }
+                // The frame was tagged with the poll it shows, each client finds its own sequence in it
+                const LveRenderServer::Snapshot *snapshot = renderServer->getSnapshot(frame.tag);
+                frameWriter->write(frame.pixels, frame.width, frame.height, frame.rowPitch, frame.format, frame.tag,
+                                   snapshot ? snapshot->clients.data() : nullptr, snapshot ? snapshot->clientCount : 0);
+            });
+        } else if (CAPTURE_FRAMES) {
+            frameReadback.setSink(LveFrameReadback::makeFileSink("frame_", CAPTURE_INTERVAL));
+        }
+        // Sits at the origin looking down +z
+        camera.setViewDirection(glm::vec3{0.f}, glm::vec3{0.f, 0.f, 1.f});
+
+        // Simulation steps run on their own thread from here on, the loop below only picks up the results
+        simulation.start();
+        auto startTime = std::chrono::steady_clock::now();
+        // For the benchmarks, the readback's cost on the CPU only shows in the time between frames
+        auto lastFrameTime = startTime;
+        uint64_t lastBytesRead = 0;
         // while the window does not want to close, poll window events
-        while (!lveWindow.shouldClose()) {
+        while (!lveWindow.shouldClose() && !(renderServer && renderServer->isShutdownRequested()) && !(benchmark && benchmark->isFinished())) {
             // Poll window events. eg. Keystrokes and actions
-            glfwPollEvents();
+            if (!lveWindow.isHeadless()) {
+                glfwPollEvents();
+            }
+
+            // Blend the newest simulation snapshot into the registry, never waits for the simulation thread
+            profiler.setCounter("sim.steps", simulation.applySnapshot(registry));
+            // Then whatever clients sent since the last frame, so the frame shows the newest scene
+            if (renderServer) {
+                renderServer->poll(registry, cubeModel);
+                profiler.setCounter("server.clients", renderServer->getStats().clientCount);
+                profiler.setCounter("server.messages", renderServer->getStats().messagesApplied);
+                profiler.setCounter("server.throttled_clients", renderServer->getStats().throttledClients);
+            }
+
+            updateLights(std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count());
+
+            // Aspect ratio follows the window, so the projection is updated every frame
+            float aspect = lveRenderer.getAspectRatio();
+            camera.setPerspectiveProjection(glm::radians(50.f), aspect, .1f, 10.f);
 
             if (auto commandBuffer = lveRenderer.beginFrame()) { // will return nullptr if swapchain needs to be recreated
 
-                // begin offscreen shadow pass
-                // render shadow casting objects
-                //end offscreen shadow pass
+                // Recreating the swap chain waited for the device, and nothing has been submitted since
+                if (!renderGraph.isCompiled() || renderGraphGeneration != lveRenderer.getSwapChainGeneration() ||
+                    renderGraphDepthPrepass != depthPrepassEnabled || renderGraphReadback != frameReadback.isEnabled()) {
+                    buildRenderGraph(simpleRenderSystem, gpuDrivenRenderSystem.get());
+                }
 
-                lveRenderer.beginSwapChainRenderPass(commandBuffer); // Record the command buffer, set up the render system
-                simpleRenderSystem.renderGameObjects(commandBuffer, gameObjects);
-                lveRenderer.endSwapChainRenderPass(commandBuffer); // Stop recording the command buffer
+                // This frame's fence was waited on, models released long enough ago are no longer drawn by any frame
+                assets.collectGarbage();
+                profiler.setCounter("assets.models", assets.getModelCount());
+                // Same for this frame's region of the ring buffer, whatever it held last time has been read
+                frameRing.beginFrame(lveRenderer.getFrameIndex());
+                bindlessHeap.beginFrame(lveRenderer.getFrameIndex());
+                // And the copy this frame slot made last time has landed
+                frameReadback.beginFrame(lveRenderer.getFrameIndex());
+                clusteredLights.beginFrame(lveRenderer.getFrameIndex());
+                // As have its timestamps, a new measurement picks the size this frame is drawn at
+                bool measured = gpuTimer.beginFrame(lveRenderer.getFrameIndex());
+                if (pipelineStatistics.beginFrame(lveRenderer.getFrameIndex())) {
+                    profiler.setCounter("gpu.fragment_invocations", pipelineStatistics.getFragmentInvocations());
+                }
+                if (measured) {
+                    profiler.setCounter("gpu.frame_us", static_cast<uint64_t>(gpuTimer.getMilliseconds() * 1000.f));
+                    if (dynamicResolutionActive) {
+                        dynamicResolution.update(gpuTimer.getMilliseconds());
+                    }
+                    if (benchmark) {
+                        benchmark->addSample(gpuTimer.getMilliseconds(), pipelineStatistics.getFragmentInvocations());
+                        if (gpuDrivenRenderSystem) {
+                            // A few frames older than the GPU time, the warm up frames cover the difference
+                            auto &cullingStats = gpuDrivenRenderSystem->getCullingStats();
+                            benchmark->addCounter("visible", cullingStats.visibleCount);
+                            benchmark->addCounter("occluded", cullingStats.occludedCount);
+                            benchmark->addCounter("draws", cullingStats.drawCount);
+                        }
+                    }
+                }
+                if (dynamicResolutionActive) {
+                    VkExtent2D renderExtent = dynamicResolution.getRenderExtent(lveRenderer.getSwapChainExtent());
+                    renderGraph.setRenderArea(mainPass, renderExtent);
+                    if (depthPrepass != LveRenderGraph::INVALID) {
+                        renderGraph.setRenderArea(depthPrepass, renderExtent);
+                    }
+                    profiler.setCounter("resolution.scale_pct", static_cast<uint64_t>(dynamicResolution.getScale() * 100.f + .5f));
+                }
+
+                auto &recorder = lveRenderer.getCommandRecorder();
+                auto &descriptorAllocator = lveRenderer.getDescriptorAllocator();
+                FrameInfo frameInfo{lveRenderer.getFrameIndex(), commandBuffer, profiler, jobSystem, recorder, camera, assets, frameRing, descriptorAllocator, bindlessHeap};
+
+                // Records every pass with the barriers between them
+                renderGraph.bindImage(swapChainColor, lveRenderer.getCurrentImage(), lveRenderer.getCurrentImageView());
+                renderGraph.bindImage(swapChainDepth, lveRenderer.getCurrentDepthImage(), lveRenderer.getCurrentDepthImageView());
+                gpuTimer.begin(commandBuffer, frameInfo.frameIndex);
+                pipelineStatistics.begin(commandBuffer, frameInfo.frameIndex);
+                renderGraph.execute(frameInfo);
+                pipelineStatistics.end(commandBuffer, frameInfo.frameIndex);
+                gpuTimer.end(commandBuffer, frameInfo.frameIndex);
+
+                // How much state the recorder saved us this frame
+                profiler.setCounter("commands.emitted", recorder.getStats().totalEmitted());
+                profiler.setCounter("commands.skipped", recorder.getStats().totalSkipped());
+                // How close the frame came to filling its region of the ring, overflows mean it grows next frame
+                auto &ringStats = frameRing.getStats();
+                profiler.setCounter("ring.used", ringStats.used);
+                profiler.setCounter("ring.high_water", ringStats.highWaterMark);
+                profiler.setCounter("ring.overflows", ringStats.overflowCount);
+                profiler.setCounter("descriptors.sets", descriptorAllocator.getAllocatedSetCount());
+                profiler.setCounter("descriptors.pools", descriptorAllocator.getPoolCount());
+                profiler.setCounter("bindless.images", bindlessHeap.getImageCount());
+                profiler.setCounter("bindless.storage_buffers", bindlessHeap.getStorageBufferCount());
+                auto &graphStats = renderGraph.getStats();
+                profiler.setCounter("graph.passes", graphStats.passCount);
+                profiler.setCounter("graph.barriers", graphStats.barrierCount);
+                profiler.setCounter("graph.transient_memory", graphStats.transientMemorySize);
+                if (frameReadback.isEnabled()) {
+                    auto &readbackStats = frameReadback.getStats();
+                    profiler.setCounter("readback.frames", readbackStats.framesDelivered);
+                    profiler.setCounter("readback.mb_per_s", static_cast<uint64_t>(readbackStats.bytesPerSecond / 1e6));
+                    profiler.setCounter("readback.sink_us", static_cast<uint64_t>(readbackStats.sinkSeconds * 1e6));
+                }
+                auto &lightStats = clusteredLights.getStats();
+                profiler.setCounter("lights.count", lightStats.lightCount);
+                profiler.setCounter("lights.max_per_cluster", lightStats.maxLightsPerCluster);
+                profiler.setCounter("lights.overflowed_clusters", lightStats.overflowedClusters);
+                // Cached views cost a copy, refreshed ones redrew their static casters
+                auto &shadowStats = shadowMaps.getStats();
+                profiler.setCounter("shadows.views", shadowStats.viewCount);
+                profiler.setCounter("shadows.cached_views", shadowStats.cachedViewCount);
+                profiler.setCounter("shadows.refreshed_views", shadowStats.refreshedViewCount);
+                profiler.setCounter("shadows.static_draws", shadowStats.staticDrawCount);
+                profiler.setCounter("shadows.dynamic_draws", shadowStats.dynamicDrawCount);
+                profiler.setCounter("shadows.atlas_used_pct", shadowStats.atlasUsedPercent);
                 lveRenderer.endFrame(); // Submits the command buffer
+                profiler.endFrame();
+                if (benchmark) {
+                    auto now = std::chrono::steady_clock::now();
+                    double frameSeconds = std::chrono::duration<double>(now - lastFrameTime).count();
+                    lastFrameTime = now;
+                    benchmark->addCounter("us per frame (wall)", static_cast<uint64_t>(frameSeconds * 1e6));
+                    uint64_t bytesRead = frameReadback.getStats().bytesDelivered;
+                    if (frameReadback.isEnabled()) {
+                        benchmark->addCounter("MB/s read back", static_cast<uint64_t>((bytesRead - lastBytesRead) / frameSeconds / 1e6));
+                    }
+                    lastBytesRead = bytesRead;
+                    benchmark->endFrame();
+                }
             }
         }
+        simulation.stop();
         // CPU will block until GPU operations are completed
         // When device is deleted, the command pool and buffer is destroyed as well
         vkDeviceWaitIdle(lveDevice.device());
+        frameReadback.flush(); // the last frames in flight
+        // The passes refer to the render systems about to go out of scope
+        renderGraph.reset();
     }
 
-    std::unique_ptr<LveModel> FirstApp::createCubeModel(LveDevice& device, glm::vec3 offset) {
+    void FirstApp::buildRenderGraph(SimpleRenderSystem &simpleRenderSystem, GpuDrivenRenderSystem *gpuDrivenRenderSystem) {
+        using Access = LveRenderGraph::Access;
+        renderGraph.reset();
+        renderGraphGeneration = lveRenderer.getSwapChainGeneration();
+        renderGraphDepthPrepass = depthPrepassEnabled;
+        renderGraphReadback = frameReadback.isEnabled();
+        VkExtent2D extent = lveRenderer.getSwapChainExtent();
+
+        // Acquiring the image waits at the color output stage, so that is where its previous use ends
+        LveRenderGraph::ImportDesc color{};
+        color.format = lveRenderer.getSwapChainImageFormat();
+        color.extent = extent;
+        color.initialStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        color.finalLayout = lveRenderer.getPresentLayout(); // or where the readback copies it from, headless
+        color.clearValue.color = {0.1f, 0.1f, 0.1f, 1.0f};
+        swapChainColor = renderGraph.importImage("swap_chain", color);
+
+        // The contents are thrown away every frame, but the last frame with this image may still be testing or sampling it
+        LveRenderGraph::ImportDesc depth{};
+        depth.format = lveRenderer.getSwapChainDepthFormat();
+        depth.extent = extent;
+        depth.initialStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        depth.initialAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        depth.clearValue.depthStencil = {1.0f, 0}; // farthest is 1, 0 is closest
+        swapChainDepth = renderGraph.importImage("swap_chain_depth", depth);
+
+        // Draw into a target the graph owns, only as much of it as the resolution scale asks for, and upscale that
+        // Same formats as the swap chain, so the render systems' pipelines work with either
+        dynamicResolutionActive = USE_DYNAMIC_RESOLUTION && !gpuDrivenRenderSystem && lveRenderer.isUpscaleSupported();
+        LveRenderGraph::resource_t mainColor = swapChainColor;
+        LveRenderGraph::resource_t mainDepth = swapChainDepth;
+        if (dynamicResolutionActive) {
+            VkExtent2D maxExtent = dynamicResolution.getMaxExtent(extent);
+            sceneColor = renderGraph.createImage("scene_color", {color.format, maxExtent, color.clearValue});
+            mainColor = sceneColor;
+            mainDepth = renderGraph.createImage("scene_depth", {depth.format, maxExtent, depth.clearValue});
+        }
+
+        // Shadows: stale tiles of the cache are redrawn with the static casters, the cache is copied into the frame's
+        // atlas and the dynamic casters are drawn on top, then main samples it. The GPU driven path has no lighting
+        shadowAtlas = LveRenderGraph::INVALID;
+        if (!gpuDrivenRenderSystem) {
+            shadowAtlas = renderGraph.createImage("shadow_atlas", {shadowMaps.getFormat(), shadowMaps.getAtlasExtent(), depth.clearValue});
+            // The cache is the shadow maps' own image, they synchronize it themselves
+            renderGraph.addPass("shadow_cache", [this, extent](FrameInfo &frameInfo) {
+                shadowMaps.update(frameInfo, registry, extent);
+            }).sideEffects();
+            renderGraph.addPass("shadow_composite", [this](FrameInfo &frameInfo) {
+                shadowMaps.composite(frameInfo, renderGraph.getImage(shadowAtlas));
+            }).write(shadowAtlas, Access::TRANSFER_DST);
+            renderGraph.addPass("shadow_dynamic", [this](FrameInfo &frameInfo) {
+                shadowMaps.renderDynamic(frameInfo);
+            }).write(shadowAtlas, Access::DEPTH_ATTACHMENT);
+        }
+
+        // Compute work can't be recorded inside a render pass, it only fills buffers so nothing reads it in the graph
+        if (gpuDrivenRenderSystem) {
+            renderGraph.addPass("cull", [this, gpuDrivenRenderSystem, extent](FrameInfo &frameInfo) {
+                gpuDrivenRenderSystem->setOcclusionCullingEnabled(occlusionCullingEnabled);
+                gpuDrivenRenderSystem->cullGameObjects(frameInfo, registry, extent);
+            }).sideEffects();
+        } else {
+            // Bins the lights for the clusters of the pixels main actually draws
+            renderGraph.addPass("light_cull", [this, extent](FrameInfo &frameInfo) {
+                VkExtent2D renderExtent = dynamicResolutionActive ? dynamicResolution.getRenderExtent(extent) : extent;
+                clusteredLights.cull(frameInfo, lights, renderExtent);
+            }).sideEffects();
+        }
+
+        // Depth of everything first, the main pass then only tests against it
+        bool useDepthPrepass = depthPrepassEnabled && !gpuDrivenRenderSystem;
+        depthPrepass = LveRenderGraph::INVALID;
+        if (useDepthPrepass) {
+            depthPrepass = renderGraph.addPass("depth_prepass", [this, &simpleRenderSystem](FrameInfo &frameInfo) {
+                simpleRenderSystem.renderDepthPrepass(frameInfo, registry);
+            }).write(mainDepth, Access::DEPTH_ATTACHMENT).getPass();
+        }
+
+        auto mainBuilder = renderGraph.addPass("main", [this, &simpleRenderSystem, gpuDrivenRenderSystem, useDepthPrepass](FrameInfo &frameInfo) {
+            if (gpuDrivenRenderSystem) {
+                gpuDrivenRenderSystem->render(frameInfo);
+            } else {
+                simpleRenderSystem.renderGameObjects(frameInfo, registry, useDepthPrepass);
+            }
+        }).write(mainColor, Access::COLOR_ATTACHMENT);
+        if (useDepthPrepass) {
+            mainBuilder.read(mainDepth, Access::DEPTH_TEST);
+        } else {
+            mainBuilder.write(mainDepth, Access::DEPTH_ATTACHMENT);
+        }
+        if (shadowAtlas != LveRenderGraph::INVALID) {
+            mainBuilder.read(shadowAtlas, Access::SAMPLED);
+        }
+        mainPass = mainBuilder.getPass();
+
+        // Occlusion culling against what was just drawn, then draw what it found on top
+        if (gpuDrivenRenderSystem) {
+            renderGraph.addPass("occlusion", [this, gpuDrivenRenderSystem](FrameInfo &frameInfo) {
+                gpuDrivenRenderSystem->cullOccludedObjects(frameInfo, lveRenderer.getCurrentDepthImageView());
+            }).read(swapChainDepth, Access::SAMPLED).sideEffects();
+
+            renderGraph.addPass("main_late", [gpuDrivenRenderSystem](FrameInfo &frameInfo) {
+                gpuDrivenRenderSystem->render(frameInfo);
+            }).write(swapChainColor, Access::COLOR_ATTACHMENT).write(swapChainDepth, Access::DEPTH_ATTACHMENT);
+        }
+
+        // Stretches the part that was drawn over the whole swap chain image, filtered
+        if (dynamicResolutionActive) {
+            renderGraph.addPass("upscale", [this, extent](FrameInfo &frameInfo) {
+                VkExtent2D renderExtent = dynamicResolution.getRenderExtent(extent);
+                VkImageBlit blit{};
+                blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                blit.srcOffsets[1] = {static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1};
+                blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                blit.dstOffsets[1] = {static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1};
+                vkCmdBlitImage(frameInfo.commandBuffer,
+                               renderGraph.getImage(sceneColor), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               lveRenderer.getCurrentImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               1, &blit, VK_FILTER_LINEAR);
+            }).read(sceneColor, Access::TRANSFER_SRC).write(swapChainColor, Access::TRANSFER_DST);
+        }
+
+        // Copies the finished frame out before it is presented
+        if (frameReadback.isEnabled() && lveRenderer.isReadbackSupported()) {
+            VkFormat format = color.format;
+            renderGraph.addPass("readback", [this, format, extent](FrameInfo &frameInfo) {
+                // Tagged with the newest client update it shows
+                uint64_t tag = renderServer ? renderServer->getPollNumber() : 0;
+                frameReadback.recordCopy(frameInfo.commandBuffer, frameInfo.frameIndex, lveRenderer.getCurrentImage(), format, extent, tag);
+            }).read(swapChainColor, Access::TRANSFER_SRC).sideEffects();
+        }
+
+        renderGraph.markOutput(swapChainColor); // presented
+        renderGraph.compile();
+        // A new graph made a new atlas
+        if (shadowAtlas != LveRenderGraph::INVALID) {
+            shadowMaps.setAtlasView(renderGraph.getImageView(shadowAtlas));
+        }
+        // Its render pass only exists now, it has no color attachment so the swap chain's won't do
+        if (useDepthPrepass) {
+            simpleRenderSystem.createDepthPrepassPipeline(renderGraph.getRenderPass(depthPrepass));
+        }
+    }
+
+    void FirstApp::updateLights(float seconds) {
+        lights.resize(lightCount);
+        // Every light gets its own orbit around the scene from a hash of its index, so the same count always looks the same
+        auto hash = [](uint32_t value) {
+            value ^= value >> 16;
+            value *= 0x7feb352du;
+            value ^= value >> 15;
+            value *= 0x846ca68bu;
+            value ^= value >> 16;
+            return static_cast<float>(value) / static_cast<float>(UINT32_MAX);
+        };
+        // Spread thinner and dimmer the more there are, so the scene's brightness stays about the same
+        float spread = 1.f + glm::sqrt(static_cast<float>(lightCount)) / 16.f;
+        float intensity = glm::min(1.f, 8.f / glm::sqrt(static_cast<float>(lightCount)));
+        jobSystem.parallelFor(lightCount, 256, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                float orbitRadius = (.5f + hash(4 * i) * 1.5f) * spread;
+                float speed = (hash(4 * i + 1) - .5f) * 2.f; // radians per second, either way round
+                float height = (hash(4 * i + 2) - .5f) * 2.f * spread;
+                float phase = hash(4 * i + 3) * glm::two_pi<float>();
+                float angle = phase + speed * seconds;
+                auto &light = lights[i];
+                light.positionRadius = {orbitRadius * glm::cos(angle), height, 2.5f + orbitRadius * glm::sin(angle), 1.5f};
+                light.color = {.5f + .5f * glm::cos(phase), .5f + .5f * glm::cos(phase + 2.1f), .5f + .5f * glm::cos(phase + 4.2f), intensity};
+            }
+        });
+    }
+
+    void FirstApp::setupShadowLights() {
+        // Low and from the side, y points down
+        LveShadowMaps::DirectionalLight sun{};
+        sun.direction = {.4f, 1.f, .3f};
+        sun.color = {1.f, .95f, .85f};
+        sun.intensity = .8f;
+        shadowMaps.setDirectionalLight(sun);
+
+        // A spot light looking down at the cube and a point light beside it
+        LveShadowMaps::LocalLight spot{};
+        spot.type = LveShadowMaps::LocalLightType::SPOT;
+        spot.position = {1.2f, -1.2f, 1.8f};
+        spot.direction = glm::vec3{0.f, .7f, 2.5f} - spot.position;
+        spot.innerAngle = glm::radians(15.f);
+        spot.outerAngle = glm::radians(25.f);
+        spot.radius = 5.f;
+        spot.color = {1.f, .8f, .6f};
+        spot.intensity = 6.f;
+        LveShadowMaps::LocalLight point{};
+        point.type = LveShadowMaps::LocalLightType::POINT;
+        point.position = {-.9f, .1f, 2.f};
+        point.radius = 3.f;
+        point.color = {.5f, .7f, 1.f};
+        point.intensity = 3.f;
+        shadowMaps.setLocalLights({spot, point});
+    }
+
+    LveDynamicResolution::Settings FirstApp::dynamicResolutionSettings() const {
+        LveDynamicResolution::Settings settings{};
+        settings.frameBudgetMs = GPU_FRAME_BUDGET_MS;
+        settings.minScale = MIN_RESOLUTION_SCALE;
+        return settings;
+    }
+
+    LveAssetRegistry::model_t FirstApp::createCubeModel(LveAssetRegistry& assetRegistry, glm::vec3 offset) {
         std::vector<LveModel::Vertex> vertices{
         
             // left face (white)
@@ -96,16 +528,59 @@ namespace lve {
         for (auto& v : vertices) {
             v.position += offset;
         }
-        return std::make_unique<LveModel>(device, vertices);
+        // Deduplicated by content, so asking for the same cube twice uploads it once
+        return assetRegistry.loadModel(vertices);
+    }
+
+    // The camera sits at the origin looking down +z with a 50 degree field of view and sees up to 10
+    // A wall at 4 covers all of it, so every cube behind it is in the frustum but hidden
+    void FirstApp::addOccludedObjects() {
+        constexpr int GRID_SIZE = 32;
+        constexpr int GRID_LAYERS = 8;
+        uint32_t wall = registry.indexOf(registry.create());
+        registry.setModel(wall, cubeModel);
+        registry.setTranslation(wall, {0.f, 0.f, 4.f});
+        registry.setScale(wall, {10.f, 10.f, .1f});
+        registry.setStatic(wall, true);
+        for (int layer = 0; layer < GRID_LAYERS; layer++) {
+            for (int y = 0; y < GRID_SIZE; y++) {
+                for (int x = 0; x < GRID_SIZE; x++) {
+                    uint32_t index = registry.indexOf(registry.create());
+                    registry.setModel(index, cubeModel);
+                    registry.setTranslation(index, {(x - GRID_SIZE / 2) * .2f, (y - GRID_SIZE / 2) * .2f, 5.f + layer * .5f});
+                    registry.setScale(index, {.1f, .1f, .1f});
+                    registry.setColor(index, {.2f, .4f, .8f});
+                    registry.setStatic(index, true);
+                }
+            }
+        }
     }
 
     void FirstApp::loadGameObjects(){
-        std::shared_ptr<LveModel> lveModel = createCubeModel(lveDevice, {0.f, 0.f, 0.f});
+        cubeModel = createCubeModel(assets, {0.f, 0.f, 0.f});
 
-        auto cube = LveGameObject::createGameObject();
-        cube.model = lveModel;
-        cube.transform.translation = {.0f, .0f, .5f}; // z goes from 0 to 1
-        cube.transform.scale = {.5f, .5f, .5f};
-        gameObjects.push_back(std::move(cube)); // moves the ownership of the object
+        auto cube = registry.create();
+        uint32_t index = registry.indexOf(cube);
+        registry.setModel(index, cubeModel);
+        registry.setTranslation(index, {.0f, .0f, 2.5f}); // in front of the camera
+        registry.setScale(index, {.5f, .5f, .5f});
+        // Spins about y and x, radians per second
+        simulation.addSpinningObject(cube, registry.getTransform(index), {.3f, .6f, 0.f});
+
+        // Scenery that never moves, its shadows are drawn once and then come from the cache
+        auto addScenery = [&](glm::vec3 translation, glm::vec3 scale) {
+            uint32_t sceneryIndex = registry.indexOf(registry.create());
+            registry.setModel(sceneryIndex, cubeModel);
+            registry.setTranslation(sceneryIndex, translation);
+            registry.setScale(sceneryIndex, scale);
+            registry.setColor(sceneryIndex, {.7f, .7f, .7f});
+            registry.setStatic(sceneryIndex, true);
+        };
+        addScenery({0.f, .75f, 3.f}, {4.f, .05f, 4.f}); // floor below the cube
+        for (float x : {-1.f, 1.f}) {
+            for (float z : {2.f, 3.5f}) {
+                addScenery({x, .35f, z}, {.15f, .8f, .15f}); // pillars standing on it
+            }
+        }
     }
 }
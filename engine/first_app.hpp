@@ -1,37 +1,143 @@
 #pragma once
 
 #include "lve_window.hpp"
+#include "lve_asset_registry.hpp"
+#include "lve_bindless_heap.hpp"
+#include "lve_clustered_lights.hpp"
+#include "lve_descriptors.hpp"
 #include "lve_device.hpp"
-#include "lve_game_object.hpp"
+#include "lve_dynamic_resolution.hpp"
+#include "lve_frame_benchmark.hpp"
+#include "lve_frame_readback.hpp"
+#include "lve_frame_ring_buffer.hpp"
+#include "lve_registry.hpp"
+#include "lve_render_server.hpp"
+#include "lve_render_graph.hpp"
 #include "lve_renderer.hpp"
+#include "lve_shadow_maps.hpp"
+#include "lve_shared_frame_ring.hpp"
+#include "lve_camera.hpp"
+#include "lve_geometry_arena.hpp"
+#include "lve_gpu_timer.hpp"
+#include "lve_job_system.hpp"
+#include "lve_pipeline_statistics.hpp"
+#include "lve_profiler.hpp"
+#include "lve_simulation.hpp"
 
 //std
 #include <memory>
 #include <vector>
 
 namespace lve {
+    class SimpleRenderSystem;
+    class GpuDrivenRenderSystem;
+
     class FirstApp {
         public:
             // Learning: constexpr is evaluated at compile time when possible
             static constexpr int WIDTH = 800;
             static constexpr int HEIGHT = 600;
+            // Size of the shared geometry arena every model is loaded into
+            static constexpr uint32_t MAX_GEOMETRY_VERTICES = 1 << 20;
+            static constexpr uint32_t MAX_GEOMETRY_INDICES = 1 << 22;
+            // Starting size of each frame's region of the frame ring buffer, it grows if a frame overflows it
+            static constexpr VkDeviceSize FRAME_RING_REGION_SIZE = 4 << 20;
+            // Cull and build draws on the GPU instead of the CPU, pays off with very large scenes
+            static constexpr bool USE_GPU_DRIVEN_RENDERING = false;
+            // Reads every rendered frame back to the CPU and writes every CAPTURE_INTERVAL-th one to a file
+            static constexpr bool CAPTURE_FRAMES = false;
+            static constexpr uint32_t CAPTURE_INTERVAL = 60;
+            // Lowers the resolution the scene is drawn at while the GPU takes longer than GPU_FRAME_BUDGET_MS,
+            // then upscales it to the window. Not with GPU driven rendering, its occlusion culling needs full size depth
+            static constexpr bool USE_DYNAMIC_RESOLUTION = false;
+            static constexpr float GPU_FRAME_BUDGET_MS = 1000.f / 60.f;
+            static constexpr float MIN_RESOLUTION_SCALE = .5f;
+            // Draws depth first from positions only, then shades only what ends up visible, pays off with heavy overdraw
+            // The GPU driven path has its own two phase depth, it ignores this
+            static constexpr bool USE_DEPTH_PREPASS = false;
+            // Point lights orbiting the scene, binned into clusters every frame
+            static constexpr uint32_t LIGHT_COUNT = 64;
+            // Frames the benchmarks let each mode settle before they measure
+            static constexpr uint32_t BENCHMARK_WARMUP_FRAMES = 30;
 
-            FirstApp();
+            // With the server enabled there is no window or surface, frames are drawn into offscreen images,
+            // the scene comes from clients of the render server and every frame is read back into a shared memory ring
+            // headless draws offscreen without a server too, eg. to benchmark reading frames back
+            explicit FirstApp(const LveRenderServer::Options &serverOptions = {}, bool headless = false);
             ~FirstApp();
 
             // Delete copy functions because using vulkan calls to make sure we don't have dangling pointers
             FirstApp(const FirstApp &) = delete;
             FirstApp &operator=(const FirstApp &) = delete;
+            // Call before run: renders framesPerMode frames without and then with the depth pre pass,
+            // prints the fragment shader invocations and GPU time of both and stops
+            void benchmarkDepthPrepass(uint32_t framesPerMode);
+            // Same with 64, 1024 and 10240 lights
+            void benchmarkLights(uint32_t framesPerMode);
+            // Switches to GPU driven rendering, hides a grid of cubes behind a wall and renders it with and
+            // without Hi-Z occlusion culling, printing the GPU time and the visible and occluded objects of both
+            void benchmarkOcclusionCulling(uint32_t framesPerMode);
+            // Headless only: renders at 1920x1080 and 3840x2160, each without and with reading every frame
+            // back into a sink that does nothing, printing the GPU and wall time per frame and the MB/s read back
+            void benchmarkReadback(uint32_t framesPerMode);
             void run();
         private:
             void loadGameObjects();
-            std::unique_ptr<LveModel> createCubeModel(LveDevice& device, glm::vec3 offset);
+            // The sun and the spot and point lights that cast shadows
+            void setupShadowLights();
+            // The occlusion benchmark's wall and the cubes hidden behind it
+            void addOccludedObjects();
+            // Declares the frame's passes against the current swap chain, again whenever it is recreated
+            void buildRenderGraph(SimpleRenderSystem &simpleRenderSystem, GpuDrivenRenderSystem *gpuDrivenRenderSystem);
+            // Moves every light along its orbit, seconds since run started
+            void updateLights(float seconds);
+            LveDynamicResolution::Settings dynamicResolutionSettings() const;
+            LveAssetRegistry::model_t createCubeModel(LveAssetRegistry& assetRegistry, glm::vec3 offset);
 
             // Learning constructed here, that means that object will construct and deconstruct with the app
+            LveRenderServer::Options serverOptions; // first, the window depends on it (headless for the server)
             LveWindow lveWindow{WIDTH, HEIGHT, "Hello Vulkan!"};
             LveDevice lveDevice{lveWindow};
             LveRenderer lveRenderer{lveWindow, lveDevice};
+            LveFrameRingBuffer frameRing{lveDevice, FRAME_RING_REGION_SIZE};
+            LveDescriptorLayoutCache descriptorLayoutCache{lveDevice}; // outlives the render systems created in run
+            LveBindlessHeap bindlessHeap{lveDevice, descriptorLayoutCache};
+            LveClusteredLights clusteredLights{lveDevice, descriptorLayoutCache};
+            LveShadowMaps shadowMaps{lveDevice, descriptorLayoutCache};
+            LveRenderGraph renderGraph{lveDevice};
+            LveFrameReadback frameReadback{lveDevice};
+            std::unique_ptr<LveRenderServer> renderServer; // server mode only
+            std::unique_ptr<LveSharedFrameWriter> frameWriter; // made with the first frame, remade when frames outgrow it
+            // The swap chain images the graph draws into, bound every frame
+            LveRenderGraph::resource_t swapChainColor = LveRenderGraph::INVALID;
+            LveRenderGraph::resource_t swapChainDepth = LveRenderGraph::INVALID;
+            uint32_t renderGraphGeneration = 0; // swap chain generation the graph was built for
+            // Times every frame's graph on the GPU, which drives the resolution scale
+            LveGpuTimer gpuTimer{lveDevice};
+            LveDynamicResolution dynamicResolution{dynamicResolutionSettings()};
+            bool dynamicResolutionActive = false; // the graph draws into scene_color and upscales it
+            LvePipelineStatistics pipelineStatistics{lveDevice}; // fragment shader invocations per frame
+            bool depthPrepassEnabled = USE_DEPTH_PREPASS;
+            bool renderGraphDepthPrepass = false; // whether the graph was built with the pre pass
+            bool renderGraphReadback = false; // and with the readback pass
+            LveRenderGraph::pass_t depthPrepass = LveRenderGraph::INVALID;
+            LveRenderGraph::pass_t mainPass = LveRenderGraph::INVALID;
+            LveRenderGraph::resource_t sceneColor = LveRenderGraph::INVALID;
+            LveRenderGraph::resource_t shadowAtlas = LveRenderGraph::INVALID; // the frame's, cached tiles plus dynamic casters
+            // Declared before the game objects so the models are freed before the arena
+            LveGeometryArena geometryArena{lveDevice, LveModel::getVertexStrides(), MAX_GEOMETRY_VERTICES, MAX_GEOMETRY_INDICES};
+            LveAssetRegistry assets{geometryArena}; // owns every model, objects refer to them by handle
+            LveAssetRegistry::model_t cubeModel = LveAssetRegistry::INVALID_MODEL; // the app's reference to it
+            LveJobSystem jobSystem{};
+            LveProfiler profiler{};
             std::vector<LveModel::Vertex> vertices;
-            std::vector<LveGameObject> gameObjects;
+            LveRegistry registry{&assets}; // every game object's components, stored as arrays
+            LveSimulation simulation{}; // animates objects at a fixed rate, independent of the frame rate
+            LveCamera camera{};
+            uint32_t lightCount = LIGHT_COUNT;
+            std::vector<LveClusteredLights::PointLight> lights; // this frame's, lightCount of them
+            std::unique_ptr<LveFrameBenchmark> benchmark; // set by the benchmark functions
+            bool gpuDrivenRendering = USE_GPU_DRIVEN_RENDERING; // the occlusion benchmark turns it on
+            bool occlusionCullingEnabled = true; // GPU driven rendering only
     };
 }
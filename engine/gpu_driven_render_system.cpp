@@ -0,0 +1,453 @@
+#include "gpu_driven_render_system.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+namespace lve {
+
+    // Binding numbers shared with gpu_cull.comp, gpu_compact_draws.comp and gpu_driven_shader.vert
+    static constexpr uint32_t OBJECT_BINDING = 0;
+    static constexpr uint32_t MODEL_COMMAND_BINDING = 1;
+    static constexpr uint32_t VISIBLE_BINDING = 2;
+    static constexpr uint32_t STATS_BINDING = 3;
+    static constexpr uint32_t DRAW_COMMAND_BINDING = 4;
+    static constexpr uint32_t CAMERA_BINDING = 5;
+    static constexpr uint32_t VISIBILITY_BINDING = 6;
+    static constexpr uint32_t DEPTH_PYRAMID_BINDING = 7;
+    static constexpr uint32_t BUFFER_BINDING_COUNT = 7; // every binding before the pyramid is a storage buffer
+
+    // Phases of gpu_cull.comp
+    static constexpr uint32_t PHASE_PREVIOUSLY_VISIBLE = 0;
+    static constexpr uint32_t PHASE_OCCLUSION = 1;
+    static constexpr uint32_t PHASE_FRUSTUM_ONLY = 2; // phase 2 with occlusion culling off
+
+    static constexpr uint32_t WORKGROUP_SIZE = 64; // local_size_x of both compute shaders
+    static constexpr uint32_t MIN_OBJECT_CAPACITY = 1024;
+    static constexpr uint32_t MIN_MODEL_CAPACITY = 64;
+    // drawCount, visibleCount, culledCount, occludedCount, totalDrawCount
+    static constexpr uint32_t STATS_SIZE = sizeof(uint32_t) * 5;
+    static constexpr VkShaderStageFlags PUSH_STAGES = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+
+    GpuDrivenRenderSystem::GpuDrivenRenderSystem(LveDevice &device, VkRenderPass renderPass, LveDescriptorLayoutCache &layoutCache)
+        : lveDevice{device}, hiZPyramid{device, layoutCache} {
+        // Without drawIndirectFirstInstance every command has to start at instance 0,
+        // so the start of each model's run is pushed before each draw instead
+        auto &features = lveDevice.getEnabledFeatures();
+        if (!features.drawIndirectFirstInstance) {
+            drawPath = DrawPath::SINGLE_DRAW_INDIRECT;
+        } else if (lveDevice.isDrawIndirectCountSupported()) {
+            drawPath = DrawPath::INDIRECT_COUNT;
+        } else if (features.multiDrawIndirect) {
+            drawPath = DrawPath::MULTI_DRAW_INDIRECT;
+        } else {
+            drawPath = DrawPath::SINGLE_DRAW_INDIRECT;
+        }
+
+        createPipelineLayout(layoutCache);
+        createPipelines(renderPass);
+    }
+
+    GpuDrivenRenderSystem::~GpuDrivenRenderSystem() {}
+
+    // The compute passes and the graphics pipeline share a single layout,
+    // so the descriptor set and push constants stay bound between them
+    void GpuDrivenRenderSystem::createPipelineLayout(LveDescriptorLayoutCache &layoutCache) {
+        // The buffers are visible to the culling passes and the vertex shader, the pyramid only to culling
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        for (uint32_t i = 0; i < BUFFER_BINDING_COUNT; i++) {
+            bindings.push_back(LveDescriptorLayoutCache::binding(
+                i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT));
+        }
+        bindings.push_back(LveDescriptorLayoutCache::binding(
+            DEPTH_PYRAMID_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT));
+        descriptorSetLayout = layoutCache.getSetLayout(std::move(bindings));
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = PUSH_STAGES;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(PushConstantData);
+        pipelineLayout = layoutCache.getPipelineLayout({descriptorSetLayout}, {pushConstantRange});
+    }
+
+    void GpuDrivenRenderSystem::createPipelines(VkRenderPass renderPass) {
+        assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+        PipelineConfigInfo pipelineConfig{};
+        LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+        pipelineConfig.renderPass = renderPass;
+        pipelineConfig.pipelineLayout = pipelineLayout;
+        lvePipeline = std::make_unique<LvePipeline>(
+            lveDevice,
+            "shaders/gpu_driven_shader.vert.spv",
+            "shaders/simple_shader.frag.spv",
+            pipelineConfig
+        );
+
+        cullPipeline = std::make_unique<LveComputePipeline>(lveDevice, "shaders/gpu_cull.comp.spv", pipelineLayout);
+        if (drawPath == DrawPath::INDIRECT_COUNT) {
+            compactPipeline = std::make_unique<LveComputePipeline>(lveDevice, "shaders/gpu_compact_draws.comp.spv", pipelineLayout);
+        }
+    }
+
+    void GpuDrivenRenderSystem::ensureCapacity(FrameResources &frame, uint32_t objectCount, uint32_t modelCount) {
+        if (frame.statsBuffer == nullptr) {
+            // Also the count buffer of vkCmdDrawIndexedIndirectCount, drawCount is its first member
+            frame.statsBuffer = std::make_unique<LveBuffer>(
+                lveDevice,
+                STATS_SIZE,
+                1,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            frame.statsReadbackBuffer = std::make_unique<LveBuffer>(
+                lveDevice,
+                STATS_SIZE,
+                1,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            frame.statsReadbackBuffer->map();
+            frame.cameraBuffer = std::make_unique<LveBuffer>(
+                lveDevice,
+                sizeof(CameraData),
+                1,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            frame.cameraBuffer->map();
+        }
+
+        if (objectCount <= frame.objectCapacity && modelCount <= frame.modelCapacity) {
+            return;
+        }
+        frame.uploadedEntities.clear(); // the new object buffer holds nothing yet
+
+        // Grow in powers of 2 so a slowly growing scene doesn't recreate buffers every frame
+        uint32_t objectCapacity = std::max(frame.objectCapacity, MIN_OBJECT_CAPACITY);
+        while (objectCapacity < objectCount) {
+            objectCapacity *= 2;
+        }
+        uint32_t modelCapacity = std::max(frame.modelCapacity, MIN_MODEL_CAPACITY);
+        while (modelCapacity < modelCount) {
+            modelCapacity *= 2;
+        }
+
+        // The fence of this frame slot has been waited on in beginFrame, nothing on the GPU uses these anymore
+        frame.objectBuffer = std::make_unique<LveBuffer>(
+            lveDevice,
+            sizeof(ObjectData),
+            objectCapacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        frame.objectBuffer->map();
+        frame.visibleBuffer = std::make_unique<LveBuffer>(
+            lveDevice,
+            sizeof(uint32_t),
+            objectCapacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        // Starts out cleared, so the first frame draws everything in phase 2
+        frame.visibilityBuffer = std::make_unique<LveBuffer>(
+            lveDevice,
+            sizeof(uint32_t),
+            objectCapacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.visibilityCleared = false;
+
+        frame.commandTemplateBuffer = std::make_unique<LveBuffer>(
+            lveDevice,
+            sizeof(VkDrawIndexedIndirectCommand),
+            modelCapacity,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        frame.commandTemplateBuffer->map();
+        frame.modelCommandBuffer = std::make_unique<LveBuffer>(
+            lveDevice,
+            sizeof(VkDrawIndexedIndirectCommand),
+            modelCapacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.drawCommandBuffer = std::make_unique<LveBuffer>(
+            lveDevice,
+            sizeof(VkDrawIndexedIndirectCommand),
+            modelCapacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        frame.objectCapacity = objectCapacity;
+        frame.modelCapacity = modelCapacity;
+    }
+
+    // The previous frame's set went back to the pool with the rest of this slot's allocator,
+    // so the set always points at the current buffers and pyramid without tracking when they change
+    void GpuDrivenRenderSystem::buildDescriptorSet(FrameInfo &frameInfo, FrameResources &frame) {
+        descriptorWriter.clear()
+            .writeBuffer(OBJECT_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.objectBuffer->descriptorInfo())
+            .writeBuffer(MODEL_COMMAND_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.modelCommandBuffer->descriptorInfo())
+            .writeBuffer(VISIBLE_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.visibleBuffer->descriptorInfo())
+            .writeBuffer(STATS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.statsBuffer->descriptorInfo())
+            .writeBuffer(DRAW_COMMAND_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.drawCommandBuffer->descriptorInfo())
+            .writeBuffer(CAMERA_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.cameraBuffer->descriptorInfo())
+            .writeBuffer(VISIBILITY_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.visibilityBuffer->descriptorInfo())
+            .writeImage(DEPTH_PYRAMID_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, hiZPyramid.descriptorInfo(frameInfo.frameIndex));
+        frame.descriptorSet = descriptorWriter.build(frameInfo.descriptorAllocator, descriptorSetLayout);
+    }
+
+    void GpuDrivenRenderSystem::readBackStats(FrameResources &frame) {
+        // Only called once this frame slot's fence has signaled, so the copy has landed
+        if (!frame.statsPending) {
+            return;
+        }
+        auto *stats = static_cast<const uint32_t *>(frame.statsReadbackBuffer->getMappedMemory());
+        cullingStats.visibleCount = stats[1];
+        cullingStats.culledCount = stats[2];
+        cullingStats.occludedCount = stats[3];
+        cullingStats.drawCount = stats[4]; // non empty commands of both phases, drawCount itself only holds the last phase's
+        frame.statsPending = false;
+    }
+
+    void GpuDrivenRenderSystem::cullGameObjects(FrameInfo &frameInfo, LveRegistry &registry, VkExtent2D depthExtent) {
+        auto &frame = frames[frameInfo.frameIndex];
+        readBackStats(frame);
+        frameInfo.profiler.setCounter("gpu_cull.draws", cullingStats.drawCount);
+        frameInfo.profiler.setCounter("gpu_cull.visible", cullingStats.visibleCount);
+        frameInfo.profiler.setCounter("gpu_cull.culled", cullingStats.culledCount);
+        frameInfo.profiler.setCounter("gpu_cull.occluded", cullingStats.occludedCount);
+
+        // Give every model a draw command, and count its objects to find where its run of instances starts
+        modelLookup.clear();
+        frameModels.clear();
+        modelObjectCounts.clear();
+        auto &models = registry.getModels();
+        for (auto model : models) {
+            auto result = modelLookup.emplace(model, static_cast<uint32_t>(frameModels.size()));
+            if (result.second) {
+                LveModel *resolved = &frameInfo.assets.getModel(model);
+                assert((frameModels.empty() || &frameModels[0]->getArena() == &resolved->getArena()) &&
+                       "GPU driven models must share a geometry arena");
+                frameModels.push_back(resolved);
+                modelObjectCounts.push_back(0);
+            }
+            modelObjectCounts[result.first->second]++;
+        }
+
+        frameInstanceBases.resize(frameModels.size());
+        uint32_t instanceBase = 0;
+        for (size_t i = 0; i < frameModels.size(); i++) {
+            frameInstanceBases[i] = instanceBase;
+            instanceBase += modelObjectCounts[i];
+        }
+
+        frameObjectCount = registry.size();
+        if (frameObjectCount == 0) {
+            return;
+        }
+        uint32_t modelCount = static_cast<uint32_t>(frameModels.size());
+        ensureCapacity(frame, frameObjectCount, modelCount);
+
+        // Upload transforms and bounds, the GPU decides what is visible
+        // Objects that haven't changed since this frame slot last wrote them only get their draw slot refreshed,
+        // that moves whenever the set of models does
+        auto *objects = static_cast<ObjectData *>(frame.objectBuffer->getMappedMemory());
+        registry.updateMatrices(&frameInfo.jobSystem);
+        auto &matrices = registry.getMatrices();
+        auto &entities = registry.getEntities();
+        frame.uploadedEntities.resize(frameObjectCount, LveRegistry::INVALID_ENTITY);
+        uint32_t uploadCount = 0;
+        for (uint32_t i = 0; i < frameObjectCount; i++) {
+            uint32_t drawIndex = modelLookup[models[i]];
+            ObjectData &object = objects[i];
+            if (frame.uploadedEntities[i] != entities[i] || registry.hasChangedSince(i, frame.uploadedVersion)) {
+                object.transform = matrices[i];
+                object.color = glm::vec4{registry.getColors()[i], 1.f};
+                object.boundingSphere = frameModels[drawIndex]->getBoundingSphere();
+                frame.uploadedEntities[i] = entities[i];
+                uploadCount++;
+            }
+            object.drawIndex = drawIndex;
+            object.instanceBase = frameInstanceBases[drawIndex];
+        }
+        frame.uploadedVersion = registry.getVersion();
+        frameInfo.profiler.setCounter("gpu_cull.object_uploads", uploadCount);
+
+        // Draw commands start with no instances, culling counts them up
+        auto *templates = static_cast<VkDrawIndexedIndirectCommand *>(frame.commandTemplateBuffer->getMappedMemory());
+        for (uint32_t i = 0; i < modelCount; i++) {
+            auto &allocation = frameModels[i]->getAllocation();
+            templates[i].indexCount = allocation.indexCount;
+            templates[i].instanceCount = 0;
+            templates[i].firstIndex = allocation.firstIndex;
+            templates[i].vertexOffset = allocation.vertexOffset;
+            templates[i].firstInstance = drawPath == DrawPath::SINGLE_DRAW_INDIRECT ? 0 : frameInstanceBases[i];
+        }
+
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        // Phase 1 doesn't sample the pyramid, but the shader is the same so the binding has to be valid
+        hiZPyramid.prepare(commandBuffer, frameInfo.frameIndex, depthExtent);
+        buildDescriptorSet(frameInfo, frame);
+        if (!frame.visibilityCleared) {
+            vkCmdFillBuffer(commandBuffer, frame.visibilityBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+            frame.visibilityCleared = true;
+        }
+        resetDrawCommands(commandBuffer, frame, true);
+
+        // This frame slot's fence has been waited on, so the GPU is done with the old camera
+        // Both phases cull with it
+        CameraData camera{};
+        camera.projectionView = frameInfo.camera.getProjectionView();
+        LveFrustum frustum = LveFrustum::fromMatrix(camera.projectionView);
+        for (uint32_t i = 0; i < LveFrustum::PLANE_COUNT; i++) {
+            camera.frustumPlanes[i] = frustum.planes[i];
+        }
+        frame.cameraBuffer->writeToBuffer(&camera);
+
+        recordCullPass(frameInfo, frame, PHASE_PREVIOUSLY_VISIBLE);
+    }
+
+    void GpuDrivenRenderSystem::cullOccludedObjects(FrameInfo &frameInfo, VkImageView depthView) {
+        if (frameObjectCount == 0) {
+            return;
+        }
+        auto &frame = frames[frameInfo.frameIndex];
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+        // Phase 1's draws have to be done with the commands and visible list before phase 2 refills them
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        if (occlusionCullingEnabled) {
+            hiZPyramid.build(frameInfo.recorder, frameInfo.descriptorAllocator, frameInfo.frameIndex, depthView);
+        }
+        resetDrawCommands(commandBuffer, frame, false);
+        recordCullPass(frameInfo, frame, occlusionCullingEnabled ? PHASE_OCCLUSION : PHASE_FRUSTUM_ONLY);
+
+        // Read back asynchronously, picked up the next time this frame slot comes around
+        VkBufferCopy statsCopy{};
+        statsCopy.size = STATS_SIZE;
+        vkCmdCopyBuffer(commandBuffer, frame.statsBuffer->getBuffer(), frame.statsReadbackBuffer->getBuffer(), 1, &statsCopy);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_HOST_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+        frame.statsPending = true;
+    }
+
+    // Draw commands go back to no instances, culling counts them up again
+    // The stats are only cleared once a frame, drawCount is cleared for each phase since it is the draw count buffer
+    void GpuDrivenRenderSystem::resetDrawCommands(VkCommandBuffer commandBuffer, FrameResources &frame, bool resetStats) {
+        uint32_t modelCount = static_cast<uint32_t>(frameModels.size());
+        VkBufferCopy commandCopy{};
+        commandCopy.size = sizeof(VkDrawIndexedIndirectCommand) * modelCount;
+        vkCmdCopyBuffer(commandBuffer, frame.commandTemplateBuffer->getBuffer(), frame.modelCommandBuffer->getBuffer(), 1, &commandCopy);
+        vkCmdFillBuffer(commandBuffer, frame.statsBuffer->getBuffer(), 0, resetStats ? STATS_SIZE : sizeof(uint32_t), 0);
+
+        // Resets have to land before the compute shaders start counting,
+        // and the visibility the last phase 2 of this frame slot wrote has to be visible to phase 1
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    void GpuDrivenRenderSystem::recordCullPass(FrameInfo &frameInfo, FrameResources &frame, uint32_t phase) {
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        uint32_t modelCount = static_cast<uint32_t>(frameModels.size());
+        VkExtent2D pyramidExtent = hiZPyramid.getExtent(frameInfo.frameIndex);
+
+        PushConstantData push{};
+        push.objectCount = frameObjectCount;
+        push.modelCount = modelCount;
+        push.instanceBase = 0;
+        push.phase = phase;
+        push.pyramidWidth = pyramidExtent.width;
+        push.pyramidHeight = pyramidExtent.height;
+
+        auto &recorder = frameInfo.recorder;
+        recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &frame.descriptorSet);
+        recorder.pushConstants(pipelineLayout, PUSH_STAGES, 0, sizeof(PushConstantData), &push);
+
+        cullPipeline->bind(recorder);
+        vkCmdDispatch(commandBuffer, (frameObjectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        if (drawPath == DrawPath::INDIRECT_COUNT) {
+            // Instance counts are final once culling is done, then the non empty commands get packed
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+            compactPipeline->bind(recorder);
+            vkCmdDispatch(commandBuffer, (modelCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+        }
+
+        // The draw commands, visible list and stats are consumed by the indirect draw,
+        // the vertex shader and the stats copy, the visibility list by the next phase
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    void GpuDrivenRenderSystem::render(FrameInfo &frameInfo) {
+        if (frameObjectCount == 0) {
+            return;
+        }
+        auto &frame = frames[frameInfo.frameIndex];
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        auto &recorder = frameInfo.recorder;
+        uint32_t modelCount = static_cast<uint32_t>(frameModels.size());
+        uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+        lvePipeline->bind(recorder);
+        recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frame.descriptorSet);
+        frameModels[0]->getArena().bind(recorder);
+
+        // gl_InstanceIndex already carries the run offset unless the per model fallback pushes it
+        // The culling push already zeroed it, so the recorder drops this one
+        uint32_t noInstanceBase = 0;
+        recorder.pushConstants(pipelineLayout, PUSH_STAGES,
+                               offsetof(PushConstantData, instanceBase), sizeof(uint32_t), &noInstanceBase);
+
+        switch (drawPath) {
+            case DrawPath::INDIRECT_COUNT:
+                // Only the commands that survived compaction are drawn, the count comes from the GPU
+                lveDevice.cmdDrawIndexedIndirectCount(commandBuffer,
+                                                      frame.drawCommandBuffer->getBuffer(), 0,
+                                                      frame.statsBuffer->getBuffer(), 0,
+                                                      modelCount, stride);
+                break;
+            case DrawPath::MULTI_DRAW_INDIRECT:
+                vkCmdDrawIndexedIndirect(commandBuffer, frame.modelCommandBuffer->getBuffer(), 0, modelCount, stride);
+                break;
+            case DrawPath::SINGLE_DRAW_INDIRECT:
+                for (uint32_t i = 0; i < modelCount; i++) {
+                    recorder.pushConstants(pipelineLayout, PUSH_STAGES,
+                                           offsetof(PushConstantData, instanceBase), sizeof(uint32_t), &frameInstanceBases[i]);
+                    vkCmdDrawIndexedIndirect(commandBuffer, frame.modelCommandBuffer->getBuffer(), stride * i, 1, stride);
+                }
+                break;
+        }
+    }
+}
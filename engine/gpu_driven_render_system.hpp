@@ -0,0 +1,157 @@
+#pragma once
+
+#include "lve_pipeline.hpp"
+#include "lve_compute_pipeline.hpp"
+#include "lve_device.hpp"
+#include "lve_registry.hpp"
+#include "lve_buffer.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_frustum.hpp"
+#include "lve_hiz_pyramid.hpp"
+#include "lve_swap_chain.hpp"
+
+//std
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+    // Render path for very large scenes
+    // Object transforms and bounds are uploaded to storage buffers, a compute pass culls them
+    // against the frustum and fills the indirect draw commands, so the CPU never touches
+    // individual draws
+    //
+    // Hidden objects are skipped with two phase occlusion culling:
+    // 1. objects that were visible the last time around are drawn, they are most likely still visible
+    // 2. their depth is reduced into a Hi-Z pyramid, every object is tested against it, and the ones
+    //    that turn out visible but weren't drawn in phase 1 are drawn on top. What passed this test
+    //    is what phase 1 draws next time
+    // Something that comes out from behind an occluder is caught by phase 2 in the same frame, so it never pops in late
+    //
+    // Per frame: cullGameObjects, render in the render pass, end it, cullOccludedObjects,
+    // then render again in a render pass that keeps the contents
+    class GpuDrivenRenderSystem {
+        public:
+            // Results of the culling passes, read back a few frames late so the CPU never waits on it
+            struct CullingStats {
+                uint32_t drawCount = 0; // indirect draws with instances, both phases and every draw path
+                uint32_t visibleCount = 0; // drawn in either phase
+                uint32_t culledCount = 0; // outside the frustum
+                uint32_t occludedCount = 0; // in the frustum but hidden behind what phase 1 drew
+            };
+
+            GpuDrivenRenderSystem(LveDevice &device, VkRenderPass renderPass, LveDescriptorLayoutCache &layoutCache);
+            ~GpuDrivenRenderSystem();
+
+            GpuDrivenRenderSystem(const GpuDrivenRenderSystem &) = delete;
+            GpuDrivenRenderSystem &operator=(const GpuDrivenRenderSystem &) = delete;
+
+            // Uploads the objects and the camera, and records the first phase's culling dispatch,
+            // call before beginSwapChainRenderPass. depthExtent is the size of the depth buffer the pyramid is built from
+            void cullGameObjects(FrameInfo &frameInfo, LveRegistry &registry, VkExtent2D depthExtent);
+            // Builds the Hi-Z pyramid from the depth the first render pass left and records the second phase,
+            // call between the two render passes
+            void cullOccludedObjects(FrameInfo &frameInfo, VkImageView depthView);
+            // Records the indirect draws of the last culling phase, call inside the render pass
+            void render(FrameInfo &frameInfo);
+
+            // Stats of the last frame whose results have made it back to the CPU
+            const CullingStats &getCullingStats() const { return cullingStats; }
+
+            // Off skips the Hi-Z pyramid and draws everything in the frustum, eg. to measure what occlusion culling saves
+            // Takes effect from the next cullOccludedObjects
+            void setOcclusionCullingEnabled(bool enabled) { occlusionCullingEnabled = enabled; }
+            bool isOcclusionCullingEnabled() const { return occlusionCullingEnabled; }
+
+        private:
+            // Matches ObjectData in gpu_cull.comp (std430)
+            struct ObjectData {
+                glm::mat4 transform{1.f};
+                glm::vec4 color{1.f};
+                glm::vec4 boundingSphere{0.f};
+                uint32_t drawIndex;
+                uint32_t instanceBase;
+                uint32_t padding[2]; // std430 rounds the struct up to 16 bytes
+            };
+
+            // Matches CameraBuffer in gpu_cull.comp and gpu_driven_shader.vert (std430)
+            // Too big to push next to the counts within the guaranteed 128 bytes, so it goes in a buffer
+            struct CameraData {
+                glm::mat4 projectionView{1.f};
+                glm::vec4 frustumPlanes[LveFrustum::PLANE_COUNT];
+            };
+
+            struct PushConstantData {
+                uint32_t objectCount;
+                uint32_t modelCount;
+                uint32_t instanceBase;
+                uint32_t phase;
+                uint32_t pyramidWidth;
+                uint32_t pyramidHeight;
+            };
+
+            // Everything a single frame in flight reads or writes on the GPU
+            struct FrameResources {
+                uint32_t objectCapacity = 0;
+                uint32_t modelCapacity = 0;
+                std::unique_ptr<LveBuffer> objectBuffer; // host visible, only changed objects are rewritten
+                std::unique_ptr<LveBuffer> commandTemplateBuffer; // host visible, commands with no instances
+                std::unique_ptr<LveBuffer> modelCommandBuffer; // one command per model, filled by culling
+                std::unique_ptr<LveBuffer> drawCommandBuffer; // compacted commands for the count path
+                std::unique_ptr<LveBuffer> visibleBuffer; // object indices grouped by model
+                std::unique_ptr<LveBuffer> statsBuffer;
+                std::unique_ptr<LveBuffer> statsReadbackBuffer; // host visible copy of statsBuffer
+                std::unique_ptr<LveBuffer> cameraBuffer; // host visible, written every frame
+                // Per object, whether it passed the occlusion test the last time this frame slot ran
+                // Indexed like the registry, so after objects are destroyed some entries belong to a different
+                // object, that only costs a draw in the wrong phase
+                std::unique_ptr<LveBuffer> visibilityBuffer;
+                bool visibilityCleared = false;
+                VkDescriptorSet descriptorSet = VK_NULL_HANDLE; // from this frame's descriptor allocator, rebuilt every frame
+                bool statsPending = false;
+                // What objectBuffer holds, so objects that haven't changed aren't written again
+                std::vector<LveRegistry::entity_t> uploadedEntities;
+                uint64_t uploadedVersion = 0;
+            };
+
+            enum class DrawPath {
+                INDIRECT_COUNT, // compacted commands + vkCmdDrawIndexedIndirectCount
+                MULTI_DRAW_INDIRECT, // one vkCmdDrawIndexedIndirect over every model
+                SINGLE_DRAW_INDIRECT, // one vkCmdDrawIndexedIndirect per model, instance base pushed per draw
+            };
+
+            void createPipelineLayout(LveDescriptorLayoutCache &layoutCache);
+            void createPipelines(VkRenderPass renderPass);
+            void ensureCapacity(FrameResources &frame, uint32_t objectCount, uint32_t modelCount);
+            void buildDescriptorSet(FrameInfo &frameInfo, FrameResources &frame);
+            void resetDrawCommands(VkCommandBuffer commandBuffer, FrameResources &frame, bool resetStats);
+            void recordCullPass(FrameInfo &frameInfo, FrameResources &frame, uint32_t phase);
+            void readBackStats(FrameResources &frame);
+
+            LveDevice &lveDevice;
+            DrawPath drawPath;
+
+            VkDescriptorSetLayout descriptorSetLayout; // owned by the layout cache
+            VkPipelineLayout pipelineLayout; // owned by the layout cache
+            LveDescriptorWriter descriptorWriter{lveDevice};
+            std::unique_ptr<LvePipeline> lvePipeline;
+            std::unique_ptr<LveComputePipeline> cullPipeline;
+            std::unique_ptr<LveComputePipeline> compactPipeline;
+
+            std::array<FrameResources, LveSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+            LveHiZPyramid hiZPyramid;
+            bool occlusionCullingEnabled = true;
+            CullingStats cullingStats{};
+
+            // Recorded by cullGameObjects for render to use
+            std::vector<LveModel *> frameModels;
+            std::vector<uint32_t> frameInstanceBases;
+            uint32_t frameObjectCount = 0;
+
+            // Reused every frame to avoid allocating while grouping
+            std::unordered_map<LveAssetRegistry::model_t, uint32_t> modelLookup;
+            std::vector<uint32_t> modelObjectCounts;
+    };
+}
@@ -0,0 +1,153 @@
+#include "lve_asset_registry.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+
+namespace lve {
+    LveAssetRegistry::LveAssetRegistry(LveGeometryArena &arena) : geometryArena{arena} {}
+
+    LveAssetRegistry::~LveAssetRegistry() {
+        // The pool destroys the models, returning their ranges to the arena
+        models.clear();
+    }
+
+    LveAssetRegistry::model_t LveAssetRegistry::loadModel(const std::string &name, const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices) {
+        model_t model = acquireModel(name);
+        if (model != INVALID_MODEL) {
+            return model;
+        }
+        // Same data under another name shares the upload, and the new name finds it from now on
+        uint64_t contentHash = hashContent(vertices, indices);
+        model = findByContent(contentHash, vertices, indices);
+        if (model != INVALID_MODEL) {
+            acquire(model);
+            if (!name.empty()) {
+                models[model].names.push_back(name);
+                modelsByName[name] = model;
+            }
+            return model;
+        }
+        return createModel(name, contentHash, vertices, indices);
+    }
+
+    LveAssetRegistry::model_t LveAssetRegistry::loadModel(const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices) {
+        uint64_t contentHash = hashContent(vertices, indices);
+        model_t model = findByContent(contentHash, vertices, indices);
+        if (model != INVALID_MODEL) {
+            acquire(model);
+            return model;
+        }
+        return createModel("", contentHash, vertices, indices);
+    }
+
+    LveAssetRegistry::model_t LveAssetRegistry::acquireModel(const std::string &name) {
+        auto found = modelsByName.find(name);
+        if (found == modelsByName.end()) {
+            return INVALID_MODEL;
+        }
+        acquire(found->second);
+        return found->second;
+    }
+
+    void LveAssetRegistry::acquire(model_t model) {
+        assert(models.isValid(model) && "Acquiring a model that isn't loaded");
+        // A model waiting to be freed is simply alive again, collectGarbage skips it
+        models[model].refCount++;
+    }
+
+    void LveAssetRegistry::release(model_t model) {
+        assert(models.isValid(model) && "Releasing a model that isn't loaded");
+        ModelEntry &entry = models[model];
+        assert(entry.refCount > 0 && "Model released more often than acquired");
+        if (--entry.refCount == 0) {
+            entry.unloadFrame = frameNumber + LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+            pendingUnloads.push_back(model);
+        }
+    }
+
+    uint32_t LveAssetRegistry::collectGarbage() {
+        frameNumber++;
+        uint32_t freed = 0;
+        size_t kept = 0;
+        for (model_t model : pendingUnloads) {
+            ModelEntry *entry = models.get(model);
+            // Already freed through a duplicate entry, or revived
+            if (entry == nullptr || entry->refCount > 0) {
+                continue;
+            }
+            if (entry->unloadFrame > frameNumber) {
+                pendingUnloads[kept++] = model;
+                continue;
+            }
+            destroyModel(model);
+            freed++;
+        }
+        pendingUnloads.resize(kept);
+        return freed;
+    }
+
+    uint64_t LveAssetRegistry::hashContent(const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices) {
+        // 64 bit FNV-1a over the raw bytes, collisions between real meshes are vanishingly unlikely
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const void *data, size_t size) {
+            auto *bytes = static_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        };
+        uint64_t counts[2] = {vertices.size(), indices.size()};
+        mix(counts, sizeof(counts));
+        mix(vertices.data(), vertices.size() * sizeof(LveModel::Vertex));
+        mix(indices.data(), indices.size() * sizeof(uint32_t));
+        return hash;
+    }
+
+    LveAssetRegistry::model_t LveAssetRegistry::findByContent(uint64_t contentHash, const std::vector<LveModel::Vertex> &vertices,
+                                                              const std::vector<uint32_t> &indices) {
+        // The hash only narrows it down, handing out a different mesh on a collision would be a silent bug
+        auto sameBytes = [](const auto &stored, const auto &loaded) {
+            using Element = typename std::decay_t<decltype(loaded)>::value_type;
+            return stored.size() == loaded.size() &&
+                   (loaded.empty() || std::memcmp(stored.data(), loaded.data(), loaded.size() * sizeof(Element)) == 0);
+        };
+        auto range = modelsByContent.equal_range(contentHash);
+        for (auto found = range.first; found != range.second; ++found) {
+            const ModelEntry &entry = models[found->second];
+            if (sameBytes(entry.vertices, vertices) && sameBytes(entry.indices, indices)) {
+                return found->second;
+            }
+        }
+        return INVALID_MODEL;
+    }
+
+    LveAssetRegistry::model_t LveAssetRegistry::createModel(const std::string &name, uint64_t contentHash,
+                                                            const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices) {
+        model_t model = models.create(geometryArena, vertices, indices);
+        ModelEntry &entry = models[model];
+        entry.contentHash = contentHash;
+        modelsByContent.emplace(contentHash, model);
+        if (!name.empty()) {
+            entry.names.push_back(name);
+            modelsByName[name] = model;
+        }
+        return model;
+    }
+
+    void LveAssetRegistry::destroyModel(model_t model) {
+        ModelEntry &entry = models[model];
+        auto range = modelsByContent.equal_range(entry.contentHash);
+        for (auto found = range.first; found != range.second; ++found) {
+            if (found->second == model) {
+                modelsByContent.erase(found);
+                break;
+            }
+        }
+        for (const std::string &name : entry.names) {
+            modelsByName.erase(name);
+        }
+        models.destroy(model);
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "lve_geometry_arena.hpp"
+#include "lve_model.hpp"
+#include "lve_object_pool.hpp"
+
+//std
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+    // Owns every loaded model and hands out 32 bit handles (see LveHandle) instead of shared pointers
+    // Copying a handle is copying an integer, no atomic refcount traffic, and ownership lives in one place
+    //
+    // Loads are deduplicated: by name (eg. a file path) first, then by a hash of the vertex and index data,
+    // so the same mesh is only ever uploaded once however many times it is asked for
+    // A hash hit is confirmed against the data the model was loaded from, meshes that only collide get their own model
+    //
+    // References are counted explicitly, every load or acquire needs a release
+    // A model whose count drops to zero isn't destroyed right away, frames in flight may still draw it:
+    // collectGarbage frees it MAX_FRAMES_IN_FLIGHT frames later, and loading it again in between revives it
+    class LveAssetRegistry {
+        public:
+            using model_t = LveHandle::handle_t;
+            static constexpr model_t INVALID_MODEL = LveHandle::INVALID;
+
+            explicit LveAssetRegistry(LveGeometryArena &arena);
+            // Frees every model, pending or not, so the device must be idle
+            ~LveAssetRegistry();
+
+            LveAssetRegistry(const LveAssetRegistry &) = delete;
+            LveAssetRegistry &operator=(const LveAssetRegistry &) = delete;
+
+            // Returns a handle holding one reference
+            model_t loadModel(const std::string &name, const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices = {});
+            model_t loadModel(const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices = {});
+            // Another reference to a model loaded under this name, INVALID_MODEL if there is none
+            // Lets callers skip reading a file that is already resident
+            model_t acquireModel(const std::string &name);
+
+            void acquire(model_t model);
+            void release(model_t model);
+
+            // Only checked by an assert, cheap enough for per object loops in release builds
+            LveModel &getModel(model_t model) {
+                assert(models.isValid(model) && "Drawing a model that isn't loaded");
+                return models[model].model;
+            }
+            const LveModel &getModel(model_t model) const {
+                assert(models.isValid(model) && "Drawing a model that isn't loaded");
+                return models[model].model;
+            }
+            bool isLoaded(model_t model) const { return models.isValid(model); }
+            uint32_t getRefCount(model_t model) const { return models[model].refCount; }
+
+            // Call once per frame, after the fence wait for the frame about to be recorded
+            // Returns how many models were freed
+            uint32_t collectGarbage();
+
+            uint32_t getModelCount() const { return models.size(); }
+            uint32_t getPendingUnloadCount() const { return static_cast<uint32_t>(pendingUnloads.size()); }
+
+        private:
+            struct ModelEntry {
+                ModelEntry(LveGeometryArena &arena, const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices)
+                    : model{arena, vertices, indices}, vertices{vertices}, indices{indices} {}
+
+                LveModel model;
+                // What it was loaded from, the arena copy lives on the GPU and has the normals filled in
+                std::vector<LveModel::Vertex> vertices;
+                std::vector<uint32_t> indices;
+                uint32_t refCount = 1;
+                uint64_t contentHash = 0;
+                uint64_t unloadFrame = 0; // frame from which it may be freed, while refCount is zero
+                std::vector<std::string> names; // every name it was loaded under, all find it
+            };
+
+            static uint64_t hashContent(const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices);
+            // INVALID_MODEL unless a model with the hash was loaded from exactly this data
+            model_t findByContent(uint64_t contentHash, const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices);
+            model_t createModel(const std::string &name, uint64_t contentHash,
+                                const std::vector<LveModel::Vertex> &vertices, const std::vector<uint32_t> &indices);
+            void destroyModel(model_t model);
+
+            LveGeometryArena &geometryArena;
+            // Models are built in place in the pool's chunks, so they never move and getModel is one lookup
+            LveObjectPool<ModelEntry> models;
+            std::unordered_map<std::string, model_t> modelsByName;
+            std::unordered_multimap<uint64_t, model_t> modelsByContent; // several models on a hash collision
+            // May hold models that were revived or are listed twice, collectGarbage checks the entry
+            std::vector<model_t> pendingUnloads;
+            uint64_t frameNumber = 0;
+    };
+}
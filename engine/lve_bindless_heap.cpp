@@ -0,0 +1,340 @@
+#include "lve_bindless_heap.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+    static constexpr VkShaderStageFlags BINDLESS_STAGES =
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    static constexpr VkDeviceSize DEFAULT_BUFFER_SIZE = 256;
+
+    LveBindlessHeap::LveBindlessHeap(LveDevice &device, LveDescriptorLayoutCache &layoutCache)
+        : lveDevice{device}, bindless{device.isDescriptorIndexingSupported()} {
+        if (bindless) {
+            // Update after bind arrays have their own, usually much higher, limits
+            auto &limits = lveDevice.getDescriptorIndexingProperties();
+            capacities.images = std::min({BINDLESS_CAPACITIES.images,
+                                          limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                          limits.maxDescriptorSetUpdateAfterBindSampledImages});
+            capacities.samplers = std::min({BINDLESS_CAPACITIES.samplers,
+                                            limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                            limits.maxDescriptorSetUpdateAfterBindSamplers});
+            capacities.storageBuffers = std::min({BINDLESS_CAPACITIES.storageBuffers,
+                                                  limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                                                  limits.maxDescriptorSetUpdateAfterBindStorageBuffers});
+        } else {
+            // Half the per stage limit, the pipelines' other sets count against it too
+            auto &limits = lveDevice.properties.limits;
+            capacities.images = std::min(FALLBACK_CAPACITIES.images, std::max(limits.maxPerStageDescriptorSampledImages / 2, 1u));
+            capacities.samplers = std::min(FALLBACK_CAPACITIES.samplers, std::max(limits.maxPerStageDescriptorSamplers / 2, 1u));
+            capacities.storageBuffers = std::min(FALLBACK_CAPACITIES.storageBuffers, std::max(limits.maxPerStageDescriptorStorageBuffers / 2, 1u));
+        }
+
+        tables[IMAGE_BINDING].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        tables[IMAGE_BINDING].capacity = capacities.images;
+        tables[SAMPLER_BINDING].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+        tables[SAMPLER_BINDING].capacity = capacities.samplers;
+        tables[STORAGE_BUFFER_BINDING].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        tables[STORAGE_BUFFER_BINDING].capacity = capacities.storageBuffers;
+
+        createDefaultResources();
+        createDescriptorSets(layoutCache);
+    }
+
+    LveBindlessHeap::~LveBindlessHeap() {
+        // Destroying the pool frees the sets
+        vkDestroyDescriptorPool(lveDevice.device(), descriptorPool, nullptr);
+        vkDestroySampler(lveDevice.device(), defaultSampler, nullptr);
+        vkDestroyImageView(lveDevice.device(), defaultImageView, nullptr);
+        vkDestroyImage(lveDevice.device(), defaultImage, nullptr);
+        vkFreeMemory(lveDevice.device(), defaultImageMemory, nullptr);
+    }
+
+    void LveBindlessHeap::createDefaultResources() {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {1, 1, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        lveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, defaultImage, defaultImageMemory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = defaultImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &defaultImageView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view!");
+        }
+
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.anisotropyEnable = VK_TRUE;
+        samplerInfo.maxAnisotropy = lveDevice.properties.limits.maxSamplerAnisotropy;
+        samplerInfo.minLod = 0.f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        if (vkCreateSampler(lveDevice.device(), &samplerInfo, nullptr, &defaultSampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create sampler!");
+        }
+
+        defaultBuffer = std::make_unique<LveBuffer>(
+            lveDevice,
+            DEFAULT_BUFFER_SIZE,
+            1,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        // Fill both in once, they never change after this
+        VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeCommands();
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = defaultImage;
+        barrier.subresourceRange = viewInfo.subresourceRange;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkClearColorValue white{};
+        white.float32[0] = white.float32[1] = white.float32[2] = white.float32[3] = 1.f;
+        vkCmdClearColorImage(commandBuffer, defaultImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &white, 1, &viewInfo.subresourceRange);
+        vkCmdFillBuffer(commandBuffer, defaultBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+        // endSingleTimeCommands waits for the queue, which also makes the buffer fill visible
+        lveDevice.endSingleTimeCommands(commandBuffer);
+    }
+
+    void LveBindlessHeap::createDescriptorSets(LveDescriptorLayoutCache &layoutCache) {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        for (uint32_t binding = 0; binding < tables.size(); binding++) {
+            bindings.push_back(LveDescriptorLayoutCache::binding(binding, tables[binding].type, BINDLESS_STAGES, tables[binding].capacity));
+        }
+
+        uint32_t setCount = bindless ? 1 : LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        if (bindless) {
+            // Elements can be written while the set is bound, and ones no shader reads may stay empty
+            VkDescriptorBindingFlagsEXT flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+                                                VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+                                                VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+            descriptorSetLayout = layoutCache.getSetLayout(bindings,
+                                                           VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT,
+                                                           std::vector<VkDescriptorBindingFlagsEXT>(bindings.size(), flags));
+            poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+        } else {
+            descriptorSetLayout = layoutCache.getSetLayout(bindings);
+        }
+
+        std::array<VkDescriptorPoolSize, 3> poolSizes{};
+        for (uint32_t binding = 0; binding < tables.size(); binding++) {
+            poolSizes[binding].type = tables[binding].type;
+            poolSizes[binding].descriptorCount = tables[binding].capacity * setCount;
+        }
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = setCount;
+
+        if (vkCreateDescriptorPool(lveDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor pool!");
+        }
+
+        std::array<VkDescriptorSetLayout, LveSwapChain::MAX_FRAMES_IN_FLIGHT> setLayouts;
+        setLayouts.fill(descriptorSetLayout);
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = descriptorPool;
+        allocInfo.descriptorSetCount = setCount;
+        allocInfo.pSetLayouts = setLayouts.data();
+
+        if (vkAllocateDescriptorSets(lveDevice.device(), &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate descriptor sets!");
+        }
+        for (uint32_t i = 0; i < setCount; i++) {
+            writeDefaults(descriptorSets[i], !bindless);
+        }
+    }
+
+    // Partially bound arrays only need the defaults themselves, the fallback has to fill in every element
+    void LveBindlessHeap::writeDefaults(VkDescriptorSet set, bool allElements) {
+        auto &images = tables[IMAGE_BINDING];
+        auto &samplers = tables[SAMPLER_BINDING];
+        auto &buffers = tables[STORAGE_BUFFER_BINDING];
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageView = defaultImageView;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        VkDescriptorImageInfo samplerInfo{};
+        samplerInfo.sampler = defaultSampler;
+        std::vector<VkDescriptorImageInfo> imageInfos(allElements ? images.capacity : 1, imageInfo);
+        std::vector<VkDescriptorImageInfo> samplerInfos(allElements ? samplers.capacity : 1, samplerInfo);
+        std::vector<VkDescriptorBufferInfo> bufferInfos(allElements ? buffers.capacity : 1, defaultBuffer->descriptorInfo());
+
+        std::array<VkWriteDescriptorSet, 3> defaultWrites{};
+        for (uint32_t binding = 0; binding < defaultWrites.size(); binding++) {
+            defaultWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            defaultWrites[binding].dstSet = set;
+            defaultWrites[binding].dstBinding = binding;
+            defaultWrites[binding].dstArrayElement = DEFAULT_INDEX;
+            defaultWrites[binding].descriptorType = tables[binding].type;
+        }
+        defaultWrites[IMAGE_BINDING].descriptorCount = static_cast<uint32_t>(imageInfos.size());
+        defaultWrites[IMAGE_BINDING].pImageInfo = imageInfos.data();
+        defaultWrites[SAMPLER_BINDING].descriptorCount = static_cast<uint32_t>(samplerInfos.size());
+        defaultWrites[SAMPLER_BINDING].pImageInfo = samplerInfos.data();
+        defaultWrites[STORAGE_BUFFER_BINDING].descriptorCount = static_cast<uint32_t>(bufferInfos.size());
+        defaultWrites[STORAGE_BUFFER_BINDING].pBufferInfo = bufferInfos.data();
+        vkUpdateDescriptorSets(lveDevice.device(), static_cast<uint32_t>(defaultWrites.size()), defaultWrites.data(), 0, nullptr);
+    }
+
+    LveBindlessHeap::index_t LveBindlessHeap::allocateIndex(Table &table) {
+        index_t index;
+        if (!table.freeIndices.empty()) {
+            index = table.freeIndices.back();
+            table.freeIndices.pop_back();
+        } else if (table.nextIndex < table.capacity) {
+            index = table.nextIndex++;
+        } else {
+            throw std::runtime_error("bindless descriptor array is full!");
+        }
+        table.liveCount++;
+        return index;
+    }
+
+    LveBindlessHeap::index_t LveBindlessHeap::addImage(VkImageView imageView, VkImageLayout imageLayout) {
+        PendingWrite pendingWrite{};
+        pendingWrite.binding = IMAGE_BINDING;
+        pendingWrite.index = allocateIndex(tables[IMAGE_BINDING]);
+        pendingWrite.imageInfo.imageView = imageView;
+        pendingWrite.imageInfo.imageLayout = imageLayout;
+        write(pendingWrite);
+        return pendingWrite.index;
+    }
+
+    LveBindlessHeap::index_t LveBindlessHeap::addSampler(VkSampler sampler) {
+        PendingWrite pendingWrite{};
+        pendingWrite.binding = SAMPLER_BINDING;
+        pendingWrite.index = allocateIndex(tables[SAMPLER_BINDING]);
+        pendingWrite.imageInfo.sampler = sampler;
+        write(pendingWrite);
+        return pendingWrite.index;
+    }
+
+    LveBindlessHeap::index_t LveBindlessHeap::addStorageBuffer(const VkDescriptorBufferInfo &bufferInfo) {
+        PendingWrite pendingWrite{};
+        pendingWrite.binding = STORAGE_BUFFER_BINDING;
+        pendingWrite.index = allocateIndex(tables[STORAGE_BUFFER_BINDING]);
+        pendingWrite.bufferInfo = bufferInfo;
+        write(pendingWrite);
+        return pendingWrite.index;
+    }
+
+    void LveBindlessHeap::remove(Table &table, index_t index) {
+        assert(index != DEFAULT_INDEX && index < table.nextIndex && "Not an index this heap handed out");
+        table.retiredIndices.push_back({index, frameNumber + LveSwapChain::MAX_FRAMES_IN_FLIGHT});
+        table.liveCount--;
+
+        // Every element of a fallback set has to stay valid, so the slot goes back to the default
+        // before whatever it pointed at is destroyed
+        if (!bindless) {
+            PendingWrite pendingWrite{};
+            pendingWrite.binding = static_cast<uint32_t>(&table - tables.data());
+            pendingWrite.index = index;
+            pendingWrite.imageInfo.imageView = defaultImageView;
+            pendingWrite.imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            pendingWrite.imageInfo.sampler = defaultSampler;
+            pendingWrite.bufferInfo = defaultBuffer->descriptorInfo();
+            write(pendingWrite);
+        }
+    }
+
+    // Update after bind sets take the write right away, the element isn't in use by anything in flight
+    // Fallback copies may be bound in a frame that is still recording, each one catches up in its beginFrame
+    void LveBindlessHeap::write(const PendingWrite &pendingWrite) {
+        if (bindless) {
+            pendingWrites[0].push_back(pendingWrite);
+            flush(0);
+            return;
+        }
+        for (auto &frameWrites : pendingWrites) {
+            frameWrites.push_back(pendingWrite);
+        }
+    }
+
+    void LveBindlessHeap::flush(uint32_t setIndex) {
+        auto &frameWrites = pendingWrites[setIndex];
+        if (frameWrites.empty()) {
+            return;
+        }
+        writes.resize(frameWrites.size());
+        for (size_t i = 0; i < frameWrites.size(); i++) {
+            auto &pending = frameWrites[i];
+            VkWriteDescriptorSet &write = writes[i];
+            write = VkWriteDescriptorSet{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = descriptorSets[setIndex];
+            write.dstBinding = pending.binding;
+            write.dstArrayElement = pending.index;
+            write.descriptorCount = 1;
+            write.descriptorType = tables[pending.binding].type;
+            if (pending.binding == STORAGE_BUFFER_BINDING) {
+                write.pBufferInfo = &pending.bufferInfo;
+            } else {
+                write.pImageInfo = &pending.imageInfo;
+            }
+        }
+        vkUpdateDescriptorSets(lveDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        frameWrites.clear();
+    }
+
+    void LveBindlessHeap::beginFrame(int frameIndex) {
+        frameNumber++;
+        for (auto &table : tables) {
+            size_t kept = 0;
+            for (auto &retired : table.retiredIndices) {
+                if (retired.second > frameNumber) {
+                    table.retiredIndices[kept++] = retired;
+                } else {
+                    table.freeIndices.push_back(retired.first);
+                }
+            }
+            table.retiredIndices.resize(kept);
+        }
+
+        // This frame's copy isn't bound anywhere yet, its fence has been waited on
+        if (!bindless) {
+            flush(static_cast<uint32_t>(frameIndex));
+        }
+    }
+}
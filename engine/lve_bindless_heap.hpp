@@ -0,0 +1,130 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+//std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace lve {
+    // One global descriptor set holding big arrays of sampled images, samplers and storage buffers
+    // Resources are registered once and referred to by index, shaders pick them with an index passed through
+    // push constants or instance data, so drawing something with different textures or material buffers
+    // needs no descriptor set binds at all
+    //
+    // With descriptor indexing (LveDevice::isDescriptorIndexingSupported) there is a single update after bind,
+    // partially bound set: elements are written straight away, unused ones may stay empty, and the set
+    // stays bound across frames
+    // Without it every frame in flight gets a copy of a set with smaller arrays, every element filled in with the
+    // defaults, and writes are replayed into each copy in beginFrame, once that frame's fence has been waited on
+    //
+    // Shader side (set number is the pipeline layout's, bindings match the constants below):
+    //   layout(set = 1, binding = 0) uniform texture2D bindlessImages[];
+    //   layout(set = 1, binding = 1) uniform sampler bindlessSamplers[];
+    //   layout(set = 1, binding = 2) readonly buffer MaterialBuffer { ... } bindlessBuffers[];
+    //   texture(sampler2D(bindlessImages[push.imageIndex], bindlessSamplers[push.samplerIndex]), uv)
+    // Indices that aren't dynamically uniform (eg. from instance data) need nonuniformEXT, which the fallback
+    // can't do, it has to size the arrays (getCapacities) and keep to push constant indices
+    class LveBindlessHeap {
+        public:
+            using index_t = uint32_t;
+            // Index 0 of every array is a default that is always valid: a white 1x1 image,
+            // a linear repeating sampler and a small zeroed buffer
+            static constexpr index_t DEFAULT_INDEX = 0;
+
+            static constexpr uint32_t IMAGE_BINDING = 0;
+            static constexpr uint32_t SAMPLER_BINDING = 1;
+            static constexpr uint32_t STORAGE_BUFFER_BINDING = 2;
+
+            struct Capacities {
+                uint32_t images;
+                uint32_t samplers;
+                uint32_t storageBuffers;
+            };
+            // What is asked for, clamped to the device's limits
+            static constexpr Capacities BINDLESS_CAPACITIES{16384, 256, 16384};
+            static constexpr Capacities FALLBACK_CAPACITIES{128, 16, 64};
+
+            LveBindlessHeap(LveDevice &device, LveDescriptorLayoutCache &layoutCache);
+            ~LveBindlessHeap();
+
+            LveBindlessHeap(const LveBindlessHeap &) = delete;
+            LveBindlessHeap &operator=(const LveBindlessHeap &) = delete;
+
+            // The resource has to stay alive until it is removed and MAX_FRAMES_IN_FLIGHT frames have passed
+            // Shaders may use the index right away with descriptor indexing, from the next frame on without it
+            // Throws when the array is full
+            index_t addImage(VkImageView imageView, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            index_t addSampler(VkSampler sampler);
+            index_t addStorageBuffer(const VkDescriptorBufferInfo &bufferInfo);
+            // The index is only reused after MAX_FRAMES_IN_FLIGHT frames, frames in flight may still read it
+            void removeImage(index_t index) { remove(tables[IMAGE_BINDING], index); }
+            void removeSampler(index_t index) { remove(tables[SAMPLER_BINDING], index); }
+            void removeStorageBuffer(index_t index) { remove(tables[STORAGE_BUFFER_BINDING], index); }
+
+            // Call once per frame, after the fence wait for the frame about to be recorded
+            void beginFrame(int frameIndex);
+
+            VkDescriptorSetLayout getSetLayout() const { return descriptorSetLayout; }
+            VkDescriptorSet getDescriptorSet(int frameIndex) const { return descriptorSets[bindless ? 0 : frameIndex]; }
+            bool isBindless() const { return bindless; }
+            const Capacities &getCapacities() const { return capacities; }
+
+            // Registered resources, the defaults not included
+            uint32_t getImageCount() const { return tables[IMAGE_BINDING].liveCount; }
+            uint32_t getSamplerCount() const { return tables[SAMPLER_BINDING].liveCount; }
+            uint32_t getStorageBufferCount() const { return tables[STORAGE_BUFFER_BINDING].liveCount; }
+
+        private:
+            // The indices of one binding's array
+            struct Table {
+                VkDescriptorType type;
+                uint32_t capacity = 0;
+                uint32_t nextIndex = DEFAULT_INDEX + 1; // never handed out yet from here on
+                uint32_t liveCount = 0;
+                std::vector<index_t> freeIndices;
+                std::vector<std::pair<index_t, uint64_t>> retiredIndices; // and the frame they may be reused from
+            };
+
+            // One array element, either an image or a buffer info depending on the table
+            struct PendingWrite {
+                uint32_t binding;
+                index_t index;
+                VkDescriptorImageInfo imageInfo;
+                VkDescriptorBufferInfo bufferInfo;
+            };
+
+            void createDefaultResources();
+            void createDescriptorSets(LveDescriptorLayoutCache &layoutCache);
+            void writeDefaults(VkDescriptorSet set, bool allElements);
+            index_t allocateIndex(Table &table);
+            void remove(Table &table, index_t index);
+            void write(const PendingWrite &pendingWrite);
+            void flush(uint32_t setIndex);
+
+            LveDevice &lveDevice;
+            bool bindless;
+            Capacities capacities;
+            std::array<Table, 3> tables; // indexed by binding
+
+            VkDescriptorSetLayout descriptorSetLayout; // owned by the layout cache
+            VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+            std::array<VkDescriptorSet, LveSwapChain::MAX_FRAMES_IN_FLIGHT> descriptorSets{};
+            // Writes each fallback copy still has to catch up on
+            std::array<std::vector<PendingWrite>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> pendingWrites;
+            std::vector<VkWriteDescriptorSet> writes;
+            uint64_t frameNumber = 0;
+
+            VkImage defaultImage = VK_NULL_HANDLE;
+            VkDeviceMemory defaultImageMemory = VK_NULL_HANDLE;
+            VkImageView defaultImageView = VK_NULL_HANDLE;
+            VkSampler defaultSampler = VK_NULL_HANDLE;
+            std::unique_ptr<LveBuffer> defaultBuffer;
+    };
+}
@@ -0,0 +1,88 @@
+#include "lve_buffer.hpp"
+
+// std
+#include <cassert>
+#include <cstring>
+
+namespace lve {
+
+    VkDeviceSize LveBuffer::getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment) {
+        // Alignments are always a power of 2, so masking off the low bits rounds up
+        if (minOffsetAlignment > 0) {
+            return (instanceSize + minOffsetAlignment - 1) & ~(minOffsetAlignment - 1);
+        }
+        return instanceSize;
+    }
+
+    LveBuffer::LveBuffer(LveDevice &device,
+                         VkDeviceSize instanceSize,
+                         uint32_t instanceCount,
+                         VkBufferUsageFlags usageFlags,
+                         VkMemoryPropertyFlags memoryPropertyFlags,
+                         VkDeviceSize minOffsetAlignment)
+                         : lveDevice{device},
+                           instanceCount{instanceCount},
+                           instanceSize{instanceSize},
+                           usageFlags{usageFlags},
+                           memoryPropertyFlags{memoryPropertyFlags} {
+        alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
+        bufferSize = alignmentSize * instanceCount;
+        lveDevice.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+    }
+
+    LveBuffer::~LveBuffer() {
+        unmap();
+        vkDestroyBuffer(lveDevice.device(), buffer, nullptr);
+        vkFreeMemory(lveDevice.device(), memory, nullptr);
+    }
+
+    VkResult LveBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
+        assert(buffer && memory && "Called map on buffer before create");
+        return vkMapMemory(lveDevice.device(), memory, offset, size, 0, &mapped);
+    }
+
+    void LveBuffer::unmap() {
+        if (mapped) {
+            vkUnmapMemory(lveDevice.device(), memory);
+            mapped = nullptr;
+        }
+    }
+
+    void LveBuffer::writeToBuffer(const void *data, VkDeviceSize size, VkDeviceSize offset) {
+        assert(mapped && "Cannot copy to unmapped buffer");
+
+        if (size == VK_WHOLE_SIZE) {
+            memcpy(mapped, data, bufferSize);
+        } else {
+            char *memOffset = static_cast<char *>(mapped);
+            memOffset += offset;
+            memcpy(memOffset, data, size);
+        }
+    }
+
+    VkResult LveBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
+        VkMappedMemoryRange mappedRange{};
+        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        mappedRange.memory = memory;
+        mappedRange.offset = offset;
+        mappedRange.size = size;
+        return vkFlushMappedMemoryRanges(lveDevice.device(), 1, &mappedRange);
+    }
+
+    VkResult LveBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
+        VkMappedMemoryRange mappedRange{};
+        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        mappedRange.memory = memory;
+        mappedRange.offset = offset;
+        mappedRange.size = size;
+        return vkInvalidateMappedMemoryRanges(lveDevice.device(), 1, &mappedRange);
+    }
+
+    VkDescriptorBufferInfo LveBuffer::descriptorInfo(VkDeviceSize size, VkDeviceSize offset) {
+        return VkDescriptorBufferInfo{buffer, offset, size};
+    }
+
+    void LveBuffer::writeToIndex(const void *data, uint32_t index) {
+        writeToBuffer(data, instanceSize, index * alignmentSize);
+    }
+}
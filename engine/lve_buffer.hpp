@@ -0,0 +1,61 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+namespace lve {
+    // Thin wrapper around a VkBuffer and its VkDeviceMemory
+    // Buffers are laid out as instanceCount slots of instanceSize bytes,
+    // each slot padded up to the requested alignment (eg. minUniformBufferOffsetAlignment)
+    class LveBuffer {
+        public:
+            LveBuffer(LveDevice &device,
+                      VkDeviceSize instanceSize,
+                      uint32_t instanceCount,
+                      VkBufferUsageFlags usageFlags,
+                      VkMemoryPropertyFlags memoryPropertyFlags,
+                      VkDeviceSize minOffsetAlignment = 1);
+            ~LveBuffer();
+
+            LveBuffer(const LveBuffer &) = delete;
+            LveBuffer &operator=(const LveBuffer &) = delete;
+
+            // Only valid for host visible memory
+            VkResult map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+            void unmap();
+
+            void writeToBuffer(const void *data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+            // Needed when memory is not HOST_COHERENT so the device sees host writes
+            VkResult flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+            // Needed when memory is not HOST_COHERENT so the host sees device writes
+            VkResult invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+            VkDescriptorBufferInfo descriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+
+            void writeToIndex(const void *data, uint32_t index);
+            VkDeviceSize getOffsetForIndex(uint32_t index) const { return index * alignmentSize; }
+
+            VkBuffer getBuffer() const { return buffer; }
+            void *getMappedMemory() const { return mapped; }
+            uint32_t getInstanceCount() const { return instanceCount; }
+            VkDeviceSize getInstanceSize() const { return instanceSize; }
+            VkDeviceSize getAlignmentSize() const { return alignmentSize; }
+            VkBufferUsageFlags getUsageFlags() const { return usageFlags; }
+            VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
+            VkDeviceSize getBufferSize() const { return bufferSize; }
+
+        private:
+            // Rounds instanceSize up to the next multiple of minOffsetAlignment
+            static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
+
+            LveDevice &lveDevice;
+            void *mapped = nullptr;
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+
+            VkDeviceSize bufferSize;
+            uint32_t instanceCount;
+            VkDeviceSize instanceSize;
+            VkDeviceSize alignmentSize;
+            VkBufferUsageFlags usageFlags;
+            VkMemoryPropertyFlags memoryPropertyFlags;
+    };
+}
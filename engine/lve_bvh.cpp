@@ -0,0 +1,565 @@
+#include "lve_bvh.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+
+namespace lve {
+
+    namespace {
+        enum BoxResult { BOX_OUTSIDE, BOX_INSIDE, BOX_INTERSECTING };
+
+        // Only tests the planes still set in planeMask, planes the box is fully in front of are cleared
+        // so the children of a node don't test them again
+        BoxResult classifyBox(const LveFrustum &frustum, const LveAabb &box, uint32_t &planeMask) {
+            glm::vec3 center = box.center();
+            glm::vec3 extent = (box.max - box.min) * .5f;
+            for (uint32_t i = 0; i < LveFrustum::PLANE_COUNT; i++) {
+                if ((planeMask & (1u << i)) == 0) {
+                    continue;
+                }
+                auto &plane = frustum.planes[i];
+                glm::vec3 normal{plane};
+                float distance = glm::dot(normal, center) + plane.w;
+                float reach = glm::dot(extent, glm::abs(normal));
+                if (distance < -reach) {
+                    return BOX_OUTSIDE;
+                }
+                if (distance >= reach) {
+                    planeMask &= ~(1u << i);
+                }
+            }
+            return planeMask == 0 ? BOX_INSIDE : BOX_INTERSECTING;
+        }
+
+        bool sphereOverlaps(const LveAabb &box, const glm::vec3 &center, float radius) {
+            glm::vec3 offset = glm::clamp(center, box.min, box.max) - center;
+            return glm::dot(offset, offset) <= radius * radius;
+        }
+
+        // The ray with its direction inverted once for all the slab tests
+        // A direction component of 0 would invert to infinity, and 0 * infinity is NaN for an origin on a box face,
+        // so those axes are flagged and tested without it
+        struct Ray {
+            glm::vec3 origin;
+            glm::vec3 inverseDirection;
+            bool parallel[3];
+        };
+
+        Ray makeRay(const glm::vec3 &origin, const glm::vec3 &direction) {
+            Ray ray{origin, glm::vec3{0.f}, {}};
+            for (int axis = 0; axis < 3; axis++) {
+                ray.parallel[axis] = direction[axis] == 0.f;
+                ray.inverseDirection[axis] = ray.parallel[axis] ? 0.f : 1.f / direction[axis];
+            }
+            return ray;
+        }
+
+        // Slab test, entry is where the ray enters the box (0 if it starts inside)
+        bool rayOverlaps(const LveAabb &box, const Ray &ray, float maxDistance, float &entry) {
+            float tNear = 0.f;
+            float tFar = maxDistance;
+            for (int axis = 0; axis < 3; axis++) {
+                if (ray.parallel[axis]) {
+                    // Never crosses this slab, so it is either inside it the whole way or never
+                    if (ray.origin[axis] < box.min[axis] || ray.origin[axis] > box.max[axis]) {
+                        return false;
+                    }
+                    continue;
+                }
+                float t1 = (box.min[axis] - ray.origin[axis]) * ray.inverseDirection[axis];
+                float t2 = (box.max[axis] - ray.origin[axis]) * ray.inverseDirection[axis];
+                tNear = std::max(tNear, std::min(t1, t2));
+                tFar = std::min(tFar, std::max(t1, t2));
+            }
+            entry = tNear;
+            return tNear <= tFar;
+        }
+    }
+
+    uint32_t LveBvh::allocateNode() {
+        uint32_t node;
+        if (freeList != NULL_NODE) {
+            node = freeList;
+            freeList = nodes[node].parent;
+        } else {
+            node = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+        }
+        nodes[node] = Node{};
+        return node;
+    }
+
+    void LveBvh::freeNode(uint32_t node) {
+        nodes[node].parent = freeList;
+        nodes[node].height = -1;
+        freeList = node;
+    }
+
+    uint32_t LveBvh::createLeaf(id_t id, const LveAabb &bounds) {
+        if (id >= leafOf.size()) {
+            leafOf.resize(id + 1, NULL_NODE);
+        }
+        assert(leafOf[id] == NULL_NODE && "Object is already in the bvh");
+
+        uint32_t leaf = allocateNode();
+        nodes[leaf].id = id;
+        nodes[leaf].tight = bounds;
+        nodes[leaf].bounds = {bounds.min - glm::vec3{margin}, bounds.max + glm::vec3{margin}};
+        leafOf[id] = leaf;
+        leafCount++;
+        return leaf;
+    }
+
+    void LveBvh::insert(id_t id, const LveAabb &bounds) {
+        insertLeaf(createLeaf(id, bounds));
+    }
+
+    void LveBvh::remove(id_t id) {
+        assert(contains(id) && "Object is not in the bvh");
+        uint32_t leaf = leafOf[id];
+        removeLeaf(leaf);
+        freeNode(leaf);
+        leafOf[id] = NULL_NODE;
+        leafCount--;
+    }
+
+    bool LveBvh::update(id_t id, const LveAabb &bounds) {
+        assert(contains(id) && "Object is not in the bvh");
+        uint32_t leaf = leafOf[id];
+        nodes[leaf].tight = bounds;
+        if (nodes[leaf].bounds.contains(bounds)) {
+            return false;
+        }
+
+        removeLeaf(leaf);
+        nodes[leaf].bounds = {bounds.min - glm::vec3{margin}, bounds.max + glm::vec3{margin}};
+        insertLeaf(leaf);
+        reinsertsSinceRebuild++;
+        return true;
+    }
+
+    void LveBvh::clear() {
+        nodes.clear();
+        leafOf.clear();
+        root = NULL_NODE;
+        freeList = NULL_NODE;
+        leafCount = 0;
+        reinsertsSinceRebuild = 0;
+        reinsertsAtCostCheck = 0;
+        costAfterRebuild = 0.f;
+    }
+
+    void LveBvh::insertBatch(const std::vector<id_t> &ids, const std::vector<LveAabb> &bounds) {
+        assert(ids.size() == bounds.size() && "Need one box per id");
+        if (ids.size() <= leafCount) {
+            for (size_t i = 0; i < ids.size(); i++) {
+                insert(ids[i], bounds[i]);
+            }
+            return;
+        }
+
+        // Leaves are left unlinked, the rebuild picks them up from leafOf
+        for (size_t i = 0; i < ids.size(); i++) {
+            createLeaf(ids[i], bounds[i]);
+        }
+        rebuild();
+    }
+
+    void LveBvh::removeBatch(const std::vector<id_t> &ids) {
+        if (ids.size() * 2 <= leafCount) {
+            for (id_t id : ids) {
+                remove(id);
+            }
+            return;
+        }
+
+        // Removing most of the tree, drop the leaves without unlinking them and build what's left
+        for (id_t id : ids) {
+            assert(contains(id) && "Object is not in the bvh");
+            freeNode(leafOf[id]);
+            leafOf[id] = NULL_NODE;
+            leafCount--;
+        }
+        rebuild();
+    }
+
+    void LveBvh::insertLeaf(uint32_t leaf) {
+        if (root == NULL_NODE) {
+            root = leaf;
+            nodes[leaf].parent = NULL_NODE;
+            return;
+        }
+
+        // Walk down towards the sibling that makes the tree grow the least
+        // Going down a level costs the area every node on the way has to grow by
+        LveAabb leafBounds = nodes[leaf].bounds;
+        uint32_t index = root;
+        while (!nodes[index].isLeaf()) {
+            const Node &node = nodes[index];
+            float area = node.bounds.halfArea();
+            float combinedArea = LveAabb::merge(node.bounds, leafBounds).halfArea();
+
+            // Cost of making a new parent for this node and the leaf
+            float cost = 2.f * combinedArea;
+            // Minimum cost of pushing the leaf further down
+            float inheritanceCost = 2.f * (combinedArea - area);
+
+            auto childCost = [&](uint32_t child) {
+                const LveAabb &childBounds = nodes[child].bounds;
+                float merged = LveAabb::merge(leafBounds, childBounds).halfArea();
+                return nodes[child].isLeaf() ? merged + inheritanceCost : merged - childBounds.halfArea() + inheritanceCost;
+            };
+            float cost1 = childCost(node.child1);
+            float cost2 = childCost(node.child2);
+
+            if (cost < cost1 && cost < cost2) {
+                break;
+            }
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        uint32_t sibling = index;
+        uint32_t oldParent = nodes[sibling].parent;
+        uint32_t newParent = allocateNode(); // can grow nodes, no references held across this
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].bounds = LveAabb::merge(leafBounds, nodes[sibling].bounds);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].child1 = sibling;
+        nodes[newParent].child2 = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+
+        if (oldParent == NULL_NODE) {
+            root = newParent;
+        } else if (nodes[oldParent].child1 == sibling) {
+            nodes[oldParent].child1 = newParent;
+        } else {
+            nodes[oldParent].child2 = newParent;
+        }
+
+        refitAncestors(nodes[leaf].parent);
+    }
+
+    void LveBvh::removeLeaf(uint32_t leaf) {
+        if (leaf == root) {
+            root = NULL_NODE;
+            return;
+        }
+
+        // The parent goes away and the sibling takes its place
+        uint32_t parent = nodes[leaf].parent;
+        uint32_t grandParent = nodes[parent].parent;
+        uint32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+        if (grandParent == NULL_NODE) {
+            root = sibling;
+            nodes[sibling].parent = NULL_NODE;
+            freeNode(parent);
+            return;
+        }
+
+        if (nodes[grandParent].child1 == parent) {
+            nodes[grandParent].child1 = sibling;
+        } else {
+            nodes[grandParent].child2 = sibling;
+        }
+        nodes[sibling].parent = grandParent;
+        freeNode(parent);
+        refitAncestors(grandParent);
+    }
+
+    void LveBvh::refitAncestors(uint32_t node) {
+        while (node != NULL_NODE) {
+            node = balance(node);
+            Node &current = nodes[node];
+            current.height = 1 + std::max(nodes[current.child1].height, nodes[current.child2].height);
+            current.bounds = LveAabb::merge(nodes[current.child1].bounds, nodes[current.child2].bounds);
+            node = current.parent;
+        }
+    }
+
+    // Tree rotation, if one child is more than a level taller than the other its taller child is moved up
+    // Returns the node now at this position
+    uint32_t LveBvh::balance(uint32_t iA) {
+        Node &a = nodes[iA];
+        if (a.isLeaf() || a.height < 2) {
+            return iA;
+        }
+
+        uint32_t iB = a.child1;
+        uint32_t iC = a.child2;
+        Node &b = nodes[iB];
+        Node &c = nodes[iC];
+        int difference = c.height - b.height;
+
+        auto replaceInParent = [&](uint32_t newNode) {
+            uint32_t parent = nodes[newNode].parent;
+            if (parent == NULL_NODE) {
+                root = newNode;
+            } else if (nodes[parent].child1 == iA) {
+                nodes[parent].child1 = newNode;
+            } else {
+                nodes[parent].child2 = newNode;
+            }
+        };
+
+        // Rotate C up
+        if (difference > 1) {
+            uint32_t iF = c.child1;
+            uint32_t iG = c.child2;
+            Node &f = nodes[iF];
+            Node &g = nodes[iG];
+
+            c.child1 = iA;
+            c.parent = a.parent;
+            a.parent = iC;
+            replaceInParent(iC);
+
+            // The taller of C's children stays with C, the other one replaces C under A
+            uint32_t iKeep = f.height > g.height ? iF : iG;
+            uint32_t iMove = f.height > g.height ? iG : iF;
+            c.child2 = iKeep;
+            a.child2 = iMove;
+            nodes[iMove].parent = iA;
+            a.bounds = LveAabb::merge(b.bounds, nodes[iMove].bounds);
+            c.bounds = LveAabb::merge(a.bounds, nodes[iKeep].bounds);
+            a.height = 1 + std::max(b.height, nodes[iMove].height);
+            c.height = 1 + std::max(a.height, nodes[iKeep].height);
+            return iC;
+        }
+
+        // Rotate B up
+        if (difference < -1) {
+            uint32_t iD = b.child1;
+            uint32_t iE = b.child2;
+            Node &d = nodes[iD];
+            Node &e = nodes[iE];
+
+            b.child1 = iA;
+            b.parent = a.parent;
+            a.parent = iB;
+            replaceInParent(iB);
+
+            uint32_t iKeep = d.height > e.height ? iD : iE;
+            uint32_t iMove = d.height > e.height ? iE : iD;
+            b.child2 = iKeep;
+            a.child1 = iMove;
+            nodes[iMove].parent = iA;
+            a.bounds = LveAabb::merge(c.bounds, nodes[iMove].bounds);
+            b.bounds = LveAabb::merge(a.bounds, nodes[iKeep].bounds);
+            a.height = 1 + std::max(c.height, nodes[iMove].height);
+            b.height = 1 + std::max(a.height, nodes[iKeep].height);
+            return iB;
+        }
+
+        return iA;
+    }
+
+    void LveBvh::rebuild() {
+        std::vector<uint32_t> leaves;
+        leaves.reserve(leafCount);
+        forEachId([&](id_t id) { leaves.push_back(leafOf[id]); });
+
+        // Every internal node is thrown away, the leaves keep their fat boxes
+        for (uint32_t node = 0; node < nodes.size(); node++) {
+            if (nodes[node].height > 0) {
+                freeNode(node);
+            }
+        }
+
+        root = leaves.empty() ? NULL_NODE : buildTopDown(leaves.data(), static_cast<uint32_t>(leaves.size()));
+        if (root != NULL_NODE) {
+            nodes[root].parent = NULL_NODE;
+        }
+        reinsertsSinceRebuild = 0;
+        reinsertsAtCostCheck = 0;
+        costAfterRebuild = getCost();
+    }
+
+    uint32_t LveBvh::buildTopDown(uint32_t *leaves, uint32_t count) {
+        if (count == 1) {
+            return leaves[0];
+        }
+
+        // Split at the median of the leaf centers along the axis they are spread the most on,
+        // a median split keeps the depth at log2(count) so the recursion can't run away
+        LveAabb centers{nodes[leaves[0]].bounds.center(), nodes[leaves[0]].bounds.center()};
+        for (uint32_t i = 1; i < count; i++) {
+            glm::vec3 center = nodes[leaves[i]].bounds.center();
+            centers.min = glm::min(centers.min, center);
+            centers.max = glm::max(centers.max, center);
+        }
+        glm::vec3 spread = centers.max - centers.min;
+        int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+
+        uint32_t half = count / 2;
+        std::nth_element(leaves, leaves + half, leaves + count, [&](uint32_t left, uint32_t right) {
+            return nodes[left].bounds.min[axis] + nodes[left].bounds.max[axis] <
+                   nodes[right].bounds.min[axis] + nodes[right].bounds.max[axis];
+        });
+
+        uint32_t child1 = buildTopDown(leaves, half);
+        uint32_t child2 = buildTopDown(leaves + half, count - half);
+        uint32_t node = allocateNode();
+        nodes[node].child1 = child1;
+        nodes[node].child2 = child2;
+        nodes[node].bounds = LveAabb::merge(nodes[child1].bounds, nodes[child2].bounds);
+        nodes[node].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+        nodes[child1].parent = node;
+        nodes[child2].parent = node;
+        return node;
+    }
+
+    void LveBvh::maintain() {
+        if (reinsertsSinceRebuild == 0) {
+            return;
+        }
+        // Measuring the cost walks every node, so only do it every so often
+        constexpr uint32_t COST_CHECK_INTERVAL = REBUILD_INTERVAL / 8;
+        if (reinsertsSinceRebuild >= REBUILD_INTERVAL) {
+            rebuild();
+        } else if (reinsertsSinceRebuild - reinsertsAtCostCheck >= COST_CHECK_INTERVAL) {
+            reinsertsAtCostCheck = reinsertsSinceRebuild;
+            if (getCost() > costAfterRebuild * REBUILD_COST_RATIO) {
+                rebuild();
+            }
+        }
+    }
+
+    float LveBvh::getCost() const {
+        if (root == NULL_NODE || nodes[root].isLeaf()) {
+            return 0.f;
+        }
+        float rootArea = nodes[root].bounds.halfArea();
+        if (rootArea <= 0.f) {
+            return 0.f;
+        }
+        float area = 0.f;
+        for (auto &node : nodes) {
+            if (node.height > 0) {
+                area += node.bounds.halfArea();
+            }
+        }
+        return area / rootArea;
+    }
+
+    template <typename Function>
+    void LveBvh::collectLeaves(uint32_t node, Function function) const {
+        std::vector<uint32_t> stack{node};
+        while (!stack.empty()) {
+            uint32_t index = stack.back();
+            stack.pop_back();
+            if (nodes[index].isLeaf()) {
+                function(nodes[index]);
+            } else {
+                stack.push_back(nodes[index].child1);
+                stack.push_back(nodes[index].child2);
+            }
+        }
+    }
+
+    void LveBvh::queryFrustum(const LveFrustum &frustum, std::vector<id_t> &ids) const {
+        if (root == NULL_NODE) {
+            return;
+        }
+
+        struct Entry {
+            uint32_t node;
+            uint32_t planeMask;
+        };
+        std::vector<Entry> stack;
+        stack.reserve(64);
+        stack.push_back({root, (1u << LveFrustum::PLANE_COUNT) - 1});
+        while (!stack.empty()) {
+            Entry entry = stack.back();
+            stack.pop_back();
+            const Node &node = nodes[entry.node];
+
+            // Fat boxes for the inner nodes, the real box for the leaves
+            BoxResult result = classifyBox(frustum, node.isLeaf() ? node.tight : node.bounds, entry.planeMask);
+            if (result == BOX_OUTSIDE) {
+                continue;
+            }
+            if (node.isLeaf()) {
+                ids.push_back(node.id);
+            } else if (result == BOX_INSIDE) {
+                collectLeaves(entry.node, [&](const Node &leaf) { ids.push_back(leaf.id); });
+            } else {
+                stack.push_back({node.child1, entry.planeMask});
+                stack.push_back({node.child2, entry.planeMask});
+            }
+        }
+    }
+
+    void LveBvh::querySphere(const glm::vec3 &center, float radius, std::vector<id_t> &ids) const {
+        if (root == NULL_NODE) {
+            return;
+        }
+
+        std::vector<uint32_t> stack;
+        stack.reserve(64);
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const Node &node = nodes[stack.back()];
+            stack.pop_back();
+            if (!sphereOverlaps(node.isLeaf() ? node.tight : node.bounds, center, radius)) {
+                continue;
+            }
+            if (node.isLeaf()) {
+                ids.push_back(node.id);
+            } else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+    bool LveBvh::raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, RayHit &hit) const {
+        if (root == NULL_NODE) {
+            return false;
+        }
+
+        Ray ray = makeRay(origin, direction);
+        float closest = maxDistance;
+        bool found = false;
+
+        std::vector<uint32_t> stack;
+        stack.reserve(64);
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const Node &node = nodes[stack.back()];
+            stack.pop_back();
+
+            float entry;
+            if (node.isLeaf()) {
+                if (rayOverlaps(node.tight, ray, closest, entry)) {
+                    closest = entry;
+                    hit = {node.id, entry};
+                    found = true;
+                }
+                continue;
+            }
+            // Anything further away than the closest hit so far can't beat it
+            if (!rayOverlaps(node.bounds, ray, closest, entry)) {
+                continue;
+            }
+
+            // Visit the nearer child first so the closest hit shrinks the search sooner
+            float entry1 = 0.f;
+            float entry2 = 0.f;
+            bool hit1 = rayOverlaps(nodes[node.child1].bounds, ray, closest, entry1);
+            bool hit2 = rayOverlaps(nodes[node.child2].bounds, ray, closest, entry2);
+            if (hit1 && hit2) {
+                bool firstNearer = entry1 <= entry2;
+                stack.push_back(firstNearer ? node.child2 : node.child1);
+                stack.push_back(firstNearer ? node.child1 : node.child2);
+            } else if (hit1) {
+                stack.push_back(node.child1);
+            } else if (hit2) {
+                stack.push_back(node.child2);
+            }
+        }
+        return found;
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "lve_frustum.hpp"
+
+#define GLM_FORCE_RADIANS // Radians must be radians
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // Expect depth values to 0 - 1
+#include <glm/glm.hpp>
+
+//std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+    struct LveAabb {
+        glm::vec3 min{0.f};
+        glm::vec3 max{0.f};
+
+        static LveAabb merge(const LveAabb &a, const LveAabb &b) { return {glm::min(a.min, b.min), glm::max(a.max, b.max)}; }
+
+        // Half the surface area, the constant factor doesn't matter when comparing costs
+        float halfArea() const {
+            glm::vec3 size = max - min;
+            return size.x * size.y + size.y * size.z + size.z * size.x;
+        }
+        bool contains(const LveAabb &other) const {
+            return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+        }
+        glm::vec3 center() const { return (min + max) * .5f; }
+    };
+
+    // Dynamic AABB tree keyed by object id (eg. registry entity), for culling and scene queries
+    // that don't want to scan every object
+    //
+    // Leaves store a "fat" box, grown by a margin, so an object that moves a little stays inside it
+    // and update is free; only objects that leave their fat box are taken out and reinserted
+    // Inserting picks the sibling that grows the tree's surface area the least, and rotations keep it balanced
+    // Many small updates still slowly make the tree worse than a fresh build, so maintain() rebuilds it
+    // top down every so often or when its cost has grown too much
+    class LveBvh {
+        public:
+            using id_t = uint32_t;
+            static constexpr uint32_t NULL_NODE = UINT32_MAX;
+            // Rebuild after this many reinserts, or once the cost has grown by this factor since the last build
+            static constexpr uint32_t REBUILD_INTERVAL = 10000;
+            static constexpr float REBUILD_COST_RATIO = 1.5f;
+
+            struct RayHit {
+                id_t id = 0;
+                float distance = 0.f;
+            };
+
+            explicit LveBvh(float margin = .1f) : margin{margin} {}
+
+            LveBvh(const LveBvh &) = delete;
+            LveBvh &operator=(const LveBvh &) = delete;
+
+            void insert(id_t id, const LveAabb &bounds);
+            void remove(id_t id);
+            // Refit on move, returns true if the object left its fat box and was reinserted
+            bool update(id_t id, const LveAabb &bounds);
+            bool contains(id_t id) const { return id < leafOf.size() && leafOf[id] != NULL_NODE; }
+            void clear();
+
+            // Large batches are cheaper to build from scratch than to insert one leaf at a time
+            void insertBatch(const std::vector<id_t> &ids, const std::vector<LveAabb> &bounds);
+            void removeBatch(const std::vector<id_t> &ids);
+
+            // Top down rebuild, splitting at the median along the widest axis of the leaf centers
+            void rebuild();
+            // Rebuilds if the tree has degraded, call once per frame
+            void maintain();
+
+            // Ids of every object whose box touches the frustum, subtrees fully inside are taken without more tests
+            void queryFrustum(const LveFrustum &frustum, std::vector<id_t> &ids) const;
+            void querySphere(const glm::vec3 &center, float radius, std::vector<id_t> &ids) const;
+            // Closest object whose (tight) box the ray hits within maxDistance, direction doesn't need to be normalized
+            bool raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, RayHit &hit) const;
+
+            uint32_t size() const { return leafCount; }
+            // Used to find removed objects without scanning the whole registry
+            template <typename Function>
+            void forEachId(Function function) const {
+                for (id_t id = 0; id < leafOf.size(); id++) {
+                    if (leafOf[id] != NULL_NODE) {
+                        function(id);
+                    }
+                }
+            }
+            int getHeight() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+            // Sum of the internal node areas relative to the root, lower means queries visit fewer nodes
+            float getCost() const;
+
+        private:
+            struct Node {
+                LveAabb bounds; // fat for leaves
+                LveAabb tight; // leaves only, the object's real box
+                uint32_t parent = NULL_NODE; // next free node while on the free list
+                uint32_t child1 = NULL_NODE;
+                uint32_t child2 = NULL_NODE;
+                id_t id = 0;
+                int height = 0; // leaves are 0, -1 while on the free list
+                bool isLeaf() const { return child1 == NULL_NODE; }
+            };
+
+            uint32_t allocateNode();
+            void freeNode(uint32_t node);
+            uint32_t createLeaf(id_t id, const LveAabb &bounds);
+            void insertLeaf(uint32_t leaf);
+            void removeLeaf(uint32_t leaf);
+            uint32_t balance(uint32_t node);
+            void refitAncestors(uint32_t node);
+            uint32_t buildTopDown(uint32_t *leaves, uint32_t count);
+            template <typename Function>
+            void collectLeaves(uint32_t node, Function function) const;
+
+            float margin;
+            std::vector<Node> nodes;
+            uint32_t root = NULL_NODE;
+            uint32_t freeList = NULL_NODE;
+            uint32_t leafCount = 0;
+            std::vector<uint32_t> leafOf; // id -> leaf node
+
+            uint32_t reinsertsSinceRebuild = 0;
+            uint32_t reinsertsAtCostCheck = 0;
+            float costAfterRebuild = 0.f;
+    };
+}
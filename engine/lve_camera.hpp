@@ -0,0 +1,41 @@
+#pragma once
+
+#include "lve_frustum.hpp"
+
+#define GLM_FORCE_RADIANS // Radians must be radians
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // Expect depth values to 0 - 1
+#include <glm/glm.hpp>
+
+namespace lve {
+    // Projection turns view space into the canonical view volume (x, y in -1..1, z in 0..1)
+    // View moves the world so the camera sits at the origin looking down +z, with y pointing down like vulkan
+    class LveCamera {
+        public:
+            // Box shaped view volume, things don't get smaller with distance
+            void setOrthographicProjection(float left, float right, float top, float bottom, float near, float far);
+            // Frustum shaped view volume, fovy is the vertical field of view in radians
+            void setPerspectiveProjection(float fovy, float aspect, float near, float far);
+
+            void setViewDirection(glm::vec3 position, glm::vec3 direction, glm::vec3 up = glm::vec3{0.f, -1.f, 0.f});
+            void setViewTarget(glm::vec3 position, glm::vec3 target, glm::vec3 up = glm::vec3{0.f, -1.f, 0.f});
+            // Same Y(1) X(2) Z(3) rotation convention as TransformComponent
+            void setViewYXZ(glm::vec3 position, glm::vec3 rotation);
+
+            const glm::mat4 &getProjection() const { return projectionMatrix; }
+            const glm::mat4 &getView() const { return viewMatrix; }
+            glm::mat4 getProjectionView() const { return projectionMatrix * viewMatrix; }
+            // World space planes of the view volume, for culling
+            LveFrustum getFrustum() const { return LveFrustum::fromMatrix(getProjectionView()); }
+            bool isPerspective() const { return perspective; }
+            // View space depth of the near and far planes
+            float getNear() const { return nearPlane; }
+            float getFar() const { return farPlane; }
+
+        private:
+            glm::mat4 projectionMatrix{1.f};
+            glm::mat4 viewMatrix{1.f};
+            bool perspective = false;
+            float nearPlane = 0.f;
+            float farPlane = 1.f;
+    };
+}
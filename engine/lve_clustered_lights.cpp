@@ -0,0 +1,147 @@
+#include "lve_clustered_lights.hpp"
+
+//std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace lve {
+
+    static constexpr uint32_t UBO_BINDING = 0;
+    static constexpr uint32_t LIGHT_BINDING = 1;
+    static constexpr uint32_t CLUSTER_BINDING = 2;
+    static constexpr uint32_t STATS_BINDING = 3;
+    static constexpr uint32_t WORKGROUP_SIZE = 64; // local_size_x of light_cull.comp, one cluster per invocation
+    static constexpr uint32_t STATS_SIZE = 2 * sizeof(uint32_t); // max lights in a cluster, overflowed clusters
+
+    LveClusteredLights::LveClusteredLights(LveDevice &device, LveDescriptorLayoutCache &layoutCache) : lveDevice{device} {
+        createPipeline(layoutCache);
+        for (auto &frame : frames) {
+            frame.clusterBuffer = std::make_unique<LveBuffer>(
+                lveDevice,
+                sizeof(uint32_t) * (MAX_LIGHTS_PER_CLUSTER + 1),
+                CLUSTER_COUNT,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            // Small enough to read where the shader wrote it
+            frame.statsBuffer = std::make_unique<LveBuffer>(
+                lveDevice,
+                STATS_SIZE,
+                1,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            frame.statsBuffer->map();
+        }
+    }
+
+    LveClusteredLights::~LveClusteredLights() {}
+
+    // The binning shader and the fragment shaders share one set, so the lights are only described once a frame
+    void LveClusteredLights::createPipeline(LveDescriptorLayoutCache &layoutCache) {
+        const VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        descriptorSetLayout = layoutCache.getSetLayout({
+            LveDescriptorLayoutCache::binding(UBO_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, stages),
+            LveDescriptorLayoutCache::binding(LIGHT_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, stages),
+            LveDescriptorLayoutCache::binding(CLUSTER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages),
+            LveDescriptorLayoutCache::binding(STATS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+        });
+        pipelineLayout = layoutCache.getPipelineLayout({descriptorSetLayout});
+        cullPipeline = std::make_unique<LveComputePipeline>(lveDevice, "shaders/light_cull.comp.spv", pipelineLayout);
+    }
+
+    void LveClusteredLights::beginFrame(int frameIndex) {
+        auto &frame = frames[frameIndex];
+        frame.ready = false;
+        if (!frame.statsPending) {
+            return;
+        }
+        frame.statsPending = false;
+        auto *values = static_cast<const uint32_t *>(frame.statsBuffer->getMappedMemory());
+        stats.maxLightsPerCluster = values[0];
+        stats.overflowedClusters = values[1];
+    }
+
+    void LveClusteredLights::cull(FrameInfo &frameInfo, const std::vector<PointLight> &lights, VkExtent2D renderExtent) {
+        auto &frame = frames[frameInfo.frameIndex];
+        frame.ready = false;
+        stats.lightCount = static_cast<uint32_t>(lights.size());
+
+        // Lights and parameters only live this frame, like the objects
+        auto &frameRing = frameInfo.frameRing;
+        auto uboAllocation = frameRing.allocateUniform(sizeof(ClusterUbo));
+        // At least one element, so the array has somewhere to start even without lights
+        auto lightArray = frameRing.allocateArray(sizeof(PointLight), std::max<uint32_t>(stats.lightCount, 1));
+        if (!uboAllocation || !lightArray) {
+            return; // the ring grows before the next frame
+        }
+        if (!lights.empty()) {
+            std::memcpy(lightArray.data, lights.data(), sizeof(PointLight) * lights.size());
+        }
+
+        // Exponential slices: slice k starts at near * (far / near)^(k / CLUSTER_Z)
+        auto &camera = frameInfo.camera;
+        float nearPlane = std::max(camera.getNear(), 1e-3f);
+        float farPlane = std::max(camera.getFar(), nearPlane * 1.001f);
+        float logRatio = std::log(farPlane / nearPlane);
+
+        auto *ubo = static_cast<ClusterUbo *>(uboAllocation.data);
+        *ubo = ClusterUbo{};
+        ubo->view = camera.getView();
+        ubo->cameraPosition = glm::inverse(camera.getView())[3];
+        ubo->ambient = glm::vec4{ambient, 0.f};
+        ubo->projectionScale = {camera.getProjection()[0][0], camera.getProjection()[1][1]};
+        ubo->screenSize = {static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height)};
+        ubo->nearPlane = nearPlane;
+        ubo->farPlane = farPlane;
+        ubo->sliceScale = CLUSTER_Z / logRatio;
+        ubo->sliceBias = -CLUSTER_Z * std::log(nearPlane) / logRatio;
+        ubo->lightCount = stats.lightCount;
+        ubo->firstLight = lightArray.regionOffset / static_cast<uint32_t>(sizeof(PointLight));
+
+        frame.descriptorSet = descriptorWriter.clear()
+            .writeBuffer(UBO_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, frameRing.descriptorInfo(sizeof(ClusterUbo)))
+            .writeBuffer(LIGHT_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, frameRing.regionDescriptorInfo())
+            .writeBuffer(CLUSTER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.clusterBuffer->descriptorInfo())
+            .writeBuffer(STATS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.statsBuffer->descriptorInfo())
+            .build(frameInfo.descriptorAllocator, descriptorSetLayout);
+        frame.dynamicOffsets[0] = uboAllocation.offset;
+        frame.dynamicOffsets[1] = frameRing.getRegionOffset();
+
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        vkCmdFillBuffer(commandBuffer, frame.statsBuffer->getBuffer(), 0, STATS_SIZE, 0);
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        auto &recorder = frameInfo.recorder;
+        cullPipeline->bind(recorder);
+        recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &frame.descriptorSet, 2, frame.dynamicOffsets);
+        vkCmdDispatch(commandBuffer, (CLUSTER_COUNT + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+        // The grid is read by this frame's fragment shaders, the stats by the CPU once the fence is signalled
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        frame.statsPending = true;
+        frame.ready = true;
+    }
+
+    bool LveClusteredLights::bind(FrameInfo &frameInfo, VkPipelineLayout graphicsLayout, uint32_t set) {
+        auto &frame = frames[frameInfo.frameIndex];
+        if (!frame.ready) {
+            return false;
+        }
+        frameInfo.recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsLayout, set, 1, &frame.descriptorSet, 2, frame.dynamicOffsets);
+        return true;
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_buffer.hpp"
+#include "lve_compute_pipeline.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_swap_chain.hpp"
+
+#define GLM_FORCE_RADIANS // Radians must be radians
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // Expect depth values to 0 - 1
+#include <glm/glm.hpp>
+
+//std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lve {
+    // Clustered forward lighting: the view volume is cut into a grid of froxels (screen tiles x depth slices)
+    // and a compute pass lists the point lights touching each one, every frame
+    // A fragment then only loops over the lights of its own cluster instead of all of them
+    //
+    // Depth slices are spaced exponentially between the camera's near and far planes, so clusters stay
+    // roughly cube shaped instead of getting long and thin in the distance
+    // Every cluster has room for MAX_LIGHTS_PER_CLUSTER lights, the rest are dropped and counted in the stats
+    //
+    // The lights, the grid and the parameters are all in one descriptor set, used by the binning compute
+    // shader and bound by render systems for their fragment shaders (see lit_shader.frag)
+    class LveClusteredLights {
+        public:
+            // Has to match light_cull.comp and lit_shader.frag
+            static constexpr uint32_t CLUSTER_X = 16;
+            static constexpr uint32_t CLUSTER_Y = 9;
+            static constexpr uint32_t CLUSTER_Z = 24;
+            static constexpr uint32_t CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+            static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 127; // plus the count makes 512 bytes per cluster
+
+            // std430, an array of them in the frame ring buffer
+            struct PointLight {
+                glm::vec4 positionRadius{0.f, 0.f, 0.f, 1.f}; // world space, the light reaches 0 at the radius
+                glm::vec4 color{1.f}; // rgb, w is the intensity
+            };
+
+            // Of the newest frame the GPU finished, read back without waiting
+            struct Stats {
+                uint32_t lightCount = 0;
+                uint32_t maxLightsPerCluster = 0; // before clamping to MAX_LIGHTS_PER_CLUSTER
+                uint32_t overflowedClusters = 0;
+            };
+
+            LveClusteredLights(LveDevice &device, LveDescriptorLayoutCache &layoutCache);
+            ~LveClusteredLights();
+
+            LveClusteredLights(const LveClusteredLights &) = delete;
+            LveClusteredLights &operator=(const LveClusteredLights &) = delete;
+
+            // For the pipeline layouts of render systems that shade with the lights
+            VkDescriptorSetLayout getSetLayout() const { return descriptorSetLayout; }
+            void setAmbient(glm::vec3 color) { ambient = color; }
+
+            // Call after the fence wait for frameIndex, picks up the stats of the last frame in this slot
+            void beginFrame(int frameIndex);
+            // Uploads the lights and records the binning for a camera drawing renderExtent pixels, outside render passes
+            // Ends with a barrier, so the fragment shaders of the frame see the finished grid
+            void cull(FrameInfo &frameInfo, const std::vector<PointLight> &lights, VkExtent2D renderExtent);
+            // Binds the set cull wrote this frame at index set of a graphics pipeline layout
+            // Returns false if cull couldn't run (the frame ring overflowed), nothing can be shaded then
+            bool bind(FrameInfo &frameInfo, VkPipelineLayout pipelineLayout, uint32_t set);
+
+            const Stats &getStats() const { return stats; }
+
+        private:
+            // std140, same for every cluster and fragment of the frame
+            struct ClusterUbo {
+                glm::mat4 view{1.f};
+                glm::vec4 cameraPosition{0.f};
+                glm::vec4 ambient{0.f};
+                glm::vec2 projectionScale{1.f}; // projection[0][0] and [1][1], view space x and y per unit of depth
+                glm::vec2 screenSize{1.f}; // pixels the grid is spread over
+                float nearPlane = 0.f;
+                float farPlane = 1.f;
+                float sliceScale = 0.f; // slice = log(depth) * sliceScale + sliceBias
+                float sliceBias = 0.f;
+                uint32_t lightCount = 0;
+                uint32_t firstLight = 0; // index of the frame's first light in the ring region
+                uint32_t padding[2] = {0, 0};
+            };
+
+            // The grid is written by the GPU, so every frame in flight has its own
+            struct FrameResources {
+                std::unique_ptr<LveBuffer> clusterBuffer; // per cluster a count then MAX_LIGHTS_PER_CLUSTER indices
+                std::unique_ptr<LveBuffer> statsBuffer; // host visible, the shader's atomics land here
+                bool statsPending = false;
+                // Written by cull, bound by bind
+                bool ready = false;
+                VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+                uint32_t dynamicOffsets[2] = {0, 0};
+            };
+
+            void createPipeline(LveDescriptorLayoutCache &layoutCache);
+
+            LveDevice &lveDevice;
+            VkDescriptorSetLayout descriptorSetLayout; // owned by the layout cache
+            VkPipelineLayout pipelineLayout; // owned by the layout cache
+            LveDescriptorWriter descriptorWriter{lveDevice};
+            std::unique_ptr<LveComputePipeline> cullPipeline;
+            std::array<FrameResources, LveSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+            glm::vec3 ambient{.1f};
+            Stats stats{};
+    };
+}
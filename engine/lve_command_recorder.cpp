@@ -0,0 +1,165 @@
+#include "lve_command_recorder.hpp"
+
+//std
+#include <cassert>
+#include <cstring>
+
+namespace lve {
+
+    uint32_t LveCommandRecorder::Stats::totalEmitted() const {
+        uint32_t total = 0;
+        for (uint32_t count : emitted) {
+            total += count;
+        }
+        return total;
+    }
+
+    uint32_t LveCommandRecorder::Stats::totalSkipped() const {
+        uint32_t total = 0;
+        for (uint32_t count : skipped) {
+            total += count;
+        }
+        return total;
+    }
+
+    void LveCommandRecorder::begin(VkCommandBuffer buffer) {
+        commandBuffer = buffer;
+        stats = Stats{};
+        invalidate();
+    }
+
+    void LveCommandRecorder::invalidate() {
+        bindPoints = {};
+        vertexBindings = {};
+        indexBufferValid = false;
+        pushConstantLayout = VK_NULL_HANDLE;
+        pushConstantStages = 0;
+        pushConstantValid.reset();
+        viewportValid = false;
+        scissorValid = false;
+    }
+
+    void LveCommandRecorder::count(CommandType type, bool emitted) {
+        if (emitted) {
+            stats.emitted[type]++;
+        } else {
+            stats.skipped[type]++;
+        }
+    }
+
+    void LveCommandRecorder::bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline) {
+        auto &state = bindPoints[bindPointIndex(bindPoint)];
+        bool changed = state.pipeline != pipeline;
+        count(PIPELINE, changed);
+        if (changed) {
+            vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
+            state.pipeline = pipeline;
+        }
+    }
+
+    void LveCommandRecorder::bindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer *buffers, const VkDeviceSize *offsets) {
+        assert(firstBinding + bindingCount <= MAX_VERTEX_BINDINGS && "Vertex binding is not tracked");
+        bool changed = false;
+        for (uint32_t i = 0; i < bindingCount; i++) {
+            auto &binding = vertexBindings[firstBinding + i];
+            changed = changed || !binding.valid || binding.buffer != buffers[i] || binding.offset != offsets[i];
+        }
+        count(VERTEX_BUFFER, changed);
+        if (!changed) {
+            return;
+        }
+
+        vkCmdBindVertexBuffers(commandBuffer, firstBinding, bindingCount, buffers, offsets);
+        for (uint32_t i = 0; i < bindingCount; i++) {
+            vertexBindings[firstBinding + i] = {true, buffers[i], offsets[i]};
+        }
+    }
+
+    void LveCommandRecorder::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType type) {
+        bool changed = !indexBufferValid || indexBuffer != buffer || indexOffset != offset || indexType != type;
+        count(INDEX_BUFFER, changed);
+        if (changed) {
+            vkCmdBindIndexBuffer(commandBuffer, buffer, offset, type);
+            indexBufferValid = true;
+            indexBuffer = buffer;
+            indexOffset = offset;
+            indexType = type;
+        }
+    }
+
+    void LveCommandRecorder::bindDescriptorSets(VkPipelineBindPoint bindPoint,
+                                                VkPipelineLayout layout,
+                                                uint32_t firstSet,
+                                                uint32_t setCount,
+                                                const VkDescriptorSet *sets,
+                                                uint32_t dynamicOffsetCount,
+                                                const uint32_t *dynamicOffsets) {
+        assert(firstSet + setCount <= MAX_DESCRIPTOR_SETS && "Descriptor set index is not tracked");
+        auto &state = bindPoints[bindPointIndex(bindPoint)];
+
+        bool changed = state.layout != layout || dynamicOffsetCount > 0;
+        for (uint32_t i = 0; i < setCount && !changed; i++) {
+            auto &binding = state.sets[firstSet + i];
+            changed = !binding.valid || binding.hasDynamicOffsets || binding.set != sets[i];
+        }
+        count(DESCRIPTOR_SET, changed);
+        if (!changed) {
+            return;
+        }
+
+        vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, firstSet, setCount, sets, dynamicOffsetCount, dynamicOffsets);
+        // A different layout may disturb sets that are already bound, only trust the ones just bound
+        if (state.layout != layout) {
+            state.sets = {};
+            state.layout = layout;
+        }
+        for (uint32_t i = 0; i < setCount; i++) {
+            state.sets[firstSet + i] = {true, sets[i], dynamicOffsetCount > 0};
+        }
+    }
+
+    void LveCommandRecorder::pushConstants(VkPipelineLayout layout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void *values) {
+        assert(offset + size <= MAX_PUSH_CONSTANT_SIZE && "Push constant range is not tracked");
+        if (pushConstantLayout != layout || pushConstantStages != stageFlags) {
+            pushConstantValid.reset();
+            pushConstantLayout = layout;
+            pushConstantStages = stageFlags;
+        }
+
+        bool changed = false;
+        for (uint32_t i = offset; i < offset + size && !changed; i++) {
+            changed = !pushConstantValid[i];
+        }
+        changed = changed || memcmp(&pushConstantData[offset], values, size) != 0;
+        count(PUSH_CONSTANT, changed);
+        if (!changed) {
+            return;
+        }
+
+        vkCmdPushConstants(commandBuffer, layout, stageFlags, offset, size, values);
+        memcpy(&pushConstantData[offset], values, size);
+        for (uint32_t i = offset; i < offset + size; i++) {
+            pushConstantValid.set(i);
+        }
+    }
+
+    void LveCommandRecorder::setViewport(const VkViewport &newViewport) {
+        bool changed = !viewportValid || memcmp(&viewport, &newViewport, sizeof(VkViewport)) != 0;
+        count(VIEWPORT, changed);
+        if (changed) {
+            vkCmdSetViewport(commandBuffer, 0, 1, &newViewport);
+            viewport = newViewport;
+            viewportValid = true;
+        }
+    }
+
+    void LveCommandRecorder::setScissor(const VkRect2D &newScissor) {
+        bool changed = !scissorValid || memcmp(&scissor, &newScissor, sizeof(VkRect2D)) != 0;
+        count(SCISSOR, changed);
+        if (changed) {
+            vkCmdSetScissor(commandBuffer, 0, 1, &newScissor);
+            scissor = newScissor;
+            scissorValid = true;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+//std
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+namespace lve {
+    // Thin wrapper around a VkCommandBuffer that remembers the state it has bound
+    // Binds, push constants and dynamic state identical to what is already set are skipped,
+    // so render systems can bind unconditionally without paying for it
+    //
+    // Anything recorded straight to the VkCommandBuffer bypasses the tracking,
+    // call invalidate() afterwards so the next bind is emitted again
+    class LveCommandRecorder {
+        public:
+            enum CommandType {
+                PIPELINE = 0,
+                VERTEX_BUFFER,
+                INDEX_BUFFER,
+                DESCRIPTOR_SET,
+                PUSH_CONSTANT,
+                VIEWPORT,
+                SCISSOR,
+                COMMAND_TYPE_COUNT
+            };
+
+            struct Stats {
+                std::array<uint32_t, COMMAND_TYPE_COUNT> emitted{};
+                std::array<uint32_t, COMMAND_TYPE_COUNT> skipped{};
+
+                uint32_t totalEmitted() const;
+                uint32_t totalSkipped() const;
+            };
+
+            static constexpr uint32_t MAX_VERTEX_BINDINGS = 8;
+            static constexpr uint32_t MAX_DESCRIPTOR_SETS = 8;
+            static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128; // the guaranteed minimum maxPushConstantsSize
+
+            LveCommandRecorder() = default;
+
+            LveCommandRecorder(const LveCommandRecorder &) = delete;
+            LveCommandRecorder &operator=(const LveCommandRecorder &) = delete;
+
+            // Starts tracking a freshly begun command buffer, forgets all state and resets the stats
+            void begin(VkCommandBuffer commandBuffer);
+            // Forgets the tracked state but keeps the stats
+            void invalidate();
+
+            VkCommandBuffer getCommandBuffer() const { return commandBuffer; }
+            const Stats &getStats() const { return stats; }
+
+            void bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline);
+            void bindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer *buffers, const VkDeviceSize *offsets);
+            void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+            void bindDescriptorSets(VkPipelineBindPoint bindPoint,
+                                    VkPipelineLayout layout,
+                                    uint32_t firstSet,
+                                    uint32_t setCount,
+                                    const VkDescriptorSet *sets,
+                                    uint32_t dynamicOffsetCount = 0,
+                                    const uint32_t *dynamicOffsets = nullptr);
+            void pushConstants(VkPipelineLayout layout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void *values);
+            void setViewport(const VkViewport &viewport);
+            void setScissor(const VkRect2D &scissor);
+
+        private:
+            // Compute and graphics have separate bind points with separate state
+            static uint32_t bindPointIndex(VkPipelineBindPoint bindPoint) { return bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? 1 : 0; }
+
+            struct VertexBinding {
+                bool valid = false;
+                VkBuffer buffer = VK_NULL_HANDLE;
+                VkDeviceSize offset = 0;
+            };
+
+            struct DescriptorBinding {
+                bool valid = false;
+                VkDescriptorSet set = VK_NULL_HANDLE;
+                // Sets with dynamic offsets are always rebound, the offsets are what changes between draws
+                bool hasDynamicOffsets = false;
+            };
+
+            struct BindPointState {
+                VkPipeline pipeline = VK_NULL_HANDLE;
+                VkPipelineLayout layout = VK_NULL_HANDLE;
+                std::array<DescriptorBinding, MAX_DESCRIPTOR_SETS> sets{};
+            };
+
+            void count(CommandType type, bool emitted);
+
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            Stats stats{};
+
+            std::array<BindPointState, 2> bindPoints{};
+            std::array<VertexBinding, MAX_VERTEX_BINDINGS> vertexBindings{};
+
+            bool indexBufferValid = false;
+            VkBuffer indexBuffer = VK_NULL_HANDLE;
+            VkDeviceSize indexOffset = 0;
+            VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+            // Copy of the last pushed bytes, with a bit per byte saying whether it is known
+            VkPipelineLayout pushConstantLayout = VK_NULL_HANDLE;
+            VkShaderStageFlags pushConstantStages = 0;
+            std::array<uint8_t, MAX_PUSH_CONSTANT_SIZE> pushConstantData{};
+            std::bitset<MAX_PUSH_CONSTANT_SIZE> pushConstantValid{};
+
+            bool viewportValid = false;
+            VkViewport viewport{};
+            bool scissorValid = false;
+            VkRect2D scissor{};
+    };
+}
@@ -0,0 +1,72 @@
+#include "lve_compute_pipeline.hpp"
+
+#include "lve_pipeline.hpp"
+
+//std
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+    LveComputePipeline::LveComputePipeline(LveDevice& device,
+                                           const std::string& compFilepath,
+                                           VkPipelineLayout pipelineLayout)
+                                           : lveDevice{device} {
+        createComputePipeline(compFilepath, pipelineLayout);
+    }
+
+    LveComputePipeline::~LveComputePipeline() {
+        vkDestroyShaderModule(lveDevice.device(), compShaderModule, nullptr);
+        vkDestroyPipeline(lveDevice.device(), computePipeline, nullptr);
+    }
+
+    // Compute pipelines have their own bind point, so binding one doesn't disturb the bound graphics pipeline
+    void LveComputePipeline::bind(VkCommandBuffer commandBuffer) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+    }
+
+    void LveComputePipeline::bind(LveCommandRecorder &recorder) {
+        recorder.bindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+    }
+
+    void LveComputePipeline::createComputePipeline(const std::string& compFilepath, VkPipelineLayout pipelineLayout) {
+        assert(
+            pipelineLayout != VK_NULL_HANDLE &&
+            "Cannot create compute pipeline:: no pipelineLayout provided"
+        );
+
+        auto compCode = LvePipeline::readFile(compFilepath);
+
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = compCode.size();
+        createInfo.pCode = reinterpret_cast<const uint32_t*>(compCode.data());
+
+        if (vkCreateShaderModule(lveDevice.device(), &createInfo, nullptr, &compShaderModule) != VK_SUCCESS){
+            throw std::runtime_error("failed to create shader module");
+        }
+
+        VkPipelineShaderStageCreateInfo shaderStage{};
+        shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shaderStage.module = compShaderModule;
+        shaderStage.pName = "main"; // name of the function in the shader file
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = shaderStage;
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.basePipelineIndex = -1;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        if (vkCreateComputePipelines(
+                lveDevice.device(),
+                VK_NULL_HANDLE,
+                1, // pipeline count
+                &pipelineInfo,
+                nullptr,
+                &computePipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute pipeline");
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_command_recorder.hpp"
+
+#include <string>
+#include <vector>
+
+namespace lve {
+    // Compute pipelines only have a single shader stage and no fixed function state,
+    // so they don't need a PipelineConfigInfo like LvePipeline does
+    class LveComputePipeline {
+        public:
+            LveComputePipeline(LveDevice& device,
+                               const std::string& compFilepath,
+                               VkPipelineLayout pipelineLayout);
+
+            ~LveComputePipeline();
+
+            LveComputePipeline(const LveComputePipeline&) = delete;
+            LveComputePipeline& operator=(const LveComputePipeline&) = delete;
+
+            void bind(VkCommandBuffer commandBuffer);
+            void bind(LveCommandRecorder &recorder);
+
+        private:
+            void createComputePipeline(const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+
+            LveDevice &lveDevice;
+            VkPipeline computePipeline;
+            VkShaderModule compShaderModule;
+    };
+}
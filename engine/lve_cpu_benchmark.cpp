@@ -0,0 +1,605 @@
+#include "lve_cpu_benchmark.hpp"
+#include "lve_bvh.hpp"
+#include "lve_job_system.hpp"
+#include "lve_object_pool.hpp"
+#include "lve_registry.hpp"
+#include "lve_transform_batch.hpp"
+#include "lve_transform_component.hpp"
+
+// Libs
+#include <glm/gtc/constants.hpp>
+
+//std
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <unordered_map>
+
+namespace lve {
+
+    namespace {
+        volatile double consumedValue = 0.;
+
+        // Same seed every run, so the variants and runs see the same data
+        constexpr uint32_t SEED = 1234;
+
+        // The per object struct the registry replaced: a shared pointer to the model, a color and the transform,
+        // kept in a vector (the original FirstApp::gameObjects) or in a map keyed by id
+        struct LegacyGameObject {
+            uint32_t id = 0;
+            std::shared_ptr<LveModel> model{};
+            glm::vec3 color{1.f, 1.f, 1.f};
+            TransformComponent transform{};
+        };
+
+        bool closeEnough(double a, double b) {
+            return std::abs(a - b) <= 1e-9 * std::max(std::abs(a), std::abs(b));
+        }
+
+        // Largest difference between two world matrices, relative to the size of what is compared
+        float worldError(const glm::mat4 &a, const glm::mat4 &b) {
+            float error = 0.f;
+            for (int column = 0; column < 4; column++) {
+                for (int row = 0; row < 4; row++) {
+                    error = std::max(error, std::abs(a[column][row] - b[column][row]) / std::max(1.f, std::abs(b[column][row])));
+                }
+            }
+            return error;
+        }
+
+        // Every world matrix recomputed from the transforms, parents must come before their children
+        // What a scene graph without cached matrices does every frame, and the reference the registry is checked against
+        void computeWorldMatrices(const std::vector<TransformComponent> &transforms, const std::vector<uint32_t> &parents,
+                                  std::vector<glm::mat4> &world) {
+            for (size_t i = 0; i < transforms.size(); i++) {
+                glm::mat4 local = TransformComponent{transforms[i]}.mat4();
+                world[i] = parents[i] == LveHierarchy::NONE ? local : world[parents[i]] * local;
+            }
+        }
+
+        // What LveBvh's queries do per node, done for every object instead
+        bool boxInFrustum(const LveFrustum &frustum, const LveAabb &box) {
+            glm::vec3 center = box.center();
+            glm::vec3 extent = (box.max - box.min) * .5f;
+            for (auto &plane : frustum.planes) {
+                glm::vec3 normal{plane};
+                if (glm::dot(normal, center) + plane.w < -glm::dot(extent, glm::abs(normal))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool boxInSphere(const LveAabb &box, const glm::vec3 &center, float radius) {
+            glm::vec3 offset = glm::clamp(center, box.min, box.max) - center;
+            return glm::dot(offset, offset) <= radius * radius;
+        }
+
+        // Slab test one axis at a time, an axis the ray runs parallel to only checks the origin is in the slab
+        bool rayHitsBox(const LveAabb &box, const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, float &entry) {
+            float tNear = 0.f;
+            float tFar = maxDistance;
+            for (int axis = 0; axis < 3; axis++) {
+                if (direction[axis] == 0.f) {
+                    if (origin[axis] < box.min[axis] || origin[axis] > box.max[axis]) {
+                        return false;
+                    }
+                    continue;
+                }
+                // Multiplying by the inverse like LveBvh does, dividing rounds differently
+                float inverseDirection = 1.f / direction[axis];
+                float t1 = (box.min[axis] - origin[axis]) * inverseDirection;
+                float t2 = (box.max[axis] - origin[axis]) * inverseDirection;
+                tNear = std::max(tNear, std::min(t1, t2));
+                tFar = std::min(tFar, std::max(t1, t2));
+            }
+            entry = tNear;
+            return tNear <= tFar;
+        }
+
+        // A 90 degree camera at position looking down +z, built from its planes so it needs no projection matrix
+        LveFrustum frustumAt(const glm::vec3 &position, float farDistance) {
+            const float s = std::sqrt(.5f);
+            LveFrustum frustum{};
+            frustum.planes[LveFrustum::PLANE_LEFT] = {s, 0.f, s, 0.f};
+            frustum.planes[LveFrustum::PLANE_RIGHT] = {-s, 0.f, s, 0.f};
+            frustum.planes[LveFrustum::PLANE_BOTTOM] = {0.f, s, s, 0.f};
+            frustum.planes[LveFrustum::PLANE_TOP] = {0.f, -s, s, 0.f};
+            frustum.planes[LveFrustum::PLANE_NEAR] = {0.f, 0.f, 1.f, -.1f};
+            frustum.planes[LveFrustum::PLANE_FAR] = {0.f, 0.f, -1.f, farDistance};
+            for (auto &plane : frustum.planes) {
+                plane.w -= glm::dot(glm::vec3{plane}, position);
+            }
+            return frustum;
+        }
+
+        // Largest difference between two model matrices, in float epsilons of each column's size: the axis scale for
+        // the rotation columns, the translation (or 1 near the origin) for the last
+        float matrixError(const glm::mat4 &a, const glm::mat4 &b, const glm::vec3 &scale, const glm::vec3 &translation) {
+            float columnSizes[4] = {std::abs(scale.x), std::abs(scale.y), std::abs(scale.z),
+                                    std::max({1.f, std::abs(translation.x), std::abs(translation.y), std::abs(translation.z)})};
+            float error = 0.f;
+            for (int column = 0; column < 4; column++) {
+                for (int row = 0; row < 4; row++) {
+                    error = std::max(error, std::abs(a[column][row] - b[column][row]) / (columnSizes[column] * FLT_EPSILON));
+                }
+            }
+            return error;
+        }
+    }
+
+    LveCpuBenchmark::LveCpuBenchmark(const std::string &name, uint32_t repetitions)
+        : name{name}, repetitions{std::max(repetitions, 1u)} {}
+
+    void LveCpuBenchmark::run(const std::string &variant, uint64_t itemCount, const std::function<void()> &body) {
+        body();
+
+        VariantResult result{variant, itemCount};
+        for (uint32_t i = 0; i < repetitions; i++) {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            result.bestMilliseconds = i == 0 ? milliseconds : std::min(result.bestMilliseconds, milliseconds);
+            result.sumMilliseconds += milliseconds;
+        }
+        results.push_back(result);
+    }
+
+    void LveCpuBenchmark::report(std::ostream &out) const {
+        auto previousPrecision = out.precision(3);
+        out << "[benchmark] " << name << ", best of " << repetitions << std::endl;
+        for (auto &result : results) {
+            double nanosecondsPerItem = result.bestMilliseconds * 1e6 / static_cast<double>(std::max<uint64_t>(result.itemCount, 1));
+            out << "  " << result.name << ": " << result.bestMilliseconds << " ms (mean " << result.sumMilliseconds / repetitions
+                << "), " << nanosecondsPerItem << " ns per item";
+            if (&result != &results.front() && result.bestMilliseconds > 0.) {
+                out << ", " << results.front().bestMilliseconds / result.bestMilliseconds << "x";
+            }
+            out << std::endl;
+        }
+        out.precision(previousPrecision);
+    }
+
+    void LveCpuBenchmark::consume(double value) {
+        consumedValue = consumedValue + value;
+    }
+
+    bool benchmarkRegistry(uint32_t entityCount) {
+        std::cout << "[benchmark] registry, " << entityCount << " entities" << std::endl;
+
+        std::vector<LegacyGameObject> objectVector(entityCount);
+        std::unordered_map<uint32_t, LegacyGameObject> objectMap;
+        objectMap.reserve(entityCount);
+        LveRegistry registry;
+        registry.reserve(entityCount);
+
+        std::mt19937 random{SEED};
+        std::uniform_real_distribution<float> distribution{-10.f, 10.f};
+        for (uint32_t i = 0; i < entityCount; i++) {
+            LegacyGameObject &object = objectVector[i];
+            object.id = i;
+            object.transform.translation = {distribution(random), distribution(random), distribution(random)};
+            object.transform.rotation = {distribution(random), distribution(random), distribution(random)};
+            object.color = {.5f, .5f, .5f};
+
+            LegacyGameObject &mapped = objectMap[i];
+            mapped.id = i;
+            mapped.transform = object.transform;
+            mapped.color = object.color;
+
+            uint32_t index = registry.indexOf(registry.create());
+            registry.setTransform(index, object.transform);
+            registry.setColor(index, object.color);
+        }
+
+        // A pass that only reads transforms, eg. sorting by depth
+        double sums[3] = {};
+        LveCpuBenchmark read{"read every translation"};
+        read.run("game object map", entityCount, [&]() {
+            double sum = 0.;
+            for (auto &entry : objectMap) {
+                const glm::vec3 &translation = entry.second.transform.translation;
+                sum += translation.x + translation.y + translation.z;
+            }
+            sums[0] = sum;
+            LveCpuBenchmark::consume(sum);
+        });
+        read.run("game object vector", entityCount, [&]() {
+            double sum = 0.;
+            for (auto &object : objectVector) {
+                const glm::vec3 &translation = object.transform.translation;
+                sum += translation.x + translation.y + translation.z;
+            }
+            sums[1] = sum;
+            LveCpuBenchmark::consume(sum);
+        });
+        read.run("registry arrays", entityCount, [&]() {
+            double sum = 0.;
+            for (auto &translation : registry.getTranslations()) {
+                sum += translation.x + translation.y + translation.z;
+            }
+            sums[2] = sum;
+            LveCpuBenchmark::consume(sum);
+        });
+        read.report(std::cout);
+
+        // A pass that writes one component, eg. the spinning animation. The registry's goes through
+        // editRotations, which marks the range changed once, the change tracking the others don't have
+        constexpr float STEP = .01f;
+        LveCpuBenchmark write{"advance every rotation"};
+        write.run("game object map", entityCount, [&]() {
+            for (auto &entry : objectMap) {
+                entry.second.transform.rotation.y += STEP;
+            }
+        });
+        write.run("game object vector", entityCount, [&]() {
+            for (auto &object : objectVector) {
+                object.transform.rotation.y += STEP;
+            }
+        });
+        write.run("registry arrays", entityCount, [&]() {
+            glm::vec3 *rotations = registry.editRotations(0, entityCount);
+            for (uint32_t i = 0; i < entityCount; i++) {
+                rotations[i].y += STEP;
+            }
+        });
+        write.report(std::cout);
+
+        // Every layout went through the same steps, so they have to agree exactly
+        bool matches = closeEnough(sums[0], sums[1]) && closeEnough(sums[1], sums[2]);
+        auto &rotations = registry.getRotations();
+        for (uint32_t i = 0; i < entityCount && matches; i++) {
+            matches = objectVector[i].transform.rotation == rotations[i] && objectMap[i].transform.rotation == rotations[i];
+        }
+        if (!matches) {
+            std::cout << "  layouts disagree!" << std::endl;
+        }
+        return matches;
+    }
+
+    bool benchmarkTransforms(uint32_t objectCount) {
+        std::cout << "[benchmark] transforms, " << objectCount << " objects, " << LveTransformBatch::getBackendName() << std::endl;
+
+        // Rotations in the range the simulation wraps them to, scales a few times either way of 1
+        std::vector<TransformComponent> transforms(objectCount);
+        std::vector<glm::vec3> translations(objectCount), rotations(objectCount), scales(objectCount);
+        std::mt19937 random{SEED};
+        std::uniform_real_distribution<float> positions{-100.f, 100.f};
+        std::uniform_real_distribution<float> angles{0.f, glm::two_pi<float>()};
+        std::uniform_real_distribution<float> sizes{.1f, 4.f};
+        for (uint32_t i = 0; i < objectCount; i++) {
+            transforms[i].translation = translations[i] = {positions(random), positions(random), positions(random)};
+            transforms[i].rotation = rotations[i] = {angles(random), angles(random), angles(random)};
+            transforms[i].scale = scales[i] = {sizes(random), sizes(random), sizes(random)};
+        }
+
+        std::vector<glm::mat4> expected(objectCount), scalar(objectCount), batched(objectCount);
+        LveCpuBenchmark timing{"model matrices"};
+        timing.run("TransformComponent::mat4", objectCount, [&]() {
+            for (uint32_t i = 0; i < objectCount; i++) {
+                expected[i] = transforms[i].mat4();
+            }
+        });
+        timing.run("batch scalar", objectCount, [&]() {
+            LveTransformBatch::computeMatricesScalar(translations.data(), rotations.data(), scales.data(), objectCount, scalar.data());
+        });
+        timing.run(std::string{"batch "} + LveTransformBatch::getBackendName(), objectCount, [&]() {
+            LveTransformBatch::computeMatrices(translations.data(), rotations.data(), scales.data(), objectCount, batched.data());
+        });
+        timing.report(std::cout);
+
+        // The closed form rounds differently from GLM's chain of 4x4 multiplies, so it can't match bit for bit,
+        // but it must stay within a few ulps of it
+        constexpr float TOLERANCE = 8.f; // float epsilons of the column's size
+        float scalarError = 0.f;
+        float batchedError = 0.f;
+        for (uint32_t i = 0; i < objectCount; i++) {
+            scalarError = std::max(scalarError, matrixError(scalar[i], expected[i], scales[i], translations[i]));
+            batchedError = std::max(batchedError, matrixError(batched[i], expected[i], scales[i], translations[i]));
+        }
+        std::cout << "  largest difference from mat4, in epsilons of the column: scalar " << scalarError
+                  << ", " << LveTransformBatch::getBackendName() << " " << batchedError << std::endl;
+        bool matches = scalarError <= TOLERANCE && batchedError <= TOLERANCE;
+        if (!matches) {
+            std::cout << "  batch matrices differ from mat4!" << std::endl;
+        }
+        return matches;
+    }
+
+    bool benchmarkHierarchy(uint32_t nodeCount) {
+        std::cout << "[benchmark] hierarchy, " << nodeCount << " nodes" << std::endl;
+        LveJobSystem jobSystem;
+        bool matches = true;
+
+        // Parent of node i, always a smaller index so the nodes are created parents first
+        struct Shape {
+            const char *name;
+            std::function<uint32_t(uint32_t)> parentOf;
+        };
+        constexpr uint32_t CHAIN_LENGTH = 10000; // deeper than a task, so the spine holds most of it
+        constexpr uint32_t BRANCHING = 8;
+        const Shape shapes[] = {
+            {"deep (chains of 10000)", [](uint32_t i) { return i % CHAIN_LENGTH == 0 ? LveHierarchy::NONE : i - 1; }},
+            {"wide (one root)", [](uint32_t i) { return i == 0 ? LveHierarchy::NONE : 0; }},
+            {"bushy (8 children per node)", [](uint32_t i) { return i == 0 ? LveHierarchy::NONE : (i - 1) / BRANCHING; }},
+        };
+
+        for (auto &shape : shapes) {
+            std::mt19937 random{SEED};
+            // Small steps, so a deep chain doesn't carry its children off too far for float precision
+            std::uniform_real_distribution<float> offsets{-1.f, 1.f};
+            std::uniform_real_distribution<float> angles{0.f, .1f};
+
+            std::vector<TransformComponent> transforms(nodeCount);
+            std::vector<uint32_t> parents(nodeCount);
+            std::vector<uint32_t> roots;
+            LveRegistry registry;
+            registry.reserve(nodeCount);
+            for (uint32_t i = 0; i < nodeCount; i++) {
+                transforms[i].translation = {offsets(random), offsets(random), offsets(random)};
+                transforms[i].rotation = {angles(random), angles(random), angles(random)};
+                parents[i] = shape.parentOf(i);
+                if (parents[i] == LveHierarchy::NONE) {
+                    roots.push_back(i);
+                }
+
+                auto entity = registry.create();
+                registry.setTransform(registry.indexOf(entity), transforms[i]);
+                if (parents[i] != LveHierarchy::NONE) {
+                    registry.setParent(entity, registry.getEntities()[parents[i]]);
+                }
+            }
+            registry.updateMatrices(&jobSystem);
+
+            std::vector<glm::mat4> world(nodeCount);
+            std::vector<uint32_t> movedNodes(nodeCount / 100);
+            std::uniform_int_distribution<uint32_t> nodes{0, nodeCount - 1};
+            for (auto &node : movedNodes) {
+                node = nodes(random);
+            }
+            auto move = [&](uint32_t node) {
+                transforms[node].rotation.y = std::fmod(transforms[node].rotation.y + .01f, glm::two_pi<float>());
+                registry.setRotation(node, transforms[node].rotation);
+            };
+
+            LveCpuBenchmark timing{shape.name};
+            timing.run("recompute every world matrix", nodeCount, [&]() {
+                computeWorldMatrices(transforms, parents, world);
+            });
+            timing.run("registry, roots moved", nodeCount, [&]() {
+                for (uint32_t root : roots) {
+                    move(root);
+                }
+                registry.updateMatrices(&jobSystem);
+            });
+            timing.run("registry, 1% of nodes moved", nodeCount, [&]() {
+                for (uint32_t node : movedNodes) {
+                    move(node);
+                }
+                registry.updateMatrices(&jobSystem);
+            });
+            // The last node is a leaf in every shape, moving it between its parent and the first root
+            // costs a rebuild of the whole order
+            uint32_t leaf = nodeCount - 1;
+            uint32_t leafParent = parents[leaf];
+            timing.run("registry, one leaf reparented", nodeCount, [&]() {
+                parents[leaf] = parents[leaf] == leafParent ? 0 : leafParent;
+                registry.setParent(registry.getEntities()[leaf], registry.getEntities()[parents[leaf]]);
+                registry.updateMatrices(&jobSystem);
+            });
+            timing.report(std::cout);
+
+            // Rounding piles up down a chain, so this is looser than the single matrix check in benchmarkTransforms
+            constexpr float TOLERANCE = 1e-3f;
+            computeWorldMatrices(transforms, parents, world);
+            float error = 0.f;
+            auto &matrices = registry.getMatrices();
+            for (uint32_t i = 0; i < nodeCount; i++) {
+                error = std::max(error, worldError(matrices[i], world[i]));
+            }
+            std::cout << "  largest relative difference from recomputing: " << error << std::endl;
+            if (error > TOLERANCE) {
+                std::cout << "  registry world matrices differ!" << std::endl;
+                matches = false;
+            }
+        }
+        return matches;
+    }
+
+    bool benchmarkBvh(uint32_t maxObjectCount) {
+        std::cout << "[benchmark] bvh queries, up to " << maxObjectCount << " objects" << std::endl;
+        // Every variant runs its queries over every object at least once, so keep the counts brute force can afford
+        constexpr uint32_t FRUSTUM_QUERIES = 16;
+        constexpr uint32_t SPHERE_QUERIES = 64;
+        constexpr uint32_t RAY_QUERIES = 64;
+        bool matches = true;
+
+        for (uint32_t objectCount = 10000; objectCount <= maxObjectCount; objectCount *= 10) {
+            std::mt19937 random{SEED};
+            // Same density at every size, the world grows with the object count
+            float worldSize = 4.f * std::cbrt(static_cast<float>(objectCount));
+            std::uniform_real_distribution<float> positions{0.f, worldSize};
+            std::uniform_real_distribution<float> sizes{.5f, 2.f};
+            std::vector<LveBvh::id_t> ids(objectCount);
+            std::vector<LveAabb> boxes(objectCount);
+            for (uint32_t i = 0; i < objectCount; i++) {
+                glm::vec3 min{positions(random), positions(random), positions(random)};
+                ids[i] = i;
+                boxes[i] = {min, min + glm::vec3{sizes(random), sizes(random), sizes(random)}};
+            }
+            LveBvh bvh;
+            bvh.insertBatch(ids, boxes);
+
+            std::vector<LveFrustum> frustums;
+            for (uint32_t i = 0; i < FRUSTUM_QUERIES; i++) {
+                frustums.push_back(frustumAt({positions(random), positions(random), positions(random)}, worldSize * .25f));
+            }
+            std::vector<glm::vec3> sphereCenters;
+            for (uint32_t i = 0; i < SPHERE_QUERIES; i++) {
+                sphereCenters.push_back({positions(random), positions(random), positions(random)});
+            }
+            // Half the rays run along an axis and start on the faces of a box, the case where a slab test
+            // that divides by the direction turns into 0 * infinity
+            std::vector<glm::vec3> rayOrigins, rayDirections;
+            std::uniform_real_distribution<float> directions{-1.f, 1.f};
+            std::uniform_int_distribution<uint32_t> objects{0, objectCount - 1};
+            for (uint32_t i = 0; i < RAY_QUERIES; i++) {
+                if (i % 2 == 0) {
+                    rayOrigins.push_back({positions(random), positions(random), positions(random)});
+                    rayDirections.push_back({directions(random), directions(random), directions(random)});
+                } else {
+                    glm::vec3 direction{0.f};
+                    direction[i / 2 % 3] = 1.f;
+                    rayOrigins.push_back(boxes[objects(random)].min - direction * 5.f);
+                    rayDirections.push_back(direction);
+                }
+            }
+            const float rayLength = worldSize;
+
+            // Results of each variant, compared once the timing is done
+            std::vector<std::vector<LveBvh::id_t>> found[2];
+            std::vector<float> rayDistances[2];
+            auto runQueries = [&](int variant, bool useBvh) {
+                auto &results = found[variant];
+                results.assign(FRUSTUM_QUERIES + SPHERE_QUERIES, {});
+                rayDistances[variant].assign(RAY_QUERIES, -1.f);
+                for (uint32_t q = 0; q < FRUSTUM_QUERIES; q++) {
+                    if (useBvh) {
+                        bvh.queryFrustum(frustums[q], results[q]);
+                        continue;
+                    }
+                    for (uint32_t i = 0; i < objectCount; i++) {
+                        if (boxInFrustum(frustums[q], boxes[i])) {
+                            results[q].push_back(i);
+                        }
+                    }
+                }
+                for (uint32_t q = 0; q < SPHERE_QUERIES; q++) {
+                    auto &result = results[FRUSTUM_QUERIES + q];
+                    if (useBvh) {
+                        bvh.querySphere(sphereCenters[q], 5.f, result);
+                        continue;
+                    }
+                    for (uint32_t i = 0; i < objectCount; i++) {
+                        if (boxInSphere(boxes[i], sphereCenters[q], 5.f)) {
+                            result.push_back(i);
+                        }
+                    }
+                }
+                for (uint32_t q = 0; q < RAY_QUERIES; q++) {
+                    float closest = rayLength;
+                    bool hitAnything = false;
+                    if (useBvh) {
+                        LveBvh::RayHit hit{};
+                        hitAnything = bvh.raycast(rayOrigins[q], rayDirections[q], rayLength, hit);
+                        closest = hit.distance;
+                    } else {
+                        for (uint32_t i = 0; i < objectCount; i++) {
+                            float entry;
+                            if (rayHitsBox(boxes[i], rayOrigins[q], rayDirections[q], closest, entry)) {
+                                closest = entry;
+                                hitAnything = true;
+                            }
+                        }
+                    }
+                    rayDistances[variant][q] = hitAnything ? closest : -1.f;
+                }
+            };
+
+            LveCpuBenchmark timing{std::to_string(objectCount) + " objects, " + std::to_string(FRUSTUM_QUERIES) + " frustums, " +
+                                       std::to_string(SPHERE_QUERIES) + " spheres, " + std::to_string(RAY_QUERIES) + " rays",
+                                   3};
+            uint32_t queryCount = FRUSTUM_QUERIES + SPHERE_QUERIES + RAY_QUERIES;
+            timing.run("brute force", queryCount, [&]() { runQueries(0, false); });
+            timing.run("bvh", queryCount, [&]() { runQueries(1, true); });
+            timing.report(std::cout);
+
+            // Same objects for every query, the order the tree returns them in doesn't matter
+            for (auto &results : found) {
+                for (auto &result : results) {
+                    std::sort(result.begin(), result.end());
+                }
+            }
+            bool same = found[0] == found[1];
+            for (uint32_t q = 0; q < RAY_QUERIES && same; q++) {
+                same = rayDistances[0][q] == rayDistances[1][q];
+            }
+            if (!same) {
+                std::cout << "  bvh and brute force found different objects!" << std::endl;
+                matches = false;
+            }
+            if (objectCount > UINT32_MAX / 10) {
+                break;
+            }
+        }
+        return matches;
+    }
+
+    bool benchmarkChurn(uint32_t operationCount) {
+        // Objects alive at any time, every operation destroys a random one and creates its replacement
+        constexpr uint32_t LIVE_COUNT = 100000;
+        std::cout << "[benchmark] churn, " << operationCount << " destroy + create pairs over " << LIVE_COUNT << " live objects" << std::endl;
+
+        std::mt19937 random{SEED};
+        std::uniform_int_distribution<uint32_t> objects{0, LIVE_COUNT - 1};
+        std::vector<uint32_t> victims(operationCount);
+        for (auto &victim : victims) {
+            victim = objects(random);
+        }
+
+        // One heap allocation per object, how game objects were kept before the pool
+        std::vector<std::unique_ptr<LegacyGameObject>> allocated(LIVE_COUNT);
+        LveObjectPool<LegacyGameObject> pool;
+        std::vector<LveHandle::handle_t> pooled(LIVE_COUNT);
+        LveRegistry registry;
+        registry.reserve(LIVE_COUNT);
+        std::vector<LveRegistry::entity_t> entities(LIVE_COUNT);
+        for (uint32_t i = 0; i < LIVE_COUNT; i++) {
+            allocated[i] = std::make_unique<LegacyGameObject>();
+            pooled[i] = pool.create();
+            entities[i] = registry.create();
+        }
+        // Destroyed in the first operation, must be stale from then on whatever reused its slot
+        LveHandle::handle_t firstPooled = pooled[victims[0]];
+        LveRegistry::entity_t firstEntity = entities[victims[0]];
+
+        uint32_t id = 0;
+        LveCpuBenchmark timing{"destroy and create"};
+        timing.run("new and delete", operationCount, [&]() {
+            for (uint32_t victim : victims) {
+                allocated[victim] = std::make_unique<LegacyGameObject>();
+                allocated[victim]->id = id++;
+            }
+        });
+        timing.run("LveObjectPool", operationCount, [&]() {
+            for (uint32_t victim : victims) {
+                pool.destroy(pooled[victim]);
+                pooled[victim] = pool.create();
+                pool[pooled[victim]].id = id++;
+            }
+        });
+        timing.run("LveRegistry", operationCount, [&]() {
+            for (uint32_t victim : victims) {
+                registry.destroy(entities[victim]);
+                entities[victim] = registry.create();
+                registry.setColor(registry.size() - 1, {.5f, .5f, .5f});
+            }
+        });
+        timing.report(std::cout);
+        std::cout << "  slots used: pool " << pool.getSlotCount() << ", registry " << registry.size() << " entities" << std::endl;
+
+        bool matches = pool.size() == LIVE_COUNT && registry.size() == LIVE_COUNT &&
+                       !pool.isValid(firstPooled) && !registry.contains(firstEntity);
+        for (uint32_t i = 0; i < LIVE_COUNT && matches; i++) {
+            matches = pool.isValid(pooled[i]) && registry.contains(entities[i]);
+        }
+        if (!matches) {
+            std::cout << "  live or stale handles are wrong!" << std::endl;
+        }
+        return matches;
+    }
+}
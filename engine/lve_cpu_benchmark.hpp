@@ -0,0 +1,64 @@
+#pragma once
+
+//std
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace lve {
+    // Times a few variants of one CPU workload (eg. the same loop over two memory layouts) and reports
+    // the best and mean time of each, and what that comes to per item
+    // Every variant runs once untimed first, so allocations and cold caches aren't charged to it
+    class LveCpuBenchmark {
+        public:
+            explicit LveCpuBenchmark(const std::string &name, uint32_t repetitions = 5);
+
+            LveCpuBenchmark(const LveCpuBenchmark &) = delete;
+            LveCpuBenchmark &operator=(const LveCpuBenchmark &) = delete;
+
+            // itemCount is how many things one run of body handles (entities, matrices, queries...)
+            void run(const std::string &variant, uint64_t itemCount, const std::function<void()> &body);
+            // Per variant, with the speed up over the first one
+            void report(std::ostream &out) const;
+
+            // Hand results to this so the optimizer can't drop the work that made them
+            static void consume(double value);
+
+        private:
+            struct VariantResult {
+                std::string name;
+                uint64_t itemCount = 0;
+                double bestMilliseconds = 0.;
+                double sumMilliseconds = 0.;
+            };
+
+            std::string name;
+            uint32_t repetitions;
+            std::vector<VariantResult> results;
+    };
+
+    // The workloads, run by main instead of the app since they need no window or GPU
+    // Each prints its report to std::cout and returns false if a variant computed something different from the others
+
+    // Iterates entityCount entities stored in LveRegistry's arrays and in the vector and map of
+    // game objects it replaced
+    bool benchmarkRegistry(uint32_t entityCount);
+
+    // Builds objectCount model matrices with TransformComponent::mat4 and both LveTransformBatch kernels,
+    // and checks the batch results stay within a few ulps of mat4
+    bool benchmarkTransforms(uint32_t objectCount);
+
+    // Updates the world matrices of nodeCount entities parented deep, wide and in between, after moving roots,
+    // moving a few nodes and reparenting, against recomputing every world matrix from the transforms
+    bool benchmarkHierarchy(uint32_t nodeCount);
+
+    // Frustum, sphere and ray queries through LveBvh against testing every object, at 10k objects and every
+    // 10x more up to maxObjectCount, checking both find the same objects
+    bool benchmarkBvh(uint32_t maxObjectCount);
+
+    // operationCount times destroys a random one of 100k live objects and creates a new one, with one heap allocation
+    // per object, with LveObjectPool and with LveRegistry, then checks the live and stale handles
+    bool benchmarkChurn(uint32_t operationCount);
+}
@@ -0,0 +1,299 @@
+#include "lve_descriptors.hpp"
+
+//std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+namespace lve {
+    namespace {
+        void hashCombine(size_t &seed, size_t value) {
+            seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+
+        // Descriptors of each type per set in a pool, a pool is SETS_PER_POOL times these
+        // Roughly what the render systems use, a pool that runs out of one type is simply replaced early
+        struct PoolRatio {
+            VkDescriptorType type;
+            float perSet;
+        };
+        constexpr std::array<PoolRatio, 7> POOL_RATIOS{{
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4.f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.f},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f},
+            {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.f},
+        }};
+    }
+
+    // *************** Descriptor Layout Cache *********************
+
+    LveDescriptorLayoutCache::LveDescriptorLayoutCache(LveDevice &device) : lveDevice{device} {}
+
+    LveDescriptorLayoutCache::~LveDescriptorLayoutCache() {
+        for (auto &entry : pipelineLayouts) {
+            vkDestroyPipelineLayout(lveDevice.device(), entry.second, nullptr);
+        }
+        for (auto &entry : setLayouts) {
+            vkDestroyDescriptorSetLayout(lveDevice.device(), entry.second, nullptr);
+        }
+    }
+
+    VkDescriptorSetLayoutBinding LveDescriptorLayoutCache::binding(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages, uint32_t count) {
+        VkDescriptorSetLayoutBinding layoutBinding{};
+        layoutBinding.binding = binding;
+        layoutBinding.descriptorType = type;
+        layoutBinding.descriptorCount = count;
+        layoutBinding.stageFlags = stages;
+        return layoutBinding;
+    }
+
+    VkDescriptorSetLayout LveDescriptorLayoutCache::getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings) {
+        return getSetLayout(std::move(bindings), 0, {});
+    }
+
+    VkDescriptorSetLayout LveDescriptorLayoutCache::getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings,
+                                                                 VkDescriptorSetLayoutCreateFlags flags,
+                                                                 std::vector<VkDescriptorBindingFlagsEXT> bindingFlags) {
+        assert((bindingFlags.empty() || bindingFlags.size() == bindings.size()) && "One set of flags per binding");
+        // Sorted through an index so the binding flags stay with their binding
+        std::vector<uint32_t> order(bindings.size());
+        for (uint32_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return bindings[a].binding < bindings[b].binding; });
+
+        SetLayoutKey key{};
+        key.flags = flags;
+        bool hasBindingFlags = std::any_of(bindingFlags.begin(), bindingFlags.end(), [](auto f) { return f != 0; });
+        for (uint32_t index : order) {
+            key.bindings.push_back(bindings[index]);
+            if (hasBindingFlags) {
+                key.bindingFlags.push_back(bindingFlags[index]);
+            }
+        }
+        auto found = setLayouts.find(key);
+        if (found != setLayouts.end()) {
+            return found->second;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.flags = key.flags;
+        layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+        layoutInfo.pBindings = key.bindings.data();
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+        if (!key.bindingFlags.empty()) {
+            bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+            bindingFlagsInfo.bindingCount = static_cast<uint32_t>(key.bindingFlags.size());
+            bindingFlagsInfo.pBindingFlags = key.bindingFlags.data();
+            layoutInfo.pNext = &bindingFlagsInfo;
+        }
+
+        VkDescriptorSetLayout layout;
+        if (vkCreateDescriptorSetLayout(lveDevice.device(), &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor set layout!");
+        }
+        setLayouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    VkPipelineLayout LveDescriptorLayoutCache::getPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayouts,
+                                                                 const std::vector<VkPushConstantRange> &pushConstantRanges) {
+        PipelineLayoutKey key{setLayouts, pushConstantRanges};
+        auto found = pipelineLayouts.find(key);
+        if (found != pipelineLayouts.end()) {
+            return found->second;
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+        pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+        VkPipelineLayout layout;
+        if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+        pipelineLayouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    bool LveDescriptorLayoutCache::SetLayoutKey::operator==(const SetLayoutKey &other) const {
+        return flags == other.flags && bindingFlags == other.bindingFlags &&
+               std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(),
+                          [](const auto &a, const auto &b) {
+                              return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+                                     a.descriptorCount == b.descriptorCount && a.stageFlags == b.stageFlags &&
+                                     a.pImmutableSamplers == b.pImmutableSamplers;
+                          });
+    }
+
+    bool LveDescriptorLayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey &other) const {
+        return setLayouts == other.setLayouts &&
+               std::equal(pushConstantRanges.begin(), pushConstantRanges.end(),
+                          other.pushConstantRanges.begin(), other.pushConstantRanges.end(),
+                          [](const auto &a, const auto &b) {
+                              return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+                          });
+    }
+
+    size_t LveDescriptorLayoutCache::KeyHash::operator()(const SetLayoutKey &key) const {
+        size_t seed = key.bindings.size();
+        hashCombine(seed, key.flags);
+        for (auto bindingFlags : key.bindingFlags) {
+            hashCombine(seed, bindingFlags);
+        }
+        for (auto &binding : key.bindings) {
+            // Packs everything but the immutable samplers, equality still compares those
+            hashCombine(seed, binding.binding | (static_cast<size_t>(binding.descriptorType) << 16));
+            hashCombine(seed, binding.descriptorCount | (static_cast<size_t>(binding.stageFlags) << 24));
+        }
+        return seed;
+    }
+
+    size_t LveDescriptorLayoutCache::KeyHash::operator()(const PipelineLayoutKey &key) const {
+        size_t seed = key.setLayouts.size();
+        for (auto layout : key.setLayouts) {
+            hashCombine(seed, std::hash<VkDescriptorSetLayout>{}(layout));
+        }
+        for (auto &range : key.pushConstantRanges) {
+            hashCombine(seed, range.stageFlags);
+            hashCombine(seed, range.offset | (static_cast<size_t>(range.size) << 16));
+        }
+        return seed;
+    }
+
+    // *************** Descriptor Allocator *********************
+
+    LveDescriptorAllocator::LveDescriptorAllocator(LveDevice &device) : lveDevice{device} {}
+
+    LveDescriptorAllocator::~LveDescriptorAllocator() {
+        // Destroying a pool frees every set allocated from it
+        for (auto pool : usedPools) {
+            vkDestroyDescriptorPool(lveDevice.device(), pool, nullptr);
+        }
+        for (auto pool : freePools) {
+            vkDestroyDescriptorPool(lveDevice.device(), pool, nullptr);
+        }
+    }
+
+    VkDescriptorPool LveDescriptorAllocator::grabPool() {
+        if (!freePools.empty()) {
+            VkDescriptorPool pool = freePools.back();
+            freePools.pop_back();
+            return pool;
+        }
+
+        std::array<VkDescriptorPoolSize, POOL_RATIOS.size()> poolSizes{};
+        for (size_t i = 0; i < POOL_RATIOS.size(); i++) {
+            poolSizes[i].type = POOL_RATIOS[i].type;
+            poolSizes[i].descriptorCount = static_cast<uint32_t>(POOL_RATIOS[i].perSet * SETS_PER_POOL);
+        }
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = SETS_PER_POOL;
+
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(lveDevice.device(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor pool!");
+        }
+        return pool;
+    }
+
+    VkDescriptorSet LveDescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+        if (currentPool == VK_NULL_HANDLE) {
+            currentPool = grabPool();
+            usedPools.push_back(currentPool);
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = currentPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        VkDescriptorSet set;
+        VkResult result = vkAllocateDescriptorSets(lveDevice.device(), &allocInfo, &set);
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+            // This pool is full, the rest of the frame allocates from a fresh one
+            currentPool = grabPool();
+            usedPools.push_back(currentPool);
+            allocInfo.descriptorPool = currentPool;
+            result = vkAllocateDescriptorSets(lveDevice.device(), &allocInfo, &set);
+        }
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate descriptor set!");
+        }
+        allocatedSetCount++;
+        return set;
+    }
+
+    void LveDescriptorAllocator::reset() {
+        for (auto pool : usedPools) {
+            vkResetDescriptorPool(lveDevice.device(), pool, 0);
+            freePools.push_back(pool);
+        }
+        usedPools.clear();
+        currentPool = VK_NULL_HANDLE;
+        allocatedSetCount = 0;
+    }
+
+    // *************** Descriptor Writer *********************
+
+    LveDescriptorWriter &LveDescriptorWriter::clear() {
+        pendingWrites.clear();
+        bufferInfos.clear();
+        imageInfos.clear();
+        return *this;
+    }
+
+    LveDescriptorWriter &LveDescriptorWriter::writeBuffer(uint32_t binding, VkDescriptorType type, const VkDescriptorBufferInfo &bufferInfo) {
+        pendingWrites.push_back({binding, type, static_cast<uint32_t>(bufferInfos.size()), false});
+        bufferInfos.push_back(bufferInfo);
+        return *this;
+    }
+
+    LveDescriptorWriter &LveDescriptorWriter::writeImage(uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo &imageInfo) {
+        pendingWrites.push_back({binding, type, static_cast<uint32_t>(imageInfos.size()), true});
+        imageInfos.push_back(imageInfo);
+        return *this;
+    }
+
+    VkDescriptorSet LveDescriptorWriter::build(LveDescriptorAllocator &allocator, VkDescriptorSetLayout layout) {
+        VkDescriptorSet set = allocator.allocate(layout);
+        update(set);
+        return set;
+    }
+
+    void LveDescriptorWriter::update(VkDescriptorSet set) {
+        writes.resize(pendingWrites.size());
+        for (size_t i = 0; i < pendingWrites.size(); i++) {
+            auto &pending = pendingWrites[i];
+            VkWriteDescriptorSet &write = writes[i];
+            write = VkWriteDescriptorSet{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = set;
+            write.dstBinding = pending.binding;
+            write.descriptorCount = 1;
+            write.descriptorType = pending.type;
+            if (pending.isImage) {
+                write.pImageInfo = &imageInfos[pending.infoIndex];
+            } else {
+                write.pBufferInfo = &bufferInfos[pending.infoIndex];
+            }
+        }
+        vkUpdateDescriptorSets(lveDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+}
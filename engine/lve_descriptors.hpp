@@ -0,0 +1,124 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+//std
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+    // Descriptor set layouts and pipeline layouts, created once and shared
+    // Asking twice for the same bindings returns the same layout, so systems just describe what they need
+    // and sets allocated by one system stay compatible with pipelines of another
+    // Everything is destroyed with the cache, so it has to outlive the pipelines using it
+    class LveDescriptorLayoutCache {
+        public:
+            LveDescriptorLayoutCache(LveDevice &device);
+            ~LveDescriptorLayoutCache();
+
+            LveDescriptorLayoutCache(const LveDescriptorLayoutCache &) = delete;
+            LveDescriptorLayoutCache &operator=(const LveDescriptorLayoutCache &) = delete;
+
+            static VkDescriptorSetLayoutBinding binding(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages, uint32_t count = 1);
+
+            // The order of the bindings doesn't matter, they are sorted before lookup
+            VkDescriptorSetLayout getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);
+            // With layout flags (eg. update after bind) and per binding flags, bindingFlags is either empty
+            // or matches bindings one to one, the flags need VK_EXT_descriptor_indexing
+            VkDescriptorSetLayout getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings,
+                                               VkDescriptorSetLayoutCreateFlags flags,
+                                               std::vector<VkDescriptorBindingFlagsEXT> bindingFlags);
+            VkPipelineLayout getPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayouts,
+                                               const std::vector<VkPushConstantRange> &pushConstantRanges = {});
+
+            size_t getSetLayoutCount() const { return setLayouts.size(); }
+            size_t getPipelineLayoutCount() const { return pipelineLayouts.size(); }
+
+        private:
+            struct SetLayoutKey {
+                std::vector<VkDescriptorSetLayoutBinding> bindings;
+                VkDescriptorSetLayoutCreateFlags flags = 0;
+                std::vector<VkDescriptorBindingFlagsEXT> bindingFlags; // empty when none are set
+                bool operator==(const SetLayoutKey &other) const;
+            };
+            struct PipelineLayoutKey {
+                std::vector<VkDescriptorSetLayout> setLayouts;
+                std::vector<VkPushConstantRange> pushConstantRanges;
+                bool operator==(const PipelineLayoutKey &other) const;
+            };
+            struct KeyHash {
+                size_t operator()(const SetLayoutKey &key) const;
+                size_t operator()(const PipelineLayoutKey &key) const;
+            };
+
+            LveDevice &lveDevice;
+            std::unordered_map<SetLayoutKey, VkDescriptorSetLayout, KeyHash> setLayouts;
+            std::unordered_map<PipelineLayoutKey, VkPipelineLayout, KeyHash> pipelineLayouts;
+    };
+
+    // Hands out descriptor sets from a list of pools, taking a new pool whenever the current one runs out
+    // Sets are never freed one by one: reset returns every set at once with vkResetDescriptorPool and keeps
+    // the pools for reuse, so with one allocator per frame in flight allocating a set is a pointer bump in the driver
+    class LveDescriptorAllocator {
+        public:
+            // Sets per pool, the descriptors of each type scale with it (see POOL_RATIOS in the .cpp)
+            static constexpr uint32_t SETS_PER_POOL = 256;
+
+            LveDescriptorAllocator(LveDevice &device);
+            ~LveDescriptorAllocator();
+
+            LveDescriptorAllocator(const LveDescriptorAllocator &) = delete;
+            LveDescriptorAllocator &operator=(const LveDescriptorAllocator &) = delete;
+
+            VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+            // Every set allocated so far becomes invalid, the GPU must be done with them
+            void reset();
+
+            uint32_t getAllocatedSetCount() const { return allocatedSetCount; }
+            size_t getPoolCount() const { return usedPools.size() + freePools.size(); }
+
+        private:
+            VkDescriptorPool grabPool();
+
+            LveDevice &lveDevice;
+            VkDescriptorPool currentPool = VK_NULL_HANDLE;
+            std::vector<VkDescriptorPool> usedPools; // current pool included
+            std::vector<VkDescriptorPool> freePools;
+            uint32_t allocatedSetCount = 0;
+    };
+
+    // Collects descriptor writes and applies them in one vkUpdateDescriptorSets call
+    // Infos are copied in, so temporaries can be passed, and clear keeps the capacity,
+    // so one writer reused for every set of a frame doesn't allocate
+    //
+    //   VkDescriptorSet set = writer.clear().writeBuffer(0, type, info).writeImage(1, type, imageInfo).build(allocator, layout);
+    class LveDescriptorWriter {
+        public:
+            LveDescriptorWriter(LveDevice &device) : lveDevice{device} {}
+
+            LveDescriptorWriter &clear();
+            LveDescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorType type, const VkDescriptorBufferInfo &bufferInfo);
+            LveDescriptorWriter &writeImage(uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo &imageInfo);
+
+            // Allocates a set and writes everything collected into it
+            VkDescriptorSet build(LveDescriptorAllocator &allocator, VkDescriptorSetLayout layout);
+            // Writes everything collected into an existing set
+            void update(VkDescriptorSet set);
+
+        private:
+            // Writes refer to their info by index, the vectors may reallocate while collecting
+            struct PendingWrite {
+                uint32_t binding;
+                VkDescriptorType type;
+                uint32_t infoIndex;
+                bool isImage;
+            };
+
+            LveDevice &lveDevice;
+            std::vector<PendingWrite> pendingWrites;
+            std::vector<VkDescriptorBufferInfo> bufferInfos;
+            std::vector<VkDescriptorImageInfo> imageInfos;
+            std::vector<VkWriteDescriptorSet> writes;
+    };
+}
@@ -3,6 +3,7 @@
 #include <vulkan/vulkan_beta.h>
 
 // std headers
+#include <cassert>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -66,7 +67,9 @@ LveDevice::~LveDevice() {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
+  if (surface_ != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(instance, surface_, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
 }
 
@@ -81,7 +84,8 @@ void LveDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  // 1.1 for vkGetPhysicalDeviceFeatures2, everything newer is enabled as an extension
+  appInfo.apiVersion = VK_API_VERSION_1_1;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -151,8 +155,38 @@ void LveDevice::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  // Used by the GPU driven path to issue every model's draw from one indirect buffer
+  deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+  deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+  // Lets the bindless fallback index its fixed size arrays with push constants
+  deviceFeatures.shaderSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+  deviceFeatures.shaderStorageBufferArrayDynamicIndexing = supportedFeatures.shaderStorageBufferArrayDynamicIndexing;
+  // Counts fragment shader invocations, to measure what the depth pre pass saves
+  deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+  enabledFeatures = deviceFeatures;
+
+  // Headless there is nothing to present to, so no swap chain either
+  std::vector<const char *> enabledExtensions;
+  if (!window.isHeadless()) {
+    enabledExtensions.assign(deviceExtensions.begin(), deviceExtensions.end());
+  }
+  for (const char *extension : optionalDeviceExtensions) {
+    if (isDeviceExtensionAvailable(physicalDevice, extension)) {
+      enabledExtensions.push_back(extension);
+    }
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+  descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+  descriptorIndexingSupported = queryDescriptorIndexing(descriptorIndexingFeatures);
+  if (descriptorIndexingSupported) {
+    enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+  }
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -161,8 +195,9 @@ void LveDevice::createLogicalDevice() {
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  createInfo.pNext = descriptorIndexingSupported ? &descriptorIndexingFeatures : nullptr;
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+  createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
   // might not really be necessary anymore because device specific validation layers
   // have been deprecated
@@ -179,6 +214,56 @@ void LveDevice::createLogicalDevice() {
 
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+  // Extension commands aren't exported by the loader, they have to be looked up
+  if (isDeviceExtensionAvailable(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+    vkCmdDrawIndexedIndirectCount_ = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(
+        device_,
+        "vkCmdDrawIndexedIndirectCountKHR");
+  }
+}
+
+// Bindless needs the whole set of descriptor indexing features below, a device missing any of them
+// gets none and LveBindlessHeap falls back to per frame sets
+// enabled is filled with just the features to enable
+bool LveDevice::queryDescriptorIndexing(VkPhysicalDeviceDescriptorIndexingFeaturesEXT &enabled) {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+  // The extension itself needs VK_KHR_maintenance3, which is core in 1.1
+  if (deviceProperties.apiVersion < VK_API_VERSION_1_1 ||
+      !isDeviceExtensionAvailable(physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+    return false;
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported{};
+  supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+  VkPhysicalDeviceFeatures2 features2{};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &supported;
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+  if (!supported.runtimeDescriptorArray || !supported.descriptorBindingPartiallyBound ||
+      !supported.descriptorBindingUpdateUnusedWhilePending ||
+      !supported.descriptorBindingSampledImageUpdateAfterBind ||
+      !supported.descriptorBindingStorageBufferUpdateAfterBind ||
+      !supported.shaderSampledImageArrayNonUniformIndexing ||
+      !supported.shaderStorageBufferArrayNonUniformIndexing) {
+    return false;
+  }
+  enabled.runtimeDescriptorArray = VK_TRUE;
+  enabled.descriptorBindingPartiallyBound = VK_TRUE;
+  enabled.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  enabled.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  enabled.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+  enabled.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  enabled.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+
+  descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+  VkPhysicalDeviceProperties2 properties2{};
+  properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties2.pNext = &descriptorIndexingProperties;
+  vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+  return true;
 }
 
 void LveDevice::createCommandPool() {
@@ -195,15 +280,22 @@ void LveDevice::createCommandPool() {
   }
 }
 
-void LveDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+void LveDevice::createSurface() {
+  if (window.isHeadless()) {
+    surface_ = VK_NULL_HANDLE;
+    return;
+  }
+  window.createWindowSurface(instance, &surface_);
+}
 
 bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
-  bool extensionsSupported = checkDeviceExtensionSupport(device);
+  // Headless needs neither the swap chain extension nor a surface it can present to
+  bool extensionsSupported = window.isHeadless() || checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  bool swapChainAdequate = window.isHeadless();
+  if (extensionsSupported && !window.isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -264,8 +356,11 @@ bool LveDevice::checkValidationLayerSupport() {
 
 std::vector<const char *> LveDevice::getRequiredExtensions() {
   uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+  const char **glfwExtensions = nullptr;
+  // The surface extensions GLFW asks for, GLFW isn't even initialized when headless
+  if (!window.isHeadless()) {
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+  }
 
   std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
 
@@ -319,6 +414,44 @@ bool LveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool LveDevice::isDeviceExtensionAvailable(VkPhysicalDevice device, const char *extensionName) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(
+      device,
+      nullptr,
+      &extensionCount,
+      availableExtensions.data());
+
+  for (const auto &extension : availableExtensions) {
+    if (strcmp(extension.extensionName, extensionName) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LveDevice::cmdDrawIndexedIndirectCount(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    VkDeviceSize offset,
+    VkBuffer countBuffer,
+    VkDeviceSize countBufferOffset,
+    uint32_t maxDrawCount,
+    uint32_t stride) {
+  assert(isDrawIndirectCountSupported() && "VK_KHR_draw_indirect_count is not enabled");
+  vkCmdDrawIndexedIndirectCount_(
+      commandBuffer,
+      buffer,
+      offset,
+      countBuffer,
+      countBufferOffset,
+      maxDrawCount,
+      stride);
+}
+
 QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -334,8 +467,11 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsFamily = i;
       indices.graphicsFamilyHasValue = true;
     }
-    VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    // Headless frames are only read back, any queue does
+    VkBool32 presentSupport = surface_ == VK_NULL_HANDLE;
+    if (surface_ != VK_NULL_HANDLE) {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
@@ -392,6 +528,22 @@ VkFormat LveDevice::findSupportedFormat(
   throw std::runtime_error("failed to find supported format!");
 }
 
+bool LveDevice::hasFormatFeatures(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features) {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+  VkFormatFeatureFlags supported =
+      tiling == VK_IMAGE_TILING_LINEAR ? props.linearTilingFeatures : props.optimalTilingFeatures;
+  return (supported & features) == features;
+}
+
+uint32_t LveDevice::getTimestampValidBits() {
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+  return queueFamilies[findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+}
+
 uint32_t LveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
   VkPhysicalDeviceMemoryProperties memProperties;
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -405,6 +557,18 @@ uint32_t LveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags pr
   throw std::runtime_error("failed to find suitable memory type!");
 }
 
+bool LveDevice::hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Takes buffer size and usage, and properties, and initializes buffer memory and location
 void LveDevice::createBuffer(
     VkDeviceSize size,
@@ -474,12 +638,17 @@ void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
 
-void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+void LveDevice::copyBuffer(
+    VkBuffer srcBuffer,
+    VkBuffer dstBuffer,
+    VkDeviceSize size,
+    VkDeviceSize srcOffset,
+    VkDeviceSize dstOffset) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
   VkBufferCopy copyRegion{};
-  copyRegion.srcOffset = 0;  // Optional
-  copyRegion.dstOffset = 0;  // Optional
+  copyRegion.srcOffset = srcOffset;
+  copyRegion.dstOffset = dstOffset;  // Lets sub-allocated buffers be filled in pieces
   copyRegion.size = size;
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
@@ -48,9 +48,14 @@ class LveDevice {
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+  // Same search as findMemoryType, but reports a miss instead of throwing, for picking between preferences
+  bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
   VkFormat findSupportedFormat(
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+  bool hasFormatFeatures(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features);
+  // Meaningful bits of timestamps written on the graphics queue, 0 if it can't write them
+  uint32_t getTimestampValidBits();
 
   // Buffer Helper Functions
   void createBuffer(
@@ -61,7 +66,12 @@ class LveDevice {
       VkDeviceMemory &bufferMemory);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+  void copyBuffer(
+      VkBuffer srcBuffer,
+      VkBuffer dstBuffer,
+      VkDeviceSize size,
+      VkDeviceSize srcOffset = 0,
+      VkDeviceSize dstOffset = 0);
   void copyBufferToImage(
       VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -73,6 +83,24 @@ class LveDevice {
 
   VkPhysicalDeviceProperties properties;
 
+  // Optional features, only enabled when the physical device supports them
+  const VkPhysicalDeviceFeatures &getEnabledFeatures() const { return enabledFeatures; }
+  bool isDrawIndirectCountSupported() const { return vkCmdDrawIndexedIndirectCount_ != nullptr; }
+  // Update after bind, partially bound and non uniformly indexed descriptor arrays (VK_EXT_descriptor_indexing)
+  bool isDescriptorIndexingSupported() const { return descriptorIndexingSupported; }
+  // Only filled in when descriptor indexing is supported
+  const VkPhysicalDeviceDescriptorIndexingPropertiesEXT &getDescriptorIndexingProperties() const {
+    return descriptorIndexingProperties;
+  }
+  void cmdDrawIndexedIndirectCount(
+      VkCommandBuffer commandBuffer,
+      VkBuffer buffer,
+      VkDeviceSize offset,
+      VkBuffer countBuffer,
+      VkDeviceSize countBufferOffset,
+      uint32_t maxDrawCount,
+      uint32_t stride);
+
  private:
   void createInstance();
   void setupDebugMessenger();
@@ -89,6 +117,8 @@ class LveDevice {
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char *extensionName);
+  bool queryDescriptorIndexing(VkPhysicalDeviceDescriptorIndexingFeaturesEXT &enabled);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
   VkInstance instance;
@@ -104,6 +134,13 @@ class LveDevice {
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  // Enabled on top of deviceExtensions when available
+  const std::vector<const char *> optionalDeviceExtensions = {VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME};
+
+  VkPhysicalDeviceFeatures enabledFeatures{};
+  bool descriptorIndexingSupported = false;
+  VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptorIndexingProperties{};
+  PFN_vkCmdDrawIndexedIndirectCountKHR vkCmdDrawIndexedIndirectCount_ = nullptr;
 };
 
 }  // namespace lve
@@ -0,0 +1,45 @@
+#include "lve_dynamic_resolution.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace lve {
+
+    LveDynamicResolution::LveDynamicResolution() : LveDynamicResolution(Settings{}) {}
+
+    LveDynamicResolution::LveDynamicResolution(const Settings &settings) : settings{settings}, scale{settings.maxScale} {
+        assert(settings.minScale > 0.f && settings.minScale <= settings.maxScale && "Scale bounds are out of order");
+        assert(settings.frameBudgetMs > 0.f && "Frame budget must be positive");
+    }
+
+    float LveDynamicResolution::update(float gpuMilliseconds) {
+        if (gpuMilliseconds <= 0.f) {
+            return scale;
+        }
+        // Smoothed, so one slow frame (eg. a pipeline compiled on first use) doesn't drop the resolution
+        smoothedMs = smoothedMs == 0.f ? gpuMilliseconds
+                                       : settings.smoothing * smoothedMs + (1.f - settings.smoothing) * gpuMilliseconds;
+
+        float error = (smoothedMs - settings.frameBudgetMs) / settings.frameBudgetMs;
+        if (std::abs(error) <= settings.deadband) {
+            return scale;
+        }
+
+        float ideal = scale * std::sqrt(settings.frameBudgetMs / smoothedMs);
+        float step = std::clamp((ideal - scale) * settings.damping, -settings.maxStep, settings.maxStep);
+        scale = std::clamp(scale + step, settings.minScale, settings.maxScale);
+        return scale;
+    }
+
+    VkExtent2D LveDynamicResolution::scaleExtent(VkExtent2D extent, float factor) const {
+        auto scaleAxis = [&](uint32_t size) {
+            uint32_t scaled = static_cast<uint32_t>(std::lround(static_cast<float>(size) * factor));
+            // Rounded down to the alignment, but never to nothing
+            scaled = scaled / settings.alignment * settings.alignment;
+            return std::max(scaled, std::min(settings.alignment, size));
+        };
+        return {scaleAxis(extent.width), scaleAxis(extent.height)};
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+//std
+#include <cstdint>
+
+namespace lve {
+    // Picks the internal render resolution from measured GPU frame times, trading pixels for frame rate
+    // The scene is drawn into the top left corner of a target sized for maxScale and upscaled to the
+    // swap chain from there, so changing the scale never recreates an image
+    //
+    // GPU time is taken to grow with the pixel count, so the scale that would hit the budget is
+    // scale * sqrt(budget / time). Each update moves only part of the way there (damping), and nothing
+    // moves while the smoothed time is within the deadband around the budget, which keeps the
+    // resolution from flickering between two sizes
+    class LveDynamicResolution {
+        public:
+            struct Settings {
+                float frameBudgetMs = 1000.f / 60.f; // GPU time per frame to aim for
+                float minScale = .5f; // of the output size, per axis
+                float maxScale = 1.f;
+                float damping = .3f; // fraction of the correction applied per measurement, 0 - 1
+                float smoothing = .8f; // weight of the history in the smoothed frame time, 0 - 1
+                float deadband = .05f; // fraction of the budget the time may be off by without reacting
+                float maxStep = .1f; // largest scale change per measurement
+                uint32_t alignment = 8; // render extents are multiples of it, friendlier to tiles and upscaling
+            };
+
+            LveDynamicResolution();
+            explicit LveDynamicResolution(const Settings &settings);
+
+            // Feed one GPU frame time, returns the new scale
+            float update(float gpuMilliseconds);
+            void reset() { scale = settings.maxScale; smoothedMs = 0.f; }
+
+            float getScale() const { return scale; }
+            float getSmoothedMilliseconds() const { return smoothedMs; }
+            const Settings &getSettings() const { return settings; }
+
+            // The target to render into for an output of outputExtent, big enough for maxScale
+            VkExtent2D getMaxExtent(VkExtent2D outputExtent) const { return scaleExtent(outputExtent, settings.maxScale); }
+            // The part of it used at the current scale
+            VkExtent2D getRenderExtent(VkExtent2D outputExtent) const { return scaleExtent(outputExtent, scale); }
+
+        private:
+            VkExtent2D scaleExtent(VkExtent2D extent, float factor) const;
+
+            Settings settings;
+            float scale;
+            float smoothedMs = 0.f; // 0 until the first measurement
+    };
+}
@@ -0,0 +1,83 @@
+#include "lve_frame_benchmark.hpp"
+
+//std
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+namespace lve {
+
+    LveFrameBenchmark::LveFrameBenchmark(const std::string &name, const std::vector<std::string> &modeNames,
+                                         uint32_t framesPerMode, uint32_t warmupFrames, std::function<void(uint32_t mode)> applyMode)
+        : name{name}, framesPerMode{framesPerMode}, warmupFrames{warmupFrames}, applyMode{std::move(applyMode)} {
+        for (auto &modeName : modeNames) {
+            results.push_back({modeName});
+        }
+        finished = results.empty();
+        if (!finished) {
+            this->applyMode(0);
+        }
+    }
+
+    void LveFrameBenchmark::addSample(float gpuMilliseconds, uint64_t fragmentInvocations) {
+        if (finished || frame < warmupFrames) {
+            return;
+        }
+        auto &result = results[mode];
+        result.samples++;
+        result.sumMilliseconds += gpuMilliseconds;
+        result.sumSquaredMilliseconds += static_cast<double>(gpuMilliseconds) * gpuMilliseconds;
+        result.maxMilliseconds = std::max(result.maxMilliseconds, gpuMilliseconds);
+        result.sumFragmentInvocations += fragmentInvocations;
+    }
+
+    void LveFrameBenchmark::addCounter(const std::string &counter, uint64_t value) {
+        if (finished || frame < warmupFrames) {
+            return;
+        }
+        auto &counters = results[mode].counters;
+        auto found = std::find_if(counters.begin(), counters.end(), [&](const CounterSum &sum) { return sum.name == counter; });
+        if (found == counters.end()) {
+            found = counters.insert(counters.end(), CounterSum{counter});
+        }
+        found->sum += value;
+        found->samples++;
+    }
+
+    void LveFrameBenchmark::endFrame() {
+        if (finished) {
+            return;
+        }
+        frame++;
+        if (frame < warmupFrames + framesPerMode) {
+            return;
+        }
+        frame = 0;
+        mode++;
+        if (mode < results.size()) {
+            applyMode(mode);
+            return;
+        }
+        finished = true;
+        report(std::cout);
+    }
+
+    void LveFrameBenchmark::report(std::ostream &out) const {
+        out << "[benchmark] " << name << ", " << framesPerMode << " frames per mode" << std::endl;
+        for (auto &result : results) {
+            double samples = std::max<uint32_t>(result.samples, 1);
+            double mean = result.sumMilliseconds / samples;
+            double variance = std::max(result.sumSquaredMilliseconds / samples - mean * mean, 0.);
+            out << "  " << result.name << ": " << mean << " GPU ms per frame (worst " << result.maxMilliseconds
+                << ", std dev " << std::sqrt(variance) << ")";
+            if (result.sumFragmentInvocations > 0) {
+                out << ", " << static_cast<uint64_t>(result.sumFragmentInvocations / samples) << " fragment invocations";
+            }
+            for (auto &counter : result.counters) {
+                out << ", " << counter.sum / std::max<uint32_t>(counter.samples, 1) << " " << counter.name;
+            }
+            out << std::endl;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+//std
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace lve {
+    // Renders the same scene in a few configurations (modes) one after another and reports what each
+    // cost the GPU: mean, worst and standard deviation of the frame time, and fragment shader invocations
+    // GPU results arrive frames after the frame they measure, and the first frames after a switch still
+    // pay for it, so every mode starts with warmupFrames that aren't measured
+    class LveFrameBenchmark {
+        public:
+            // applyMode switches the app to a mode, it is called with mode 0 right away and then between
+            // frames, before the first frame of every other mode
+            LveFrameBenchmark(const std::string &name, const std::vector<std::string> &modeNames,
+                              uint32_t framesPerMode, uint32_t warmupFrames, std::function<void(uint32_t mode)> applyMode);
+
+            LveFrameBenchmark(const LveFrameBenchmark &) = delete;
+            LveFrameBenchmark &operator=(const LveFrameBenchmark &) = delete;
+
+            // A GPU measurement that arrived this frame, fragmentInvocations is 0 when they can't be counted
+            void addSample(float gpuMilliseconds, uint64_t fragmentInvocations);
+            // Any other per frame number worth comparing between modes (eg. objects culled), reported as its mean
+            void addCounter(const std::string &counter, uint64_t value);
+            // Call once per rendered frame, moves on to the next mode or finishes and prints the report
+            void endFrame();
+            bool isFinished() const { return finished; }
+
+            void report(std::ostream &out) const;
+
+        private:
+            struct CounterSum {
+                std::string name;
+                uint64_t sum = 0;
+                uint32_t samples = 0;
+            };
+
+            struct ModeResult {
+                std::string name;
+                uint32_t samples = 0;
+                double sumMilliseconds = 0.;
+                double sumSquaredMilliseconds = 0.;
+                float maxMilliseconds = 0.f;
+                uint64_t sumFragmentInvocations = 0;
+                std::vector<CounterSum> counters; // in the order they were first added
+            };
+
+            std::string name;
+            std::vector<ModeResult> results;
+            uint32_t framesPerMode;
+            uint32_t warmupFrames;
+            std::function<void(uint32_t mode)> applyMode;
+            uint32_t mode = 0;
+            uint32_t frame = 0; // since the mode started
+            bool finished = false;
+    };
+}
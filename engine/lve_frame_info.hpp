@@ -0,0 +1,28 @@
+#pragma once
+
+#include "lve_asset_registry.hpp"
+#include "lve_bindless_heap.hpp"
+#include "lve_camera.hpp"
+#include "lve_command_recorder.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_frame_ring_buffer.hpp"
+#include "lve_job_system.hpp"
+#include "lve_profiler.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace lve {
+    // Everything a render system needs to know about the frame it is recording
+    struct FrameInfo {
+        int frameIndex; // Which of the MAX_FRAMES_IN_FLIGHT slots, use it to pick per frame resources
+        VkCommandBuffer commandBuffer;
+        LveProfiler &profiler; // per frame counters, eg. draws and state changes
+        LveJobSystem &jobSystem; // worker threads for data parallel work while recording
+        LveCommandRecorder &recorder; // bind through this so redundant state changes are dropped
+        LveCamera &camera; // what the frame is looked at through, also what gets culled against
+        LveAssetRegistry &assets; // resolves the registry's model handles
+        LveFrameRingBuffer &frameRing; // scratch for data that only lives this frame, bound with dynamic offsets
+        LveDescriptorAllocator &descriptorAllocator; // sets that only live this frame, released all at once
+        LveBindlessHeap &bindless; // every registered image, sampler and storage buffer, picked by index in shaders
+    };
+}
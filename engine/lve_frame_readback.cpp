@@ -0,0 +1,164 @@
+#include "lve_frame_readback.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace lve {
+    namespace {
+        bool isBgra(VkFormat format) {
+            return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+        }
+
+        bool isSupportedFormat(VkFormat format) {
+            return isBgra(format) || format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+        }
+    }
+
+    LveFrameReadback::LveFrameReadback(LveDevice &device) : lveDevice{device} {
+        // Cached memory makes reading it back on the CPU much faster, it then needs invalidating first
+        memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        if (!lveDevice.hasMemoryType(~0u, memoryProperties)) {
+            memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        }
+    }
+
+    void LveFrameReadback::beginFrame(int frameIndex) {
+        deliver(slots[frameIndex]);
+    }
+
+    void LveFrameReadback::flush() {
+        // Oldest first, frame numbers are increasing from the slot after the last recorded one
+        std::array<Slot *, LveSwapChain::MAX_FRAMES_IN_FLIGHT> ordered;
+        for (size_t i = 0; i < slots.size(); i++) {
+            ordered[i] = &slots[i];
+        }
+        std::sort(ordered.begin(), ordered.end(), [](const Slot *a, const Slot *b) { return a->frameNumber < b->frameNumber; });
+        for (Slot *slot : ordered) {
+            deliver(*slot);
+        }
+    }
+
+    void LveFrameReadback::recordCopy(VkCommandBuffer commandBuffer, int frameIndex, VkImage image, VkFormat format, VkExtent2D extent, uint64_t tag) {
+        if (!sink) {
+            return;
+        }
+        if (!isSupportedFormat(format)) {
+            throw std::runtime_error("frame readback only supports 8 bit RGBA and BGRA images!");
+        }
+        auto &slot = slots[frameIndex];
+        assert(!slot.pending && "beginFrame wasn't called for this frame");
+
+        // Grows when the swap chain does, smaller frames reuse the bigger buffer
+        VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+        if (slot.buffer == nullptr || slot.buffer->getBufferSize() < size) {
+            slot.buffer = std::make_unique<LveBuffer>(lveDevice, size, 1, VK_BUFFER_USAGE_TRANSFER_DST_BIT, memoryProperties);
+            slot.buffer->map(); // Stays mapped for the lifetime of the buffer
+        }
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = 0;
+        region.bufferRowLength = 0; // tightly packed
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {extent.width, extent.height, 1};
+        vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer->getBuffer(), 1, &region);
+
+        // The fence only makes the copy available, the host read still has to be made visible
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = slot.buffer->getBuffer();
+        barrier.offset = 0;
+        barrier.size = size;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        slot.pending = true;
+        slot.extent = extent;
+        slot.format = format;
+        slot.frameNumber = nextFrameNumber++;
+        slot.tag = tag;
+    }
+
+    void LveFrameReadback::deliver(Slot &slot) {
+        if (!slot.pending) {
+            return;
+        }
+        slot.pending = false;
+        if (!sink) {
+            return;
+        }
+        if ((memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0) {
+            slot.buffer->invalidate();
+        }
+
+        Frame frame{};
+        frame.pixels = static_cast<const uint8_t *>(slot.buffer->getMappedMemory());
+        frame.width = slot.extent.width;
+        frame.height = slot.extent.height;
+        frame.rowPitch = slot.extent.width * 4;
+        frame.format = slot.format;
+        frame.frameNumber = slot.frameNumber;
+        frame.tag = slot.tag;
+
+        auto start = std::chrono::steady_clock::now();
+        sink(frame);
+        auto end = std::chrono::steady_clock::now();
+
+        uint64_t bytes = static_cast<uint64_t>(frame.rowPitch) * frame.height;
+        stats.framesDelivered++;
+        stats.bytesDelivered += bytes;
+        stats.sinkSeconds = std::chrono::duration<double>(end - start).count();
+
+        // Sustained rate over roughly a second of deliveries, so a single slow frame doesn't swing it
+        if (windowStart == std::chrono::steady_clock::time_point{}) {
+            windowStart = end;
+        }
+        windowBytes += bytes;
+        double windowSeconds = std::chrono::duration<double>(end - windowStart).count();
+        if (windowSeconds >= 1.0) {
+            stats.bytesPerSecond = static_cast<double>(windowBytes) / windowSeconds;
+            windowStart = end;
+            windowBytes = 0;
+        }
+    }
+
+    LveFrameReadback::Sink LveFrameReadback::makeFileSink(const std::string &prefix, uint32_t everyNthFrame) {
+        assert(everyNthFrame > 0 && "everyNthFrame must be at least 1");
+        // Reused between frames so writing doesn't allocate
+        auto row = std::make_shared<std::vector<char>>();
+        return [prefix, everyNthFrame, row](const Frame &frame) {
+            if (frame.frameNumber % everyNthFrame != 0) {
+                return;
+            }
+            std::ofstream file{prefix + std::to_string(frame.frameNumber) + ".ppm", std::ios::binary};
+            if (!file) {
+                throw std::runtime_error("failed to open frame capture file!");
+            }
+            file << "P6\n" << frame.width << " " << frame.height << "\n255\n";
+
+            // PPM is packed RGB
+            bool bgra = isBgra(frame.format);
+            row->resize(static_cast<size_t>(frame.width) * 3);
+            for (uint32_t y = 0; y < frame.height; y++) {
+                const uint8_t *source = frame.pixels + static_cast<size_t>(y) * frame.rowPitch;
+                for (uint32_t x = 0; x < frame.width; x++) {
+                    (*row)[x * 3 + 0] = static_cast<char>(source[x * 4 + (bgra ? 2 : 0)]);
+                    (*row)[x * 3 + 1] = static_cast<char>(source[x * 4 + 1]);
+                    (*row)[x * 3 + 2] = static_cast<char>(source[x * 4 + (bgra ? 0 : 2)]);
+                }
+                file.write(row->data(), static_cast<std::streamsize>(row->size()));
+            }
+        };
+    }
+}
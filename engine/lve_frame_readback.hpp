@@ -0,0 +1,87 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+//std
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace lve {
+    // Copies rendered frames into host visible buffers and hands them to a sink once the GPU is done with them
+    // Every frame in flight has its own buffer, the copy recorded into a frame is read back the next time that
+    // frame slot begins, after its fence was waited on anyway, so reading back never waits on the GPU
+    // Frames arrive MAX_FRAMES_IN_FLIGHT frames late, in order
+    //
+    // Recording: a render graph pass reading the image as TRANSFER_SRC calls recordCopy, the graph moves
+    // the image in and out of the transfer layout around it
+    class LveFrameReadback {
+        public:
+            // Tightly packed rows of 4 byte pixels, only valid during the sink call
+            struct Frame {
+                const uint8_t *pixels;
+                uint32_t width;
+                uint32_t height;
+                uint32_t rowPitch; // bytes
+                VkFormat format; // 8 bit RGBA or BGRA
+                uint64_t frameNumber; // counts recorded copies from 0
+                uint64_t tag; // passed to recordCopy, eg. the scene version the frame shows
+            };
+            using Sink = std::function<void(const Frame &frame)>;
+
+            struct Stats {
+                uint64_t framesDelivered = 0;
+                uint64_t bytesDelivered = 0;
+                double bytesPerSecond = 0.0; // over the last second of deliveries
+                double sinkSeconds = 0.0; // spent in the sink for the last frame, the render thread waits for it
+            };
+
+            LveFrameReadback(LveDevice &device);
+
+            LveFrameReadback(const LveFrameReadback &) = delete;
+            LveFrameReadback &operator=(const LveFrameReadback &) = delete;
+
+            // Nothing is recorded or delivered without a sink
+            void setSink(Sink newSink) { sink = std::move(newSink); }
+            bool isEnabled() const { return static_cast<bool>(sink); }
+
+            // Call after the fence wait for frameIndex, delivers what the slot copied last time
+            void beginFrame(int frameIndex);
+            // image has to be in TRANSFER_SRC_OPTIMAL, format 8 bit RGBA or BGRA
+            void recordCopy(VkCommandBuffer commandBuffer, int frameIndex, VkImage image, VkFormat format, VkExtent2D extent, uint64_t tag = 0);
+            // Delivers every copy still pending, the device must be idle
+            void flush();
+
+            const Stats &getStats() const { return stats; }
+
+            // Writes every nth frame to <prefix><frameNumber>.ppm, synchronously, so it costs frame time
+            static Sink makeFileSink(const std::string &prefix, uint32_t everyNthFrame = 1);
+
+        private:
+            struct Slot {
+                std::unique_ptr<LveBuffer> buffer;
+                bool pending = false; // holds a copy that hasn't been delivered
+                VkExtent2D extent{};
+                VkFormat format = VK_FORMAT_UNDEFINED;
+                uint64_t frameNumber = 0;
+                uint64_t tag = 0;
+            };
+
+            void deliver(Slot &slot);
+
+            LveDevice &lveDevice;
+            Sink sink;
+            VkMemoryPropertyFlags memoryProperties;
+            std::array<Slot, LveSwapChain::MAX_FRAMES_IN_FLIGHT> slots;
+            uint64_t nextFrameNumber = 0;
+
+            Stats stats{};
+            std::chrono::steady_clock::time_point windowStart{};
+            uint64_t windowBytes = 0;
+    };
+}
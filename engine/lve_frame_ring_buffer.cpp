@@ -0,0 +1,104 @@
+#include "lve_frame_ring_buffer.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+    namespace {
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    LveFrameRingBuffer::LveFrameRingBuffer(LveDevice &device, VkDeviceSize regionSize) : lveDevice{device} {
+        auto &limits = lveDevice.properties.limits;
+        uniformAlignment = limits.minUniformBufferOffsetAlignment;
+        // At least 16 so vec4 and mat4 data written from the CPU lands aligned too
+        regionAlignment = std::max({limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, VkDeviceSize{16}});
+        createBuffer(regionSize);
+    }
+
+    void LveFrameRingBuffer::createBuffer(VkDeviceSize regionSize) {
+        // One descriptor covers a whole region, so it has to stay within what a storage descriptor can reach
+        if (regionSize > lveDevice.properties.limits.maxStorageBufferRange) {
+            throw std::runtime_error("frame ring buffer region is larger than maxStorageBufferRange!");
+        }
+        buffer = std::make_unique<LveBuffer>(
+            lveDevice,
+            regionSize,
+            LveSwapChain::MAX_FRAMES_IN_FLIGHT,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            regionAlignment);
+        buffer->map(); // Stays mapped for the lifetime of the buffer
+        generation++;
+        stats.regionSize = buffer->getAlignmentSize();
+    }
+
+    void LveFrameRingBuffer::beginFrame(int frameIndex) {
+        for (auto &retired : retiredBuffers) {
+            retired.framesLeft--;
+        }
+        retiredBuffers.erase(
+            std::remove_if(retiredBuffers.begin(), retiredBuffers.end(), [](const RetiredBuffer &retired) { return retired.framesLeft == 0; }),
+            retiredBuffers.end());
+
+        // The other frames may still be reading their regions of the old buffer, so it is retired, not destroyed
+        if (stats.highWaterMark > getRegionSize()) {
+            VkDeviceSize regionSize = getRegionSize();
+            while (regionSize < stats.highWaterMark) {
+                regionSize *= 2;
+            }
+            retiredBuffers.push_back({std::move(buffer), static_cast<uint32_t>(LveSwapChain::MAX_FRAMES_IN_FLIGHT)});
+            createBuffer(regionSize);
+            stats.growCount++;
+        }
+
+        regionBase = buffer->getOffsetForIndex(static_cast<uint32_t>(frameIndex));
+        cursor = 0;
+        requested = 0;
+        stats.used = 0;
+        stats.allocationCount = 0;
+        stats.overflowCount = 0;
+    }
+
+    LveFrameRingBuffer::Allocation LveFrameRingBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of 2");
+        // Tracked even when it doesn't fit, so growing makes room for everything that was asked for
+        requested = alignUp(requested, alignment) + size;
+        stats.highWaterMark = std::max(stats.highWaterMark, requested);
+
+        VkDeviceSize offset = alignUp(cursor, alignment);
+        if (offset + size > getRegionSize()) {
+            stats.overflowCount++;
+            return {};
+        }
+        cursor = offset + size;
+        stats.used = cursor;
+        stats.allocationCount++;
+
+        Allocation allocation{};
+        allocation.data = static_cast<char *>(buffer->getMappedMemory()) + regionBase + offset;
+        allocation.offset = static_cast<uint32_t>(regionBase + offset);
+        allocation.regionOffset = static_cast<uint32_t>(offset);
+        allocation.size = size;
+        return allocation;
+    }
+
+    LveFrameRingBuffer::Allocation LveFrameRingBuffer::allocateArray(VkDeviceSize elementSize, uint32_t count) {
+        // Element sizes aren't powers of 2 in general, so round up to the next whole element by hand
+        VkDeviceSize padding = (elementSize - cursor % elementSize) % elementSize;
+        // Keeps requested in step with cursor, the padding counts as part of the allocation
+        Allocation allocation = allocate(padding + elementSize * count, 1);
+        if (!allocation) {
+            return {};
+        }
+        allocation.data = static_cast<char *>(allocation.data) + padding;
+        allocation.offset += static_cast<uint32_t>(padding);
+        allocation.regionOffset += static_cast<uint32_t>(padding);
+        allocation.size -= padding;
+        return allocation;
+    }
+}
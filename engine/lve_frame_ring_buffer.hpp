@@ -0,0 +1,96 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+//std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lve {
+    // Host visible buffer for data that only lives for one frame (camera, lights, per object data),
+    // split into one region per frame in flight and mapped for its whole lifetime
+    // Allocating is bumping the current region's cursor, and beginFrame resets it once that frame's fence
+    // has been waited on, so nothing is ever freed one by one
+    //
+    // Offsets are meant for dynamic descriptors: a set is written once against the buffer and every
+    // allocation is picked at bind time through its dynamic offset
+    //
+    // A frame asking for more than its region fails the allocation instead of overwriting another frame,
+    // the next beginFrame then grows every region to fit the most any frame asked for
+    // The old buffer is kept until the frames still reading it are done
+    class LveFrameRingBuffer {
+        public:
+            struct Allocation {
+                void *data = nullptr; // nullptr when the region overflowed
+                uint32_t offset = 0; // from the start of the buffer, the dynamic offset for a descriptor at offset 0
+                uint32_t regionOffset = 0; // from the start of this frame's region
+                VkDeviceSize size = 0;
+
+                explicit operator bool() const { return data != nullptr; }
+            };
+
+            struct Stats {
+                VkDeviceSize regionSize = 0;
+                VkDeviceSize used = 0; // bytes handed out this frame, including alignment padding
+                VkDeviceSize highWaterMark = 0; // most any frame asked for so far, overflowed requests included
+                uint32_t allocationCount = 0; // this frame
+                uint32_t overflowCount = 0; // allocations that didn't fit this frame
+                uint32_t growCount = 0; // times the regions were grown after an overflow
+            };
+
+            LveFrameRingBuffer(LveDevice &device, VkDeviceSize regionSize);
+
+            LveFrameRingBuffer(const LveFrameRingBuffer &) = delete;
+            LveFrameRingBuffer &operator=(const LveFrameRingBuffer &) = delete;
+
+            // Call after beginFrame waited on this frame slot's fence, before anything allocates
+            void beginFrame(int frameIndex);
+
+            // alignment has to be a power of 2
+            Allocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+            // Aligned for a dynamic uniform buffer offset
+            Allocation allocateUniform(VkDeviceSize size) { return allocate(size, uniformAlignment); }
+            // count elements at a multiple of elementSize from the start of the region, so they can be indexed
+            // through one storage descriptor over the whole region: the first one is element regionOffset / elementSize
+            Allocation allocateArray(VkDeviceSize elementSize, uint32_t count);
+
+            VkBuffer getBuffer() const { return buffer->getBuffer(); }
+            // Bumped whenever the buffer is replaced, descriptors written against an older one need rewriting
+            uint64_t getGeneration() const { return generation; }
+            VkDeviceSize getRegionSize() const { return buffer->getAlignmentSize(); }
+            // Dynamic offset of the current frame's region, for a descriptor covering one region (see regionDescriptorInfo)
+            uint32_t getRegionOffset() const { return static_cast<uint32_t>(regionBase); }
+            // Descriptor for allocations up to range bytes, eg. a uniform block
+            VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const { return {getBuffer(), 0, range}; }
+            // Descriptor covering a whole region, bound with getRegionOffset
+            VkDescriptorBufferInfo regionDescriptorInfo() const { return {getBuffer(), 0, getRegionSize()}; }
+
+            const Stats &getStats() const { return stats; }
+
+        private:
+            void createBuffer(VkDeviceSize regionSize);
+
+            LveDevice &lveDevice;
+            std::unique_ptr<LveBuffer> buffer; // MAX_FRAMES_IN_FLIGHT instances of one region each
+            VkDeviceSize uniformAlignment;
+            VkDeviceSize regionAlignment; // dynamic offsets of uniform and storage descriptors both fit it
+            uint64_t generation = 0;
+
+            VkDeviceSize regionBase = 0;
+            VkDeviceSize cursor = 0; // within the current region
+            VkDeviceSize requested = 0; // what the current frame asked for, overflows included
+
+            // Replaced buffers stay alive until the frames that were recorded against them have finished
+            struct RetiredBuffer {
+                std::unique_ptr<LveBuffer> buffer;
+                uint32_t framesLeft;
+            };
+            std::vector<RetiredBuffer> retiredBuffers;
+
+            Stats stats{};
+    };
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS // Radians must be radians
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // Expect depth values to 0 - 1
+#include <glm/glm.hpp>
+
+//std
+#include <array>
+
+namespace lve {
+    // Six planes facing inwards, xyz is the normal and w the distance
+    // A point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+    struct LveFrustum {
+        enum Plane { PLANE_LEFT = 0, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+
+        std::array<glm::vec4, PLANE_COUNT> planes{};
+
+        // Gribb & Hartmann plane extraction from a projection * view matrix
+        // With GLM_FORCE_DEPTH_ZERO_TO_ONE the near plane is z >= 0 instead of z >= -w
+        static LveFrustum fromMatrix(const glm::mat4 &projectionView) {
+            // glm is column major, so build the rows out of the columns
+            glm::vec4 row0{projectionView[0][0], projectionView[1][0], projectionView[2][0], projectionView[3][0]};
+            glm::vec4 row1{projectionView[0][1], projectionView[1][1], projectionView[2][1], projectionView[3][1]};
+            glm::vec4 row2{projectionView[0][2], projectionView[1][2], projectionView[2][2], projectionView[3][2]};
+            glm::vec4 row3{projectionView[0][3], projectionView[1][3], projectionView[2][3], projectionView[3][3]};
+
+            LveFrustum frustum{};
+            frustum.planes[PLANE_LEFT] = row3 + row0;
+            frustum.planes[PLANE_RIGHT] = row3 - row0;
+            frustum.planes[PLANE_BOTTOM] = row3 + row1;
+            frustum.planes[PLANE_TOP] = row3 - row1;
+            frustum.planes[PLANE_NEAR] = row2;
+            frustum.planes[PLANE_FAR] = row3 - row2;
+
+            // Normalize so plane distances are real distances and can be compared to a radius
+            for (auto &plane : frustum.planes) {
+                plane /= glm::length(glm::vec3{plane});
+            }
+            return frustum;
+        }
+
+        bool intersectsSphere(const glm::vec3 &center, float radius) const {
+            for (auto &plane : planes) {
+                if (glm::dot(glm::vec3{plane}, center) + plane.w < -radius) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+}
@@ -0,0 +1,261 @@
+#include "lve_frustum_culler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define LVE_CULL_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LVE_CULL_NEON
+#endif
+
+//std
+#include <algorithm>
+#include <cmath>
+
+namespace lve {
+
+    namespace {
+        enum SphereResult : uint8_t { SPHERE_OUTSIDE = 0, SPHERE_INSIDE = 1, SPHERE_INTERSECTING = 2 };
+
+        inline uint8_t sphereResult(bool outside, bool straddles) {
+            return outside ? SPHERE_OUTSIDE : (straddles ? SPHERE_INTERSECTING : SPHERE_INSIDE);
+        }
+
+        // A sphere is outside when it is completely behind any plane, inside when it is in front of all of them
+        void classifySpheres(const float *x, const float *y, const float *z, const float *r,
+                             uint32_t count, const LveFrustum &frustum, uint8_t *results) {
+            uint32_t i = 0;
+#if defined(LVE_CULL_SSE)
+            for (; i + 4 <= count; i += 4) {
+                __m128 cx = _mm_loadu_ps(x + i);
+                __m128 cy = _mm_loadu_ps(y + i);
+                __m128 cz = _mm_loadu_ps(z + i);
+                __m128 radius = _mm_loadu_ps(r + i);
+                __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+                __m128 outside = _mm_setzero_ps();
+                __m128 straddles = _mm_setzero_ps();
+                for (auto &plane : frustum.planes) {
+                    __m128 distance = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+                    straddles = _mm_or_ps(straddles, _mm_cmplt_ps(distance, radius));
+                }
+                int outsideMask = _mm_movemask_ps(outside);
+                int straddlesMask = _mm_movemask_ps(straddles);
+                for (int lane = 0; lane < 4; lane++) {
+                    results[i + lane] = sphereResult((outsideMask >> lane) & 1, (straddlesMask >> lane) & 1);
+                }
+            }
+#elif defined(LVE_CULL_NEON)
+            for (; i + 4 <= count; i += 4) {
+                float32x4_t cx = vld1q_f32(x + i);
+                float32x4_t cy = vld1q_f32(y + i);
+                float32x4_t cz = vld1q_f32(z + i);
+                float32x4_t radius = vld1q_f32(r + i);
+                float32x4_t negativeRadius = vnegq_f32(radius);
+                uint32x4_t outside = vdupq_n_u32(0);
+                uint32x4_t straddles = vdupq_n_u32(0);
+                for (auto &plane : frustum.planes) {
+                    float32x4_t distance = vaddq_f32(
+                        vaddq_f32(vmulq_n_f32(cx, plane.x), vmulq_n_f32(cy, plane.y)),
+                        vaddq_f32(vmulq_n_f32(cz, plane.z), vdupq_n_f32(plane.w)));
+                    outside = vorrq_u32(outside, vcltq_f32(distance, negativeRadius));
+                    straddles = vorrq_u32(straddles, vcltq_f32(distance, radius));
+                }
+                uint32_t outsideLanes[4];
+                uint32_t straddlesLanes[4];
+                vst1q_u32(outsideLanes, outside);
+                vst1q_u32(straddlesLanes, straddles);
+                for (int lane = 0; lane < 4; lane++) {
+                    results[i + lane] = sphereResult(outsideLanes[lane] != 0, straddlesLanes[lane] != 0);
+                }
+            }
+#endif
+            for (; i < count; i++) {
+                bool outside = false;
+                bool straddles = false;
+                for (auto &plane : frustum.planes) {
+                    float distance = plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w;
+                    outside = outside || distance < -r[i];
+                    straddles = straddles || distance < r[i];
+                }
+                results[i] = sphereResult(outside, straddles);
+            }
+        }
+
+        // World space box around the transformed model box: the center moves with the matrix,
+        // the half extents are spread over the world axes by the absolute rotation and scale
+        void worldBox(const glm::mat4 &matrix, const glm::vec3 &boxMin, const glm::vec3 &boxMax, glm::vec3 &center, glm::vec3 &extent) {
+            glm::vec3 localCenter = (boxMin + boxMax) * .5f;
+            glm::vec3 localExtent = (boxMax - boxMin) * .5f;
+            center = glm::vec3{matrix * glm::vec4{localCenter, 1.f}};
+            extent = glm::abs(glm::vec3{matrix[0]}) * localExtent.x +
+                     glm::abs(glm::vec3{matrix[1]}) * localExtent.y +
+                     glm::abs(glm::vec3{matrix[2]}) * localExtent.z;
+        }
+
+        LveAabb worldAabb(const glm::mat4 &matrix, const LveModel &model) {
+            glm::vec3 center;
+            glm::vec3 extent;
+            worldBox(matrix, model.getBoundingBoxMin(), model.getBoundingBoxMax(), center, extent);
+            return {center - extent, center + extent};
+        }
+
+        bool boxIntersects(const LveFrustum &frustum, const glm::mat4 &matrix, const glm::vec3 &boxMin, const glm::vec3 &boxMax) {
+            glm::vec3 center;
+            glm::vec3 extent;
+            worldBox(matrix, boxMin, boxMax, center, extent);
+            for (auto &plane : frustum.planes) {
+                glm::vec3 normal{plane};
+                float reach = glm::dot(extent, glm::abs(normal));
+                if (glm::dot(normal, center) + plane.w < -reach) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    void LveFrustumCuller::cull(const LveFrustum &frustum, const LveRegistry &registry, const LveAssetRegistry &assets,
+                                LveJobSystem *jobSystem, std::vector<uint32_t> &visible) {
+        stats = Stats{};
+        bool useBvh = method == METHOD_BVH || (method == METHOD_AUTO && registry.size() >= BVH_MIN_OBJECTS);
+        if (useBvh) {
+            cullBvh(frustum, registry, assets, visible);
+        } else {
+            cullSpheres(frustum, registry, assets, jobSystem, visible);
+        }
+        stats.visibleCount = static_cast<uint32_t>(visible.size());
+        stats.culledCount = registry.size() - stats.visibleCount;
+    }
+
+    void LveFrustumCuller::cullSpheres(const LveFrustum &frustum, const LveRegistry &registry, const LveAssetRegistry &assets,
+                                       LveJobSystem *jobSystem, std::vector<uint32_t> &visible) {
+        uint32_t count = registry.size();
+        centerX.resize(count);
+        centerY.resize(count);
+        centerZ.resize(count);
+        radius.resize(count);
+        results.resize(count);
+
+        uint32_t chunkCount = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        chunkVisible.resize(chunkCount);
+        chunkBoxTests.assign(chunkCount, 0);
+
+        auto cullChunks = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t chunk = begin; chunk < end; chunk++) {
+                cullChunk(chunk, frustum, registry, assets);
+            }
+        };
+        if (jobSystem != nullptr && chunkCount > 1) {
+            jobSystem->parallelFor(chunkCount, 1, cullChunks);
+        } else {
+            cullChunks(0, chunkCount);
+        }
+
+        visible.clear();
+        for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+            visible.insert(visible.end(), chunkVisible[chunk].begin(), chunkVisible[chunk].end());
+            stats.boxTestCount += chunkBoxTests[chunk];
+        }
+    }
+
+    void LveFrustumCuller::cullBvh(const LveFrustum &frustum, const LveRegistry &registry, const LveAssetRegistry &assets, std::vector<uint32_t> &visible) {
+        stats.usedBvh = true;
+        stats.bvhReinsertCount = syncBvh(registry, assets);
+
+        bvhIds.clear();
+        bvh.queryFrustum(frustum, bvhIds);
+        visible.clear();
+        visible.reserve(bvhIds.size());
+        for (LveBvh::id_t slot : bvhIds) {
+            visible.push_back(registry.indexOfSlot(slot));
+        }
+    }
+
+    // Brings the tree up to date with everything that changed since the last sync, returns how many objects were reinserted
+    uint32_t LveFrustumCuller::syncBvh(const LveRegistry &registry, const LveAssetRegistry &assets) {
+        auto &entities = registry.getEntities();
+        auto &matrices = registry.getMatrices();
+        auto &models = registry.getModels();
+        uint32_t count = registry.size();
+
+        // New objects are gathered so the first sync of a big scene is one top down build
+        uint32_t reinserts = 0;
+        bvhInsertIds.clear();
+        bvhInsertBounds.clear();
+        for (uint32_t i = 0; i < count; i++) {
+            // A reused slot still holds the destroyed object's leaf, the new object is always
+            // changed since the last sync so it just moves that leaf
+            LveBvh::id_t slot = LveRegistry::slotOf(entities[i]);
+            bool known = bvh.contains(slot);
+            if (known && !registry.hasChangedSince(i, bvhVersion)) {
+                continue;
+            }
+            LveAabb bounds = worldAabb(matrices[i], assets.getModel(models[i]));
+            if (known) {
+                reinserts += bvh.update(slot, bounds) ? 1 : 0;
+            } else {
+                bvhInsertIds.push_back(slot);
+                bvhInsertBounds.push_back(bounds);
+            }
+        }
+        bvh.insertBatch(bvhInsertIds, bvhInsertBounds);
+
+        // Every live object is in the tree now, so it only holds destroyed ones if it is bigger than the registry
+        if (bvh.size() > count) {
+            bvhIds.clear();
+            bvh.forEachId([&](LveBvh::id_t slot) {
+                if (registry.indexOfSlot(slot) == LveRegistry::INVALID_INDEX) {
+                    bvhIds.push_back(slot);
+                }
+            });
+            bvh.removeBatch(bvhIds);
+        }
+
+        bvh.maintain();
+        bvhVersion = registry.getVersion();
+        return reinserts;
+    }
+
+    void LveFrustumCuller::cullChunk(uint32_t chunk, const LveFrustum &frustum, const LveRegistry &registry, const LveAssetRegistry &assets) {
+        uint32_t begin = chunk * CHUNK_SIZE;
+        uint32_t end = std::min(begin + CHUNK_SIZE, registry.size());
+        auto &matrices = registry.getMatrices();
+        auto &models = registry.getModels();
+
+        // Model spheres into world space, scaled by the largest axis so non uniform scale stays conservative
+        for (uint32_t i = begin; i < end; i++) {
+            const glm::mat4 &matrix = matrices[i];
+            glm::vec4 sphere = assets.getModel(models[i]).getBoundingSphere();
+            glm::vec4 center = matrix * glm::vec4{glm::vec3{sphere}, 1.f};
+            float scale = std::sqrt(std::max({glm::dot(glm::vec3{matrix[0]}, glm::vec3{matrix[0]}),
+                                              glm::dot(glm::vec3{matrix[1]}, glm::vec3{matrix[1]}),
+                                              glm::dot(glm::vec3{matrix[2]}, glm::vec3{matrix[2]})}));
+            centerX[i] = center.x;
+            centerY[i] = center.y;
+            centerZ[i] = center.z;
+            radius[i] = sphere.w * scale;
+        }
+
+        classifySpheres(&centerX[begin], &centerY[begin], &centerZ[begin], &radius[begin], end - begin, frustum, &results[begin]);
+
+        auto &chunkList = chunkVisible[chunk];
+        chunkList.clear();
+        uint32_t boxTests = 0;
+        for (uint32_t i = begin; i < end; i++) {
+            if (results[i] == SPHERE_INTERSECTING) {
+                boxTests++;
+                const LveModel &model = assets.getModel(models[i]);
+                if (!boxIntersects(frustum, matrices[i], model.getBoundingBoxMin(), model.getBoundingBoxMax())) {
+                    continue;
+                }
+            } else if (results[i] == SPHERE_OUTSIDE) {
+                continue;
+            }
+            chunkList.push_back(i);
+        }
+        chunkBoxTests[chunk] = boxTests;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "lve_asset_registry.hpp"
+#include "lve_bvh.hpp"
+#include "lve_frustum.hpp"
+#include "lve_job_system.hpp"
+#include "lve_registry.hpp"
+
+//std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+    // CPU frustum culling over the registry
+    // World space bounding spheres are laid out as arrays (x, y, z, radius) and tested 4 at a time with SSE / NEON
+    // Spheres that straddle a plane get a second, tighter test with the model's box, so a cube
+    // isn't drawn just because the corner of its sphere pokes into the view
+    // The registry is cut into chunks that are culled in parallel, the visible lists are joined in order
+    //
+    // Big scenes are culled through a BVH of world boxes instead, which skips whole groups of objects
+    // outside the view with one test. The tree is kept in sync with the registry's change versions,
+    // so objects that didn't move cost nothing but a version compare
+    class LveFrustumCuller {
+        public:
+            // Objects per job, a multiple of the SIMD width
+            static constexpr uint32_t CHUNK_SIZE = 1024;
+            // Below this many objects testing all of them is about as fast as walking the tree
+            static constexpr uint32_t BVH_MIN_OBJECTS = 8192;
+
+            enum Method { METHOD_AUTO, METHOD_SPHERES, METHOD_BVH };
+
+            struct Stats {
+                uint32_t visibleCount = 0;
+                uint32_t culledCount = 0;
+                uint32_t boxTestCount = 0; // spheres that straddled a plane and needed the box test
+                uint32_t bvhReinsertCount = 0; // objects that moved out of their fat box in the bvh
+                bool usedBvh = false;
+            };
+
+            // Dense indices of the registry objects inside the frustum, in dense order for the sphere test
+            // and in no particular order for the bvh
+            // Uses the registry's world matrices, so call updateMatrices first
+            void cull(const LveFrustum &frustum, const LveRegistry &registry, const LveAssetRegistry &assets,
+                      LveJobSystem *jobSystem, std::vector<uint32_t> &visible);
+
+            void setMethod(Method newMethod) { method = newMethod; }
+            const Stats &getStats() const { return stats; }
+            // Also usable for other scene queries (picking, overlap) once cull has synced it
+            const LveBvh &getBvh() const { return bvh; }
+
+        private:
+            void cullSpheres(const LveFrustum &frustum, const LveRegistry &registry, const LveAssetRegistry &assets,
+                             LveJobSystem *jobSystem, std::vector<uint32_t> &visible);
+            void cullBvh(const LveFrustum &frustum, const LveRegistry &registry, const LveAssetRegistry &assets, std::vector<uint32_t> &visible);
+            void cullChunk(uint32_t chunk, const LveFrustum &frustum, const LveRegistry &registry, const LveAssetRegistry &assets);
+            uint32_t syncBvh(const LveRegistry &registry, const LveAssetRegistry &assets);
+
+            // Structure of arrays, so one SIMD load picks up the same value of 4 spheres
+            std::vector<float> centerX;
+            std::vector<float> centerY;
+            std::vector<float> centerZ;
+            std::vector<float> radius;
+            std::vector<uint8_t> results; // SphereResult per object
+
+            std::vector<std::vector<uint32_t>> chunkVisible;
+            std::vector<uint32_t> chunkBoxTests;
+
+            // Keyed by entity slot, bvhVersion is the registry version it was last synced to
+            LveBvh bvh;
+            uint64_t bvhVersion = 0;
+            std::vector<LveBvh::id_t> bvhInsertIds;
+            std::vector<LveAabb> bvhInsertBounds;
+            std::vector<LveBvh::id_t> bvhIds;
+
+            Method method = METHOD_AUTO;
+            Stats stats{};
+    };
+}
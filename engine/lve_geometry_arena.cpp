@@ -0,0 +1,159 @@
+#include "lve_geometry_arena.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+
+namespace lve {
+
+    LveRangeAllocator::LveRangeAllocator(uint32_t capacity) : capacity{capacity} {
+        if (capacity > 0) {
+            freeBlocks.emplace(0, capacity);
+        }
+    }
+
+    uint32_t LveRangeAllocator::allocate(uint32_t count) {
+        assert(count > 0 && "Cannot allocate an empty range");
+        for (auto it = freeBlocks.begin(); it != freeBlocks.end(); it++) {
+            if (it->second < count) {
+                continue;
+            }
+            uint32_t offset = it->first;
+            uint32_t remaining = it->second - count;
+            freeBlocks.erase(it);
+            if (remaining > 0) {
+                freeBlocks.emplace(offset + count, remaining); // Keep the tail of the block free
+            }
+            used += count;
+            peakUsed = std::max(peakUsed, used);
+            return offset;
+        }
+        return INVALID_OFFSET;
+    }
+
+    void LveRangeAllocator::free(uint32_t offset, uint32_t count) {
+        assert(offset + count <= capacity && "Freed range is outside of the allocator");
+        auto next = freeBlocks.lower_bound(offset);
+        assert((next == freeBlocks.end() || next->first >= offset + count) && "Range was freed twice");
+        used -= count;
+
+        // Merge with the block right after
+        if (next != freeBlocks.end() && next->first == offset + count) {
+            count += next->second;
+            next = freeBlocks.erase(next);
+        }
+
+        // Merge with the block right before, otherwise start a new block
+        if (next != freeBlocks.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += count;
+                return;
+            }
+        }
+        freeBlocks.emplace(offset, count);
+    }
+
+    LveGeometryArena::LveGeometryArena(LveDevice &device, const std::vector<VkDeviceSize> &vertexStrides, uint32_t maxVertices, uint32_t maxIndices)
+        : lveDevice{device}, vertexStrides{vertexStrides}, vertexRanges{maxVertices}, indexRanges{maxIndices} {
+        assert(!vertexStrides.empty() && vertexStrides.size() <= LveCommandRecorder::MAX_VERTEX_BINDINGS && "Unsupported number of vertex streams");
+        // Device local memory is the fastest for the GPU to read, but the CPU can't see it
+        // so everything is copied in through a staging buffer
+        for (VkDeviceSize stride : vertexStrides) {
+            vertexBuffers.push_back(std::make_unique<LveBuffer>(
+                lveDevice,
+                stride,
+                maxVertices,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+            bindBuffers.push_back(vertexBuffers.back()->getBuffer());
+            bindOffsets.push_back(0); // Models are reached through the vertexOffset of each draw instead
+        }
+        indexBuffer = std::make_unique<LveBuffer>(
+            lveDevice,
+            sizeof(uint32_t),
+            maxIndices,
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    LveGeometryArena::~LveGeometryArena() {}
+
+    LveGeometryArena::Allocation LveGeometryArena::allocate(const std::vector<const void *> &vertexData, uint32_t vertexCount, const uint32_t *indexData, uint32_t indexCount) {
+        assert(vertexCount > 0 && indexCount > 0 && "Cannot allocate empty geometry");
+        assert(vertexData.size() == vertexStrides.size() && "Need data for every vertex stream");
+
+        uint32_t vertexOffset = vertexRanges.allocate(vertexCount);
+        if (vertexOffset == LveRangeAllocator::INVALID_OFFSET) {
+            throw std::runtime_error("geometry arena is out of vertex space!");
+        }
+        uint32_t firstIndex = indexRanges.allocate(indexCount);
+        if (firstIndex == LveRangeAllocator::INVALID_OFFSET) {
+            vertexRanges.free(vertexOffset, vertexCount);
+            throw std::runtime_error("geometry arena is out of index space!");
+        }
+
+        // One staging buffer holds every stream's vertices and the indices, back to back
+        VkDeviceSize vertexBytes = 0;
+        for (VkDeviceSize stride : vertexStrides) {
+            vertexBytes += stride * vertexCount;
+        }
+        VkDeviceSize indexBytes = sizeof(uint32_t) * indexCount;
+        LveBuffer stagingBuffer{
+            lveDevice,
+            1,
+            static_cast<uint32_t>(vertexBytes + indexBytes),
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        };
+        stagingBuffer.map();
+        VkDeviceSize stagingOffset = 0;
+        for (size_t stream = 0; stream < vertexStrides.size(); stream++) {
+            stagingBuffer.writeToBuffer(vertexData[stream], vertexStrides[stream] * vertexCount, stagingOffset);
+            stagingOffset += vertexStrides[stream] * vertexCount;
+        }
+        stagingBuffer.writeToBuffer(indexData, indexBytes, vertexBytes);
+
+        // Every stream and the indices in one submit, each submit waits for the queue to go idle
+        VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeCommands();
+        stagingOffset = 0;
+        for (size_t stream = 0; stream < vertexStrides.size(); stream++) {
+            VkBufferCopy copyRegion{};
+            copyRegion.srcOffset = stagingOffset;
+            copyRegion.dstOffset = vertexStrides[stream] * vertexOffset;
+            copyRegion.size = vertexStrides[stream] * vertexCount;
+            vkCmdCopyBuffer(commandBuffer, stagingBuffer.getBuffer(), vertexBuffers[stream]->getBuffer(), 1, &copyRegion);
+            stagingOffset += copyRegion.size;
+        }
+        VkBufferCopy indexRegion{};
+        indexRegion.srcOffset = vertexBytes;
+        indexRegion.dstOffset = sizeof(uint32_t) * firstIndex;
+        indexRegion.size = indexBytes;
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer.getBuffer(), indexBuffer->getBuffer(), 1, &indexRegion);
+        lveDevice.endSingleTimeCommands(commandBuffer);
+
+        Allocation allocation{};
+        allocation.vertexOffset = static_cast<int32_t>(vertexOffset);
+        allocation.vertexCount = vertexCount;
+        allocation.firstIndex = firstIndex;
+        allocation.indexCount = indexCount;
+        return allocation;
+    }
+
+    void LveGeometryArena::free(const Allocation &allocation) {
+        vertexRanges.free(static_cast<uint32_t>(allocation.vertexOffset), allocation.vertexCount);
+        indexRanges.free(allocation.firstIndex, allocation.indexCount);
+    }
+
+    void LveGeometryArena::bind(VkCommandBuffer commandBuffer) {
+        vkCmdBindVertexBuffers(commandBuffer, 0, getStreamCount(), bindBuffers.data(), bindOffsets.data());
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    }
+
+    void LveGeometryArena::bind(LveCommandRecorder &recorder) {
+        recorder.bindVertexBuffers(0, getStreamCount(), bindBuffers.data(), bindOffsets.data());
+        recorder.bindIndexBuffer(indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_buffer.hpp"
+#include "lve_command_recorder.hpp"
+
+//std
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace lve {
+    // First fit free list over a range of [0, capacity) elements
+    // Neighbouring free blocks are merged on release so load/unload cycles don't fragment forever
+    class LveRangeAllocator {
+        public:
+            static constexpr uint32_t INVALID_OFFSET = UINT32_MAX;
+
+            explicit LveRangeAllocator(uint32_t capacity);
+
+            // Returns INVALID_OFFSET when there is no free block large enough
+            uint32_t allocate(uint32_t count);
+            void free(uint32_t offset, uint32_t count);
+
+            uint32_t getCapacity() const { return capacity; }
+            uint32_t getUsed() const { return used; }
+            uint32_t getPeakUsed() const { return peakUsed; }
+            size_t getFreeBlockCount() const { return freeBlocks.size(); }
+
+        private:
+            // Keyed by offset so the neighbours of a released block are one lookup away
+            std::map<uint32_t, uint32_t> freeBlocks;
+            uint32_t capacity;
+            uint32_t used = 0;
+            uint32_t peakUsed = 0;
+    };
+
+    // Device local vertex buffers and one index buffer shared by every model
+    // Models live as (vertexOffset, firstIndex, indexCount) ranges inside it,
+    // so a frame binds geometry once and every draw is just offsets
+    // Vertices can be split over several streams, each its own buffer bound at the binding of the same index,
+    // eg. positions apart from everything else so depth only passes fetch just the positions
+    class LveGeometryArena {
+        public:
+            struct Allocation {
+                int32_t vertexOffset = 0; // Added to every index by vkCmdDrawIndexed
+                uint32_t vertexCount = 0;
+                uint32_t firstIndex = 0;
+                uint32_t indexCount = 0;
+            };
+
+            // One stride per vertex stream, every stream holds maxVertices
+            LveGeometryArena(LveDevice &device, const std::vector<VkDeviceSize> &vertexStrides, uint32_t maxVertices, uint32_t maxIndices);
+            ~LveGeometryArena();
+
+            LveGeometryArena(const LveGeometryArena &) = delete;
+            LveGeometryArena &operator=(const LveGeometryArena &) = delete;
+
+            // Copies the vertices and indices into free ranges of the arena through a staging buffer
+            // vertexData has one array of vertexCount elements per stream, all at the same offset in their streams
+            // Indices are relative to the first vertex, the vertex offset is applied at draw time
+            Allocation allocate(const std::vector<const void *> &vertexData, uint32_t vertexCount, const uint32_t *indexData, uint32_t indexCount);
+            // Returns the ranges to the free lists, the caller must make sure no frame in flight still reads them
+            void free(const Allocation &allocation);
+
+            // Every stream, a pipeline that reads fewer of them simply ignores the rest
+            void bind(VkCommandBuffer commandBuffer);
+            void bind(LveCommandRecorder &recorder);
+
+            uint32_t getStreamCount() const { return static_cast<uint32_t>(vertexStrides.size()); }
+            VkDeviceSize getVertexStride(uint32_t stream) const { return vertexStrides[stream]; }
+            VkBuffer getVertexBuffer(uint32_t stream) const { return vertexBuffers[stream]->getBuffer(); }
+            VkBuffer getIndexBuffer() const { return indexBuffer->getBuffer(); }
+            const LveRangeAllocator &getVertexRanges() const { return vertexRanges; }
+            const LveRangeAllocator &getIndexRanges() const { return indexRanges; }
+
+        private:
+            LveDevice &lveDevice;
+            std::vector<VkDeviceSize> vertexStrides;
+
+            std::vector<std::unique_ptr<LveBuffer>> vertexBuffers;
+            std::unique_ptr<LveBuffer> indexBuffer;
+            // What bind passes to vkCmdBindVertexBuffers, one per stream
+            std::vector<VkBuffer> bindBuffers;
+            std::vector<VkDeviceSize> bindOffsets;
+            LveRangeAllocator vertexRanges;
+            LveRangeAllocator indexRanges;
+    };
+}
@@ -0,0 +1,64 @@
+#include "lve_gpu_timer.hpp"
+
+//std
+#include <stdexcept>
+
+namespace lve {
+
+    LveGpuTimer::LveGpuTimer(LveDevice &device) : lveDevice{device} {
+        uint32_t validBits = lveDevice.getTimestampValidBits();
+        if (validBits == 0) {
+            return;
+        }
+        validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+        nanosecondsPerTick = lveDevice.properties.limits.timestampPeriod;
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = 2 * LveSwapChain::MAX_FRAMES_IN_FLIGHT; // start and end per frame
+        if (vkCreateQueryPool(lveDevice.device(), &poolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
+    LveGpuTimer::~LveGpuTimer() {
+        vkDestroyQueryPool(lveDevice.device(), queryPool, nullptr);
+    }
+
+    bool LveGpuTimer::beginFrame(int frameIndex) {
+        if (!written[frameIndex]) {
+            return false;
+        }
+        written[frameIndex] = false;
+
+        // The fence was waited on, so both are available, no WAIT flag needed
+        uint64_t timestamps[2];
+        VkResult result = vkGetQueryPoolResults(lveDevice.device(), queryPool, 2 * frameIndex, 2, sizeof(timestamps),
+                                                timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) {
+            return false;
+        }
+        uint64_t ticks = (timestamps[1] - timestamps[0]) & validMask;
+        milliseconds = static_cast<float>(static_cast<double>(ticks) * nanosecondsPerTick / 1e6);
+        return true;
+    }
+
+    void LveGpuTimer::begin(VkCommandBuffer commandBuffer, int frameIndex) {
+        if (!isSupported()) {
+            return;
+        }
+        // Queries have to be reset before they are written again, recorded here so it needs no separate submit
+        vkCmdResetQueryPool(commandBuffer, queryPool, 2 * frameIndex, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 2 * frameIndex);
+    }
+
+    void LveGpuTimer::end(VkCommandBuffer commandBuffer, int frameIndex) {
+        if (!isSupported()) {
+            return;
+        }
+        // Written once everything before it in the command buffer has finished
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 2 * frameIndex + 1);
+        written[frameIndex] = true;
+    }
+}
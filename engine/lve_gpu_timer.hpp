@@ -0,0 +1,42 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+//std
+#include <array>
+#include <cstdint>
+
+namespace lve {
+    // Times a span of each frame's command buffer on the GPU with a pair of timestamp queries
+    // Every frame in flight has its own pair, read back the next time the slot begins, after its fence,
+    // so the result is MAX_FRAMES_IN_FLIGHT frames old but getting it never waits
+    class LveGpuTimer {
+        public:
+            LveGpuTimer(LveDevice &device);
+            ~LveGpuTimer();
+
+            LveGpuTimer(const LveGpuTimer &) = delete;
+            LveGpuTimer &operator=(const LveGpuTimer &) = delete;
+
+            // False if the graphics queue can't write timestamps, begin and end then record nothing
+            bool isSupported() const { return queryPool != VK_NULL_HANDLE; }
+
+            // Call after the fence wait for frameIndex, returns true if it picked up a new measurement
+            bool beginFrame(int frameIndex);
+            // Outside of render passes
+            void begin(VkCommandBuffer commandBuffer, int frameIndex);
+            void end(VkCommandBuffer commandBuffer, int frameIndex);
+
+            // Of the newest measured frame
+            float getMilliseconds() const { return milliseconds; }
+
+        private:
+            LveDevice &lveDevice;
+            VkQueryPool queryPool = VK_NULL_HANDLE;
+            uint64_t validMask = 0; // timestamps wrap at timestampValidBits
+            float nanosecondsPerTick = 1.f;
+            std::array<bool, LveSwapChain::MAX_FRAMES_IN_FLIGHT> written{}; // slot has a pair waiting to be read
+            float milliseconds = 0.f;
+    };
+}
@@ -0,0 +1,152 @@
+#include "lve_hierarchy.hpp"
+
+//std
+#include <cassert>
+
+namespace lve {
+
+    void LveHierarchy::add(entity_t entity) {
+        if (entity >= links.size()) {
+            links.resize(entity + 1);
+        }
+        assert(!links[entity].alive && "Entity is already in the hierarchy");
+        links[entity] = Links{};
+        links[entity].alive = true;
+        link(entity, NONE);
+        orderDirty = true;
+    }
+
+    void LveHierarchy::remove(entity_t entity) {
+        assert(entity < links.size() && links[entity].alive && "Entity is not in the hierarchy");
+        while (links[entity].firstChild != NONE) {
+            setParent(links[entity].firstChild, NONE);
+        }
+        unlink(entity);
+        links[entity].alive = false;
+        orderDirty = true;
+    }
+
+    void LveHierarchy::clear() {
+        links.clear();
+        firstRoot = NONE;
+        linkCount = 0;
+        orderDirty = true;
+    }
+
+    void LveHierarchy::setParent(entity_t child, entity_t parent) {
+        assert(links[child].alive && "Child is not in the hierarchy");
+        assert((parent == NONE || links[parent].alive) && "Parent is not in the hierarchy");
+        assert((parent == NONE || !isDescendant(parent, child)) && "Reparenting would create a cycle");
+        if (links[child].parent == parent) {
+            return;
+        }
+        unlink(child);
+        link(child, parent);
+        orderDirty = true;
+    }
+
+    bool LveHierarchy::isDescendant(entity_t entity, entity_t ancestor) const {
+        for (entity_t current = entity; current != NONE; current = links[current].parent) {
+            if (current == ancestor) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Pushes at the front of the parent's (or the root) list
+    void LveHierarchy::link(entity_t entity, entity_t parent) {
+        entity_t &head = parent == NONE ? firstRoot : links[parent].firstChild;
+        links[entity].parent = parent;
+        links[entity].prevSibling = NONE;
+        links[entity].nextSibling = head;
+        if (head != NONE) {
+            links[head].prevSibling = entity;
+        }
+        head = entity;
+        if (parent != NONE) {
+            linkCount++;
+        }
+    }
+
+    void LveHierarchy::unlink(entity_t entity) {
+        Links &node = links[entity];
+        if (node.prevSibling != NONE) {
+            links[node.prevSibling].nextSibling = node.nextSibling;
+        } else if (node.parent != NONE) {
+            links[node.parent].firstChild = node.nextSibling;
+        } else {
+            firstRoot = node.nextSibling;
+        }
+        if (node.nextSibling != NONE) {
+            links[node.nextSibling].prevSibling = node.prevSibling;
+        }
+        if (node.parent != NONE) {
+            linkCount--;
+        }
+        node.parent = node.nextSibling = node.prevSibling = NONE;
+    }
+
+    void LveHierarchy::updateOrder() {
+        if (!orderDirty) {
+            return;
+        }
+        orderDirty = false;
+        order.clear();
+        parentNodes.clear();
+        nodeOf.resize(links.size());
+
+        // Iterative depth first walk, a deep hierarchy would overflow the call stack
+        std::vector<entity_t> stack;
+        for (entity_t root = firstRoot; root != NONE; root = links[root].nextSibling) {
+            stack.push_back(root);
+            while (!stack.empty()) {
+                entity_t entity = stack.back();
+                stack.pop_back();
+                nodeOf[entity] = static_cast<uint32_t>(order.size());
+                order.push_back(entity);
+                entity_t parent = links[entity].parent;
+                parentNodes.push_back(parent == NONE ? NONE : nodeOf[parent]);
+                for (entity_t child = links[entity].firstChild; child != NONE; child = links[child].nextSibling) {
+                    stack.push_back(child);
+                }
+            }
+        }
+
+        // Children come after their parent, so walking backwards every subtree is complete before its parent adds it
+        uint32_t count = static_cast<uint32_t>(order.size());
+        subtreeSizes.assign(count, 1);
+        for (uint32_t node = count; node-- > 0;) {
+            if (parentNodes[node] != NONE) {
+                subtreeSizes[parentNodes[node]] += subtreeSizes[node];
+            }
+        }
+
+        spine.clear();
+        tasks.clear();
+        for (uint32_t node = 0; node < count; node += subtreeSizes[node]) {
+            split(node);
+        }
+    }
+
+    // Small subtrees become one task, big ones put their root on the spine and split their children instead
+    void LveHierarchy::split(uint32_t node) {
+        std::vector<uint32_t> pending{node};
+        while (!pending.empty()) {
+            uint32_t current = pending.back();
+            pending.pop_back();
+            if (subtreeSizes[current] <= TASK_SIZE) {
+                tasks.push_back(current);
+                continue;
+            }
+            spine.push_back(current);
+            // Pushed in reverse so the spine stays in order, parents before children
+            std::vector<uint32_t> children;
+            uint32_t end = current + subtreeSizes[current];
+            for (uint32_t child = current + 1; child < end; child += subtreeSizes[child]) {
+                children.push_back(child);
+            }
+            pending.insert(pending.end(), children.rbegin(), children.rend());
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+//std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+    // Parent / child links between entities, plus a flattened order to walk them in
+    //
+    // The links are intrusive lists keyed by entity slot (LveHandle::slotOf), so reparenting is O(1): unlink, relink, mark the order stale
+    // The order is rebuilt at most once per update however many reparents happened:
+    // a depth first (pre)order over every entity, so a parent always comes before its children
+    // and every subtree is one contiguous range [node, node + subtreeSize)
+    //
+    // Contiguous subtrees are what make the parallel update work: the order is cut into
+    // independent subtree ranges (tasks) plus the few big nodes above them (spine)
+    class LveHierarchy {
+        public:
+            using entity_t = uint32_t;
+            static constexpr uint32_t NONE = UINT32_MAX;
+            // Subtrees up to this many nodes are handed to a single job
+            static constexpr uint32_t TASK_SIZE = 4096;
+
+            LveHierarchy() = default;
+
+            LveHierarchy(const LveHierarchy &) = delete;
+            LveHierarchy &operator=(const LveHierarchy &) = delete;
+
+            // New entities start as roots
+            void add(entity_t entity);
+            // Children of a removed entity become roots
+            void remove(entity_t entity);
+            void clear();
+
+            // NONE makes the entity a root again. Parenting an entity under its own subtree is not allowed
+            void setParent(entity_t child, entity_t parent);
+            entity_t getParent(entity_t entity) const { return links[entity].parent; }
+            entity_t getFirstChild(entity_t entity) const { return links[entity].firstChild; }
+            entity_t getNextSibling(entity_t entity) const { return links[entity].nextSibling; }
+            bool isDescendant(entity_t entity, entity_t ancestor) const;
+            // True when no entity has a parent, every world matrix is then just the local one
+            bool isFlat() const { return linkCount == 0; }
+
+            // Rebuilds the order if anything was added, removed or reparented since the last call
+            void updateOrder();
+
+            // Flattened order, all indexed by node (position in the order), valid after updateOrder
+            const std::vector<entity_t> &getOrder() const { return order; }
+            const std::vector<uint32_t> &getParentNodes() const { return parentNodes; } // NONE for roots
+            const std::vector<uint32_t> &getSubtreeSizes() const { return subtreeSizes; } // including the node itself
+            // Nodes above the tasks, in order, update these first
+            const std::vector<uint32_t> &getSpine() const { return spine; }
+            // First node of each independent subtree, its range is [node, node + subtreeSize)
+            const std::vector<uint32_t> &getTasks() const { return tasks; }
+
+        private:
+            struct Links {
+                entity_t parent = NONE;
+                entity_t firstChild = NONE;
+                entity_t nextSibling = NONE;
+                entity_t prevSibling = NONE;
+                bool alive = false;
+            };
+
+            // Roots are kept in a sibling list too, starting at firstRoot
+            void link(entity_t entity, entity_t parent);
+            void unlink(entity_t entity);
+            void split(uint32_t node);
+
+            std::vector<Links> links; // indexed by entity
+            entity_t firstRoot = NONE;
+            uint32_t linkCount = 0; // entities with a parent
+            bool orderDirty = true;
+
+            std::vector<entity_t> order;
+            std::vector<uint32_t> parentNodes;
+            std::vector<uint32_t> subtreeSizes;
+            std::vector<uint32_t> spine;
+            std::vector<uint32_t> tasks;
+            std::vector<uint32_t> nodeOf; // entity -> node, scratch while building the order
+    };
+}
@@ -0,0 +1,243 @@
+#include "lve_hiz_pyramid.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+    static constexpr uint32_t SOURCE_BINDING = 0;
+    static constexpr uint32_t DESTINATION_BINDING = 1;
+    static constexpr uint32_t WORKGROUP_SIZE = 8; // local_size_x and local_size_y of hiz_downsample.comp
+    static constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+
+    namespace {
+        uint32_t previousPowerOfTwo(uint32_t value) {
+            uint32_t result = 1;
+            while (result * 2 <= value) {
+                result *= 2;
+            }
+            return result;
+        }
+    }
+
+    LveHiZPyramid::LveHiZPyramid(LveDevice &device, LveDescriptorLayoutCache &layoutCache) : lveDevice{device} {
+        createSampler();
+        createPipeline(layoutCache);
+    }
+
+    LveHiZPyramid::~LveHiZPyramid() {
+        for (auto &frame : frames) {
+            destroyImage(frame);
+        }
+        downsamplePipeline = nullptr;
+        vkDestroySampler(lveDevice.device(), sampler, nullptr);
+    }
+
+    void LveHiZPyramid::createSampler() {
+        // Nearest with no mip blending, a filtered depth would be neither the nearest nor the farthest
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.minLod = 0.f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+        if (vkCreateSampler(lveDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create sampler!");
+        }
+    }
+
+    void LveHiZPyramid::createPipeline(LveDescriptorLayoutCache &layoutCache) {
+        descriptorSetLayout = layoutCache.getSetLayout({
+            LveDescriptorLayoutCache::binding(SOURCE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),
+            LveDescriptorLayoutCache::binding(DESTINATION_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),
+        });
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(PushConstantData);
+        pipelineLayout = layoutCache.getPipelineLayout({descriptorSetLayout}, {pushConstantRange});
+
+        downsamplePipeline = std::make_unique<LveComputePipeline>(lveDevice, "shaders/hiz_downsample.comp.spv", pipelineLayout);
+    }
+
+    void LveHiZPyramid::createImage(FrameResources &frame, VkExtent2D depthExtent) {
+        frame.depthExtent = depthExtent;
+        frame.extent = {previousPowerOfTwo(depthExtent.width), previousPowerOfTwo(depthExtent.height)};
+        frame.levelCount = 1;
+        while ((std::max(frame.extent.width, frame.extent.height) >> frame.levelCount) > 0) {
+            frame.levelCount++;
+        }
+        frame.levelCount = std::min(frame.levelCount, MAX_LEVELS);
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = frame.extent.width;
+        imageInfo.extent.height = frame.extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = frame.levelCount;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = PYRAMID_FORMAT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        lveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.image, frame.memory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = frame.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = PYRAMID_FORMAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = frame.levelCount;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &frame.view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view!");
+        }
+
+        // Each level also gets its own view, to be written as a storage image and read by the next level
+        for (uint32_t level = 0; level < frame.levelCount; level++) {
+            viewInfo.subresourceRange.baseMipLevel = level;
+            viewInfo.subresourceRange.levelCount = 1;
+            if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &frame.levelViews[level]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create texture image view!");
+            }
+        }
+    }
+
+    void LveHiZPyramid::destroyImage(FrameResources &frame) {
+        if (frame.image == VK_NULL_HANDLE) {
+            return;
+        }
+        for (uint32_t level = 0; level < frame.levelCount; level++) {
+            vkDestroyImageView(lveDevice.device(), frame.levelViews[level], nullptr);
+            frame.levelViews[level] = VK_NULL_HANDLE;
+        }
+        vkDestroyImageView(lveDevice.device(), frame.view, nullptr);
+        vkDestroyImage(lveDevice.device(), frame.image, nullptr);
+        vkFreeMemory(lveDevice.device(), frame.memory, nullptr);
+        frame.view = VK_NULL_HANDLE;
+        frame.image = VK_NULL_HANDLE;
+        frame.memory = VK_NULL_HANDLE;
+        frame.levelCount = 0;
+    }
+
+    bool LveHiZPyramid::prepare(VkCommandBuffer commandBuffer, int frameIndex, VkExtent2D depthExtent) {
+        auto &frame = frames[frameIndex];
+        if (frame.image != VK_NULL_HANDLE &&
+            frame.depthExtent.width == depthExtent.width && frame.depthExtent.height == depthExtent.height) {
+            return false;
+        }
+
+        // The fence of this frame slot has been waited on, nothing on the GPU uses the old pyramid anymore
+        destroyImage(frame);
+        createImage(frame, depthExtent);
+
+        // Into the one layout it stays in, the contents are undefined until the first build
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = frame.image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, frame.levelCount, 0, 1};
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+        return true;
+    }
+
+    void LveHiZPyramid::build(LveCommandRecorder &recorder, LveDescriptorAllocator &descriptorAllocator, int frameIndex, VkImageView depthView) {
+        auto &frame = frames[frameIndex];
+        assert(frame.image != VK_NULL_HANDLE && "Call prepare before building the pyramid");
+        VkCommandBuffer commandBuffer = recorder.getCommandBuffer();
+
+        // Set i reads level i - 1 (the depth buffer for level 0) and writes level i
+        std::array<VkDescriptorSet, MAX_LEVELS> levelSets;
+        for (uint32_t level = 0; level < frame.levelCount; level++) {
+            VkDescriptorImageInfo source{};
+            source.sampler = sampler;
+            source.imageView = level == 0 ? depthView : frame.levelViews[level - 1];
+            source.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+            VkDescriptorImageInfo destination{};
+            destination.imageView = frame.levelViews[level];
+            destination.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+            levelSets[level] = descriptorWriter.clear()
+                .writeImage(SOURCE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, source)
+                .writeImage(DESTINATION_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, destination)
+                .build(descriptorAllocator, descriptorSetLayout);
+        }
+
+        // Whatever culled against the pyramid before has to finish reading it before it is overwritten
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = frame.image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, frame.levelCount, 0, 1};
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        downsamplePipeline->bind(recorder);
+        VkExtent2D sourceExtent = frame.depthExtent;
+        for (uint32_t level = 0; level < frame.levelCount; level++) {
+            VkExtent2D levelExtent{std::max(frame.extent.width >> level, 1u), std::max(frame.extent.height >> level, 1u)};
+
+            PushConstantData push{};
+            push.sourceSize[0] = static_cast<int32_t>(sourceExtent.width);
+            push.sourceSize[1] = static_cast<int32_t>(sourceExtent.height);
+            push.destinationSize[0] = static_cast<int32_t>(levelExtent.width);
+            push.destinationSize[1] = static_cast<int32_t>(levelExtent.height);
+
+            recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &levelSets[level]);
+            recorder.pushConstants(pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstantData), &push);
+            vkCmdDispatch(commandBuffer,
+                          (levelExtent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                          (levelExtent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                          1);
+
+            // The next level reads this one, and culling reads all of them
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &barrier);
+            sourceExtent = levelExtent;
+        }
+    }
+
+    VkDescriptorImageInfo LveHiZPyramid::descriptorInfo(int frameIndex) const {
+        VkDescriptorImageInfo info{};
+        info.sampler = sampler;
+        info.imageView = frames[frameIndex].view;
+        info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        return info;
+    }
+}
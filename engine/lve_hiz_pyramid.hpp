@@ -0,0 +1,75 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_command_recorder.hpp"
+#include "lve_compute_pipeline.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_swap_chain.hpp"
+
+//std
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace lve {
+    // Hierarchical Z buffer: a mip chain where every texel holds the farthest depth of the
+    // area it covers in the level below, built from a depth attachment with compute
+    // One texel read at the right level then tells whether a whole object is behind what was drawn,
+    // if its nearest depth is farther than the farthest depth over its footprint it can't be seen
+    //
+    // Level 0 is the depth size rounded down to powers of 2, so every level after it halves exactly
+    // Kept in VK_IMAGE_LAYOUT_GENERAL, it is written as a storage image and sampled by culling
+    class LveHiZPyramid {
+        public:
+            // Enough levels for a 32768 pixel wide depth buffer
+            static constexpr uint32_t MAX_LEVELS = 16;
+
+            LveHiZPyramid(LveDevice &device, LveDescriptorLayoutCache &layoutCache);
+            ~LveHiZPyramid();
+
+            LveHiZPyramid(const LveHiZPyramid &) = delete;
+            LveHiZPyramid &operator=(const LveHiZPyramid &) = delete;
+
+            // Makes sure this frame slot's pyramid fits the depth buffer, recreating it after a resize
+            // Returns true when it was recreated
+            bool prepare(VkCommandBuffer commandBuffer, int frameIndex, VkExtent2D depthExtent);
+            // Records the downsample of every level, depthView has to be in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+            // The sets for each level come from the frame's descriptor allocator
+            void build(LveCommandRecorder &recorder, LveDescriptorAllocator &descriptorAllocator, int frameIndex, VkImageView depthView);
+
+            // Every level, with a nearest sampler so textureLod picks whole texels
+            VkDescriptorImageInfo descriptorInfo(int frameIndex) const;
+            VkExtent2D getExtent(int frameIndex) const { return frames[frameIndex].extent; }
+            uint32_t getLevelCount(int frameIndex) const { return frames[frameIndex].levelCount; }
+
+        private:
+            struct PushConstantData {
+                int32_t sourceSize[2];
+                int32_t destinationSize[2];
+            };
+
+            // One pyramid per frame in flight, so building one never races culling in the other
+            struct FrameResources {
+                VkImage image = VK_NULL_HANDLE;
+                VkDeviceMemory memory = VK_NULL_HANDLE;
+                VkImageView view = VK_NULL_HANDLE; // all levels
+                std::array<VkImageView, MAX_LEVELS> levelViews{};
+                VkExtent2D depthExtent{0, 0};
+                VkExtent2D extent{0, 0};
+                uint32_t levelCount = 0;
+            };
+
+            void createSampler();
+            void createPipeline(LveDescriptorLayoutCache &layoutCache);
+            void createImage(FrameResources &frame, VkExtent2D depthExtent);
+            void destroyImage(FrameResources &frame);
+
+            LveDevice &lveDevice;
+            VkSampler sampler;
+            VkDescriptorSetLayout descriptorSetLayout; // owned by the layout cache
+            VkPipelineLayout pipelineLayout; // owned by the layout cache
+            LveDescriptorWriter descriptorWriter{lveDevice};
+            std::unique_ptr<LveComputePipeline> downsamplePipeline;
+            std::array<FrameResources, LveSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+    };
+}
@@ -0,0 +1,106 @@
+#include "lve_job_system.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+
+namespace lve {
+
+    uint32_t LveJobSystem::defaultWorkerCount() {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    LveJobSystem::LveJobSystem(uint32_t workerCount) {
+        workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    LveJobSystem::~LveJobSystem() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    void LveJobSystem::parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t)> &task) {
+        if (count == 0) {
+            return;
+        }
+        batchSize = std::max(batchSize, 1u);
+        uint32_t batches = (count + batchSize - 1) / batchSize;
+
+        // Not worth waking anyone up for a single batch
+        if (batches == 1 || workers.empty()) {
+            task(0, count);
+            return;
+        }
+
+        std::lock_guard<std::mutex> submitLock{submitMutex};
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            currentTask = &task;
+            taskCount = count;
+            taskBatchSize = batchSize;
+            batchCount = batches;
+            nextBatch.store(0);
+            batchesRemaining.store(batches);
+            generation++;
+        }
+        wakeCondition.notify_all();
+
+        // The calling thread works on the loop too instead of sleeping
+        runBatches();
+
+        // Also wait for workers to let go of the task, so the next loop can't be picked up by a stale worker
+        std::unique_lock<std::mutex> lock{mutex};
+        doneCondition.wait(lock, [this] { return batchesRemaining.load() == 0 && activeWorkers == 0; });
+        currentTask = nullptr;
+    }
+
+    void LveJobSystem::runBatches() {
+        while (true) {
+            uint32_t batch = nextBatch.fetch_add(1);
+            if (batch >= batchCount) {
+                return;
+            }
+            uint32_t begin = batch * taskBatchSize;
+            uint32_t end = std::min(begin + taskBatchSize, taskCount);
+            (*currentTask)(begin, end);
+
+            if (batchesRemaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock{mutex};
+                doneCondition.notify_all();
+            }
+        }
+    }
+
+    void LveJobSystem::workerLoop() {
+        uint64_t seenGeneration = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                wakeCondition.wait(lock, [&] { return stopping || (generation != seenGeneration && currentTask != nullptr); });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+                activeWorkers++;
+            }
+
+            runBatches();
+
+            std::lock_guard<std::mutex> lock{mutex};
+            activeWorkers--;
+            if (activeWorkers == 0) {
+                doneCondition.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+//std
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lve {
+    // Small pool of persistent worker threads for data parallel loops
+    // Threads are created once, so splitting a loop across them costs a wake up, not a thread spawn
+    class LveJobSystem {
+        public:
+            // Leaves one core for the thread calling parallelFor, it does work too
+            static uint32_t defaultWorkerCount();
+
+            explicit LveJobSystem(uint32_t workerCount = defaultWorkerCount());
+            ~LveJobSystem();
+
+            LveJobSystem(const LveJobSystem &) = delete;
+            LveJobSystem &operator=(const LveJobSystem &) = delete;
+
+            // Number of threads that run a parallelFor, including the caller
+            uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+            // Splits [0, count) into batches of batchSize and runs task(begin, end) on every batch
+            // Blocks until all batches are done. Not reentrant, don't call it from inside a task
+            void parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t)> &task);
+
+        private:
+            void workerLoop();
+            // Takes batches until there are none left, returns when this thread can't find more work
+            void runBatches();
+
+            std::vector<std::thread> workers;
+
+            std::mutex mutex;
+            std::condition_variable wakeCondition; // workers wait on this for a new loop
+            std::condition_variable doneCondition; // the caller waits on this for the loop to finish
+            std::mutex submitMutex; // only one parallelFor at a time
+
+            // State of the loop in progress, only changed while no worker is running it
+            const std::function<void(uint32_t, uint32_t)> *currentTask = nullptr;
+            uint32_t taskCount = 0;
+            uint32_t taskBatchSize = 1;
+            uint32_t batchCount = 0;
+            std::atomic<uint32_t> nextBatch{0};
+            std::atomic<uint32_t> batchesRemaining{0};
+            uint32_t activeWorkers = 0; // guarded by mutex
+            uint64_t generation = 0; // bumped for every new loop, guarded by mutex
+            bool stopping = false;
+    };
+}
@@ -1,83 +1,151 @@
 #include "lve_model.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
 namespace lve {
-    LveModel::LveModel(LveDevice &device, const std::vector<Vertex> &vertices) : lveDevice{device} {
-        createVertexBuffers(vertices);
+    LveModel::LveModel(LveGeometryArena &arena, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices)
+        : geometryArena{arena} {
+        uint32_t vertexCount = static_cast<uint32_t>(vertices.size()); // static cast is the basic compile time cast in c++
+        assert(vertexCount >= 3 && "Vertex count must be at least 3");
+        assert(geometryArena.getStreamCount() == 2 &&
+               geometryArena.getVertexStride(POSITION_STREAM) == sizeof(glm::vec3) &&
+               geometryArena.getVertexStride(ATTRIBUTE_STREAM) == sizeof(VertexAttributes) &&
+               "Geometry arena was created for a different vertex layout");
+
+        computeBounds(vertices);
+
+        // Draw the vertices in order if no indices were given, so every model goes through the same indexed draw
+        std::vector<uint32_t> sequentialIndices;
+        if (indices.empty()) {
+            sequentialIndices.resize(vertexCount);
+            for (uint32_t i = 0; i < vertexCount; i++) {
+                sequentialIndices[i] = i;
+            }
+        }
+        const std::vector<uint32_t> &drawIndices = indices.empty() ? sequentialIndices : indices;
+
+        bool hasNormals = std::any_of(vertices.begin(), vertices.end(), [](const Vertex &vertex) { return vertex.normal != glm::vec3{0.f}; });
+        std::vector<glm::vec3> normals;
+        if (!hasNormals) {
+            normals = computeNormals(vertices, drawIndices);
+        }
+
+        // De-interleave into the arena's streams
+        std::vector<glm::vec3> positions(vertexCount);
+        std::vector<VertexAttributes> attributes(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            positions[i] = vertices[i].position;
+            attributes[i].color = vertices[i].color;
+            attributes[i].normal = hasNormals ? vertices[i].normal : normals[i];
+        }
+        std::vector<const void *> streams{positions.data(), attributes.data()};
+        allocation = geometryArena.allocate(streams, vertexCount, drawIndices.data(), static_cast<uint32_t>(drawIndices.size()));
     }
 
     LveModel::~LveModel() {
-        vkDestroyBuffer(lveDevice.device(), vertexBuffer, nullptr);
-        // The number of memory allocations is limited
-        // Allowed to manage memory seperately so you can do one allocation and use it many times
-        vkFreeMemory(lveDevice.device(), vertexBufferMemory, nullptr);
+        // The arena keeps one big allocation, the model only gives its range back
+        geometryArena.free(allocation);
     }
 
-    void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
-        // Initialize teh memory of the buffer size
-        vertexCount = static_cast<uint32_t>(vertices.size()); // static cast is the basic compile time cast in c++
-        assert(vertexCount >= 3 && "Vertex count must be at least 3");
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount; // total number of bytes to store the vertices of the model
-
-        //
-        lveDevice.createBuffer(
-            bufferSize,
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // combines the bit operators together
-            // HOST_VISIBLE_BIT Want the allocated memory to be available to CPU, necessary to write to device memory
-            // HOST_COHERENT_BIT Keeps host and device memory regions consistent with each toher  
-            vertexBuffer,
-            vertexBufferMemory
-        );
-
-        void * data;
-        // Create a region of host memory mapped to device memory
-        // and sets data to point to the beginning of the mapped meory range
-        vkMapMemory(lveDevice.device(), vertexBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), static_cast<size_t>(bufferSize)); // All vertex data will be accounted for
-        vkUnmapMemory(lveDevice.device(), vertexBufferMemory);
-
-        // Memcpy
-        // Takes the host (CPU) data and copies it to the host mapped memory region
-        // Host coherent will flushed to the device memory region
+    void LveModel::computeBounds(const std::vector<Vertex> &vertices) {
+        // Centering the sphere on the box around the vertices is not the tightest fit,
+        // but it only takes two passes and is good enough for culling
+        glm::vec3 minExtent = vertices[0].position;
+        glm::vec3 maxExtent = vertices[0].position;
+        for (auto &vertex : vertices) {
+            minExtent = glm::min(minExtent, vertex.position);
+            maxExtent = glm::max(maxExtent, vertex.position);
+        }
+        glm::vec3 center = (minExtent + maxExtent) * .5f;
+        boundingBoxMin = minExtent;
+        boundingBoxMax = maxExtent;
+
+        float radiusSquared = 0.f;
+        for (auto &vertex : vertices) {
+            glm::vec3 offset = vertex.position - center;
+            radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+        }
+        boundingSphere = glm::vec4{center, glm::sqrt(radiusSquared)};
+    }
+
+    std::vector<glm::vec3> LveModel::computeNormals(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) {
+        // The cross product is twice the triangle's area long, so big triangles count for more
+        std::vector<glm::vec3> normals(vertices.size(), glm::vec3{0.f});
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            glm::vec3 a = vertices[indices[i]].position;
+            glm::vec3 b = vertices[indices[i + 1]].position;
+            glm::vec3 c = vertices[indices[i + 2]].position;
+            glm::vec3 faceNormal = glm::cross(b - a, c - a);
+            for (size_t corner = 0; corner < 3; corner++) {
+                normals[indices[i + corner]] += faceNormal;
+            }
+        }
+        for (auto &normal : normals) {
+            float length = glm::length(normal);
+            normal = length > 0.f ? normal / length : glm::vec3{0.f, -1.f, 0.f}; // up, for vertices of degenerate triangles only
+        }
+        return normals;
     }
 
     void LveModel::draw(VkCommandBuffer commandBuffer) {
-        vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+        vkCmdDrawIndexed(commandBuffer, allocation.indexCount, 1, allocation.firstIndex, allocation.vertexOffset, 0);
+    }
+
+    void LveModel::drawInstanced(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance) {
+        vkCmdDrawIndexed(commandBuffer, allocation.indexCount, instanceCount, allocation.firstIndex, allocation.vertexOffset, firstInstance);
     }
 
     void LveModel::bind(VkCommandBuffer commandBuffer) {
-        VkBuffer buffers[] = {vertexBuffer}; // Sets the buffers array as an array of vertex buffers, can add more later
-        VkDeviceSize offsets[] = {0};
+        geometryArena.bind(commandBuffer);
+    }
 
-        // Binds the command buffer given to the vertex buffers that we offer
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+    void LveModel::bind(LveCommandRecorder &recorder) {
+        geometryArena.bind(recorder);
     }
 
     std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptions() {
-        // Corresponds to our vertex buffer, bound to location 0, strde advances by size of Vertex
-        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1); // Sets the size
-        bindingDescriptions[0].binding = 0;
-        bindingDescriptions[0].stride = sizeof(Vertex); // Sets the number of buffer steps to skip, will auto map to our struct
-        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        // One binding per stream of the geometry arena, the binding number is the stream's index
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions = getPositionBindingDescriptions();
+        bindingDescriptions.resize(2); // Sets the size
+        bindingDescriptions[1].binding = ATTRIBUTE_STREAM;
+        bindingDescriptions[1].stride = sizeof(VertexAttributes); // Sets the number of buffer steps to skip, will auto map to our struct
+        bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
         return bindingDescriptions;
     }
 
     std::vector<VkVertexInputAttributeDescription> LveModel::Vertex::getAttributeDescriptions() {
-        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2); // Needs to match the number of output vertex attribues
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT; // The format of our data
-        attributeDescriptions[0].offset = offsetof(Vertex, position);
-
-        attributeDescriptions[1].binding = 0; // inteleaving position and color in 1 binding
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions = getPositionAttributeDescriptions();
+        attributeDescriptions.resize(3); // Needs to match the number of output vertex attribues
+        attributeDescriptions[1].binding = ATTRIBUTE_STREAM; // color and normal come from the second stream
         attributeDescriptions[1].location = 1; // Must match with location in vertex shader
         attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT; // The format of our data
-        attributeDescriptions[1].offset = offsetof(Vertex, color); // Will automatically calculate the byte offset of the color member in the vertex struct
-                                                                   // Makes sure the order which the Vertex struct is declared doesn't matter
+        attributeDescriptions[1].offset = offsetof(VertexAttributes, color); // Will automatically calculate the byte offset of the color member in the struct
+                                                                             // Makes sure the order which the struct is declared doesn't matter
+        attributeDescriptions[2].binding = ATTRIBUTE_STREAM;
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(VertexAttributes, normal);
+        return attributeDescriptions;
+    }
+
+    std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getPositionBindingDescriptions() {
+        // Tightly packed positions, strde advances by one vec3
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = POSITION_STREAM;
+        bindingDescriptions[0].stride = sizeof(glm::vec3);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> LveModel::Vertex::getPositionAttributeDescriptions() {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(1);
+        attributeDescriptions[0].binding = POSITION_STREAM;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT; // The format of our data
+        attributeDescriptions[0].offset = 0;
         return attributeDescriptions;
     }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_geometry_arena.hpp"
 
 #define GLM_FORCE_RADIANS // Radians must be radians
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE // Expect depth values to 0 - 1
@@ -10,37 +11,74 @@
 
 namespace lve {
     // Take vertex data created by the CPU or read in a file,
-    // Then allocate and copy the data to the device GPU to be 
-    // rendered efficiently
+    // Then copy the data into a range of the shared geometry arena on the GPU
+    // to be rendered efficiently
+    // Models are owned by an LveAssetRegistry, everything else refers to them by handle
     class LveModel {
         public:
+            // On the GPU positions are a stream of their own, the rest of the vertex is interleaved in a second one
+            // so depth only passes fetch 12 bytes per vertex and nothing else
+            static constexpr uint32_t POSITION_STREAM = 0;
+            static constexpr uint32_t ATTRIBUTE_STREAM = 1;
+
             // Define a struct that wraps the glm vertext buffer
+            // How models are handed in, split into the streams when uploaded
             struct Vertex {
                 glm::vec3 position;
-                glm::vec3 color; // interleaved with position in binding
+                glm::vec3 color;
+                glm::vec3 normal{0.f}; // left at 0 on every vertex, the model computes them from its triangles
 
                 // Static funcitons
+                // Both streams, for pipelines that shade
                 static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
                 static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+                // The position stream alone, for depth only pipelines
+                static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions();
+                static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions();
             };
-            //Delete the copy constructors, because Vulkan manages the memory
-            LveModel(LveDevice &device, const std::vector<Vertex> &vertices);
+
+            // Everything but the position, one element of the attribute stream
+            struct VertexAttributes {
+                glm::vec3 color;
+                glm::vec3 normal;
+            };
+
+            // What the geometry arena models are loaded into has to be created with
+            static std::vector<VkDeviceSize> getVertexStrides() { return {sizeof(glm::vec3), sizeof(VertexAttributes)}; }
+
+            // If no indices are given, every 3 vertices in order make a triangle
+            LveModel(LveGeometryArena &arena, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices = {});
             ~LveModel();
 
+            //Delete the copy constructors, because Vulkan manages the memory
             LveModel(const LveModel &) = delete;
             LveModel &operator=(const LveModel &) = delete;
 
+            // Binds the whole arena, only needed once for all the models living in it
             void bind(VkCommandBuffer commandBuffer);
+            void bind(LveCommandRecorder &recorder);
             void draw(VkCommandBuffer commandBuffer);
+            // Draws instanceCount copies, gl_InstanceIndex starts at firstInstance
+            void drawInstanced(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance);
+
+            LveGeometryArena &getArena() const { return geometryArena; }
+            const LveGeometryArena::Allocation &getAllocation() const { return allocation; }
+            // Model space bounding sphere, xyz is the center and w the radius
+            glm::vec4 getBoundingSphere() const { return boundingSphere; }
+            // Model space axis aligned bounding box, tighter than the sphere for boxy models
+            glm::vec3 getBoundingBoxMin() const { return boundingBoxMin; }
+            glm::vec3 getBoundingBoxMax() const { return boundingBoxMax; }
 
         private:
-            void createVertexBuffers(const std::vector<Vertex> &verticies);
-
-            LveDevice& lveDevice;
-            // Buffer and memory are seperate objects
-            // Puts programmers in control of memory management
-            VkBuffer vertexBuffer;
-            VkDeviceMemory vertexBufferMemory;
-            uint32_t vertexCount;
+            void computeBounds(const std::vector<Vertex> &vertices);
+            // Sum of the normals of the triangles using each vertex, weighted by their area
+            static std::vector<glm::vec3> computeNormals(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices);
+
+            LveGeometryArena &geometryArena;
+            // Where the vertices and indices of this model live inside the arena
+            LveGeometryArena::Allocation allocation;
+            glm::vec4 boundingSphere{0.f};
+            glm::vec3 boundingBoxMin{0.f};
+            glm::vec3 boundingBoxMax{0.f};
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+//std
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace lve {
+    // 32 bit generational handle: the low bits pick a slot, the high bits count how often that slot has been reused
+    // A handle whose generation doesn't match its slot's anymore is stale, so holding on to the handle
+    // of a destroyed object can never reach whatever took its slot
+    struct LveHandle {
+        using handle_t = uint32_t;
+        static constexpr uint32_t INDEX_BITS = 22; // up to ~4 million live objects
+        static constexpr uint32_t GENERATION_BITS = 32 - INDEX_BITS;
+        static constexpr uint32_t MAX_SLOTS = 1u << INDEX_BITS;
+        // A slot is retired instead of reaching this, so INVALID (all bits set) is never handed out
+        static constexpr uint32_t MAX_GENERATION = (1u << GENERATION_BITS) - 1;
+        static constexpr handle_t INVALID = UINT32_MAX;
+
+        static handle_t make(uint32_t slot, uint32_t generation) { return (generation << INDEX_BITS) | slot; }
+        static uint32_t slotOf(handle_t handle) { return handle & (MAX_SLOTS - 1); }
+        static uint32_t generationOf(handle_t handle) { return handle >> INDEX_BITS; }
+    };
+
+    // Object pool addressed by generational handles
+    // - create, destroy and lookup are O(1), destroyed slots go on a free list and are reused
+    // - the free list is first in first out, so reuse is spread over every free slot and generations wrap slowly
+    // - slots live in fixed size chunks that never move, growing adds a chunk instead of copying every object,
+    //   so pointers to objects stay valid until they are destroyed
+    //
+    // Slots are dense enough to index side tables by (see LveHandle::slotOf), eg. a BVH or a hierarchy
+    template <typename T, uint32_t CHUNK_SIZE = 4096>
+    class LveObjectPool {
+        public:
+            using handle_t = LveHandle::handle_t;
+
+            LveObjectPool() = default;
+            ~LveObjectPool() { clear(); }
+
+            LveObjectPool(const LveObjectPool &) = delete;
+            LveObjectPool &operator=(const LveObjectPool &) = delete;
+
+            // Throws once every slot a handle can address is in use or retired
+            template <typename... Args>
+            handle_t create(Args &&...args) {
+                uint32_t index = acquireSlot();
+                Slot &slot = slotAt(index);
+                try {
+                    new (slot.storage) T(std::forward<Args>(args)...);
+                } catch (...) {
+                    // Nothing was created, the slot goes straight back on the free list
+                    releaseSlot(index);
+                    throw;
+                }
+                slot.alive = true;
+                liveCount++;
+                return LveHandle::make(index, slot.generation);
+            }
+
+            void destroy(handle_t handle) {
+                assert(isValid(handle) && "Destroying a stale or invalid handle");
+                uint32_t index = LveHandle::slotOf(handle);
+                Slot &slot = slotAt(index);
+                object(slot).~T();
+                slot.alive = false;
+                liveCount--;
+                releaseSlot(index);
+            }
+
+            bool isValid(handle_t handle) const {
+                uint32_t index = LveHandle::slotOf(handle);
+                if (handle == LveHandle::INVALID || index >= slotCount) {
+                    return false;
+                }
+                const Slot &slot = slotAt(index);
+                return slot.alive && slot.generation == LveHandle::generationOf(handle);
+            }
+
+            // nullptr if the handle is stale
+            T *get(handle_t handle) { return isValid(handle) ? &object(slotAt(LveHandle::slotOf(handle))) : nullptr; }
+            const T *get(handle_t handle) const { return isValid(handle) ? &object(slotAt(LveHandle::slotOf(handle))) : nullptr; }
+            T &operator[](handle_t handle) {
+                assert(isValid(handle) && "Stale or invalid handle");
+                return object(slotAt(LveHandle::slotOf(handle)));
+            }
+            const T &operator[](handle_t handle) const {
+                assert(isValid(handle) && "Stale or invalid handle");
+                return object(slotAt(LveHandle::slotOf(handle)));
+            }
+
+            // For side tables indexed by slot: the handle of the object living there, INVALID if it is free
+            handle_t handleAt(uint32_t index) const {
+                if (index >= slotCount || !slotAt(index).alive) {
+                    return LveHandle::INVALID;
+                }
+                return LveHandle::make(index, slotAt(index).generation);
+            }
+            // Unchecked, the slot has to hold a live object
+            T &atSlot(uint32_t index) {
+                assert(index < slotCount && slotAt(index).alive && "Slot is free");
+                return object(slotAt(index));
+            }
+            const T &atSlot(uint32_t index) const {
+                assert(index < slotCount && slotAt(index).alive && "Slot is free");
+                return object(slotAt(index));
+            }
+
+            uint32_t size() const { return liveCount; }
+            // Slots handed out so far, every slot index is below this
+            uint32_t getSlotCount() const { return slotCount; }
+
+            // Allocates the chunks up front, so creating this many objects never allocates
+            void reserve(uint32_t count) {
+                while (static_cast<uint32_t>(chunks.size()) * CHUNK_SIZE < count) {
+                    chunks.push_back(std::make_unique<Slot[]>(CHUNK_SIZE));
+                }
+            }
+
+            // Destroys every object, the chunks are kept and outstanding handles stay stale
+            void clear() {
+                for (uint32_t index = 0; index < slotCount; index++) {
+                    Slot &slot = slotAt(index);
+                    if (slot.alive) {
+                        object(slot).~T();
+                        slot.alive = false;
+                        releaseSlot(index);
+                    }
+                }
+                liveCount = 0;
+            }
+
+            // function(handle, object) for every live object, in slot order
+            template <typename Function>
+            void forEach(Function function) {
+                for (uint32_t index = 0; index < slotCount; index++) {
+                    Slot &slot = slotAt(index);
+                    if (slot.alive) {
+                        function(LveHandle::make(index, slot.generation), object(slot));
+                    }
+                }
+            }
+
+        private:
+            static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+            struct Slot {
+                alignas(T) unsigned char storage[sizeof(T)];
+                uint32_t generation = 0;
+                uint32_t nextFree = NO_SLOT;
+                bool alive = false;
+            };
+
+            Slot &slotAt(uint32_t index) { return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE]; }
+            const Slot &slotAt(uint32_t index) const { return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE]; }
+            static T &object(Slot &slot) { return *std::launder(reinterpret_cast<T *>(slot.storage)); }
+            static const T &object(const Slot &slot) { return *std::launder(reinterpret_cast<const T *>(slot.storage)); }
+
+            uint32_t acquireSlot() {
+                if (freeHead != NO_SLOT) {
+                    uint32_t index = freeHead;
+                    freeHead = slotAt(index).nextFree;
+                    if (freeHead == NO_SLOT) {
+                        freeTail = NO_SLOT;
+                    }
+                    return index;
+                }
+                // A handle can't address more slots, and reusing a retired one would bring back stale handles
+                if (slotCount >= LveHandle::MAX_SLOTS) {
+                    throw std::runtime_error("failed to allocate pool slot!");
+                }
+                reserve(slotCount + 1);
+                return slotCount++;
+            }
+
+            void releaseSlot(uint32_t index) {
+                Slot &slot = slotAt(index);
+                // Handing the slot out again would bring back handles from its first generation,
+                // so once its generations run out it is never reused
+                if (++slot.generation == LveHandle::MAX_GENERATION) {
+                    return;
+                }
+                slot.nextFree = NO_SLOT;
+                if (freeTail == NO_SLOT) {
+                    freeHead = index;
+                } else {
+                    slotAt(freeTail).nextFree = index;
+                }
+                freeTail = index;
+            }
+
+            std::vector<std::unique_ptr<Slot[]>> chunks;
+            uint32_t slotCount = 0;
+            uint32_t liveCount = 0;
+            uint32_t freeHead = NO_SLOT;
+            uint32_t freeTail = NO_SLOT;
+    };
+}
@@ -32,6 +32,10 @@ namespace lve {
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
     }
 
+    void LvePipeline::bind(LveCommandRecorder &recorder) {
+        recorder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    }
+
     // read the vert file or frag file as binary
     std::vector<char> LvePipeline::readFile(const std::string& filepath) {
         std::ifstream file{filepath, std::ios::ate | std::ios::binary};
@@ -65,10 +69,13 @@ namespace lve {
         );
 
         auto vertCode = readFile(vertFilepath);
-        auto fragCode = readFile(fragFilepath);
-
         createShaderModule(vertCode, &vertShaderModule);
-        createShaderModule(fragCode, &fragShaderModule);
+        // Without a fragment shader only depth is written
+        bool hasFragmentStage = !fragFilepath.empty();
+        if (hasFragmentStage) {
+            auto fragCode = readFile(fragFilepath);
+            createShaderModule(fragCode, &fragShaderModule);
+        }
 
         // Creating pipeline shader stages
         VkPipelineShaderStageCreateInfo shaderStages[2];
@@ -89,8 +96,8 @@ namespace lve {
         shaderStages[1].pNext = nullptr;
         shaderStages[1].pSpecializationInfo = nullptr;
 
-        auto bindingDescriptions = LveModel::Vertex::getBindingDescriptions();
-        auto attributeDescriptions = LveModel::Vertex::getAttributeDescriptions();
+        auto &bindingDescriptions = configInfo.bindingDescriptions;
+        auto &attributeDescriptions = configInfo.attributeDescriptions;
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
         vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size()); // Set the size to allocate
@@ -100,7 +107,7 @@ namespace lve {
 
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2; // There are 2 stages
+        pipelineInfo.stageCount = hasFragmentStage ? 2 : 1; // There are 2 stages, the vertex one always comes first
         pipelineInfo.pStages = shaderStages; // From the pipeline stages defined above
         pipelineInfo.pVertexInputState = &vertexInputInfo; // From the vertex input info above
         pipelineInfo.pViewportState = &configInfo.viewportInfo;
@@ -237,5 +244,18 @@ namespace lve {
         configInfo.dynamicStateInfo.dynamicStateCount =
                 static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
         configInfo.dynamicStateInfo.flags = 0;
+
+        configInfo.bindingDescriptions = LveModel::Vertex::getBindingDescriptions();
+        configInfo.attributeDescriptions = LveModel::Vertex::getAttributeDescriptions();
+    }
+
+    void LvePipeline::depthOnlyPipelineConfigInfo(PipelineConfigInfo& configInfo) {
+        defaultPipelineConfigInfo(configInfo);
+        // No color attachments to blend into
+        configInfo.colorBlendInfo.attachmentCount = 0;
+        configInfo.colorBlendInfo.pAttachments = nullptr;
+        // Positions are all depth needs, the attribute stream isn't fetched at all
+        configInfo.bindingDescriptions = LveModel::Vertex::getPositionBindingDescriptions();
+        configInfo.attributeDescriptions = LveModel::Vertex::getPositionAttributeDescriptions();
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_command_recorder.hpp"
 
 #include <string>
 #include <vector>
@@ -19,6 +20,9 @@ namespace lve{
         VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
         std::vector<VkDynamicState> dynamicStateEnables;
         VkPipelineDynamicStateCreateInfo dynamicStateInfo;
+        // Vertex input layout, defaults to LveModel::Vertex but render systems can add bindings (eg. per instance data)
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
         // Will set these outside of the function, not a default
         VkPipelineLayout pipelineLayout = nullptr;
         VkRenderPass renderPass = nullptr;
@@ -27,6 +31,7 @@ namespace lve{
 
     class LvePipeline {
         public:
+            // An empty fragFilepath makes a vertex only pipeline, eg. for depth only passes
             LvePipeline(LveDevice& device,
                         const std::string& vertFilepath,
                         const std::string& fragFilepath,
@@ -38,11 +43,15 @@ namespace lve{
             LvePipeline& operator=(const LvePipeline&) = delete;
 
             void bind(VkCommandBuffer commandBuffer);
+            void bind(LveCommandRecorder &recorder);
 
             static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
+            // Writes depth and nothing else, from the position stream only, for render passes without color attachments
+            static void depthOnlyPipelineConfigInfo(PipelineConfigInfo& configInfo);
+            // read a compiled shader file as binary
+            static std::vector<char> readFile(const std::string& filepath);
 
         private:
-            static std::vector<char> readFile(const std::string& filepath);
 
             void createGraphicsPipeline(const std::string& vertFilepath,
                                         const std::string& fragFilepath,
@@ -56,6 +65,6 @@ namespace lve{
             LveDevice &lveDevice;
             VkPipeline graphicsPipeline;
             VkShaderModule vertShaderModule;
-            VkShaderModule fragShaderModule;
+            VkShaderModule fragShaderModule = VK_NULL_HANDLE;
     };
 }
@@ -0,0 +1,59 @@
+#include "lve_pipeline_statistics.hpp"
+
+//std
+#include <stdexcept>
+
+namespace lve {
+
+    LvePipelineStatistics::LvePipelineStatistics(LveDevice &device) : lveDevice{device} {
+        if (!lveDevice.getEnabledFeatures().pipelineStatisticsQuery) {
+            return;
+        }
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolInfo.queryCount = LveSwapChain::MAX_FRAMES_IN_FLIGHT; // one per frame
+        poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+        if (vkCreateQueryPool(lveDevice.device(), &poolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline statistics query pool!");
+        }
+    }
+
+    LvePipelineStatistics::~LvePipelineStatistics() {
+        vkDestroyQueryPool(lveDevice.device(), queryPool, nullptr);
+    }
+
+    bool LvePipelineStatistics::beginFrame(int frameIndex) {
+        if (!written[frameIndex]) {
+            return false;
+        }
+        written[frameIndex] = false;
+
+        // The fence was waited on, the result is available
+        uint64_t invocations = 0;
+        VkResult result = vkGetQueryPoolResults(lveDevice.device(), queryPool, frameIndex, 1, sizeof(invocations),
+                                                &invocations, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) {
+            return false;
+        }
+        fragmentInvocations = invocations;
+        return true;
+    }
+
+    void LvePipelineStatistics::begin(VkCommandBuffer commandBuffer, int frameIndex) {
+        if (!isSupported()) {
+            return;
+        }
+        vkCmdResetQueryPool(commandBuffer, queryPool, frameIndex, 1);
+        vkCmdBeginQuery(commandBuffer, queryPool, frameIndex, 0);
+    }
+
+    void LvePipelineStatistics::end(VkCommandBuffer commandBuffer, int frameIndex) {
+        if (!isSupported()) {
+            return;
+        }
+        vkCmdEndQuery(commandBuffer, queryPool, frameIndex);
+        written[frameIndex] = true;
+    }
+}
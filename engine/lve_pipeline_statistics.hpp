@@ -0,0 +1,39 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+//std
+#include <array>
+#include <cstdint>
+
+namespace lve {
+    // Counts the fragment shader invocations of a span of each frame's command buffer with a pipeline statistics query
+    // Read back like LveGpuTimer, when the frame slot comes around again, so it never waits on the GPU
+    // Needs the pipelineStatisticsQuery device feature, everything is a no op without it
+    class LvePipelineStatistics {
+        public:
+            LvePipelineStatistics(LveDevice &device);
+            ~LvePipelineStatistics();
+
+            LvePipelineStatistics(const LvePipelineStatistics &) = delete;
+            LvePipelineStatistics &operator=(const LvePipelineStatistics &) = delete;
+
+            bool isSupported() const { return queryPool != VK_NULL_HANDLE; }
+
+            // Call after the fence wait for frameIndex, returns true if it picked up a new result
+            bool beginFrame(int frameIndex);
+            // Outside of render passes, the query can span any number of them
+            void begin(VkCommandBuffer commandBuffer, int frameIndex);
+            void end(VkCommandBuffer commandBuffer, int frameIndex);
+
+            // Of the newest measured frame
+            uint64_t getFragmentInvocations() const { return fragmentInvocations; }
+
+        private:
+            LveDevice &lveDevice;
+            VkQueryPool queryPool = VK_NULL_HANDLE;
+            std::array<bool, LveSwapChain::MAX_FRAMES_IN_FLIGHT> written{}; // slot has a result waiting to be read
+            uint64_t fragmentInvocations = 0;
+    };
+}
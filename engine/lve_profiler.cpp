@@ -0,0 +1,69 @@
+#include "lve_profiler.hpp"
+
+//std
+#include <algorithm>
+#include <iostream>
+
+namespace lve {
+
+    LveProfiler::LveProfiler(float reportIntervalSeconds)
+        : reportIntervalSeconds{reportIntervalSeconds}, lastReportTime{std::chrono::steady_clock::now()} {}
+
+    LveProfiler::Counter &LveProfiler::getOrCreate(const std::string &name) {
+        auto it = counterLookup.find(name);
+        if (it != counterLookup.end()) {
+            return counters[it->second];
+        }
+        counterLookup.emplace(name, counters.size());
+        counters.push_back(Counter{name});
+        return counters.back();
+    }
+
+    void LveProfiler::setCounter(const std::string &name, uint64_t value) {
+        getOrCreate(name).frameValue = value;
+    }
+
+    void LveProfiler::addCounter(const std::string &name, uint64_t value) {
+        getOrCreate(name).frameValue += value;
+    }
+
+    uint64_t LveProfiler::getCounter(const std::string &name) const {
+        auto it = counterLookup.find(name);
+        return it == counterLookup.end() ? 0 : counters[it->second].frameValue;
+    }
+
+    void LveProfiler::endFrame() {
+        for (auto &counter : counters) {
+            counter.total += counter.frameValue;
+            counter.peak = std::max(counter.peak, counter.frameValue);
+            counter.frameValue = 0;
+        }
+        framesSinceReport++;
+
+        auto now = std::chrono::steady_clock::now();
+        float elapsedSeconds = std::chrono::duration<float>(now - lastReportTime).count();
+        if (elapsedSeconds < reportIntervalSeconds) {
+            return;
+        }
+        if (reportingEnabled) {
+            report(elapsedSeconds);
+        }
+        for (auto &counter : counters) {
+            counter.total = 0;
+            counter.peak = 0;
+        }
+        framesSinceReport = 0;
+        lastReportTime = now;
+    }
+
+    void LveProfiler::report(float elapsedSeconds) {
+        // One line per report: frame time first, then every counter as average (peak) per frame
+        std::cout << "[profiler] " << framesSinceReport << " frames, "
+                  << (elapsedSeconds * 1000.f / framesSinceReport) << " ms/frame";
+        for (auto &counter : counters) {
+            std::cout << " | " << counter.name << " " << (counter.total / framesSinceReport)
+                      << " (" << counter.peak << ")";
+        }
+        std::cout << std::endl;
+    }
+}
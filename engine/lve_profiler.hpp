@@ -0,0 +1,50 @@
+#pragma once
+
+//std
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+    // Collects named per frame counters (draws, state changes, culled objects...)
+    // and prints their averages and peaks once per report interval
+    class LveProfiler {
+        public:
+            explicit LveProfiler(float reportIntervalSeconds = 1.f);
+
+            LveProfiler(const LveProfiler &) = delete;
+            LveProfiler &operator=(const LveProfiler &) = delete;
+
+            // Counters are reset to 0 at the start of every frame
+            void setCounter(const std::string &name, uint64_t value);
+            void addCounter(const std::string &name, uint64_t value);
+            // Value of the counter in the frame being recorded
+            uint64_t getCounter(const std::string &name) const;
+
+            // Folds this frame's counters into the running totals and prints a report when it is due
+            void endFrame();
+
+            void setReportingEnabled(bool enabled) { reportingEnabled = enabled; }
+
+        private:
+            struct Counter {
+                std::string name;
+                uint64_t frameValue = 0;
+                uint64_t total = 0; // since the last report
+                uint64_t peak = 0; // since the last report
+            };
+
+            Counter &getOrCreate(const std::string &name);
+            void report(float elapsedSeconds);
+
+            std::vector<Counter> counters; // kept in creation order so reports read the same every time
+            std::unordered_map<std::string, size_t> counterLookup;
+
+            float reportIntervalSeconds;
+            bool reportingEnabled = true;
+            uint32_t framesSinceReport = 0;
+            std::chrono::steady_clock::time_point lastReportTime;
+    };
+}
@@ -0,0 +1,389 @@
+#include "lve_registry.hpp"
+#include "lve_transform_batch.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+
+namespace lve {
+
+    LveRegistry::entity_t LveRegistry::create() {
+        // The handle's generation keeps a stale id from aliasing whichever entity reuses its slot
+        uint32_t index = size();
+        entity_t entity = denseIndices.create(index);
+        entities.push_back(entity);
+        translations.push_back(glm::vec3{0.f});
+        rotations.push_back(glm::vec3{0.f});
+        scales.push_back(glm::vec3{1.f});
+        colors.push_back(glm::vec3{1.f});
+        models.push_back(LveAssetRegistry::INVALID_MODEL);
+        staticFlags.push_back(0);
+
+        changeVersions.push_back(0);
+        matrixDirty.push_back(0);
+        localMatrices.push_back(glm::mat4{1.f});
+        localNormalMatrices.push_back(glm::mat4{1.f});
+        matrices.push_back(glm::mat4{1.f});
+        normalMatrices.push_back(glm::mat4{1.f});
+        markTransformChanged(index);
+        hierarchy.add(slotOf(entity));
+        return entity;
+    }
+
+    void LveRegistry::destroy(entity_t entity) {
+        uint32_t index = indexOf(entity);
+        assert(index != INVALID_INDEX && "Destroying an entity that is not alive");
+        // Orphaned children become roots, so their world matrices change
+        uint32_t slot = slotOf(entity);
+        for (uint32_t child = hierarchy.getFirstChild(slot); child != LveHierarchy::NONE; child = hierarchy.getNextSibling(child)) {
+            markTransformChanged(indexOfSlot(child));
+        }
+        hierarchy.remove(slot);
+        releaseModel(models[index]);
+        removeIndex(index);
+        denseIndices.destroy(entity);
+        // Every destroy can leave an entry behind, without updateMatrices in between (eg. churn) they'd pile up
+        // Compacting once the list is twice what it can hold live keeps it bounded at amortized O(1) per destroy
+        if (dirtyIndices.size() > 2 * static_cast<size_t>(size()) + DIRTY_SLACK) {
+            compactDirtyIndices();
+        }
+    }
+
+    void LveRegistry::clear() {
+        // Every live entity is gone, their handles stay stale
+        for (LveAssetRegistry::model_t model : models) {
+            releaseModel(model);
+        }
+        denseIndices.clear();
+        entities.clear();
+        translations.clear();
+        rotations.clear();
+        scales.clear();
+        colors.clear();
+        models.clear();
+        staticFlags.clear();
+        changeVersions.clear();
+        matrixDirty.clear();
+        dirtyIndices.clear();
+        hierarchy.clear();
+        localMatrices.clear();
+        localNormalMatrices.clear();
+        matrices.clear();
+        normalMatrices.clear();
+    }
+
+    void LveRegistry::reserve(size_t count) {
+        denseIndices.reserve(static_cast<uint32_t>(count));
+        entities.reserve(count);
+        translations.reserve(count);
+        rotations.reserve(count);
+        scales.reserve(count);
+        colors.reserve(count);
+        models.reserve(count);
+        staticFlags.reserve(count);
+        changeVersions.reserve(count);
+        matrixDirty.reserve(count);
+        localMatrices.reserve(count);
+        localNormalMatrices.reserve(count);
+        matrices.reserve(count);
+        normalMatrices.reserve(count);
+    }
+
+    uint32_t LveRegistry::indexOf(entity_t entity) const {
+        const uint32_t *index = denseIndices.get(entity);
+        return index ? *index : INVALID_INDEX;
+    }
+
+    uint32_t LveRegistry::indexOfSlot(uint32_t slot) const {
+        entity_t entity = denseIndices.handleAt(slot);
+        return entity == INVALID_ENTITY ? INVALID_INDEX : denseIndices[entity];
+    }
+
+    glm::vec3 *LveRegistry::editTranslations(uint32_t first, uint32_t count) {
+        markTransformRangeChanged(first, count);
+        return translations.data() + first;
+    }
+
+    glm::vec3 *LveRegistry::editRotations(uint32_t first, uint32_t count) {
+        markTransformRangeChanged(first, count);
+        return rotations.data() + first;
+    }
+
+    glm::vec3 *LveRegistry::editScales(uint32_t first, uint32_t count) {
+        markTransformRangeChanged(first, count);
+        return scales.data() + first;
+    }
+
+    void LveRegistry::setTranslation(uint32_t index, const glm::vec3 &translation) {
+        assert(index < size() && "Dense index out of range");
+        translations[index] = translation;
+        markTransformChanged(index);
+    }
+
+    void LveRegistry::setRotation(uint32_t index, const glm::vec3 &rotation) {
+        assert(index < size() && "Dense index out of range");
+        rotations[index] = rotation;
+        markTransformChanged(index);
+    }
+
+    void LveRegistry::setScale(uint32_t index, const glm::vec3 &scale) {
+        assert(index < size() && "Dense index out of range");
+        scales[index] = scale;
+        markTransformChanged(index);
+    }
+
+    void LveRegistry::setColor(uint32_t index, const glm::vec3 &color) {
+        assert(index < size() && "Dense index out of range");
+        colors[index] = color;
+        markChanged(index);
+    }
+
+    void LveRegistry::setModel(uint32_t index, LveAssetRegistry::model_t model) {
+        assert(index < size() && "Dense index out of range");
+        // Acquired first, so setting the model an object already has never drops it to zero
+        if (assets != nullptr && model != LveAssetRegistry::INVALID_MODEL) {
+            assets->acquire(model);
+        }
+        releaseModel(models[index]);
+        models[index] = model;
+        markChanged(index);
+    }
+
+    void LveRegistry::releaseModel(LveAssetRegistry::model_t model) {
+        if (assets != nullptr && model != LveAssetRegistry::INVALID_MODEL) {
+            assets->release(model);
+        }
+    }
+
+    void LveRegistry::setStatic(uint32_t index, bool isStatic) {
+        assert(index < size() && "Dense index out of range");
+        staticFlags[index] = isStatic ? 1 : 0;
+        markChanged(index);
+    }
+
+    TransformComponent LveRegistry::getTransform(uint32_t index) const {
+        assert(index < size() && "Dense index out of range");
+        TransformComponent transform{};
+        transform.translation = translations[index];
+        transform.rotation = rotations[index];
+        transform.scale = scales[index];
+        return transform;
+    }
+
+    void LveRegistry::setTransform(uint32_t index, const TransformComponent &transform) {
+        assert(index < size() && "Dense index out of range");
+        translations[index] = transform.translation;
+        rotations[index] = transform.rotation;
+        scales[index] = transform.scale;
+        markTransformChanged(index);
+    }
+
+    void LveRegistry::setParent(entity_t child, entity_t parent) {
+        uint32_t index = indexOf(child);
+        assert(index != INVALID_INDEX && "Parenting an entity that is not alive");
+        assert((parent == INVALID_ENTITY || contains(parent)) && "Parent is not alive");
+        hierarchy.setParent(slotOf(child), parent == INVALID_ENTITY ? LveHierarchy::NONE : slotOf(parent));
+        // Marking the child is enough, the change flows down to its descendants
+        markTransformChanged(index);
+    }
+
+    LveRegistry::entity_t LveRegistry::getParent(entity_t entity) const {
+        assert(contains(entity) && "Entity is not alive");
+        uint32_t parent = hierarchy.getParent(slotOf(entity));
+        return parent == LveHierarchy::NONE ? INVALID_ENTITY : denseIndices.handleAt(parent);
+    }
+
+    void LveRegistry::markTransformRangeChanged(uint32_t first, uint32_t count) {
+        assert(first <= size() && count <= size() - first && "Dense range out of range");
+        // One version for the whole range, what the caller writes after this is covered by it
+        uint64_t rangeVersion = ++version;
+        std::fill(changeVersions.begin() + first, changeVersions.begin() + first + count, rangeVersion);
+        for (uint32_t index = first; index < first + count; index++) {
+            if (!matrixDirty[index]) {
+                matrixDirty[index] = 1;
+                dirtyIndices.push_back(index);
+            }
+        }
+    }
+
+    void LveRegistry::markTransformChanged(uint32_t index) {
+        markChanged(index);
+        if (!matrixDirty[index]) {
+            matrixDirty[index] = 1;
+            dirtyIndices.push_back(index);
+        }
+    }
+
+    void LveRegistry::compactDirtyIndices() {
+        // Drop the stale entries left behind by destroy and the duplicates, what is left is exactly the dirty set
+        auto last = std::remove_if(dirtyIndices.begin(), dirtyIndices.end(), [this](uint32_t index) {
+            if (index >= size() || matrixDirty[index] != 1) {
+                return true;
+            }
+            matrixDirty[index] = 2; // seen, so a repeat of this index is dropped
+            return false;
+        });
+        dirtyIndices.erase(last, dirtyIndices.end());
+        for (uint32_t index : dirtyIndices) {
+            matrixDirty[index] = 1;
+        }
+    }
+
+    void LveRegistry::updateMatrices(LveJobSystem *jobSystem) {
+        compactDirtyIndices();
+        lastMatrixUpdateCount = static_cast<uint32_t>(dirtyIndices.size());
+        if (dirtyIndices.empty()) {
+            return;
+        }
+
+        // Sorted, runs of neighbouring objects read and write memory in order
+        std::sort(dirtyIndices.begin(), dirtyIndices.end());
+        uint32_t count = static_cast<uint32_t>(dirtyIndices.size());
+        if (jobSystem != nullptr && count > MATRIX_BATCH_SIZE) {
+            jobSystem->parallelFor(count, MATRIX_BATCH_SIZE, [this](uint32_t begin, uint32_t end) {
+                computeMatrixRange(&dirtyIndices[begin], end - begin);
+            });
+        } else {
+            computeMatrixRange(dirtyIndices.data(), count);
+        }
+
+        if (hierarchy.isFlat()) {
+            // Nothing is parented, world matrices are the local ones
+            for (uint32_t index : dirtyIndices) {
+                matrices[index] = localMatrices[index];
+                normalMatrices[index] = localNormalMatrices[index];
+            }
+        } else {
+            hierarchy.updateOrder();
+            worldChanged.resize(hierarchy.getOrder().size());
+            // Descendants that only moved with their parent still need re-uploading, stamp them all with one version
+            uint64_t propagateVersion = ++version;
+
+            // The spine holds the few big nodes above the independent subtrees, it goes first so parents are done
+            for (uint32_t node : hierarchy.getSpine()) {
+                propagateNode(node, propagateVersion);
+            }
+            auto &tasks = hierarchy.getTasks();
+            auto &subtreeSizes = hierarchy.getSubtreeSizes();
+            auto propagateTasks = [&](uint32_t begin, uint32_t end) {
+                for (uint32_t task = begin; task < end; task++) {
+                    uint32_t first = tasks[task];
+                    for (uint32_t node = first; node < first + subtreeSizes[first]; node++) {
+                        propagateNode(node, propagateVersion);
+                    }
+                }
+            };
+            if (jobSystem != nullptr && tasks.size() > 1) {
+                jobSystem->parallelFor(static_cast<uint32_t>(tasks.size()), 1, propagateTasks);
+            } else {
+                propagateTasks(0, static_cast<uint32_t>(tasks.size()));
+            }
+        }
+
+        for (uint32_t index : dirtyIndices) {
+            matrixDirty[index] = 0;
+        }
+        dirtyIndices.clear();
+    }
+
+    void LveRegistry::computeMatrixRange(const uint32_t *indices, uint32_t count) {
+        // Everything dirty at once (eg. every object animating) runs the kernel straight over the arrays
+        bool contiguous = indices[count - 1] - indices[0] == count - 1;
+        if (contiguous) {
+            uint32_t first = indices[0];
+            LveTransformBatch::computeMatrices(&translations[first], &rotations[first], &scales[first], count, &localMatrices[first]);
+        } else {
+            // Otherwise gather the dirty transforms in blocks so the kernel still gets whole SIMD blocks
+            constexpr uint32_t GATHER_SIZE = 64;
+            glm::vec3 gatheredTranslations[GATHER_SIZE];
+            glm::vec3 gatheredRotations[GATHER_SIZE];
+            glm::vec3 gatheredScales[GATHER_SIZE];
+            glm::mat4 gatheredMatrices[GATHER_SIZE];
+            for (uint32_t begin = 0; begin < count; begin += GATHER_SIZE) {
+                uint32_t blockCount = std::min(GATHER_SIZE, count - begin);
+                for (uint32_t i = 0; i < blockCount; i++) {
+                    uint32_t index = indices[begin + i];
+                    gatheredTranslations[i] = translations[index];
+                    gatheredRotations[i] = rotations[index];
+                    gatheredScales[i] = scales[index];
+                }
+                LveTransformBatch::computeMatrices(gatheredTranslations, gatheredRotations, gatheredScales, blockCount, gatheredMatrices);
+                for (uint32_t i = 0; i < blockCount; i++) {
+                    localMatrices[indices[begin + i]] = gatheredMatrices[i];
+                }
+            }
+        }
+
+        // Columns of the model matrix are the rotation axes times the scale,
+        // the inverse transpose is the same axes divided by the scale instead, so divide by scale twice
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t index = indices[i];
+            const glm::mat4 &matrix = localMatrices[index];
+            const glm::vec3 inverseScale = 1.f / scales[index];
+            glm::mat4 &normalMatrix = localNormalMatrices[index];
+            normalMatrix = glm::mat4{1.f};
+            for (int column = 0; column < 3; column++) {
+                normalMatrix[column] = glm::vec4{glm::vec3{matrix[column]} * (inverseScale[column] * inverseScale[column]), 0.f};
+            }
+        }
+    }
+
+    // A node's world matrix changes when its own transform did or its parent's world matrix did
+    // Clean nodes under a clean parent cost a couple of flag reads, no matrix math
+    void LveRegistry::propagateNode(uint32_t node, uint64_t propagateVersion) {
+        uint32_t index = denseIndices.atSlot(hierarchy.getOrder()[node]);
+        uint32_t parentNode = hierarchy.getParentNodes()[node];
+        bool changed = matrixDirty[index] != 0 || (parentNode != LveHierarchy::NONE && worldChanged[parentNode]);
+        worldChanged[node] = changed;
+        if (!changed) {
+            return;
+        }
+
+        if (parentNode == LveHierarchy::NONE) {
+            matrices[index] = localMatrices[index];
+            normalMatrices[index] = localNormalMatrices[index];
+        } else {
+            // The inverse transpose of a product is the product of the inverse transposes
+            uint32_t parentIndex = denseIndices.atSlot(hierarchy.getOrder()[parentNode]);
+            matrices[index] = matrices[parentIndex] * localMatrices[index];
+            normalMatrices[index] = normalMatrices[parentIndex] * localNormalMatrices[index];
+        }
+        changeVersions[index] = propagateVersion;
+    }
+
+    // Swap and pop every array so they stay packed and in step
+    // The cached matrices aren't copied, four mat4s per destroy, the moved object is marked dirty instead
+    // and the next updateMatrices rebuilds them
+    void LveRegistry::removeIndex(uint32_t index) {
+        uint32_t last = size() - 1;
+        if (index != last) {
+            entity_t moved = entities[last];
+            entities[index] = moved;
+            translations[index] = translations[last];
+            rotations[index] = rotations[last];
+            scales[index] = scales[last];
+            colors[index] = colors[last];
+            models[index] = models[last];
+            staticFlags[index] = staticFlags[last];
+            denseIndices[moved] = index;
+
+            // The object moved, so whoever uploaded it at this index has to upload it again,
+            // and its matrices at this index are the destroyed object's until they are rebuilt
+            // If the destroyed one was dirty, the index is listed already
+            markTransformChanged(index);
+        }
+        entities.pop_back();
+        translations.pop_back();
+        rotations.pop_back();
+        scales.pop_back();
+        colors.pop_back();
+        models.pop_back();
+        staticFlags.pop_back();
+        changeVersions.pop_back();
+        matrixDirty.pop_back();
+        localMatrices.pop_back();
+        localNormalMatrices.pop_back();
+        matrices.pop_back();
+        normalMatrices.pop_back();
+    }
+}
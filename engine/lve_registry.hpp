@@ -0,0 +1,157 @@
+#pragma once
+
+#include "lve_asset_registry.hpp"
+#include "lve_hierarchy.hpp"
+#include "lve_job_system.hpp"
+#include "lve_object_pool.hpp"
+#include "lve_transform_component.hpp"
+
+// Libs
+#include <glm/glm.hpp>
+
+//std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+    // ECS style storage for game objects, one tightly packed array per component (structure of arrays)
+    // A pass that only touches transforms streams through just the transform arrays,
+    // instead of dragging every object's model pointer and color through the cache too
+    //
+    // Entities are generational handles into an LveObjectPool holding each one's dense index, dense[index] is the entity
+    // A destroyed entity's handle goes stale, it stops being contains() even after its slot is reused
+    // Destroying swaps the last entity into the hole, so the arrays never have gaps but dense indices move
+    //
+    // Components are written through setters so the registry knows what changed:
+    // - a changed transform marks the cached matrices dirty, updateMatrices only rebuilds those
+    // - every change stamps the object with a new version, so render systems can ask
+    //   "changed since the version I last uploaded?" and skip everything else
+    //
+    // Entities can be parented to each other, the transform components are then relative to the parent
+    // and getMatrices holds world matrices, see LveHierarchy for how they are propagated
+    class LveRegistry {
+        public:
+            using entity_t = LveHandle::handle_t;
+            static constexpr entity_t INVALID_ENTITY = LveHandle::INVALID;
+            static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+            // Objects per job when building matrices, a multiple of every SIMD width so blocks stay whole
+            static constexpr uint32_t MATRIX_BATCH_SIZE = 4096;
+            // Stale dirty entries tolerated beyond twice the entity count before destroy compacts them
+            static constexpr size_t DIRTY_SLACK = 1024;
+
+            // Objects hold a reference to their model in assets, without one models are handles nobody counts
+            // (eg. CPU benchmarks that never load any)
+            explicit LveRegistry(LveAssetRegistry *assets = nullptr) : assets{assets} {}
+            // Releases the models of the entities still alive
+            ~LveRegistry() { clear(); }
+
+            LveRegistry(const LveRegistry &) = delete;
+            LveRegistry &operator=(const LveRegistry &) = delete;
+
+            // New entities start at the origin, unscaled, unrotated and white, with no model
+            entity_t create();
+            void destroy(entity_t entity);
+            void clear();
+            void reserve(size_t count);
+
+            bool contains(entity_t entity) const { return indexOf(entity) != INVALID_INDEX; }
+            uint32_t indexOf(entity_t entity) const;
+            // Slots are small and reused, so side tables (BVH, hierarchy) index by them instead of the handle
+            static uint32_t slotOf(entity_t entity) { return LveHandle::slotOf(entity); }
+            // Dense index of whatever lives in a slot, INVALID_INDEX if it is free
+            uint32_t indexOfSlot(uint32_t slot) const;
+            uint32_t size() const { return static_cast<uint32_t>(entities.size()); }
+
+            // Dense arrays, all indexed the same way, valid until the next create or destroy
+            const std::vector<entity_t> &getEntities() const { return entities; }
+            const std::vector<glm::vec3> &getTranslations() const { return translations; }
+            const std::vector<glm::vec3> &getRotations() const { return rotations; }
+            const std::vector<glm::vec3> &getScales() const { return scales; }
+            const std::vector<glm::vec3> &getColors() const { return colors; }
+            // Handles into the asset registry, INVALID_MODEL until one is set
+            const std::vector<LveAssetRegistry::model_t> &getModels() const { return models; }
+
+            // Writable views of count dense entries from first, for passes that rewrite a whole range (eg. animation)
+            // The range is marked changed once, up front, instead of per element like the setters
+            // Valid until the next create or destroy, write through them before the next updateMatrices
+            glm::vec3 *editTranslations(uint32_t first, uint32_t count);
+            glm::vec3 *editRotations(uint32_t first, uint32_t count);
+            glm::vec3 *editScales(uint32_t first, uint32_t count);
+
+            void setTranslation(uint32_t index, const glm::vec3 &translation);
+            void setRotation(uint32_t index, const glm::vec3 &rotation);
+            void setScale(uint32_t index, const glm::vec3 &scale);
+            void setColor(uint32_t index, const glm::vec3 &color);
+            // Takes a reference to the new model and releases the old one, destroying the entity releases it too
+            void setModel(uint32_t index, LveAssetRegistry::model_t model);
+            // Static objects promise not to move, so what they cast can be cached (eg. in shadow maps)
+            // Moving one anyway still works, it only throws those caches away
+            void setStatic(uint32_t index, bool isStatic);
+            // 1 for static objects, dense like the other arrays
+            const std::vector<uint8_t> &getStaticFlags() const { return staticFlags; }
+
+            // Gathers the transform of one dense index, eg. to build its matrix with TransformComponent::mat4
+            TransformComponent getTransform(uint32_t index) const;
+            void setTransform(uint32_t index, const TransformComponent &transform);
+
+            // Keeps the child's local transform, so it moves along with its new parent from now on
+            // INVALID_ENTITY detaches it back to the root
+            void setParent(entity_t child, entity_t parent);
+            entity_t getParent(entity_t entity) const;
+
+            // Bumped by every change, remember it after an upload and pass it to hasChangedSince next time
+            uint64_t getVersion() const { return version; }
+            bool hasChangedSince(uint32_t index, uint64_t sinceVersion) const { return changeVersions[index] > sinceVersion; }
+
+            // Rebuilds the model and normal matrices of objects whose transform changed, with the batched SIMD kernel,
+            // then pushes changed world matrices down to their descendants
+            // Both steps are split across the job system's threads when one is given
+            void updateMatrices(LveJobSystem *jobSystem = nullptr);
+            // World matrices, dense order like the other arrays, as of the last updateMatrices
+            // An entity moved by a destroy since then has its matrices rebuilt by the next one
+            const std::vector<glm::mat4> &getMatrices() const { return matrices; }
+            // Inverse transpose of the model matrix, so normals stay perpendicular under non uniform scale
+            // Kept as a mat4 so it can be copied straight into GPU buffers
+            const std::vector<glm::mat4> &getNormalMatrices() const { return normalMatrices; }
+            // How many matrices the last updateMatrices rebuilt
+            uint32_t getLastMatrixUpdateCount() const { return lastMatrixUpdateCount; }
+
+        private:
+            void removeIndex(uint32_t index);
+            void markChanged(uint32_t index) { changeVersions[index] = ++version; }
+            void markTransformChanged(uint32_t index);
+            void markTransformRangeChanged(uint32_t first, uint32_t count);
+            void compactDirtyIndices();
+            void computeMatrixRange(const uint32_t *indices, uint32_t count);
+            void propagateNode(uint32_t node, uint64_t propagateVersion);
+
+            void releaseModel(LveAssetRegistry::model_t model);
+
+            LveAssetRegistry *assets;
+            LveObjectPool<uint32_t> denseIndices; // entity -> dense index
+            std::vector<entity_t> entities; // dense index -> entity
+
+            std::vector<glm::vec3> translations;
+            std::vector<glm::vec3> rotations;
+            std::vector<glm::vec3> scales;
+            std::vector<glm::vec3> colors;
+            std::vector<LveAssetRegistry::model_t> models;
+            std::vector<uint8_t> staticFlags;
+
+            // Change tracking, dense like the components
+            uint64_t version = 0;
+            std::vector<uint64_t> changeVersions;
+            std::vector<uint8_t> matrixDirty; // uint8_t, vector<bool> packs bits and can't be written from several threads
+            std::vector<uint32_t> dirtyIndices; // may hold stale or repeated entries, matrixDirty is the truth
+
+            LveHierarchy hierarchy; // keyed by slot
+            std::vector<uint8_t> worldChanged; // per hierarchy node, scratch for propagation
+
+            // Derived from the transforms, not components
+            std::vector<glm::mat4> localMatrices;
+            std::vector<glm::mat4> localNormalMatrices;
+            std::vector<glm::mat4> matrices;
+            std::vector<glm::mat4> normalMatrices;
+            uint32_t lastMatrixUpdateCount = 0;
+    };
+}
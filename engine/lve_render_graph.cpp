@@ -0,0 +1,776 @@
+#include "lve_render_graph.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+
+namespace lve {
+
+    static constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                                  VK_ACCESS_SHADER_WRITE_BIT |
+                                                  VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    namespace {
+        // Handles are pointers on 64 bit and integers on 32 bit builds, either fits a key
+        template<typename T>
+        uint64_t handleKey(T handle) {
+            return (uint64_t)handle;
+        }
+
+        // A barrier needs some source stage, nothing having used the image yet is the top of the pipe
+        VkPipelineStageFlags orTopOfPipe(VkPipelineStageFlags stages) {
+            return stages != 0 ? stages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        }
+    }
+
+    // *************** Declaring *********************
+
+    LveRenderGraph::PassBuilder &LveRenderGraph::PassBuilder::read(resource_t resource, Access access) {
+        graph.addUse(pass, resource, access, false);
+        return *this;
+    }
+
+    LveRenderGraph::PassBuilder &LveRenderGraph::PassBuilder::write(resource_t resource, Access access) {
+        graph.addUse(pass, resource, access, true);
+        return *this;
+    }
+
+    LveRenderGraph::PassBuilder &LveRenderGraph::PassBuilder::sideEffects() {
+        graph.passes[pass].hasSideEffects = true;
+        return *this;
+    }
+
+    LveRenderGraph::LveRenderGraph(LveDevice &device) : lveDevice{device} {}
+
+    LveRenderGraph::~LveRenderGraph() {
+        destroyCompiledResources();
+        for (auto &entry : renderPasses) {
+            vkDestroyRenderPass(lveDevice.device(), entry.second, nullptr);
+        }
+    }
+
+    void LveRenderGraph::reset() {
+        destroyCompiledResources();
+        resources.clear();
+        passes.clear();
+        outputs.clear();
+        compiled = false;
+    }
+
+    LveRenderGraph::resource_t LveRenderGraph::createImage(const std::string &name, const ImageDesc &desc) {
+        assert(!compiled && "Call reset before changing a compiled graph");
+        Resource resource{};
+        resource.name = name;
+        resource.imported = false;
+        resource.format = desc.format;
+        resource.extent = desc.extent;
+        resource.clearValue = desc.clearValue;
+        resources.push_back(resource);
+        return static_cast<resource_t>(resources.size() - 1);
+    }
+
+    LveRenderGraph::resource_t LveRenderGraph::importImage(const std::string &name, const ImportDesc &desc) {
+        assert(!compiled && "Call reset before changing a compiled graph");
+        Resource resource{};
+        resource.name = name;
+        resource.imported = true;
+        resource.format = desc.format;
+        resource.extent = desc.extent;
+        resource.clearValue = desc.clearValue;
+        resource.importDesc = desc;
+        resources.push_back(resource);
+        return static_cast<resource_t>(resources.size() - 1);
+    }
+
+    LveRenderGraph::PassBuilder LveRenderGraph::addPass(const std::string &name, ExecuteFn execute) {
+        assert(!compiled && "Call reset before changing a compiled graph");
+        Pass pass{};
+        pass.name = name;
+        pass.execute = std::move(execute);
+        passes.push_back(std::move(pass));
+        return PassBuilder{*this, static_cast<pass_t>(passes.size() - 1)};
+    }
+
+    void LveRenderGraph::addUse(pass_t pass, resource_t resource, Access access, bool isWrite) {
+        assert(resource < resources.size() && "Unknown render graph resource");
+        assert(getAccessInfo(access, resources[resource].format).isWrite == isWrite && "Access doesn't match read or write");
+        for (auto &use : passes[pass].uses) {
+            assert(use.resource != resource && "A pass can only use an image one way");
+        }
+        passes[pass].uses.push_back({resource, access});
+    }
+
+    void LveRenderGraph::markOutput(resource_t resource) {
+        outputs.push_back(resource);
+    }
+
+    bool LveRenderGraph::isDepthFormat(VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_D16_UNORM:
+            case VK_FORMAT_X8_D24_UNORM_PACK32:
+            case VK_FORMAT_D32_SFLOAT:
+            case VK_FORMAT_D16_UNORM_S8_UINT:
+            case VK_FORMAT_D24_UNORM_S8_UINT:
+            case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    LveRenderGraph::AccessInfo LveRenderGraph::getAccessInfo(Access access, VkFormat format) {
+        switch (access) {
+            case Access::COLOR_ATTACHMENT:
+                return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true, true};
+            case Access::DEPTH_ATTACHMENT:
+                return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, true};
+            case Access::DEPTH_TEST:
+                return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false, true};
+            case Access::SAMPLED:
+                // Depth stays in the read only depth layout, so it can also be tested against while sampled
+                return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                        VK_ACCESS_SHADER_READ_BIT,
+                        isDepthFormat(format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                        VK_IMAGE_USAGE_SAMPLED_BIT, false, false};
+            case Access::STORAGE_READ:
+                return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                        VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false, false};
+            case Access::STORAGE_WRITE:
+                return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true, false};
+            case Access::TRANSFER_SRC:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false, false};
+            case Access::TRANSFER_DST:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true, false};
+        }
+        throw std::runtime_error("unknown render graph access!");
+    }
+
+    // *************** Compiling *********************
+
+    void LveRenderGraph::compile() {
+        assert(!compiled && "Graph is already compiled");
+
+        sortPasses();
+        cullPasses();
+        computeLifetimes();
+        createTransientImages();
+        computeBarriers();
+        createRenderPasses();
+        compiled = true;
+    }
+
+    // Orders every pass so each one runs after the passes it depends on:
+    // - writers of the same image, in the order they were added
+    // - a read after the write it sees, the last writer added before the reader, or when there is none
+    //   (and the image didn't come in with contents) the last writer of the image, so a reader can be added first
+    // - the write after the one a read sees waits for that read, it would overwrite what is being read
+    // Kahn's algorithm, picking the earliest added among the ready passes, so declaration order is kept
+    // when it already satisfies every dependency
+    void LveRenderGraph::sortPasses() {
+        std::vector<std::vector<pass_t>> writers(resources.size());
+        for (pass_t i = 0; i < passes.size(); i++) {
+            for (auto &use : passes[i].uses) {
+                if (getAccessInfo(use.access, resources[use.resource].format).isWrite) {
+                    writers[use.resource].push_back(i);
+                }
+            }
+        }
+
+        std::vector<std::vector<pass_t>> dependents(passes.size());
+        std::vector<uint32_t> dependencyCount(passes.size(), 0);
+        auto addDependency = [&](pass_t before, pass_t after) {
+            dependents[before].push_back(after);
+            dependencyCount[after]++;
+        };
+        for (resource_t resource = 0; resource < resources.size(); resource++) {
+            for (size_t i = 1; i < writers[resource].size(); i++) {
+                addDependency(writers[resource][i - 1], writers[resource][i]);
+            }
+        }
+        for (pass_t i = 0; i < passes.size(); i++) {
+            for (auto &use : passes[i].uses) {
+                if (getAccessInfo(use.access, resources[use.resource].format).isWrite) {
+                    continue;
+                }
+                auto &resource = resources[use.resource];
+                auto &resourceWriters = writers[use.resource];
+                // The first writer added after the reader, the reader sees the one before it
+                size_t next = std::lower_bound(resourceWriters.begin(), resourceWriters.end(), i) - resourceWriters.begin();
+                bool hasContents = resource.imported && resource.importDesc.initialLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+                if (next > 0) {
+                    addDependency(resourceWriters[next - 1], i);
+                } else if (!hasContents) {
+                    if (resourceWriters.empty()) {
+                        throw std::runtime_error("render graph pass " + passes[i].name + " reads " +
+                                                 resource.name + " but nothing writes it!");
+                    }
+                    // Added before every writer, it sees the finished image
+                    addDependency(resourceWriters.back(), i);
+                    next = resourceWriters.size();
+                }
+                if (next < resourceWriters.size()) {
+                    addDependency(i, resourceWriters[next]);
+                }
+            }
+        }
+
+        std::priority_queue<pass_t, std::vector<pass_t>, std::greater<pass_t>> ready;
+        for (pass_t i = 0; i < passes.size(); i++) {
+            if (dependencyCount[i] == 0) {
+                ready.push(i);
+            }
+        }
+        order.clear();
+        while (!ready.empty()) {
+            pass_t pass = ready.top();
+            ready.pop();
+            order.push_back(pass);
+            for (pass_t dependent : dependents[pass]) {
+                if (--dependencyCount[dependent] == 0) {
+                    ready.push(dependent);
+                }
+            }
+        }
+        if (order.size() < passes.size()) {
+            for (pass_t i = 0; i < passes.size(); i++) {
+                if (dependencyCount[i] > 0) {
+                    throw std::runtime_error("render graph pass " + passes[i].name + " is part of a dependency cycle!");
+                }
+            }
+        }
+    }
+
+    // Walks back from the outputs, a pass is kept when it has side effects or writes something a kept pass
+    // or an output needs. Attachments may be loaded, so everything a kept pass uses is needed, writes included
+    void LveRenderGraph::cullPasses() {
+        std::vector<bool> needed(resources.size(), false);
+        for (resource_t output : outputs) {
+            needed[output] = true;
+        }
+
+        for (size_t position = order.size(); position-- > 0;) {
+            auto &pass = passes[order[position]];
+            pass.culled = !pass.hasSideEffects;
+            for (auto &use : pass.uses) {
+                if (needed[use.resource] && getAccessInfo(use.access, resources[use.resource].format).isWrite) {
+                    pass.culled = false;
+                }
+            }
+            if (pass.culled) {
+                continue;
+            }
+            for (auto &use : pass.uses) {
+                needed[use.resource] = true;
+            }
+        }
+
+        // The survivors keep their sorted order
+        order.erase(std::remove_if(order.begin(), order.end(), [this](pass_t pass) { return passes[pass].culled; }),
+                    order.end());
+        stats = Stats{};
+        stats.passCount = static_cast<uint32_t>(order.size());
+        stats.culledPassCount = static_cast<uint32_t>(passes.size() - order.size());
+    }
+
+    void LveRenderGraph::computeLifetimes() {
+        for (uint32_t position = 0; position < order.size(); position++) {
+            for (auto &use : passes[order[position]].uses) {
+                auto &resource = resources[use.resource];
+                resource.usage |= getAccessInfo(use.access, resource.format).usage;
+                if (resource.firstUse == INVALID) {
+                    resource.firstUse = position;
+                }
+                resource.lastUse = position;
+            }
+        }
+    }
+
+    void LveRenderGraph::createTransientImages() {
+        for (auto &resource : resources) {
+            if (resource.imported || resource.firstUse == INVALID) {
+                continue;
+            }
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent = {resource.extent.width, resource.extent.height, 1};
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = resource.format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = resource.usage;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            // Memory is bound below, once it is known who shares it
+            if (vkCreateImage(lveDevice.device(), &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create image!");
+            }
+            vkGetImageMemoryRequirements(lveDevice.device(), resource.image, &resource.memoryRequirements);
+            stats.transientImageCount++;
+            stats.unaliasedMemorySize += resource.memoryRequirements.size;
+        }
+
+        assignAliasSlots();
+
+        for (auto &slot : aliasSlots) {
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = slot.size;
+            allocInfo.memoryTypeIndex = lveDevice.findMemoryType(slot.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            if (vkAllocateMemory(lveDevice.device(), &allocInfo, nullptr, &slot.memory) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate image memory!");
+            }
+            stats.transientMemorySize += slot.size;
+            // Every occupant starts at offset 0, the slot is as big and as aligned as the largest needs
+            for (resource_t occupant : slot.occupants) {
+                if (vkBindImageMemory(lveDevice.device(), resources[occupant].image, slot.memory, 0) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to bind image memory!");
+                }
+            }
+        }
+        stats.aliasSlotCount = static_cast<uint32_t>(aliasSlots.size());
+
+        for (auto &resource : resources) {
+            if (resource.imported || resource.image == VK_NULL_HANDLE) {
+                continue;
+            }
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = resource.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.format;
+            viewInfo.subresourceRange.aspectMask = isDepthFormat(resource.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+            if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create texture image view!");
+            }
+        }
+    }
+
+    // Greedy interval packing: images are placed by when they are first used, into the first slot whose
+    // last occupant is done by then and whose memory types agree, the slot grows to fit the largest
+    void LveRenderGraph::assignAliasSlots() {
+        std::vector<resource_t> transients;
+        for (resource_t i = 0; i < resources.size(); i++) {
+            if (!resources[i].imported && resources[i].image != VK_NULL_HANDLE) {
+                transients.push_back(i);
+            }
+        }
+        std::stable_sort(transients.begin(), transients.end(), [&](resource_t a, resource_t b) {
+            return resources[a].firstUse < resources[b].firstUse;
+        });
+
+        for (resource_t index : transients) {
+            auto &resource = resources[index];
+            auto &requirements = resource.memoryRequirements;
+            AliasSlot *chosen = nullptr;
+            for (auto &slot : aliasSlots) {
+                if (slot.lastUse < resource.firstUse && (slot.memoryTypeBits & requirements.memoryTypeBits) != 0) {
+                    chosen = &slot;
+                    break;
+                }
+            }
+            if (chosen == nullptr) {
+                aliasSlots.emplace_back();
+                chosen = &aliasSlots.back();
+            }
+            // Offset 0 is aligned to anything, so only the size matters
+            chosen->size = std::max(chosen->size, requirements.size);
+            chosen->memoryTypeBits &= requirements.memoryTypeBits;
+            chosen->lastUse = resource.lastUse;
+            chosen->occupants.push_back(index);
+            resource.aliasSlot = static_cast<uint32_t>(chosen - aliasSlots.data());
+        }
+    }
+
+    // Replays the passes, tracking each image's layout and who touched it last, and records a barrier
+    // only where a use actually depends on an earlier one
+    void LveRenderGraph::computeBarriers() {
+        std::vector<ResourceState> states(resources.size());
+        for (resource_t i = 0; i < resources.size(); i++) {
+            if (resources[i].imported) {
+                auto &desc = resources[i].importDesc;
+                states[i].layout = desc.initialLayout;
+                states[i].writeStages = desc.initialStages;
+                states[i].writeAccess = desc.initialAccess;
+            }
+        }
+        // The first barrier of each graph image, its source is only known once every image has been walked
+        std::vector<Barrier *> firstBarriers(resources.size(), nullptr);
+
+        for (pass_t passIndex : order) {
+            auto &pass = passes[passIndex];
+            pass.barriers.clear();
+            for (auto &use : pass.uses) {
+                auto info = getAccessInfo(use.access, resources[use.resource].format);
+                auto &state = states[use.resource];
+
+                bool needsBarrier;
+                VkPipelineStageFlags srcStages;
+                if (info.layout != state.layout) {
+                    // Transitions are writes, they wait for every earlier use
+                    needsBarrier = true;
+                    srcStages = state.writeStages | state.readStages;
+                } else if (info.isWrite) {
+                    // Write after write, or after reads that must finish first
+                    needsBarrier = (state.writeStages | state.readStages) != 0;
+                    srcStages = state.writeStages | state.readStages;
+                } else {
+                    // Read after write, unless an earlier barrier already made the write visible here
+                    needsBarrier = state.writeStages != 0 &&
+                                   ((info.stages & ~state.visibleStages) != 0 || (info.access & ~state.visibleAccess) != 0);
+                    srcStages = state.writeStages;
+                }
+
+                if (needsBarrier) {
+                    Barrier barrier{};
+                    barrier.resource = use.resource;
+                    barrier.oldLayout = state.layout;
+                    barrier.newLayout = info.layout;
+                    barrier.srcStages = orTopOfPipe(srcStages);
+                    barrier.srcAccess = state.writeAccess;
+                    barrier.dstStages = info.stages;
+                    barrier.dstAccess = info.access;
+                    pass.barriers.push_back(barrier);
+                }
+
+                if (info.isWrite || info.layout != state.layout) {
+                    state.visibleStages = info.isWrite ? 0 : info.stages;
+                    state.visibleAccess = info.isWrite ? 0 : info.access;
+                    state.readStages = info.isWrite ? 0 : info.stages;
+                    state.writeStages = info.isWrite ? info.stages : state.writeStages | srcStages;
+                    state.writeAccess = info.isWrite ? (info.access & WRITE_ACCESS) : state.writeAccess;
+                } else {
+                    state.readStages |= info.stages;
+                    if (needsBarrier) {
+                        state.visibleStages |= info.stages;
+                        state.visibleAccess |= info.access;
+                    }
+                }
+                state.layout = info.layout;
+            }
+            stats.barrierCount += static_cast<uint32_t>(pass.barriers.size());
+        }
+
+        // Graph images start every frame undefined, but their memory is still in use by whatever held the slot
+        // last, the previous image in the slot, or for the first one the last image of the previous frame
+        for (pass_t passIndex : order) {
+            for (auto &barrier : passes[passIndex].barriers) {
+                if (!resources[barrier.resource].imported && firstBarriers[barrier.resource] == nullptr) {
+                    firstBarriers[barrier.resource] = &barrier;
+                }
+            }
+        }
+        for (auto &slot : aliasSlots) {
+            for (size_t i = 0; i < slot.occupants.size(); i++) {
+                resource_t previous = slot.occupants[(i + slot.occupants.size() - 1) % slot.occupants.size()];
+                Barrier *barrier = firstBarriers[slot.occupants[i]];
+                assert(barrier != nullptr && "Graph images always start with a transition");
+                auto &previousState = states[previous];
+                barrier->srcStages = orTopOfPipe(previousState.writeStages | previousState.readStages);
+                barrier->srcAccess = previousState.writeAccess;
+            }
+        }
+
+        // Leave imported images the way their owner expects them
+        finalBarriers.clear();
+        for (resource_t i = 0; i < resources.size(); i++) {
+            auto &desc = resources[i].importDesc;
+            if (!resources[i].imported || desc.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || resources[i].firstUse == INVALID) {
+                continue;
+            }
+            auto &state = states[i];
+            if (state.layout == desc.finalLayout && state.writeStages == 0) {
+                continue;
+            }
+            Barrier barrier{};
+            barrier.resource = i;
+            barrier.oldLayout = state.layout;
+            barrier.newLayout = desc.finalLayout;
+            barrier.srcStages = orTopOfPipe(state.writeStages | state.readStages);
+            barrier.srcAccess = state.writeAccess;
+            barrier.dstStages = desc.finalStages;
+            barrier.dstAccess = desc.finalAccess;
+            finalBarriers.push_back(barrier);
+        }
+        stats.barrierCount += static_cast<uint32_t>(finalBarriers.size());
+    }
+
+    // Attachments are already in their layout when the render pass begins, the barriers before it did that
+    // They are cleared unless something earlier wrote them, and stored unless nothing later reads them
+    void LveRenderGraph::createRenderPasses() {
+        std::vector<bool> written(resources.size(), false);
+        for (resource_t i = 0; i < resources.size(); i++) {
+            written[i] = resources[i].imported && resources[i].importDesc.initialLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+
+        for (uint32_t position = 0; position < order.size(); position++) {
+            auto &pass = passes[order[position]];
+            pass.attachments.clear();
+            pass.clearValues.clear();
+            RenderPassKey key{};
+            // Colors first, then the one depth attachment
+            for (int depth = 0; depth < 2; depth++) {
+                for (auto &use : pass.uses) {
+                    auto &resource = resources[use.resource];
+                    auto info = getAccessInfo(use.access, resource.format);
+                    if (!info.isAttachment || isDepthFormat(resource.format) != (depth == 1)) {
+                        continue;
+                    }
+                    bool readLater = resource.imported || resource.lastUse > position ||
+                                     std::find(outputs.begin(), outputs.end(), use.resource) != outputs.end();
+                    key.formats.push_back(resource.format);
+                    key.loadOps.push_back(written[use.resource] ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR);
+                    // Read only attachments are stored too, DONT_CARE would allow the pass to discard them
+                    key.storeOps.push_back(readLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE);
+                    key.layouts.push_back(info.layout);
+                    pass.attachments.push_back(use.resource);
+                    pass.clearValues.push_back(resource.clearValue);
+                    pass.extent = resource.extent;
+                }
+            }
+            for (auto &use : pass.uses) {
+                if (getAccessInfo(use.access, resources[use.resource].format).isWrite) {
+                    written[use.resource] = true;
+                }
+            }
+            if (pass.attachments.empty()) {
+                continue;
+            }
+            for (resource_t attachment : pass.attachments) {
+                if (resources[attachment].extent.width != pass.extent.width ||
+                    resources[attachment].extent.height != pass.extent.height) {
+                    throw std::runtime_error("render graph pass " + pass.name + " has attachments of different sizes!");
+                }
+            }
+            pass.renderPass = getOrCreateRenderPass(key);
+
+            bool allTransient = std::none_of(pass.attachments.begin(), pass.attachments.end(),
+                                             [&](resource_t attachment) { return resources[attachment].imported; });
+            if (allTransient) {
+                pass.framebuffer = getOrCreateFramebuffer(pass);
+            }
+        }
+    }
+
+    bool LveRenderGraph::RenderPassKey::operator<(const RenderPassKey &other) const {
+        return std::tie(formats, loadOps, storeOps, layouts) < std::tie(other.formats, other.loadOps, other.storeOps, other.layouts);
+    }
+
+    VkRenderPass LveRenderGraph::getOrCreateRenderPass(const RenderPassKey &key) {
+        auto found = renderPasses.find(key);
+        if (found != renderPasses.end()) {
+            return found->second;
+        }
+
+        std::vector<VkAttachmentDescription> attachments(key.formats.size());
+        std::vector<VkAttachmentReference> colorReferences;
+        VkAttachmentReference depthReference{};
+        bool hasDepth = false;
+        for (uint32_t i = 0; i < attachments.size(); i++) {
+            auto &attachment = attachments[i];
+            attachment.format = key.formats[i];
+            attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            attachment.loadOp = key.loadOps[i];
+            attachment.storeOp = key.storeOps[i];
+            attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = key.layouts[i];
+            attachment.finalLayout = key.layouts[i];
+            if (isDepthFormat(key.formats[i])) {
+                depthReference = {i, key.layouts[i]};
+                hasDepth = true;
+            } else {
+                colorReferences.push_back({i, key.layouts[i]});
+            }
+        }
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+        subpass.pColorAttachments = colorReferences.data();
+        subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+        // No dependencies, the graph's barriers around the render pass take care of that
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+
+        VkRenderPass renderPass;
+        if (vkCreateRenderPass(lveDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create render pass!");
+        }
+        renderPasses.emplace(key, renderPass);
+        return renderPass;
+    }
+
+    VkFramebuffer LveRenderGraph::getOrCreateFramebuffer(Pass &pass) {
+        std::vector<uint64_t> key{handleKey(pass.renderPass)};
+        std::vector<VkImageView> views;
+        for (resource_t attachment : pass.attachments) {
+            assert(resources[attachment].view != VK_NULL_HANDLE && "Imported image wasn't bound");
+            key.push_back(handleKey(resources[attachment].view));
+            views.push_back(resources[attachment].view);
+        }
+        auto found = framebuffers.find(key);
+        if (found != framebuffers.end()) {
+            return found->second;
+        }
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = pass.renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+        framebufferInfo.pAttachments = views.data();
+        framebufferInfo.width = pass.extent.width;
+        framebufferInfo.height = pass.extent.height;
+        framebufferInfo.layers = 1;
+
+        VkFramebuffer framebuffer;
+        if (vkCreateFramebuffer(lveDevice.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create framebuffer!");
+        }
+        framebuffers.emplace(std::move(key), framebuffer);
+        return framebuffer;
+    }
+
+    void LveRenderGraph::destroyCompiledResources() {
+        for (auto &entry : framebuffers) {
+            vkDestroyFramebuffer(lveDevice.device(), entry.second, nullptr);
+        }
+        framebuffers.clear();
+        for (auto &resource : resources) {
+            if (resource.imported) {
+                continue;
+            }
+            vkDestroyImageView(lveDevice.device(), resource.view, nullptr);
+            vkDestroyImage(lveDevice.device(), resource.image, nullptr);
+            resource.view = VK_NULL_HANDLE;
+            resource.image = VK_NULL_HANDLE;
+        }
+        for (auto &slot : aliasSlots) {
+            vkFreeMemory(lveDevice.device(), slot.memory, nullptr);
+        }
+        aliasSlots.clear();
+    }
+
+    // *************** Executing *********************
+
+    VkRenderPass LveRenderGraph::getRenderPass(pass_t pass) const {
+        assert(compiled && "Compile the graph before asking for render passes");
+        return passes[pass].renderPass;
+    }
+
+    void LveRenderGraph::bindImage(resource_t resource, VkImage image, VkImageView view) {
+        assert(resources[resource].imported && "Only imported images are bound");
+        resources[resource].image = image;
+        resources[resource].view = view;
+    }
+
+    void LveRenderGraph::setRenderArea(pass_t pass, VkExtent2D extent) {
+        passes[pass].renderArea = extent;
+    }
+
+    void LveRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier> &barriers) {
+        if (barriers.empty()) {
+            return;
+        }
+        imageBarriers.clear();
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        for (auto &barrier : barriers) {
+            auto &resource = resources[barrier.resource];
+            VkImageMemoryBarrier imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.srcAccessMask = barrier.srcAccess;
+            imageBarrier.dstAccessMask = barrier.dstAccess;
+            imageBarrier.oldLayout = barrier.oldLayout;
+            imageBarrier.newLayout = barrier.newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = resource.image;
+            // Transitions of depth stencil images have to cover both aspects
+            VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            if (isDepthFormat(resource.format)) {
+                bool hasStencil = resource.format == VK_FORMAT_D16_UNORM_S8_UINT || resource.format == VK_FORMAT_D24_UNORM_S8_UINT ||
+                                  resource.format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+                aspectMask = hasStencil ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+            }
+            imageBarrier.subresourceRange = {aspectMask, 0, 1, 0, 1};
+            imageBarriers.push_back(imageBarrier);
+            srcStages |= barrier.srcStages;
+            dstStages |= barrier.dstStages;
+        }
+        // One call per pass, so the driver sees every transition the pass needs at once
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr,
+                             static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+
+    void LveRenderGraph::execute(FrameInfo &frameInfo) {
+        assert(compiled && "Compile the graph before executing it");
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+        for (pass_t passIndex : order) {
+            auto &pass = passes[passIndex];
+            recordBarriers(commandBuffer, pass.barriers);
+            if (pass.renderPass == VK_NULL_HANDLE) {
+                pass.execute(frameInfo);
+                continue;
+            }
+
+            VkExtent2D area = pass.extent;
+            if (pass.renderArea.width != 0 && pass.renderArea.height != 0) {
+                area.width = std::min(pass.renderArea.width, pass.extent.width);
+                area.height = std::min(pass.renderArea.height, pass.extent.height);
+            }
+
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = pass.renderPass;
+            renderPassInfo.framebuffer = pass.framebuffer != VK_NULL_HANDLE ? pass.framebuffer : getOrCreateFramebuffer(pass);
+            renderPassInfo.renderArea.offset = {0, 0};
+            renderPassInfo.renderArea.extent = area;
+            renderPassInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+            renderPassInfo.pClearValues = pass.clearValues.data();
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+            // Viewport and scissor cover the render area, the recorder skips them when they didn't change
+            VkViewport viewport{};
+            viewport.x = 0.0f;
+            viewport.y = 0.0f;
+            viewport.width = static_cast<float>(area.width);
+            viewport.height = static_cast<float>(area.height);
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+            frameInfo.recorder.setViewport(viewport);
+            frameInfo.recorder.setScissor({{0, 0}, area});
+
+            pass.execute(frameInfo);
+            vkCmdEndRenderPass(commandBuffer);
+        }
+        recordBarriers(commandBuffer, finalBarriers);
+    }
+}
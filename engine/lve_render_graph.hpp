@@ -0,0 +1,265 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+
+//std
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace lve {
+    // Describes a frame as passes that read and write images, and works out everything in between:
+    // - passes whose results nothing uses are culled
+    // - pipeline barriers and layout transitions are derived from how consecutive passes use each image,
+    //   reads in the same layout share one barrier and back to back reads need none
+    // - passes writing attachments get a render pass and framebuffer made for them
+    // - images created by the graph only live for the passes using them, those whose lifetimes don't
+    //   overlap share the same memory
+    //
+    // Setting up (once, and again whenever the topology changes, eg. when the swap chain is recreated):
+    //   graph.reset();
+    //   auto shadowMap = graph.createImage("shadow_map", {depthFormat, {2048, 2048}});
+    //   auto color = graph.importImage("swap_chain", {...});
+    //   graph.addPass("shadows", [&](FrameInfo &frameInfo) { ... }).write(shadowMap, Access::DEPTH_ATTACHMENT);
+    //   graph.addPass("main", [&](FrameInfo &frameInfo) { ... })
+    //       .read(shadowMap, Access::SAMPLED).write(color, Access::COLOR_ATTACHMENT);
+    //   graph.markOutput(color);
+    //   graph.compile();
+    // Every frame: bindImage for each imported image, then execute
+    //
+    // compile sorts the passes by what they read and write, declaration order only breaks ties:
+    // - passes writing the same image write it in the order they were added, eg. an overlay after the main pass
+    // - a read sees what the last writer added before it wrote, or the finished image when every writer was
+    //   added after it, so a consumer can be added before its producer
+    // - a write waits for the reads of the image's previous contents
+    // compile throws when a pass reads something nothing writes (imported images with an initial layout
+    // count as written) or the passes depend on each other in a cycle
+    // - culling only drops passes, the survivors keep their sorted order
+    // Only images are tracked, passes synchronize their own buffers
+    class LveRenderGraph {
+        public:
+            using resource_t = uint32_t;
+            using pass_t = uint32_t;
+            static constexpr uint32_t INVALID = UINT32_MAX;
+
+            // How a pass uses an image, each one implies its stages, access, layout and image usage
+            enum class Access {
+                COLOR_ATTACHMENT, // written (and blended) as a color attachment
+                DEPTH_ATTACHMENT, // depth tested and written
+                DEPTH_TEST, // depth tested only, eg. against the result of a depth pre pass
+                SAMPLED, // read through a sampler in fragment or compute shaders
+                STORAGE_READ,
+                STORAGE_WRITE,
+                TRANSFER_SRC,
+                TRANSFER_DST,
+            };
+
+            // An image the graph creates and owns, its contents don't outlive the frame
+            struct ImageDesc {
+                VkFormat format;
+                VkExtent2D extent;
+                VkClearValue clearValue{}; // what the first pass attaching it starts from
+            };
+
+            // An image owned by someone else (eg. a swap chain image), bound with bindImage every frame
+            struct ImportDesc {
+                VkFormat format;
+                VkExtent2D extent;
+                // State it is in when the frame starts, UNDEFINED discards the contents
+                VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                VkPipelineStageFlags initialStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT; // what last used it
+                VkAccessFlags initialAccess = 0; // and how it wrote it
+                // State it has to be left in, UNDEFINED leaves it in the last pass's layout
+                VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                VkPipelineStageFlags finalStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+                VkAccessFlags finalAccess = 0;
+                VkClearValue clearValue{};
+            };
+
+            using ExecuteFn = std::function<void(FrameInfo &frameInfo)>;
+
+            // Declares what one pass reads and writes, returned by addPass
+            class PassBuilder {
+                public:
+                    PassBuilder &read(resource_t resource, Access access);
+                    PassBuilder &write(resource_t resource, Access access);
+                    // Kept even if nothing reads what it writes, eg. it fills buffers the graph doesn't see
+                    PassBuilder &sideEffects();
+                    pass_t getPass() const { return pass; }
+
+                private:
+                    friend class LveRenderGraph;
+                    PassBuilder(LveRenderGraph &graph, pass_t pass) : graph{graph}, pass{pass} {}
+
+                    LveRenderGraph &graph;
+                    pass_t pass;
+            };
+
+            struct Stats {
+                uint32_t passCount = 0; // after culling
+                uint32_t culledPassCount = 0;
+                uint32_t barrierCount = 0; // image barriers recorded per frame
+                uint32_t transientImageCount = 0;
+                uint32_t aliasSlotCount = 0; // memory blocks the transient images share
+                VkDeviceSize transientMemorySize = 0;
+                VkDeviceSize unaliasedMemorySize = 0; // what the transient images would take without aliasing
+            };
+
+            LveRenderGraph(LveDevice &device);
+            ~LveRenderGraph();
+
+            LveRenderGraph(const LveRenderGraph &) = delete;
+            LveRenderGraph &operator=(const LveRenderGraph &) = delete;
+
+            // Forgets every pass and resource and frees the graph's images, the device must be idle
+            // Render passes are kept, so pipelines made for them stay valid across recompiles
+            void reset();
+            resource_t createImage(const std::string &name, const ImageDesc &desc);
+            resource_t importImage(const std::string &name, const ImportDesc &desc);
+            PassBuilder addPass(const std::string &name, ExecuteFn execute);
+            // Keeps the passes writing it, imported images presented or read back later are outputs
+            void markOutput(resource_t resource);
+            void compile();
+            bool isCompiled() const { return compiled; }
+
+            // Available after compile
+            // The render pass a pass records into, VK_NULL_HANDLE when it has no attachments or was culled
+            VkRenderPass getRenderPass(pass_t pass) const;
+            bool isCulled(pass_t pass) const { return passes[pass].culled; }
+            // Graph images only, imported ones are whatever was bound
+            VkImage getImage(resource_t resource) const { return resources[resource].image; }
+            VkImageView getImageView(resource_t resource) const { return resources[resource].view; }
+            const Stats &getStats() const { return stats; }
+
+            void bindImage(resource_t resource, VkImage image, VkImageView view);
+            // Restricts a pass to the top left corner of its attachments (render area, viewport and scissor),
+            // eg. to draw at a lower resolution without new images. Can change every frame, the attachments' size by default
+            void setRenderArea(pass_t pass, VkExtent2D extent);
+            // Records every pass that survived culling with its barriers into frameInfo.commandBuffer
+            void execute(FrameInfo &frameInfo);
+
+        private:
+            struct AccessInfo {
+                VkPipelineStageFlags stages;
+                VkAccessFlags access;
+                VkImageLayout layout;
+                VkImageUsageFlags usage;
+                bool isWrite;
+                bool isAttachment;
+            };
+
+            struct Use {
+                resource_t resource;
+                Access access;
+            };
+
+            struct Resource {
+                std::string name;
+                bool imported;
+                VkFormat format;
+                VkExtent2D extent;
+                VkClearValue clearValue;
+                ImportDesc importDesc; // imported only
+
+                // Filled in by compile, graph images only
+                VkImageUsageFlags usage = 0;
+                uint32_t firstUse = INVALID; // position in the compiled order
+                uint32_t lastUse = INVALID;
+                uint32_t aliasSlot = INVALID;
+                VkMemoryRequirements memoryRequirements{};
+                // Bound every frame for imported images
+                VkImage image = VK_NULL_HANDLE;
+                VkImageView view = VK_NULL_HANDLE;
+            };
+
+            // One layout transition or memory dependency, the image is looked up when recording
+            struct Barrier {
+                resource_t resource;
+                VkImageLayout oldLayout;
+                VkImageLayout newLayout;
+                VkPipelineStageFlags srcStages;
+                VkAccessFlags srcAccess;
+                VkPipelineStageFlags dstStages;
+                VkAccessFlags dstAccess;
+            };
+
+            struct Pass {
+                std::string name;
+                ExecuteFn execute;
+                std::vector<Use> uses;
+                bool hasSideEffects = false;
+
+                // Filled in by compile
+                bool culled = true;
+                std::vector<Barrier> barriers; // recorded before the pass
+                std::vector<resource_t> attachments; // colors first, then depth
+                std::vector<VkClearValue> clearValues;
+                VkRenderPass renderPass = VK_NULL_HANDLE;
+                VkFramebuffer framebuffer = VK_NULL_HANDLE; // only when every attachment is a graph image
+                VkExtent2D extent{};
+                VkExtent2D renderArea{}; // set per frame, 0 means all of extent
+            };
+
+            // Memory shared by graph images whose lifetimes don't overlap
+            struct AliasSlot {
+                VkDeviceSize size = 0;
+                uint32_t memoryTypeBits = ~0u;
+                uint32_t lastUse = 0;
+                std::vector<resource_t> occupants; // in the order they use it
+                VkDeviceMemory memory = VK_NULL_HANDLE;
+            };
+
+            // What an image last went through while walking the passes
+            struct ResourceState {
+                VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+                VkPipelineStageFlags writeStages = 0;
+                VkAccessFlags writeAccess = 0;
+                VkPipelineStageFlags readStages = 0; // since the last write
+                VkPipelineStageFlags visibleStages = 0; // that have seen the last write
+                VkAccessFlags visibleAccess = 0;
+            };
+
+            struct RenderPassKey {
+                std::vector<VkFormat> formats;
+                std::vector<VkAttachmentLoadOp> loadOps;
+                std::vector<VkAttachmentStoreOp> storeOps;
+                std::vector<VkImageLayout> layouts;
+                bool operator<(const RenderPassKey &other) const;
+            };
+
+            static AccessInfo getAccessInfo(Access access, VkFormat format);
+            static bool isDepthFormat(VkFormat format);
+            void addUse(pass_t pass, resource_t resource, Access access, bool isWrite);
+
+            void sortPasses();
+            void cullPasses();
+            void computeLifetimes();
+            void createTransientImages();
+            void assignAliasSlots();
+            void computeBarriers();
+            void createRenderPasses();
+            VkRenderPass getOrCreateRenderPass(const RenderPassKey &key);
+            VkFramebuffer getOrCreateFramebuffer(Pass &pass);
+            void destroyCompiledResources();
+            void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier> &barriers);
+
+            LveDevice &lveDevice;
+            std::vector<Resource> resources;
+            std::vector<Pass> passes;
+            std::vector<resource_t> outputs;
+            bool compiled = false;
+
+            std::vector<pass_t> order; // the passes that survived culling, sorted
+            std::vector<AliasSlot> aliasSlots;
+            std::vector<Barrier> finalBarriers; // leave imported images how they were asked for
+            Stats stats{};
+
+            std::map<RenderPassKey, VkRenderPass> renderPasses;
+            // Framebuffers of passes attaching imported images, by render pass and views
+            std::map<std::vector<uint64_t>, VkFramebuffer> framebuffers;
+            std::vector<VkImageMemoryBarrier> imageBarriers; // reused when recording
+    };
+}
@@ -0,0 +1,134 @@
+#include "lve_render_queue.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace lve {
+
+    uint64_t LveRenderQueue::makeKey(uint32_t pipeline, uint32_t material, uint32_t model, float depth) {
+        assert(pipeline <= mask(PIPELINE_BITS) && "Pipeline id does not fit in the sort key");
+        assert(material <= mask(MATERIAL_BITS) && "Material id does not fit in the sort key");
+
+        float clampedDepth = std::min(std::max(depth, 0.f), 1.f);
+        uint64_t quantizedDepth = static_cast<uint64_t>(std::lround(clampedDepth * mask(DEPTH_BITS)));
+
+        return (static_cast<uint64_t>(pipeline) << PIPELINE_SHIFT) |
+               (static_cast<uint64_t>(material) << MATERIAL_SHIFT) |
+               (static_cast<uint64_t>(model & mask(MODEL_BITS)) << MODEL_SHIFT) |
+               (quantizedDepth << DEPTH_SHIFT);
+    }
+
+    void LveRenderQueue::sort(LveJobSystem *jobSystem) {
+        scratch.resize(items.size());
+        if (jobSystem != nullptr && jobSystem->getThreadCount() > 1 && items.size() >= PARALLEL_SORT_THRESHOLD) {
+            sortParallel(*jobSystem);
+        } else {
+            sortSerial();
+        }
+    }
+
+    void LveRenderQueue::sortSerial() {
+        size_t count = items.size();
+        Item *source = items.data();
+        Item *destination = scratch.data();
+
+        for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+            uint32_t shift = pass * RADIX_BITS;
+            Histogram histogram{};
+            for (size_t i = 0; i < count; i++) {
+                histogram[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+            }
+
+            // Every key has the same byte here, the pass wouldn't move anything
+            if (std::find(histogram.begin(), histogram.end(), count) != histogram.end()) {
+                continue;
+            }
+
+            // Turn the counts into the first slot of each bucket
+            uint32_t offset = 0;
+            for (auto &bucket : histogram) {
+                uint32_t bucketCount = bucket;
+                bucket = offset;
+                offset += bucketCount;
+            }
+
+            // Stable scatter, keeps the order from the previous passes within a bucket
+            for (size_t i = 0; i < count; i++) {
+                destination[histogram[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+            }
+            std::swap(source, destination);
+        }
+
+        // An odd number of passes leaves the result in the scratch buffer
+        if (source != items.data()) {
+            items.swap(scratch);
+        }
+    }
+
+    void LveRenderQueue::sortParallel(LveJobSystem &jobSystem) {
+        uint32_t count = static_cast<uint32_t>(items.size());
+        // Each chunk is histogrammed and scattered by one task, chunks keep their relative order
+        // so the scatter stays stable
+        uint32_t chunkCount = jobSystem.getThreadCount();
+        uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        chunkHistograms.resize(chunkCount);
+
+        Item *source = items.data();
+        Item *destination = scratch.data();
+
+        for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+            uint32_t shift = pass * RADIX_BITS;
+
+            jobSystem.parallelFor(chunkCount, 1, [&](uint32_t beginChunk, uint32_t endChunk) {
+                for (uint32_t chunk = beginChunk; chunk < endChunk; chunk++) {
+                    Histogram &histogram = chunkHistograms[chunk];
+                    histogram.fill(0);
+                    uint32_t begin = chunk * chunkSize;
+                    uint32_t end = std::min(begin + chunkSize, count);
+                    for (uint32_t i = begin; i < end; i++) {
+                        histogram[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+                    }
+                }
+            });
+
+            // Bucket totals decide whether the pass can be skipped, and where each bucket starts
+            Histogram totals{};
+            for (auto &histogram : chunkHistograms) {
+                for (uint32_t bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+                    totals[bucket] += histogram[bucket];
+                }
+            }
+            if (std::find(totals.begin(), totals.end(), count) != totals.end()) {
+                continue;
+            }
+
+            // Chunk c writes bucket b after every earlier chunk's share of bucket b
+            uint32_t offset = 0;
+            for (uint32_t bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+                for (auto &histogram : chunkHistograms) {
+                    uint32_t chunkBucketCount = histogram[bucket];
+                    histogram[bucket] = offset;
+                    offset += chunkBucketCount;
+                }
+            }
+
+            jobSystem.parallelFor(chunkCount, 1, [&](uint32_t beginChunk, uint32_t endChunk) {
+                for (uint32_t chunk = beginChunk; chunk < endChunk; chunk++) {
+                    Histogram &offsets = chunkHistograms[chunk];
+                    uint32_t begin = chunk * chunkSize;
+                    uint32_t end = std::min(begin + chunkSize, count);
+                    for (uint32_t i = begin; i < end; i++) {
+                        destination[offsets[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+                    }
+                }
+            });
+            std::swap(source, destination);
+        }
+
+        if (source != items.data()) {
+            items.swap(scratch);
+        }
+    }
+}
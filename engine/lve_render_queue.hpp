@@ -0,0 +1,72 @@
+#pragma once
+
+#include "lve_job_system.hpp"
+
+//std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+    // Render systems push one 64 bit sort key per draw plus a payload index back into their own data
+    // Sorting the keys puts draws sharing a pipeline, material and model next to each other,
+    // so state only changes between runs instead of between objects
+    //
+    // Key layout, most significant bits first:
+    //   | pipeline (6) | material (10) | model (24) | depth (24) |
+    class LveRenderQueue {
+        public:
+            struct Item {
+                uint64_t key;
+                uint32_t payload; // index into the render system's own object list
+            };
+
+            static constexpr uint32_t PIPELINE_BITS = 6;
+            static constexpr uint32_t MATERIAL_BITS = 10;
+            static constexpr uint32_t MODEL_BITS = 24;
+            static constexpr uint32_t DEPTH_BITS = 24;
+
+            static constexpr uint32_t DEPTH_SHIFT = 0;
+            static constexpr uint32_t MODEL_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+            static constexpr uint32_t MATERIAL_SHIFT = MODEL_SHIFT + MODEL_BITS;
+            static constexpr uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+
+            // Below this many items a single threaded sort beats waking the workers
+            static constexpr size_t PARALLEL_SORT_THRESHOLD = 1 << 16;
+
+            // depth is expected in [0, 1] with 0 the closest, closer draws sort first within a model
+            static uint64_t makeKey(uint32_t pipeline, uint32_t material, uint32_t model, float depth);
+
+            static uint32_t getPipeline(uint64_t key) { return static_cast<uint32_t>(key >> PIPELINE_SHIFT) & mask(PIPELINE_BITS); }
+            static uint32_t getMaterial(uint64_t key) { return static_cast<uint32_t>(key >> MATERIAL_SHIFT) & mask(MATERIAL_BITS); }
+            static uint32_t getModel(uint64_t key) { return static_cast<uint32_t>(key >> MODEL_SHIFT) & mask(MODEL_BITS); }
+            // Everything but the depth, draws with equal state bits can share one instanced draw
+            static uint64_t getStateBits(uint64_t key) { return key >> MODEL_SHIFT; }
+
+            void clear() { items.clear(); }
+            void reserve(size_t count) { items.reserve(count); }
+            void push(uint64_t key, uint32_t payload) { items.push_back({key, payload}); }
+
+            // LSD radix sort on the keys, 8 bits per pass. Passes where every key has the same byte are skipped,
+            // so unused key fields cost nothing. Large queues are split across the job system
+            void sort(LveJobSystem *jobSystem = nullptr);
+
+            const std::vector<Item> &getItems() const { return items; }
+            size_t size() const { return items.size(); }
+
+        private:
+            static constexpr uint32_t RADIX_BITS = 8;
+            static constexpr uint32_t RADIX_BUCKETS = 1 << RADIX_BITS;
+            static constexpr uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+            using Histogram = std::array<uint32_t, RADIX_BUCKETS>;
+
+            static constexpr uint32_t mask(uint32_t bits) { return bits >= 32 ? ~0u : (1u << bits) - 1; }
+
+            void sortSerial();
+            void sortParallel(LveJobSystem &jobSystem);
+
+            std::vector<Item> items;
+            std::vector<Item> scratch; // second buffer the passes ping pong with, kept between frames
+            std::vector<Histogram> chunkHistograms;
+    };
+}
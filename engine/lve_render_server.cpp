@@ -0,0 +1,178 @@
+#include "lve_render_server.hpp"
+
+//posix
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+//std
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace lve {
+    namespace {
+        void setNonBlocking(int fd) {
+            int flags = fcntl(fd, F_GETFL, 0);
+            if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+                throw std::runtime_error("failed to make socket non blocking!");
+            }
+        }
+    }
+
+    LveRenderServer::LveRenderServer(const std::string &socketPath) : socketPath{socketPath} {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("render server socket path is too long!");
+        }
+        std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0) {
+            throw std::runtime_error("failed to create render server socket!");
+        }
+        // Left behind by a server that didn't shut down cleanly
+        unlink(socketPath.c_str());
+        if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listenFd, 8) != 0) {
+            close(listenFd);
+            throw std::runtime_error("failed to listen on render server socket!");
+        }
+        setNonBlocking(listenFd);
+    }
+
+    LveRenderServer::~LveRenderServer() {
+        for (auto &client : clients) {
+            close(client.fd);
+        }
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+
+    void LveRenderServer::poll(LveRegistry &registry, LveAssetRegistry::model_t model) {
+        pollNumber++;
+        stats.messagesApplied = 0;
+        stats.throttledClients = 0;
+        acceptClients();
+        clients.erase(
+            std::remove_if(clients.begin(), clients.end(), [&](Client &client) {
+                if (receive(client, registry, model)) {
+                    return false;
+                }
+                // Nobody is left to update or remove them
+                for (auto &object : client.objects) {
+                    registry.destroy(object.second);
+                }
+                close(client.fd);
+                return true;
+            }),
+            clients.end());
+        stats.clientCount = static_cast<uint32_t>(clients.size());
+        stats.objectCount = 0;
+        for (auto &client : clients) {
+            stats.objectCount += static_cast<uint32_t>(client.objects.size());
+        }
+        takeSnapshot();
+    }
+
+    const LveRenderServer::Snapshot *LveRenderServer::getSnapshot(uint64_t poll) const {
+        const Snapshot &snapshot = snapshots[poll % SNAPSHOT_COUNT];
+        return snapshot.pollNumber == poll && poll != 0 ? &snapshot : nullptr;
+    }
+
+    void LveRenderServer::takeSnapshot() {
+        Snapshot &snapshot = snapshots[pollNumber % SNAPSHOT_COUNT];
+        snapshot.pollNumber = pollNumber;
+        snapshot.clientCount = static_cast<uint32_t>(clients.size());
+        for (uint32_t i = 0; i < snapshot.clientCount; i++) {
+            snapshot.clients[i] = {clients[i].id, clients[i].lastSequence};
+        }
+    }
+
+    void LveRenderServer::acceptClients() {
+        while (true) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                return; // EAGAIN when nobody else is waiting, anything else is retried next poll
+            }
+            setNonBlocking(fd);
+            // The socket's buffer is empty, so the welcome goes out whole or not at all
+            LveSceneWelcome welcome{clients.size() < MAX_CLIENTS ? nextClientId : 0};
+            if (send(fd, &welcome, sizeof(welcome), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(welcome)) || welcome.clientId == 0) {
+                close(fd);
+                continue;
+            }
+            nextClientId++;
+            clients.push_back({fd, welcome.clientId});
+        }
+    }
+
+    bool LveRenderServer::receive(Client &client, LveRegistry &registry, LveAssetRegistry::model_t model) {
+        char buffer[64 * sizeof(LveSceneMessage)];
+        uint32_t budget = MAX_MESSAGES_PER_POLL;
+        while (true) {
+            // Messages can be split anywhere by the stream, only whole ones are applied
+            size_t whole = std::min<size_t>(client.pending.size() / sizeof(LveSceneMessage), budget);
+            for (size_t i = 0; i < whole; i++) {
+                LveSceneMessage message;
+                std::memcpy(&message, client.pending.data() + i * sizeof(LveSceneMessage), sizeof(LveSceneMessage));
+                apply(message, client, registry, model);
+            }
+            client.pending.erase(client.pending.begin(), client.pending.begin() + whole * sizeof(LveSceneMessage));
+            budget -= static_cast<uint32_t>(whole);
+            if (budget == 0) {
+                // The rest waits for the next poll, the frame doesn't
+                stats.throttledClients++;
+                return true;
+            }
+
+            ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+            if (received == 0) {
+                return false;
+            }
+            if (received < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            client.pending.insert(client.pending.end(), buffer, buffer + received);
+        }
+    }
+
+    void LveRenderServer::apply(const LveSceneMessage &message, Client &client, LveRegistry &registry, LveAssetRegistry::model_t model) {
+        stats.messagesApplied++;
+        client.lastSequence = std::max(client.lastSequence, message.sequence);
+        auto &objects = client.objects;
+
+        switch (message.type) {
+            case LveSceneMessage::UPDATE_OBJECT: {
+                auto found = objects.find(message.objectId);
+                if (found == objects.end()) {
+                    auto entity = registry.create();
+                    registry.setModel(registry.indexOf(entity), model);
+                    found = objects.emplace(message.objectId, entity).first;
+                }
+                uint32_t index = registry.indexOf(found->second);
+                auto toVec3 = [](const float *values) { return glm::vec3{values[0], values[1], values[2]}; };
+                registry.setTranslation(index, toVec3(message.translation));
+                registry.setRotation(index, toVec3(message.rotation));
+                registry.setScale(index, toVec3(message.scale));
+                registry.setColor(index, toVec3(message.color));
+                break;
+            }
+            case LveSceneMessage::REMOVE_OBJECT: {
+                auto found = objects.find(message.objectId);
+                if (found != objects.end()) {
+                    registry.destroy(found->second);
+                    objects.erase(found);
+                }
+                break;
+            }
+            case LveSceneMessage::SHUTDOWN:
+                shutdownRequested = true;
+                break;
+            default:
+                break; // From a newer client, nothing to do with it
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "lve_asset_registry.hpp"
+#include "lve_registry.hpp"
+#include "lve_scene_protocol.hpp"
+#include "lve_shared_frame_ring.hpp"
+
+//std
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+    // Lets another process on the same machine drive the scene: clients connect to a UNIX socket and send
+    // LveSceneMessages, which poll applies to the registry once per frame
+    // Rendered frames go the other way through an LveSharedFrameWriter, tagged with getPollNumber,
+    // and list each client's newest applied sequence from getSnapshot of that poll
+    //
+    // Every client has its own object ids and sequences, and its objects are destroyed when it disconnects
+    // Everything is non blocking, poll takes whatever has arrived and returns, a client that stalls or
+    // sends half a message only holds up itself, and one that floods is cut off at MAX_MESSAGES_PER_POLL
+    class LveRenderServer {
+        public:
+            struct Options {
+                bool enabled = false;
+                std::string socketPath = "/tmp/lve_render.sock";
+                std::string frameRingName = "/lve_frames"; // POSIX shared memory name
+                uint32_t frameRingSlots = 4;
+            };
+
+            // One per frame ring entry, extra clients are turned away
+            static constexpr uint32_t MAX_CLIENTS = LveSharedFrameLayout::MAX_CLIENTS;
+            // Per client and poll, what doesn't fit waits in the socket, which in turn blocks the client's sends
+            static constexpr uint32_t MAX_MESSAGES_PER_POLL = 4096;
+            // Polls getSnapshot remembers, more than there are frames between a poll and its readback
+            static constexpr uint32_t SNAPSHOT_COUNT = 8;
+
+            struct Stats {
+                uint32_t clientCount = 0;
+                uint32_t messagesApplied = 0; // by the last poll
+                uint32_t throttledClients = 0; // that hit MAX_MESSAGES_PER_POLL in the last poll
+                uint32_t objectCount = 0;
+            };
+
+            // Every connected client's newest applied sequence, as of one poll
+            struct Snapshot {
+                uint64_t pollNumber = 0;
+                uint32_t clientCount = 0;
+                std::array<LveSharedFrameLayout::ClientSequence, MAX_CLIENTS> clients{};
+            };
+
+            explicit LveRenderServer(const std::string &socketPath);
+            ~LveRenderServer();
+
+            LveRenderServer(const LveRenderServer &) = delete;
+            LveRenderServer &operator=(const LveRenderServer &) = delete;
+
+            // Objects are created with model on their first update
+            // A client that disconnected has its objects destroyed
+            void poll(LveRegistry &registry, LveAssetRegistry::model_t model);
+
+            // Counts polls from 1, tag frames with it to look up their snapshot when they are read back
+            uint64_t getPollNumber() const { return pollNumber; }
+            // nullptr once SNAPSHOT_COUNT newer polls happened
+            const Snapshot *getSnapshot(uint64_t poll) const;
+            bool isShutdownRequested() const { return shutdownRequested; }
+            const Stats &getStats() const { return stats; }
+
+        private:
+            struct Client {
+                int fd;
+                uint64_t id;
+                uint64_t lastSequence = 0; // newest applied
+                std::vector<char> pending; // bytes of a message that hasn't fully arrived
+                std::unordered_map<uint32_t, LveRegistry::entity_t> objects; // the client's object ids to entities
+            };
+
+            void acceptClients();
+            // False once the client hung up or failed
+            bool receive(Client &client, LveRegistry &registry, LveAssetRegistry::model_t model);
+            void apply(const LveSceneMessage &message, Client &client, LveRegistry &registry, LveAssetRegistry::model_t model);
+            void takeSnapshot();
+
+            std::string socketPath;
+            int listenFd = -1;
+            std::vector<Client> clients;
+            uint64_t nextClientId = 1;
+            uint64_t pollNumber = 0;
+            std::array<Snapshot, SNAPSHOT_COUNT> snapshots{}; // indexed by poll number
+            bool shutdownRequested = false;
+            Stats stats{};
+    };
+}
@@ -7,6 +7,9 @@ namespace lve {
     LveRenderer::LveRenderer(LveWindow &window, LveDevice &device) : lveWindow{window}, lveDevice{device} {
         recreateSwapChain();
         createCommandBuffers();
+        for (int i = 0; i < LveSwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+            descriptorAllocators.push_back(std::make_unique<LveDescriptorAllocator>(lveDevice));
+        }
     }
 
     LveRenderer::~LveRenderer() {
@@ -28,12 +31,14 @@ namespace lve {
             lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent);
         } else {
             std::shared_ptr<LveSwapChain> oldSwapChain = std::move(lveSwapChain);
-            lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent, std::move(lveSwapChain)); // Allow us to create a new copy of lveSwapChain, but set LveSwapChain as null pointer
+            lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent, oldSwapChain); // The old one is handed over, so the new swap chain can reuse its resources
 
-            if (oldSwapChain->compareSwapFormats(*lveSwapChain.get())) {// .get returns a pointer to the original object managed
+            // Everything made for the old images' formats (pipelines, render passes) has to keep working
+            if (!oldSwapChain->compareSwapFormats(*lveSwapChain.get())) {// .get returns a pointer to the original object managed
                 throw std::runtime_error("Swap chain image(or depth) format has changed");
             }
         }
+        swapChainGeneration++;
     }
 
     /*
@@ -109,6 +114,8 @@ namespace lve {
         }
 
         isFrameStarted = true;
+        // acquireNextImage waited on this frame slot's fence, so the sets it allocated last time are no longer in use
+        descriptorAllocators[currentFrameIndex]->reset();
 
         auto commandBuffer = getCurrentCommandBuffer();
         VkCommandBufferBeginInfo beginInfo{};
@@ -118,6 +125,8 @@ namespace lve {
         if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS){
             throw std::runtime_error("failed to begin recording command buffer!");
         }
+        // Nothing is bound in a freshly begun command buffer
+        commandRecorder.begin(commandBuffer);
 
         return commandBuffer;
 
@@ -148,7 +157,7 @@ namespace lve {
         currentFrameIndex = (currentFrameIndex + 1) % LveSwapChain::MAX_FRAMES_IN_FLIGHT;
     }
 
-    void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+    void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, bool loadContents) {
         assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
         assert(commandBuffer == getCurrentCommandBuffer() &&
                "Can't begin render pass on command buffer from different frame");
@@ -159,7 +168,7 @@ namespace lve {
         // First command to begin a render pass
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = lveSwapChain->getRenderPass();
+        renderPassInfo.renderPass = loadContents ? lveSwapChain->getLoadRenderPass() : lveSwapChain->getRenderPass();
         renderPassInfo.framebuffer = lveSwapChain->getFrameBuffer(currentImageIndex); // writing to a specific frame buffer
 
         // Setup the render area, area where shaders loads and stores take place
@@ -186,8 +195,8 @@ namespace lve {
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
         VkRect2D scissor{{0, 0}, lveSwapChain->getSwapChainExtent()};
-        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        commandRecorder.setViewport(viewport);
+        commandRecorder.setScissor(scissor);
     }
 
     void LveRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
@@ -3,6 +3,8 @@
 #include "lve_window.hpp"
 #include "lve_device.hpp"
 #include "lve_swap_chain.hpp"
+#include "lve_command_recorder.hpp"
+#include "lve_descriptors.hpp"
 
 //std
 #include <memory>
@@ -21,6 +23,16 @@ namespace lve {
 
             // Render pass is a blueprint to tell the pipeline what frame buffer to expect
             VkRenderPass getSwapChainRenderPass() const { return lveSwapChain->getRenderPass();   }
+            float getAspectRatio() const { return lveSwapChain->extentAspectRatio(); }
+            VkExtent2D getSwapChainExtent() const { return lveSwapChain->getSwapChainExtent(); }
+            VkFormat getSwapChainImageFormat() const { return lveSwapChain->getSwapChainImageFormat(); }
+            VkFormat getSwapChainDepthFormat() const { return lveSwapChain->getSwapChainDepthFormat(); }
+            bool isReadbackSupported() const { return lveSwapChain->isReadbackSupported(); }
+            bool isUpscaleSupported() const { return lveSwapChain->isUpscaleSupported(); }
+            // The layout a finished frame is left in, for presenting or, headless, for reading it back
+            VkImageLayout getPresentLayout() const { return lveSwapChain->getPresentLayout(); }
+            // Goes up every time the swap chain is recreated, anything made for its images has to be made again
+            uint32_t getSwapChainGeneration() const { return swapChainGeneration; }
             bool isFrameInProgress() const { return isFrameStarted; }
 
             VkCommandBuffer getCurrentCommandBuffer() const {
@@ -28,6 +40,41 @@ namespace lve {
                 return commandBuffers[currentFrameIndex];
             }
 
+            // Records into the current command buffer, skipping binds that are already in place
+            LveCommandRecorder &getCommandRecorder() {
+                assert(isFrameStarted && "Cannot get command recorder when frame not in progress");
+                return commandRecorder;
+            }
+
+            // Descriptor sets allocated here only live for this frame, they are all released at once
+            // the next time this frame slot begins
+            LveDescriptorAllocator &getDescriptorAllocator() {
+                assert(isFrameStarted && "Cannot get descriptor allocator when frame not in progress");
+                return *descriptorAllocators[currentFrameIndex];
+            }
+
+            // The swap chain image this frame presents
+            VkImage getCurrentImage() const {
+                assert(isFrameStarted && "Cannot get swap chain image when frame not in progress");
+                return lveSwapChain->getImage(currentImageIndex);
+            }
+
+            VkImageView getCurrentImageView() const {
+                assert(isFrameStarted && "Cannot get swap chain image when frame not in progress");
+                return lveSwapChain->getImageView(currentImageIndex);
+            }
+
+            VkImage getCurrentDepthImage() const {
+                assert(isFrameStarted && "Cannot get depth image when frame not in progress");
+                return lveSwapChain->getDepthImage(currentImageIndex);
+            }
+
+            // Depth written by this frame's render passes, readable by shaders once a pass has ended
+            VkImageView getCurrentDepthImageView() const {
+                assert(isFrameStarted && "Cannot get depth image when frame not in progress");
+                return lveSwapChain->getDepthImageView(currentImageIndex);
+            }
+
             int getFrameIndex() const {
                 assert(isFrameStarted && "Cannot get frame index when frame not in progress");
                 return currentFrameIndex;
@@ -39,7 +86,8 @@ namespace lve {
             void endFrame();
 
             // Need command to record swap chain's render pass
-            void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+            // loadContents keeps what earlier passes of this frame drew instead of clearing
+            void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, bool loadContents = false);
             void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
         private:
             void createCommandBuffers();
@@ -51,9 +99,12 @@ namespace lve {
             // By using unique ptr, can easily create a new swapchain and swapping it out
             std::unique_ptr<LveSwapChain> lveSwapChain;
             std::vector<VkCommandBuffer> commandBuffers; // This class manages command buffers
+            LveCommandRecorder commandRecorder; // Only one frame records at a time, so one recorder is enough
+            std::vector<std::unique_ptr<LveDescriptorAllocator>> descriptorAllocators; // One per frame in flight
 
             // Track current state of frame in process
             uint32_t currentImageIndex = {0};
+            uint32_t swapChainGeneration = {0};
             int currentFrameIndex = {0};
             bool isFrameStarted = {false};
     };
@@ -0,0 +1,35 @@
+#pragma once
+
+//std
+#include <cstdint>
+
+namespace lve {
+    // What render server clients send, see LveRenderServer
+    // Messages are fixed size and sent back to back over a UNIX stream socket in host byte order,
+    // both ends are on the same machine
+    struct LveSceneMessage {
+        enum Type : uint32_t {
+            UPDATE_OBJECT = 0, // creates the object on its first update
+            REMOVE_OBJECT = 1,
+            SHUTDOWN = 2, // stops the server
+        };
+
+        uint32_t type;
+        uint32_t objectId; // picked by the client
+        // Increasing per client, every frame reports the last one it shows, so the client can time
+        // how long an update takes to reach the screen
+        uint64_t sequence;
+        float translation[3];
+        float rotation[3]; // radians, same convention as TransformComponent
+        float scale[3];
+        float color[3];
+    };
+    static_assert(sizeof(LveSceneMessage) == 64, "LveSceneMessage is part of the wire format");
+
+    // The only thing the server sends, once, right after accepting the connection
+    // Frames list sequences by client id (LveSharedFrameReader::getClientSequence), so the client needs its own
+    struct LveSceneWelcome {
+        uint64_t clientId; // unique while the server runs, 0 when it is full and hangs up
+    };
+    static_assert(sizeof(LveSceneWelcome) == 8, "LveSceneWelcome is part of the wire format");
+}
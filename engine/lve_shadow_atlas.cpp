@@ -0,0 +1,112 @@
+#include "lve_shadow_atlas.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace lve {
+
+    namespace {
+        uint32_t nextPowerOfTwo(uint32_t value) {
+            uint32_t result = 1;
+            while (result < value) {
+                result *= 2;
+            }
+            return result;
+        }
+
+        // Every other bit of a Z order index, the x or the y coordinate
+        uint32_t compactBits(uint32_t value) {
+            value &= 0x55555555u;
+            value = (value | (value >> 1)) & 0x33333333u;
+            value = (value | (value >> 2)) & 0x0f0f0f0fu;
+            value = (value | (value >> 4)) & 0x00ff00ffu;
+            value = (value | (value >> 8)) & 0x0000ffffu;
+            return value;
+        }
+    }
+
+    LveShadowAtlas::LveShadowAtlas(uint32_t atlasSize, uint32_t minTileSize)
+        : atlasSize{nextPowerOfTwo(atlasSize)}, minTileSize{nextPowerOfTwo(minTileSize)} {
+        assert(this->minTileSize <= this->atlasSize && "Tiles can't be bigger than the atlas");
+    }
+
+    void LveShadowAtlas::pack(const std::vector<Request> &requests, std::vector<Tile> &tiles) {
+        uint32_t count = static_cast<uint32_t>(requests.size());
+        sizes.resize(count);
+        uint64_t totalArea = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            sizes[i] = std::min(std::max(nextPowerOfTwo(requests[i].size), minTileSize), atlasSize);
+            totalArea += static_cast<uint64_t>(sizes[i]) * sizes[i];
+        }
+
+        // Shrink the least important tile until everything fits, dropping it once it can't get smaller
+        const uint64_t atlasArea = static_cast<uint64_t>(atlasSize) * atlasSize;
+        while (totalArea > atlasArea) {
+            uint32_t victim = count;
+            for (uint32_t i = 0; i < count; i++) {
+                if (sizes[i] == 0) {
+                    continue;
+                }
+                if (victim == count || requests[i].importance < requests[victim].importance ||
+                    (requests[i].importance == requests[victim].importance && i > victim)) {
+                    victim = i;
+                }
+            }
+            uint64_t area = static_cast<uint64_t>(sizes[victim]) * sizes[victim];
+            if (sizes[victim] > minTileSize) {
+                sizes[victim] /= 2;
+                totalArea -= area - area / 4;
+            } else {
+                sizes[victim] = 0;
+                totalArea -= area;
+            }
+        }
+
+        // Largest first keeps every tile aligned to its own size along the curve
+        order.clear();
+        for (uint32_t i = 0; i < count; i++) {
+            if (sizes[i] != 0) {
+                order.push_back(i);
+            }
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            if (sizes[a] != sizes[b]) {
+                return sizes[a] > sizes[b];
+            }
+            if (requests[a].importance != requests[b].importance) {
+                return requests[a].importance > requests[b].importance;
+            }
+            return a < b;
+        });
+
+        tiles.assign(count, Tile{});
+        uint32_t cursor = 0; // in minTileSize cells along the curve
+        for (uint32_t i : order) {
+            uint32_t cells = (sizes[i] / minTileSize) * (sizes[i] / minTileSize);
+            assert(cursor % cells == 0 && "Tiles placed largest first stay aligned");
+            tiles[i].x = compactBits(cursor) * minTileSize;
+            tiles[i].y = compactBits(cursor >> 1) * minTileSize;
+            tiles[i].size = sizes[i];
+            cursor += cells;
+        }
+        usedArea = totalArea;
+    }
+
+    uint32_t LveShadowAtlas::chooseTileSize(float pixels, uint32_t previousSize, uint32_t maxSize) const {
+        maxSize = std::min(nextPowerOfTwo(maxSize), atlasSize);
+        uint32_t size = std::min(std::max(nextPowerOfTwo(static_cast<uint32_t>(std::max(pixels, 0.f))), minTileSize), maxSize);
+        if (previousSize == 0 || size == previousSize) {
+            return size;
+        }
+        // A quarter past the boundary either way before the size changes
+        if (size > previousSize && pixels < previousSize * 1.25f) {
+            return previousSize;
+        }
+        if (size < previousSize && pixels > previousSize * .5f * .75f) {
+            return previousSize;
+        }
+        return size;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+//std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+    // Packs square power of 2 shadow map tiles into one square atlas
+    // Tiles are placed largest first along a Z order curve of minTileSize cells: a tile of n cells then
+    // always starts at a multiple of n, so it covers an aligned square and nothing is ever wasted
+    //
+    // When the requests don't fit, the least important tiles are halved first and dropped only once they
+    // are at minTileSize, so the important lights keep their resolution
+    // The same requests always pack the same way, so tiles only move when some request changes
+    class LveShadowAtlas {
+        public:
+            struct Request {
+                uint32_t size; // power of 2, in texels
+                float importance; // higher keeps its size longer when the atlas is full
+            };
+
+            // Texels of the atlas, size 0 if the request had to be dropped
+            struct Tile {
+                uint32_t x = 0;
+                uint32_t y = 0;
+                uint32_t size = 0;
+            };
+
+            LveShadowAtlas(uint32_t atlasSize, uint32_t minTileSize);
+
+            // One tile per request, in the same order
+            void pack(const std::vector<Request> &requests, std::vector<Tile> &tiles);
+
+            // The power of 2 tile size for something covering pixels on screen, between minTileSize and maxSize
+            // Only steps away from previousSize once pixels is well past the next size, so it doesn't flip
+            // back and forth (and throw away what was cached) while a light hovers around a boundary
+            uint32_t chooseTileSize(float pixels, uint32_t previousSize, uint32_t maxSize) const;
+
+            uint32_t getAtlasSize() const { return atlasSize; }
+            uint32_t getMinTileSize() const { return minTileSize; }
+            // Texels covered by tiles after the last pack
+            uint64_t getUsedArea() const { return usedArea; }
+
+        private:
+            uint32_t atlasSize;
+            uint32_t minTileSize;
+            uint64_t usedArea = 0;
+            std::vector<uint32_t> sizes; // reused by pack
+            std::vector<uint32_t> order;
+    };
+}
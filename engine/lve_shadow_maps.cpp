@@ -0,0 +1,663 @@
+#include "lve_shadow_maps.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+namespace lve {
+
+    static constexpr uint32_t CASTER_BINDING = 0;
+    static constexpr uint32_t SHADOW_UBO_BINDING = 0;
+    static constexpr uint32_t ATLAS_BINDING = 1;
+    static constexpr float CASCADE_SPLIT_LAMBDA = .6f; // 0 splits the distance evenly, 1 logarithmically
+    static constexpr float LOCAL_NEAR_PLANE = .05f;
+
+    namespace {
+        // Diameter in pixels of a sphere seen by the camera, 0 when it is outside the view
+        float projectedPixels(const LveCamera &camera, glm::vec3 center, float radius, float screenHeight) {
+            if (!camera.getFrustum().intersectsSphere(center, radius)) {
+                return 0.f;
+            }
+            float scale = camera.getProjection()[1][1];
+            if (!camera.isPerspective()) {
+                return std::min(scale * radius * screenHeight, screenHeight);
+            }
+            float depth = (camera.getView() * glm::vec4{center, 1.f}).z;
+            if (depth <= radius) {
+                return screenHeight; // the camera is inside it
+            }
+            return std::min(scale * radius / std::sqrt(depth * depth - radius * radius) * screenHeight, screenHeight);
+        }
+
+        // Any vector that isn't parallel to the direction, for building a view basis
+        glm::vec3 upFor(glm::vec3 direction) {
+            return std::abs(glm::normalize(direction).y) > .99f ? glm::vec3{0.f, 0.f, 1.f} : glm::vec3{0.f, -1.f, 0.f};
+        }
+
+        uint64_t mixEntity(uint64_t value) {
+            value ^= value >> 33;
+            value *= 0xff51afd7ed558ccdull;
+            value ^= value >> 33;
+            value *= 0xc4ceb9fe1a85ec53ull;
+            value ^= value >> 33;
+            return value;
+        }
+
+        bool sameTile(const LveShadowAtlas::Tile &a, const LveShadowAtlas::Tile &b) {
+            return a.x == b.x && a.y == b.y && a.size == b.size;
+        }
+
+        VkRect2D tileRect(const LveShadowAtlas::Tile &tile) {
+            return {{static_cast<int32_t>(tile.x), static_cast<int32_t>(tile.y)}, {tile.size, tile.size}};
+        }
+    }
+
+    LveShadowMaps::LveShadowMaps(LveDevice &device, LveDescriptorLayoutCache &layoutCache) : lveDevice{device} {
+        chooseFormat();
+        createSampler();
+        createAtlas();
+        createRenderPass();
+        createPipelines(layoutCache);
+    }
+
+    LveShadowMaps::~LveShadowMaps() {
+        casterPipeline = nullptr;
+        vkDestroyFramebuffer(lveDevice.device(), cacheFramebuffer, nullptr);
+        vkDestroyRenderPass(lveDevice.device(), cacheRenderPass, nullptr);
+        vkDestroyImageView(lveDevice.device(), cacheView, nullptr);
+        vkDestroyImage(lveDevice.device(), cacheImage, nullptr);
+        vkFreeMemory(lveDevice.device(), cacheMemory, nullptr);
+        vkDestroySampler(lveDevice.device(), sampler, nullptr);
+    }
+
+    // 16 bits are plenty for tiles this size and halve the memory and copy bandwidth,
+    // as long as they can be filtered, a 2x2 filtered compare is a free softer edge
+    void LveShadowMaps::chooseFormat() {
+        const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+        for (VkFormat candidate : {VK_FORMAT_D16_UNORM, VK_FORMAT_D32_SFLOAT}) {
+            if (lveDevice.hasFormatFeatures(candidate, VK_IMAGE_TILING_OPTIMAL, required | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+                format = candidate;
+                linearFiltering = true;
+                return;
+            }
+        }
+        // Every device can attach and sample it, just maybe not filter it
+        format = VK_FORMAT_D16_UNORM;
+        linearFiltering = false;
+    }
+
+    void LveShadowMaps::createSampler() {
+        // Compares against the reference depth instead of returning the depth, LESS_OR_EQUAL means lit
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = linearFiltering ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+        samplerInfo.minFilter = linearFiltering ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.compareEnable = VK_TRUE;
+        samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        samplerInfo.minLod = 0.f;
+        samplerInfo.maxLod = 0.f;
+
+        if (vkCreateSampler(lveDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow sampler!");
+        }
+    }
+
+    void LveShadowMaps::createAtlas() {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = ATLAS_SIZE;
+        imageInfo.extent.height = ATLAS_SIZE;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // Drawn into, copied out of, never sampled itself
+        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        lveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, cacheImage, cacheMemory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = cacheImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+
+        if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &cacheView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow cache image view!");
+        }
+    }
+
+    // Keeps what is already in the cache and leaves it ready to be copied from, a refresh only touches its tiles
+    void LveShadowMaps::createRenderPass() {
+        VkAttachmentDescription attachment{};
+        attachment.format = format;
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+        VkAttachmentReference depthReference{0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.pDepthStencilAttachment = &depthReference;
+
+        // The last frame's copy out of the cache has to finish before it is drawn over,
+        // and this frame's copy has to wait for the drawing
+        std::array<VkSubpassDependency, 2> dependencies{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = 1;
+        renderPassInfo.pAttachments = &attachment;
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        if (vkCreateRenderPass(lveDevice.device(), &renderPassInfo, nullptr, &cacheRenderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow cache render pass!");
+        }
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = cacheRenderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &cacheView;
+        framebufferInfo.width = ATLAS_SIZE;
+        framebufferInfo.height = ATLAS_SIZE;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(lveDevice.device(), &framebufferInfo, nullptr, &cacheFramebuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow cache framebuffer!");
+        }
+    }
+
+    // Casters only need their world matrices, the view they are drawn for is pushed
+    void LveShadowMaps::createPipelines(LveDescriptorLayoutCache &layoutCache) {
+        casterSetLayout = layoutCache.getSetLayout({
+            LveDescriptorLayoutCache::binding(CASTER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT),
+        });
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(PushConstantData);
+        casterPipelineLayout = layoutCache.getPipelineLayout({casterSetLayout}, {pushConstantRange});
+
+        samplingSetLayout = layoutCache.getSetLayout({
+            LveDescriptorLayoutCache::binding(SHADOW_UBO_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT),
+            LveDescriptorLayoutCache::binding(ATLAS_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
+        });
+
+        // Render passes with one attachment of the same format are compatible whatever they load and store,
+        // so the same pipeline draws into the cache and into the graph's render pass over the frame's atlas
+        PipelineConfigInfo pipelineConfig{};
+        LvePipeline::depthOnlyPipelineConfigInfo(pipelineConfig);
+        // Pushes the depth away a little more where the surface is steep to the light, against shadow acne
+        pipelineConfig.rasterizationInfo.depthBiasEnable = VK_TRUE;
+        pipelineConfig.rasterizationInfo.depthBiasConstantFactor = 1.25f;
+        pipelineConfig.rasterizationInfo.depthBiasSlopeFactor = 1.75f;
+        pipelineConfig.renderPass = cacheRenderPass;
+        pipelineConfig.pipelineLayout = casterPipelineLayout;
+        casterPipeline = std::make_unique<LvePipeline>(
+            lveDevice,
+            "shaders/shadow_caster.vert.spv",
+            "", // depth only
+            pipelineConfig
+        );
+    }
+
+    void LveShadowMaps::setLocalLights(const std::vector<LocalLight> &lights) {
+        localLights.assign(lights.begin(), lights.begin() + std::min<size_t>(lights.size(), MAX_LOCAL_LIGHTS));
+    }
+
+    void LveShadowMaps::update(FrameInfo &frameInfo, LveRegistry &registry, VkExtent2D screenExtent) {
+        assert(atlasView != VK_NULL_HANDLE && "Set the frame's atlas before updating the shadows");
+        prepared.valid = false;
+        uint32_t repackCount = stats.repackCount;
+        stats = Stats{};
+        stats.repackCount = repackCount;
+
+        // Casters are culled with their world matrices
+        registry.updateMatrices(&frameInfo.jobSystem);
+
+        updateViews(frameInfo.camera, screenExtent);
+        packAtlas();
+
+        // Every view's casters go into one array of matrices, the static ones only for views being refreshed
+        casterOrder.clear();
+        for (auto &view : views) {
+            stats.dynamicCasterCount += gatherCasters(view, registry, frameInfo);
+        }
+
+        auto &frameRing = frameInfo.frameRing;
+        auto shadowUbo = frameRing.allocateUniform(sizeof(ShadowUbo));
+        // At least one element, so the array has somewhere to start even without casters
+        auto casterArray = frameRing.allocateArray(sizeof(glm::mat4), std::max<uint32_t>(static_cast<uint32_t>(casterOrder.size()), 1));
+        if (!shadowUbo || !casterArray) {
+            return; // the ring grows before the next frame
+        }
+        auto &matrices = registry.getMatrices();
+        auto *casterMatrices = static_cast<glm::mat4 *>(casterArray.data);
+        for (size_t i = 0; i < casterOrder.size(); i++) {
+            casterMatrices[i] = matrices[casterOrder[i]];
+        }
+
+        prepared.casterSet = descriptorWriter.clear()
+            .writeBuffer(CASTER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, frameRing.regionDescriptorInfo())
+            .build(frameInfo.descriptorAllocator, casterSetLayout);
+        prepared.casterOffset = frameRing.getRegionOffset();
+        // Runs count from the start of the array, which is this element of the region
+        uint32_t firstCaster = casterArray.regionOffset / static_cast<uint32_t>(sizeof(glm::mat4));
+        for (auto &view : views) {
+            for (auto &run : view.staticRuns) {
+                run.firstInstance += firstCaster;
+            }
+            for (auto &run : view.dynamicRuns) {
+                run.firstInstance += firstCaster;
+            }
+        }
+        prepared.valid = true;
+
+        refreshCache(frameInfo);
+
+        // After the refresh, only tiles holding something are sampled
+        writeShadowUbo(*static_cast<ShadowUbo *>(shadowUbo.data));
+        VkDescriptorImageInfo atlasInfo{};
+        atlasInfo.sampler = sampler;
+        atlasInfo.imageView = atlasView;
+        atlasInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        prepared.samplingSet = descriptorWriter.clear()
+            .writeBuffer(SHADOW_UBO_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, frameRing.descriptorInfo(sizeof(ShadowUbo)))
+            .writeImage(ATLAS_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, atlasInfo)
+            .build(frameInfo.descriptorAllocator, samplingSetLayout);
+        prepared.samplingOffset = shadowUbo.offset;
+
+        stats.atlasUsedPercent = static_cast<uint32_t>(atlas.getUsedArea() * 100 / (static_cast<uint64_t>(ATLAS_SIZE) * ATLAS_SIZE));
+    }
+
+    void LveShadowMaps::updateViews(const LveCamera &camera, VkExtent2D screenExtent) {
+        uint32_t viewCount = CASCADE_COUNT;
+        for (auto &light : localLights) {
+            viewCount += light.type == LocalLightType::POINT ? 6 : 1;
+        }
+        // Views keep their index as long as the lights do, and with it their cache
+        views.resize(viewCount);
+
+        updateCascades(camera);
+
+        // Cube faces in the order lit_shader.frag picks them by the major axis
+        static const glm::vec3 faceDirections[6] = {
+            {1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f}};
+        float screenHeight = static_cast<float>(screenExtent.height);
+        uint32_t viewIndex = CASCADE_COUNT;
+        for (auto &light : localLights) {
+            float pixels = projectedPixels(camera, light.position, light.radius, screenHeight);
+            if (light.type == LocalLightType::SPOT) {
+                auto &view = views[viewIndex++];
+                // A little wider than the cone so filtering at its edge stays inside the tile
+                float fov = std::min(2.f * light.outerAngle * 1.1f, 3.f);
+                view.camera.setPerspectiveProjection(fov, 1.f, LOCAL_NEAR_PLANE, light.radius);
+                view.camera.setViewDirection(light.position, light.direction, upFor(light.direction));
+                view.projectionView = view.camera.getProjectionView();
+                view.importance = pixels;
+                view.requestedSize = pixels > 0.f ? atlas.chooseTileSize(pixels, view.requestedSize, MAX_LOCAL_TILE_SIZE) : 0;
+            } else {
+                // Each face sees about half of the light's reach across
+                for (auto &direction : faceDirections) {
+                    auto &view = views[viewIndex++];
+                    view.camera.setPerspectiveProjection(glm::radians(90.f), 1.f, LOCAL_NEAR_PLANE, light.radius);
+                    view.camera.setViewDirection(light.position, direction, upFor(direction));
+                    view.projectionView = view.camera.getProjectionView();
+                    view.importance = pixels * .5f;
+                    view.requestedSize = pixels > 0.f ? atlas.chooseTileSize(pixels * .5f, view.requestedSize, MAX_LOCAL_TILE_SIZE) : 0;
+                }
+            }
+        }
+    }
+
+    // Each cascade covers a slice of the camera's view with a sphere, so its size doesn't change when the camera
+    // turns, and moves in whole texels, so a moving camera doesn't make the shadow edges crawl
+    // A still camera keeps the exact same matrices, and with them the cached tiles
+    void LveShadowMaps::updateCascades(const LveCamera &camera) {
+        bool enabled = directionalLight.intensity > 0.f;
+        float nearPlane = std::max(camera.getNear(), 1e-3f);
+        float farPlane = std::max(std::min(camera.getFar(), SHADOW_DISTANCE), nearPlane * 1.001f);
+        const glm::mat4 &projection = camera.getProjection();
+        glm::mat4 inverseProjectionView = glm::inverse(camera.getProjectionView());
+        auto ndcDepth = [&](float depth) {
+            return camera.isPerspective() ? projection[2][2] + projection[3][2] / depth : projection[2][2] * depth + projection[3][2];
+        };
+
+        glm::vec3 direction = glm::normalize(directionalLight.direction);
+        float sliceStart = nearPlane;
+        for (uint32_t cascade = 0; cascade < CASCADE_COUNT; cascade++) {
+            auto &view = views[cascade];
+            view.requestedSize = enabled ? CASCADE_TILE_SIZE : 0;
+            view.importance = 1e9f / static_cast<float>(cascade + 1); // always before the local lights, nearest first
+
+            // Between an even and a logarithmic split, the near cascades get most of the detail
+            float fraction = static_cast<float>(cascade + 1) / CASCADE_COUNT;
+            float logSplit = nearPlane * std::pow(farPlane / nearPlane, fraction);
+            float evenSplit = nearPlane + (farPlane - nearPlane) * fraction;
+            float sliceEnd = CASCADE_SPLIT_LAMBDA * logSplit + (1.f - CASCADE_SPLIT_LAMBDA) * evenSplit;
+            cascadeSplits[cascade] = sliceEnd;
+
+            glm::vec3 corners[8];
+            glm::vec3 center{0.f};
+            for (int i = 0; i < 8; i++) {
+                glm::vec4 corner = inverseProjectionView * glm::vec4{
+                    i & 1 ? 1.f : -1.f, i & 2 ? 1.f : -1.f, ndcDepth(i & 4 ? sliceEnd : sliceStart), 1.f};
+                corners[i] = glm::vec3{corner} / corner.w;
+                center += corners[i] / 8.f;
+            }
+            float radius = 0.f;
+            for (auto &corner : corners) {
+                radius = std::max(radius, glm::length(corner - center));
+            }
+            radius = std::ceil(radius * 16.f) / 16.f; // so rounding doesn't change it every frame
+            sliceStart = sliceEnd;
+
+            // Built around the origin, then the box is placed on the texel grid in light space
+            view.camera.setViewDirection(glm::vec3{0.f}, direction, upFor(direction));
+            glm::vec3 lightCenter{view.camera.getView() * glm::vec4{center, 1.f}};
+            float texelSize = 2.f * radius / CASCADE_TILE_SIZE;
+            lightCenter = glm::floor(lightCenter / texelSize) * texelSize;
+            // Casters between the light and the slice still have to land in the map
+            view.camera.setOrthographicProjection(
+                lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius,
+                lightCenter.z - radius - SHADOW_DISTANCE, lightCenter.z + radius);
+            view.projectionView = view.camera.getProjectionView();
+        }
+        for (uint32_t cascade = CASCADE_COUNT; cascade < MAX_CASCADES; cascade++) {
+            cascadeSplits[cascade] = 0.f;
+        }
+    }
+
+    // Only when some view wants a different size, so tiles (and what is cached in them) stay put otherwise
+    void LveShadowMaps::packAtlas() {
+        bool changed = packedSizes.size() != views.size();
+        for (size_t i = 0; i < views.size() && !changed; i++) {
+            changed = packedSizes[i] != views[i].requestedSize;
+        }
+        if (!changed) {
+            return;
+        }
+
+        atlasRequests.clear();
+        for (auto &view : views) {
+            if (view.requestedSize != 0) {
+                atlasRequests.push_back({view.requestedSize, view.importance});
+            }
+        }
+        atlas.pack(atlasRequests, atlasTiles);
+
+        packedSizes.resize(views.size());
+        uint32_t request = 0;
+        for (size_t i = 0; i < views.size(); i++) {
+            packedSizes[i] = views[i].requestedSize;
+            views[i].tile = views[i].requestedSize != 0 ? atlasTiles[request++] : LveShadowAtlas::Tile{};
+        }
+        stats.repackCount++;
+    }
+
+    uint32_t LveShadowMaps::gatherCasters(View &view, const LveRegistry &registry, FrameInfo &frameInfo) {
+        view.refresh = false;
+        view.staticRuns.clear();
+        view.dynamicRuns.clear();
+        if (view.tile.size == 0) {
+            view.cached = false; // it will be somewhere else when it comes back
+            return 0;
+        }
+        stats.viewCount++;
+
+        frustumCuller.cull(LveFrustum::fromMatrix(view.projectionView), registry, frameInfo.assets, &frameInfo.jobSystem, visible);
+        auto &staticFlags = registry.getStaticFlags();
+        auto &entities = registry.getEntities();
+        staticCasters.clear();
+        dynamicCasters.clear();
+        // Order independent, so the same set of casters always hashes the same
+        uint64_t casterHash = 0;
+        bool staticChanged = false;
+        for (uint32_t index : visible) {
+            if (staticFlags[index]) {
+                staticCasters.push_back(index);
+                casterHash += mixEntity(entities[index]);
+                staticChanged = staticChanged || registry.hasChangedSince(index, view.cachedVersion);
+            } else {
+                dynamicCasters.push_back(index);
+            }
+        }
+
+        // A static caster that moved out of the view or was destroyed only shows up in the hash
+        view.refresh = !view.cached || staticChanged ||
+                       view.cachedProjectionView != view.projectionView || !sameTile(view.cachedTile, view.tile) ||
+                       view.cachedCasterHash != casterHash || view.cachedCasterCount != staticCasters.size();
+        if (view.refresh) {
+            view.cached = false; // until refreshCache has drawn it
+            uint32_t nextInstance = static_cast<uint32_t>(casterOrder.size());
+            writeRuns(staticCasters, registry, view.staticRuns, nextInstance);
+            view.cachedProjectionView = view.projectionView;
+            view.cachedTile = view.tile;
+            view.cachedVersion = registry.getVersion();
+            view.cachedCasterHash = casterHash;
+            view.cachedCasterCount = static_cast<uint32_t>(staticCasters.size());
+            stats.refreshedViewCount++;
+        } else {
+            stats.cachedViewCount++;
+        }
+        uint32_t nextInstance = static_cast<uint32_t>(casterOrder.size());
+        writeRuns(dynamicCasters, registry, view.dynamicRuns, nextInstance);
+        return static_cast<uint32_t>(dynamicCasters.size());
+    }
+
+    // Sorted by model, so every run of one model is a single instanced draw
+    void LveShadowMaps::writeRuns(std::vector<uint32_t> &casters, const LveRegistry &registry, std::vector<DrawRun> &runs, uint32_t &nextInstance) {
+        auto &models = registry.getModels();
+        std::sort(casters.begin(), casters.end(), [&](uint32_t a, uint32_t b) {
+            return models[a] != models[b] ? models[a] < models[b] : a < b;
+        });
+        for (uint32_t index : casters) {
+            if (models[index] == LveAssetRegistry::INVALID_MODEL) {
+                continue;
+            }
+            if (runs.empty() || runs.back().model != models[index]) {
+                runs.push_back({models[index], nextInstance, 0});
+            }
+            runs.back().instanceCount++;
+            casterOrder.push_back(index);
+            nextInstance++;
+        }
+    }
+
+    void LveShadowMaps::drawRuns(FrameInfo &frameInfo, const View &view, const std::vector<DrawRun> &runs) {
+        auto &recorder = frameInfo.recorder;
+        VkRect2D rect = tileRect(view.tile);
+        VkViewport viewport{};
+        viewport.x = static_cast<float>(rect.offset.x);
+        viewport.y = static_cast<float>(rect.offset.y);
+        viewport.width = static_cast<float>(rect.extent.width);
+        viewport.height = static_cast<float>(rect.extent.height);
+        viewport.minDepth = 0.f;
+        viewport.maxDepth = 1.f;
+        recorder.setViewport(viewport);
+        recorder.setScissor(rect);
+
+        PushConstantData push{view.projectionView};
+        recorder.pushConstants(casterPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstantData), &push);
+        for (auto &run : runs) {
+            LveModel &model = frameInfo.assets.getModel(run.model);
+            model.bind(recorder);
+            model.drawInstanced(recorder.getCommandBuffer(), run.instanceCount, run.firstInstance);
+        }
+    }
+
+    // One render pass over the stale tiles only, each is cleared and gets its static casters again
+    void LveShadowMaps::refreshCache(FrameInfo &frameInfo) {
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        uint32_t minX = ATLAS_SIZE, minY = ATLAS_SIZE, maxX = 0, maxY = 0;
+        for (auto &view : views) {
+            if (view.refresh) {
+                minX = std::min(minX, view.tile.x);
+                minY = std::min(minY, view.tile.y);
+                maxX = std::max(maxX, view.tile.x + view.tile.size);
+                maxY = std::max(maxY, view.tile.y + view.tile.size);
+            }
+        }
+        if (maxX == 0) {
+            return;
+        }
+
+        // Its contents are whatever, every tile is cleared before it is first copied
+        if (!cacheInitialized) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = cacheImage;
+            barrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &barrier);
+            cacheInitialized = true;
+        }
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = cacheRenderPass;
+        renderPassInfo.framebuffer = cacheFramebuffer;
+        renderPassInfo.renderArea.offset = {static_cast<int32_t>(minX), static_cast<int32_t>(minY)};
+        renderPassInfo.renderArea.extent = {maxX - minX, maxY - minY};
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        auto &recorder = frameInfo.recorder;
+        casterPipeline->bind(recorder);
+        recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, casterPipelineLayout, 0, 1, &prepared.casterSet, 1, &prepared.casterOffset);
+        for (auto &view : views) {
+            if (!view.refresh) {
+                continue;
+            }
+            VkClearAttachment clear{};
+            clear.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+            clear.clearValue.depthStencil = {1.f, 0};
+            VkClearRect clearRect{tileRect(view.tile), 0, 1};
+            vkCmdClearAttachments(commandBuffer, 1, &clear, 1, &clearRect);
+
+            drawRuns(frameInfo, view, view.staticRuns);
+            stats.staticDrawCount += static_cast<uint32_t>(view.staticRuns.size());
+            view.cached = true;
+        }
+        vkCmdEndRenderPass(commandBuffer);
+    }
+
+    void LveShadowMaps::composite(FrameInfo &frameInfo, VkImage atlasImage) {
+        if (!prepared.valid) {
+            return;
+        }
+        copyRegions.clear();
+        for (auto &view : views) {
+            if (!view.cached) {
+                continue;
+            }
+            VkImageCopy region{};
+            region.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+            region.srcOffset = {static_cast<int32_t>(view.tile.x), static_cast<int32_t>(view.tile.y), 0};
+            region.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+            region.dstOffset = region.srcOffset;
+            region.extent = {view.tile.size, view.tile.size, 1};
+            copyRegions.push_back(region);
+        }
+        if (copyRegions.empty()) {
+            return;
+        }
+        vkCmdCopyImage(frameInfo.commandBuffer,
+                       cacheImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       atlasImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+    }
+
+    void LveShadowMaps::renderDynamic(FrameInfo &frameInfo) {
+        if (!prepared.valid) {
+            return;
+        }
+        auto &recorder = frameInfo.recorder;
+        casterPipeline->bind(recorder);
+        recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, casterPipelineLayout, 0, 1, &prepared.casterSet, 1, &prepared.casterOffset);
+        for (auto &view : views) {
+            if (!view.cached || view.dynamicRuns.empty()) {
+                continue;
+            }
+            drawRuns(frameInfo, view, view.dynamicRuns);
+            stats.dynamicDrawCount += static_cast<uint32_t>(view.dynamicRuns.size());
+        }
+    }
+
+    bool LveShadowMaps::bind(FrameInfo &frameInfo, VkPipelineLayout pipelineLayout, uint32_t set) {
+        if (!prepared.valid) {
+            return false;
+        }
+        frameInfo.recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, 1, &prepared.samplingSet, 1, &prepared.samplingOffset);
+        return true;
+    }
+
+    void LveShadowMaps::writeShadowUbo(ShadowUbo &ubo) const {
+        ubo = ShadowUbo{};
+        bool sunEnabled = directionalLight.intensity > 0.f;
+        ubo.sunDirection = glm::vec4{-glm::normalize(directionalLight.direction), sunEnabled ? 1.f : 0.f};
+        ubo.sunColor = glm::vec4{directionalLight.color * directionalLight.intensity, 0.f};
+        ubo.cascadeSplits = glm::vec4{cascadeSplits[0], cascadeSplits[1], cascadeSplits[2], cascadeSplits[3]};
+        ubo.counts = glm::uvec4{sunEnabled ? CASCADE_COUNT : 0, static_cast<uint32_t>(localLights.size()), 0, 0};
+
+        for (size_t i = 0; i < views.size(); i++) {
+            auto &view = views[i];
+            ubo.viewMatrices[i] = view.projectionView;
+            if (view.cached) {
+                float scale = static_cast<float>(view.tile.size) / ATLAS_SIZE;
+                ubo.viewRects[i] = {static_cast<float>(view.tile.x) / ATLAS_SIZE, static_cast<float>(view.tile.y) / ATLAS_SIZE, scale, scale};
+            }
+        }
+
+        uint32_t firstView = CASCADE_COUNT;
+        for (size_t i = 0; i < localLights.size(); i++) {
+            auto &light = localLights[i];
+            uint32_t viewCount = light.type == LocalLightType::POINT ? 6 : 1;
+            auto &data = ubo.localLights[i];
+            data.positionRadius = glm::vec4{light.position, light.radius};
+            data.directionCosOuter = glm::vec4{glm::normalize(light.direction), std::cos(light.outerAngle)};
+            data.colorCosInner = glm::vec4{light.color * light.intensity, std::cos(light.innerAngle)};
+            data.info = glm::uvec4{static_cast<uint32_t>(light.type), firstView, viewCount, 0};
+            firstView += viewCount;
+        }
+    }
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_camera.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_frustum_culler.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_registry.hpp"
+#include "lve_shadow_atlas.hpp"
+#include "lve_swap_chain.hpp"
+
+#define GLM_FORCE_RADIANS // Radians must be radians
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // Expect depth values to 0 - 1
+#include <glm/glm.hpp>
+
+//std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lve {
+    // Shadow maps for a directional light (cascades over the camera's view) and a few spot and point lights,
+    // all as tiles of one depth atlas. Point lights take 6 tiles, one per cube face
+    //
+    // Static casters (LveRegistry::setStatic) are drawn into a cached atlas that outlives the frame, a tile
+    // is only drawn again when its view changes (the light or a cascade moved, the tile moved) or a static
+    // caster inside it moved, appeared or disappeared. Every frame the cached tiles are copied into the
+    // frame's atlas and the dynamic casters are drawn on top, so a still scene with one moving object only
+    // pays for that object
+    //
+    // Spot and point light tiles are sized by how big the light's reach looks on screen, cascades get
+    // CASCADE_TILE_SIZE. Lights off screen get no tile and shade unshadowed
+    //
+    // Each frame, in this order (see FirstApp::buildRenderGraph):
+    //   update          works out the views and tiles, culls the casters and redraws stale cached tiles
+    //   composite       copies the cached tiles into the frame's atlas, outside render passes
+    //   renderDynamic   draws the dynamic casters, inside a depth only render pass over the frame's atlas
+    //   bind            for render systems shading with the shadows, in lit_shader.frag
+    class LveShadowMaps {
+        public:
+            static constexpr uint32_t ATLAS_SIZE = 4096;
+            static constexpr uint32_t MIN_TILE_SIZE = 128;
+            static constexpr uint32_t CASCADE_TILE_SIZE = 1024;
+            static constexpr uint32_t MAX_LOCAL_TILE_SIZE = 1024;
+            // Has to match lit_shader.frag
+            static constexpr uint32_t CASCADE_COUNT = 3;
+            static constexpr uint32_t MAX_CASCADES = 4; // the splits are one vec4
+            static constexpr uint32_t MAX_LOCAL_LIGHTS = 4;
+            static constexpr uint32_t MAX_VIEWS = MAX_CASCADES + 6 * MAX_LOCAL_LIGHTS;
+            // Cascades cover the camera's view up to here, or its far plane if that is closer
+            static constexpr float SHADOW_DISTANCE = 20.f;
+
+            struct DirectionalLight {
+                glm::vec3 direction{0.f, 1.f, 0.f}; // the way the light travels, y points down
+                glm::vec3 color{1.f};
+                float intensity = 0.f; // 0 turns it and its cascades off
+            };
+
+            enum class LocalLightType : uint32_t { SPOT = 0, POINT = 1 };
+
+            struct LocalLight {
+                LocalLightType type = LocalLightType::SPOT;
+                glm::vec3 position{0.f};
+                glm::vec3 direction{0.f, 1.f, 0.f}; // spot only
+                float innerAngle = .3f; // spot only, radians from the direction, full brightness inside
+                float outerAngle = .5f; // and nothing outside
+                float radius = 5.f; // reaches 0 here, also the far plane of its shadow views
+                glm::vec3 color{1.f};
+                float intensity = 1.f;
+            };
+
+            // Of the last update
+            struct Stats {
+                uint32_t viewCount = 0; // views with a tile
+                uint32_t cachedViewCount = 0; // whose static casters came from the cache
+                uint32_t refreshedViewCount = 0; // whose cached tile was drawn again
+                uint32_t staticDrawCount = 0; // instanced draws into the cache
+                uint32_t dynamicDrawCount = 0; // instanced draws on top, every frame
+                uint32_t dynamicCasterCount = 0;
+                uint32_t repackCount = 0; // times the atlas layout changed, since the start
+                uint32_t atlasUsedPercent = 0;
+            };
+
+            LveShadowMaps(LveDevice &device, LveDescriptorLayoutCache &layoutCache);
+            ~LveShadowMaps();
+
+            LveShadowMaps(const LveShadowMaps &) = delete;
+            LveShadowMaps &operator=(const LveShadowMaps &) = delete;
+
+            // What the frame's atlas has to be created with
+            VkFormat getFormat() const { return format; }
+            VkExtent2D getAtlasExtent() const { return {ATLAS_SIZE, ATLAS_SIZE}; }
+            // For the pipeline layouts of render systems that shade with the shadows
+            VkDescriptorSetLayout getSetLayout() const { return samplingSetLayout; }
+
+            void setDirectionalLight(const DirectionalLight &light) { directionalLight = light; }
+            // Up to MAX_LOCAL_LIGHTS, the rest are ignored
+            void setLocalLights(const std::vector<LocalLight> &lights);
+            // The frame's atlas, once the graph that owns it is compiled. In DEPTH_STENCIL_READ_ONLY_OPTIMAL when sampled
+            void setAtlasView(VkImageView view) { atlasView = view; }
+
+            // Outside render passes. screenExtent is what the camera draws, it decides the local lights' tile sizes
+            void update(FrameInfo &frameInfo, LveRegistry &registry, VkExtent2D screenExtent);
+            // Atlas in TRANSFER_DST_OPTIMAL
+            void composite(FrameInfo &frameInfo, VkImage atlas);
+            // Inside a render pass with the frame's atlas as its only attachment, loaded
+            void renderDynamic(FrameInfo &frameInfo);
+            // Binds the light and shadow data at index set of a graphics pipeline layout
+            // Returns false if update couldn't run this frame (the frame ring overflowed)
+            bool bind(FrameInfo &frameInfo, VkPipelineLayout pipelineLayout, uint32_t set);
+
+            const Stats &getStats() const { return stats; }
+
+        private:
+            // std140, mirrored in lit_shader.frag
+            struct LocalLightData {
+                glm::vec4 positionRadius{0.f};
+                glm::vec4 directionCosOuter{0.f}; // cos of the outer angle in w
+                glm::vec4 colorCosInner{0.f}; // rgb times the intensity, cos of the inner angle in w
+                glm::uvec4 info{0}; // type, first view, views
+            };
+            struct ShadowUbo {
+                glm::vec4 sunDirection{0.f}; // towards the light, w is 1 when it shines
+                glm::vec4 sunColor{0.f};
+                glm::vec4 cascadeSplits{0.f}; // view depth each cascade ends at
+                glm::uvec4 counts{0}; // cascades, local lights
+                glm::mat4 viewMatrices[MAX_VIEWS]; // world space to the view's clip space
+                glm::vec4 viewRects[MAX_VIEWS]; // atlas uv offset in xy, scale in zw, 0 when the view has no tile
+                LocalLightData localLights[MAX_LOCAL_LIGHTS];
+            };
+
+            // Consecutive instances of one model
+            struct DrawRun {
+                LveAssetRegistry::model_t model;
+                uint32_t firstInstance;
+                uint32_t instanceCount;
+            };
+
+            struct View {
+                LveCamera camera; // its view and projection
+                glm::mat4 projectionView{1.f};
+                uint32_t requestedSize = 0; // 0 when it needs no tile
+                float importance = 0.f;
+                LveShadowAtlas::Tile tile{};
+
+                // What the cached tile holds
+                bool cached = false;
+                glm::mat4 cachedProjectionView{1.f};
+                LveShadowAtlas::Tile cachedTile{};
+                uint64_t cachedVersion = 0; // registry version it was drawn at
+                uint64_t cachedCasterHash = 0; // of the static casters' entities
+                uint32_t cachedCasterCount = 0;
+
+                // This frame
+                bool refresh = false;
+                std::vector<DrawRun> staticRuns; // only when refreshing
+                std::vector<DrawRun> dynamicRuns;
+            };
+
+            struct PushConstantData {
+                glm::mat4 projectionView;
+            };
+
+            void chooseFormat();
+            void createSampler();
+            void createAtlas();
+            void createRenderPass();
+            void createPipelines(LveDescriptorLayoutCache &layoutCache);
+
+            void updateViews(const LveCamera &camera, VkExtent2D screenExtent);
+            void updateCascades(const LveCamera &camera);
+            void packAtlas();
+            // Splits the casters of a view into its static and dynamic runs, decides whether its cached tile is stale
+            uint32_t gatherCasters(View &view, const LveRegistry &registry, FrameInfo &frameInfo);
+            void writeRuns(std::vector<uint32_t> &casters, const LveRegistry &registry, std::vector<DrawRun> &runs, uint32_t &nextInstance);
+            void drawRuns(FrameInfo &frameInfo, const View &view, const std::vector<DrawRun> &runs);
+            void refreshCache(FrameInfo &frameInfo);
+            void writeShadowUbo(ShadowUbo &ubo) const;
+
+            LveDevice &lveDevice;
+            VkFormat format = VK_FORMAT_UNDEFINED;
+            bool linearFiltering = false;
+            VkSampler sampler = VK_NULL_HANDLE;
+            // The cache, stays in TRANSFER_SRC_OPTIMAL between refreshes
+            VkImage cacheImage = VK_NULL_HANDLE;
+            VkDeviceMemory cacheMemory = VK_NULL_HANDLE;
+            VkImageView cacheView = VK_NULL_HANDLE;
+            bool cacheInitialized = false; // moved out of UNDEFINED
+            VkRenderPass cacheRenderPass = VK_NULL_HANDLE;
+            VkFramebuffer cacheFramebuffer = VK_NULL_HANDLE;
+            VkImageView atlasView = VK_NULL_HANDLE; // the frame's, owned by the render graph
+
+            VkDescriptorSetLayout casterSetLayout; // owned by the layout cache
+            VkPipelineLayout casterPipelineLayout; // owned by the layout cache
+            VkDescriptorSetLayout samplingSetLayout; // owned by the layout cache
+            std::unique_ptr<LvePipeline> casterPipeline;
+            LveDescriptorWriter descriptorWriter{lveDevice};
+
+            DirectionalLight directionalLight{};
+            std::vector<LocalLight> localLights;
+            std::vector<View> views; // cascades first, then the local lights' in order
+            float cascadeSplits[MAX_CASCADES] = {};
+            LveShadowAtlas atlas{ATLAS_SIZE, MIN_TILE_SIZE};
+            std::vector<LveShadowAtlas::Request> atlasRequests; // reused by packAtlas
+            std::vector<LveShadowAtlas::Tile> atlasTiles;
+            std::vector<uint32_t> packedSizes; // requested size of every view at the last pack
+
+            // Reused every frame so gathering doesn't allocate
+            LveFrustumCuller frustumCuller;
+            std::vector<uint32_t> visible;
+            std::vector<uint32_t> staticCasters;
+            std::vector<uint32_t> dynamicCasters;
+            std::vector<uint32_t> casterOrder; // dense indices in instance order
+            std::vector<VkImageCopy> copyRegions;
+
+            // What update left for the rest of the frame
+            struct PreparedFrame {
+                bool valid = false;
+                VkDescriptorSet casterSet = VK_NULL_HANDLE;
+                uint32_t casterOffset = 0; // dynamic offset of the caster matrices
+                VkDescriptorSet samplingSet = VK_NULL_HANDLE;
+                uint32_t samplingOffset = 0;
+            };
+            PreparedFrame prepared;
+            Stats stats{};
+    };
+}
@@ -0,0 +1,179 @@
+#include "lve_shared_frame_ring.hpp"
+
+//posix
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//std
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace lve {
+    namespace {
+        uint64_t alignUp(uint64_t value, uint64_t alignment) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    // *************** Writer *********************
+
+    LveSharedFrameWriter::LveSharedFrameWriter(const std::string &name, uint32_t slotCount, uint64_t maxFrameBytes) : name{name} {
+        if (slotCount < 2) {
+            throw std::runtime_error("shared frame ring needs at least 2 slots!");
+        }
+        uint64_t slotStride = alignUp(LveSharedFrameLayout::SLOT_HEADER_SIZE + maxFrameBytes, 64);
+        mappedSize = LveSharedFrameLayout::HEADER_SIZE + slotStride * slotCount;
+
+        // A ring left behind by a server that crashed would have stale readers' expectations, start over
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("failed to create shared memory for frames!");
+        }
+        if (ftruncate(fd, static_cast<off_t>(mappedSize)) != 0) {
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::runtime_error("failed to size shared memory for frames!");
+        }
+        void *memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd); // The mapping keeps it alive
+        if (memory == MAP_FAILED) {
+            shm_unlink(name.c_str());
+            throw std::runtime_error("failed to map shared memory for frames!");
+        }
+        mapped = static_cast<uint8_t *>(memory);
+
+        // Fresh shared memory is zeroed, so every slot starts out as never written (sequence 0)
+        header = new (mapped) LveSharedFrameLayout::Header{};
+        header->magic = LveSharedFrameLayout::MAGIC;
+        header->version = LveSharedFrameLayout::VERSION;
+        header->slotCount = slotCount;
+        header->slotStride = slotStride;
+        header->maxFrameBytes = maxFrameBytes;
+        for (uint32_t slot = 0; slot < slotCount; slot++) {
+            new (mapped + LveSharedFrameLayout::HEADER_SIZE + slotStride * slot) LveSharedFrameLayout::SlotHeader{};
+        }
+        header->latestFrame.store(0, std::memory_order_release);
+    }
+
+    LveSharedFrameWriter::~LveSharedFrameWriter() {
+        header->closed.store(1, std::memory_order_release);
+        munmap(mapped, mappedSize);
+        shm_unlink(name.c_str());
+    }
+
+    bool LveSharedFrameWriter::write(const void *pixels, uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t format, uint64_t tag,
+                                     const LveSharedFrameLayout::ClientSequence *clients, uint32_t clientCount) {
+        uint64_t size = static_cast<uint64_t>(rowPitch) * height;
+        if (size > header->maxFrameBytes) {
+            return false;
+        }
+        uint64_t frame = ++frameNumber;
+        uint8_t *slotStart = mapped + LveSharedFrameLayout::HEADER_SIZE + header->slotStride * (frame % header->slotCount);
+        auto *slotHeader = reinterpret_cast<LveSharedFrameLayout::SlotHeader *>(slotStart);
+
+        // Odd before any pixel changes, so readers of the previous frame in this slot see it was lapped
+        slotHeader->sequence.store(2 * frame - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::memcpy(slotStart + LveSharedFrameLayout::SLOT_HEADER_SIZE, pixels, size);
+        slotHeader->frameNumber = frame;
+        slotHeader->tag = tag;
+        slotHeader->width = width;
+        slotHeader->height = height;
+        slotHeader->rowPitch = rowPitch;
+        slotHeader->format = format;
+        for (uint32_t i = 0; i < LveSharedFrameLayout::MAX_CLIENTS; i++) {
+            slotHeader->clients[i] = i < clientCount ? clients[i] : LveSharedFrameLayout::ClientSequence{0, 0};
+        }
+
+        slotHeader->sequence.store(2 * frame, std::memory_order_release);
+        header->latestFrame.store(frame, std::memory_order_release);
+        return true;
+    }
+
+    // *************** Reader *********************
+
+    LveSharedFrameReader::LveSharedFrameReader(const std::string &name) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            throw std::runtime_error("failed to open shared memory for frames!");
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < LveSharedFrameLayout::HEADER_SIZE) {
+            close(fd);
+            throw std::runtime_error("shared memory for frames is not set up!");
+        }
+        mappedSize = static_cast<uint64_t>(info.st_size);
+        void *memory = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED) {
+            throw std::runtime_error("failed to map shared memory for frames!");
+        }
+        mapped = static_cast<const uint8_t *>(memory);
+        header = reinterpret_cast<const LveSharedFrameLayout::Header *>(mapped);
+
+        if (header->magic != LveSharedFrameLayout::MAGIC || header->version != LveSharedFrameLayout::VERSION ||
+            header->slotCount == 0 ||
+            LveSharedFrameLayout::HEADER_SIZE + header->slotStride * header->slotCount > mappedSize) {
+            munmap(const_cast<uint8_t *>(mapped), mappedSize);
+            throw std::runtime_error("shared memory is not a frame ring!");
+        }
+    }
+
+    LveSharedFrameReader::~LveSharedFrameReader() {
+        munmap(const_cast<uint8_t *>(mapped), mappedSize);
+    }
+
+    const LveSharedFrameLayout::SlotHeader *LveSharedFrameReader::getSlotHeader(uint32_t slot) const {
+        return reinterpret_cast<const LveSharedFrameLayout::SlotHeader *>(
+            mapped + LveSharedFrameLayout::HEADER_SIZE + header->slotStride * slot);
+    }
+
+    bool LveSharedFrameReader::acquireLatest(FrameView &view) {
+        uint64_t latest = header->latestFrame.load(std::memory_order_acquire);
+        if (latest == 0 || latest == lastFrame) {
+            return false;
+        }
+        uint32_t slot = static_cast<uint32_t>(latest % header->slotCount);
+        auto *slotHeader = getSlotHeader(slot);
+        uint64_t sequence = slotHeader->sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * latest) {
+            return false; // already being overwritten, a newer one is on its way
+        }
+
+        view.pixels = reinterpret_cast<const uint8_t *>(slotHeader) + LveSharedFrameLayout::SLOT_HEADER_SIZE;
+        view.frameNumber = slotHeader->frameNumber;
+        view.tag = slotHeader->tag;
+        view.width = slotHeader->width;
+        view.height = slotHeader->height;
+        view.rowPitch = slotHeader->rowPitch;
+        view.format = slotHeader->format;
+        view.sequence = sequence;
+        view.slot = slot;
+
+        if (lastFrame != 0) {
+            skippedFrames += latest - lastFrame - 1;
+        }
+        lastFrame = latest;
+        // The fields above are only trustworthy if the sequence still matches after reading them
+        return validate(view);
+    }
+
+    uint64_t LveSharedFrameReader::getClientSequence(const FrameView &view, uint64_t clientId) const {
+        for (auto &client : getSlotHeader(view.slot)->clients) {
+            if (client.clientId == clientId) {
+                return client.sequence;
+            }
+        }
+        return 0;
+    }
+
+    bool LveSharedFrameReader::validate(const FrameView &view) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return getSlotHeader(view.slot)->sequence.load(std::memory_order_relaxed) == view.sequence;
+    }
+}
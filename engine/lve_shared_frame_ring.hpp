@@ -0,0 +1,129 @@
+#pragma once
+
+//std
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace lve {
+    // A ring of frames in POSIX shared memory, written by one process and read in place by any number of others
+    // Frames are numbered from 1, each goes to slot number % slotCount and the header holds the newest number
+    //
+    // Every slot is a seqlock: its sequence is odd while the writer fills it and 2 * frame number once done
+    // A reader looks at the pixels where they are, then checks the sequence didn't move (LveSharedFrameReader::validate),
+    // a frame the writer lapped while it was being read is simply dropped, the writer never waits for readers
+    // A writer that goes away (or makes a bigger ring under the same name) marks its ring closed first,
+    // readers then open the name again
+    //
+    // Layout: Header, then slotCount slots of slotStride bytes, each a SlotHeader followed by the pixels
+    struct LveSharedFrameLayout {
+        static constexpr uint32_t MAGIC = 0x4c564546; // "LVEF"
+        static constexpr uint32_t VERSION = 2;
+        // Render server clients a frame can report sequences for
+        static constexpr uint32_t MAX_CLIENTS = 8;
+
+        struct ClientSequence {
+            uint64_t clientId; // 0 for an unused entry
+            uint64_t sequence; // newest of that client's updates the frame shows, see LveSceneMessage
+        };
+
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t slotCount;
+            std::atomic<uint32_t> closed; // 1 once the writer is gone, a newer ring may have the name by then
+            uint64_t slotStride; // bytes, a multiple of 64 so every slot starts on its own cache line
+            uint64_t maxFrameBytes;
+            std::atomic<uint64_t> latestFrame; // 0 until the first frame is written
+        };
+
+        struct SlotHeader {
+            std::atomic<uint64_t> sequence;
+            uint64_t frameNumber;
+            uint64_t tag; // whatever the writer passed, eg. the render server's poll number
+            uint32_t width;
+            uint32_t height;
+            uint32_t rowPitch;
+            uint32_t format; // VkFormat, 8 bit RGBA or BGRA
+            // Sequences are per client, a single number from all of them wouldn't tell a client its update is on screen
+            ClientSequence clients[MAX_CLIENTS];
+        };
+
+        static constexpr uint64_t HEADER_SIZE = 64;
+        static constexpr uint64_t SLOT_HEADER_SIZE = 192;
+        static_assert(sizeof(Header) <= HEADER_SIZE, "Header has to fit its cache line");
+        static_assert(sizeof(SlotHeader) <= SLOT_HEADER_SIZE, "SlotHeader has to fit its cache lines");
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared atomics can't use a lock");
+    };
+
+    class LveSharedFrameWriter {
+        public:
+            // Creates (or replaces) the shared memory object, name starts with a slash, eg. "/lve_frames"
+            LveSharedFrameWriter(const std::string &name, uint32_t slotCount, uint64_t maxFrameBytes);
+            // Marks the ring closed and unlinks the name, readers that have it mapped keep their mapping
+            ~LveSharedFrameWriter();
+
+            LveSharedFrameWriter(const LveSharedFrameWriter &) = delete;
+            LveSharedFrameWriter &operator=(const LveSharedFrameWriter &) = delete;
+
+            // Copies the frame into the next slot, false when it is bigger than maxFrameBytes
+            // Up to MAX_CLIENTS client sequences go with it, the rest are dropped
+            bool write(const void *pixels, uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t format, uint64_t tag,
+                       const LveSharedFrameLayout::ClientSequence *clients = nullptr, uint32_t clientCount = 0);
+            uint64_t getLatestFrame() const { return frameNumber; }
+            uint64_t getMaxFrameBytes() const { return header->maxFrameBytes; }
+
+        private:
+            std::string name;
+            LveSharedFrameLayout::Header *header = nullptr;
+            uint8_t *mapped = nullptr;
+            uint64_t mappedSize = 0;
+            uint64_t frameNumber = 0;
+    };
+
+    class LveSharedFrameReader {
+        public:
+            // A frame still in shared memory, valid until the writer laps it
+            struct FrameView {
+                const uint8_t *pixels = nullptr;
+                uint64_t frameNumber = 0;
+                uint64_t tag = 0;
+                uint32_t width = 0;
+                uint32_t height = 0;
+                uint32_t rowPitch = 0;
+                uint32_t format = 0;
+                uint64_t sequence = 0; // what validate compares against
+                uint32_t slot = 0;
+            };
+
+            // Throws when it doesn't exist (yet) or isn't a frame ring
+            explicit LveSharedFrameReader(const std::string &name);
+            ~LveSharedFrameReader();
+
+            LveSharedFrameReader(const LveSharedFrameReader &) = delete;
+            LveSharedFrameReader &operator=(const LveSharedFrameReader &) = delete;
+
+            // The newest frame if it is newer than the last one returned, never waits
+            bool acquireLatest(FrameView &view);
+            // True if the writer hasn't touched the frame since acquireLatest, call it after reading the pixels
+            // Whatever was read from a frame that fails it has to be thrown away
+            bool validate(const FrameView &view) const;
+            // Newest update of the client the frame shows, 0 if none, trustworthy only if validate passes afterwards
+            uint64_t getClientSequence(const FrameView &view, uint64_t clientId) const;
+            // Size of a slot's pixels, a frame whose rowPitch * height claims more is corrupt
+            uint64_t getMaxFrameBytes() const { return header->maxFrameBytes; }
+            // The writer is gone, no more frames come through this ring, open the name again for its replacement
+            bool isClosed() const { return header->closed.load(std::memory_order_acquire) != 0; }
+            // Frames the writer produced that were never returned, because newer ones came first
+            uint64_t getSkippedFrames() const { return skippedFrames; }
+
+        private:
+            const LveSharedFrameLayout::SlotHeader *getSlotHeader(uint32_t slot) const;
+
+            const LveSharedFrameLayout::Header *header = nullptr;
+            const uint8_t *mapped = nullptr;
+            uint64_t mappedSize = 0;
+            uint64_t lastFrame = 0;
+            uint64_t skippedFrames = 0;
+    };
+}
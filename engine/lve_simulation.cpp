@@ -0,0 +1,197 @@
+#include "lve_simulation.hpp"
+
+// Libs
+#include <glm/gtc/constants.hpp>
+
+//std
+#include <algorithm>
+#include <cassert>
+
+namespace lve {
+
+    namespace {
+        // Angles are kept in [0, 2pi), blend the short way round instead of spinning back across the wrap
+        glm::vec3 blendAngles(const glm::vec3 &from, const glm::vec3 &to, float alpha) {
+            glm::vec3 delta = to - from;
+            for (int i = 0; i < 3; i++) {
+                if (delta[i] > glm::pi<float>()) {
+                    delta[i] -= glm::two_pi<float>();
+                } else if (delta[i] < -glm::pi<float>()) {
+                    delta[i] += glm::two_pi<float>();
+                }
+            }
+            return from + delta * alpha;
+        }
+    }
+
+    LveSimulation::LveSimulation(double stepSeconds)
+        : stepSeconds{stepSeconds},
+          stepDuration{std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(stepSeconds))} {
+        startTime = clock::now();
+        lastStepTime = startTime;
+        nextStepTime = startTime + stepDuration;
+    }
+
+    LveSimulation::~LveSimulation() {
+        stop();
+    }
+
+    void LveSimulation::start() {
+        if (isRunning()) {
+            return;
+        }
+        running = true;
+        thread = std::thread(&LveSimulation::threadLoop, this);
+    }
+
+    void LveSimulation::stop() {
+        running = false;
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    void LveSimulation::update() {
+        assert(!isRunning() && "The simulation thread is already running the steps");
+        runDueSteps(clock::now());
+    }
+
+    void LveSimulation::threadLoop() {
+        while (running) {
+            std::this_thread::sleep_until(runDueSteps(clock::now()));
+        }
+    }
+
+    LveSimulation::clock::time_point LveSimulation::runDueSteps(clock::time_point now) {
+        uint32_t steps = 0;
+        while (nextStepTime <= now && steps < MAX_STEPS_PER_UPDATE) {
+            applyPendingChanges();
+            step();
+            lastStepTime = nextStepTime;
+            nextStepTime += stepDuration;
+            steps++;
+        }
+        if (steps > 0) {
+            publish();
+        }
+        // Too far behind, drop the backlog and carry on from now
+        if (nextStepTime <= now) {
+            nextStepTime = now + stepDuration;
+        }
+        return nextStepTime;
+    }
+
+    void LveSimulation::addSpinningObject(LveRegistry::entity_t entity, const TransformComponent &transform, const glm::vec3 &angularVelocity) {
+        std::lock_guard<std::mutex> lock{pendingMutex};
+        pendingChanges.push_back({entity, false, transform, angularVelocity});
+    }
+
+    void LveSimulation::removeObject(LveRegistry::entity_t entity) {
+        std::lock_guard<std::mutex> lock{pendingMutex};
+        pendingChanges.push_back({entity, true, TransformComponent{}, glm::vec3{0.f}});
+    }
+
+    void LveSimulation::applyPendingChanges() {
+        std::vector<PendingChange> changes;
+        {
+            std::lock_guard<std::mutex> lock{pendingMutex};
+            changes.swap(pendingChanges);
+        }
+        for (auto &change : changes) {
+            uint32_t index = indexOf(change.entity);
+            if (change.remove) {
+                if (index != LveRegistry::INVALID_INDEX) {
+                    // Swap and pop, order doesn't matter here
+                    entities[index] = entities.back();
+                    previous[index] = previous.back();
+                    current[index] = current.back();
+                    angularVelocities[index] = angularVelocities.back();
+                    slotIndices[LveHandle::slotOf(entities[index])] = index;
+                    slotIndices[LveHandle::slotOf(change.entity)] = LveRegistry::INVALID_INDEX;
+                    entities.pop_back();
+                    previous.pop_back();
+                    current.pop_back();
+                    angularVelocities.pop_back();
+                }
+            } else if (index != LveRegistry::INVALID_INDEX) {
+                previous[index] = current[index] = change.transform;
+                angularVelocities[index] = change.angularVelocity;
+            } else {
+                uint32_t slot = LveHandle::slotOf(change.entity);
+                if (slot >= slotIndices.size()) {
+                    slotIndices.resize(slot + 1, LveRegistry::INVALID_INDEX);
+                }
+                slotIndices[slot] = static_cast<uint32_t>(entities.size());
+                entities.push_back(change.entity);
+                previous.push_back(change.transform);
+                current.push_back(change.transform);
+                angularVelocities.push_back(change.angularVelocity);
+            }
+        }
+    }
+
+    uint32_t LveSimulation::indexOf(LveRegistry::entity_t entity) const {
+        uint32_t slot = LveHandle::slotOf(entity);
+        if (slot >= slotIndices.size()) {
+            return LveRegistry::INVALID_INDEX;
+        }
+        uint32_t index = slotIndices[slot];
+        return index < entities.size() && entities[index] == entity ? index : LveRegistry::INVALID_INDEX;
+    }
+
+    // The animation that used to run once per rendered frame, now in radians per second
+    void LveSimulation::step() {
+        float dt = static_cast<float>(stepSeconds);
+        previous = current;
+        for (size_t i = 0; i < current.size(); i++) {
+            current[i].rotation = glm::mod(current[i].rotation + angularVelocities[i] * dt, glm::two_pi<float>());
+        }
+        stepCount++;
+    }
+
+    void LveSimulation::publish() {
+        Snapshot &snapshot = snapshots[back];
+        snapshot.step = stepCount;
+        snapshot.time = secondsSinceStart(lastStepTime);
+        snapshot.entities = entities;
+        snapshot.previous = previous;
+        snapshot.current = current;
+        // Hand the written buffer over and take whichever one was in the middle, read or not
+        back = middle.exchange(back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    uint64_t LveSimulation::applySnapshot(LveRegistry &registry) {
+        if (middle.load(std::memory_order_acquire) & FRESH_BIT) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+        const Snapshot &snapshot = snapshots[front];
+        if (snapshot.step == 0) {
+            return 0;
+        }
+        uint64_t stepsSinceLastApply = snapshot.step - lastAppliedStep;
+        lastAppliedStep = snapshot.step;
+
+        // Drawing one step behind: now - step lands between the previous and current transforms
+        float alpha = static_cast<float>((secondsSinceStart(clock::now()) - snapshot.time) / stepSeconds);
+        alpha = std::clamp(alpha, 0.f, 1.f);
+
+        for (size_t i = 0; i < snapshot.entities.size(); i++) {
+            uint32_t index = registry.indexOf(snapshot.entities[i]);
+            if (index == LveRegistry::INVALID_INDEX) {
+                continue;
+            }
+            const TransformComponent &from = snapshot.previous[i];
+            const TransformComponent &to = snapshot.current[i];
+            TransformComponent blended{};
+            blended.translation = glm::mix(from.translation, to.translation, alpha);
+            blended.scale = glm::mix(from.scale, to.scale, alpha);
+            blended.rotation = blendAngles(from.rotation, to.rotation, alpha);
+            registry.setTransform(index, blended);
+        }
+        return stepsSinceLastApply;
+    }
+
+    double LveSimulation::secondsSinceStart(clock::time_point time) const {
+        return std::chrono::duration<double>(time - startTime).count();
+    }
+}
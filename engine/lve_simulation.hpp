@@ -0,0 +1,115 @@
+#pragma once
+
+#include "lve_registry.hpp"
+#include "lve_transform_component.hpp"
+
+// Libs
+#include <glm/glm.hpp>
+
+//std
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lve {
+    // Fixed timestep simulation, so objects move at the same speed whatever the frame rate
+    //
+    // The simulation owns its own copy of the transforms it animates and can run on its own thread
+    // After every step it publishes a snapshot holding the previous and the current step's transforms
+    // Snapshots go through a triple buffer: the simulation always has a buffer to write and the renderer
+    // always has one to read, so neither ever waits for the other
+    //
+    // The renderer draws one step behind and blends the two transforms of the newest snapshot,
+    // so motion stays smooth when the frame rate and the step rate don't line up
+    class LveSimulation {
+        public:
+            using clock = std::chrono::steady_clock;
+            static constexpr double DEFAULT_STEP_SECONDS = 1.0 / 60.0;
+            // After a long stall don't try to catch up on every missed step, it would only fall further behind
+            static constexpr uint32_t MAX_STEPS_PER_UPDATE = 5;
+
+            explicit LveSimulation(double stepSeconds = DEFAULT_STEP_SECONDS);
+            ~LveSimulation();
+
+            LveSimulation(const LveSimulation &) = delete;
+            LveSimulation &operator=(const LveSimulation &) = delete;
+
+            // Runs the steps on a thread of its own until stop or destruction
+            void start();
+            void stop();
+            bool isRunning() const { return thread.joinable(); }
+            // Without the thread, call this regularly (eg. once per frame) to run the steps that are due
+            void update();
+
+            // Queued, the simulation picks them up at the start of its next step
+            void addSpinningObject(LveRegistry::entity_t entity, const TransformComponent &transform, const glm::vec3 &angularVelocity);
+            void removeObject(LveRegistry::entity_t entity);
+
+            // Writes the blended transforms of the newest snapshot into the registry, objects it doesn't know are skipped
+            // Returns how many steps were simulated since the previous call
+            uint64_t applySnapshot(LveRegistry &registry);
+
+            double getStepSeconds() const { return stepSeconds; }
+
+        private:
+            struct Snapshot {
+                uint64_t step = 0; // 0 until the first step has been published
+                double time = 0.0; // seconds since start of the current transforms
+                std::vector<LveRegistry::entity_t> entities;
+                std::vector<TransformComponent> previous;
+                std::vector<TransformComponent> current;
+            };
+
+            struct PendingChange {
+                LveRegistry::entity_t entity;
+                bool remove;
+                TransformComponent transform;
+                glm::vec3 angularVelocity;
+            };
+
+            void threadLoop();
+            // Runs every step that is due at now, returns the time the next one is due
+            clock::time_point runDueSteps(clock::time_point now);
+            void applyPendingChanges();
+            // Index of the entity in entities, INVALID_INDEX if the simulation doesn't have it
+            uint32_t indexOf(LveRegistry::entity_t entity) const;
+            void step();
+            void publish();
+            double secondsSinceStart(clock::time_point time) const;
+
+            const double stepSeconds;
+            const clock::duration stepDuration;
+            clock::time_point startTime;
+            clock::time_point nextStepTime;
+            clock::time_point lastStepTime; // when the current transforms were due
+
+            // Only touched by whoever runs the steps
+            uint64_t stepCount = 0;
+            std::vector<LveRegistry::entity_t> entities;
+            std::vector<TransformComponent> previous;
+            std::vector<TransformComponent> current;
+            std::vector<glm::vec3> angularVelocities;
+            // Entity slot -> index into the arrays above, sparse like the registry's own index
+            // A reused slot still points at the old entity's index, indexOf checks the entity is the same
+            std::vector<uint32_t> slotIndices;
+
+            std::mutex pendingMutex; // held only to queue or take changes, never across a step
+            std::vector<PendingChange> pendingChanges;
+
+            // Triple buffer: the middle index is swapped atomically, FRESH_BIT says it holds an unread snapshot
+            static constexpr uint32_t INDEX_MASK = 3;
+            static constexpr uint32_t FRESH_BIT = 4;
+            std::array<Snapshot, 3> snapshots;
+            std::atomic<uint32_t> middle{1};
+            uint32_t back = 0; // simulation side
+            uint32_t front = 2; // renderer side
+            uint64_t lastAppliedStep = 0;
+
+            std::thread thread;
+            std::atomic<bool> running{false};
+    };
+}
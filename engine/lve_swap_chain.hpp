@@ -12,6 +12,9 @@
 
 namespace lve {
 
+// Without a surface (a headless LveWindow) there is no VkSwapchainKHR, the swap chain owns one offscreen color
+// image per frame in flight instead. Acquiring hands out the frame slot's image once its fence signaled, and
+// submitting doesn't present, whatever wants the frames reads them back (see LveFrameReadback)
 class LveSwapChain {
  public:
   static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
@@ -25,8 +28,22 @@ class LveSwapChain {
 
   VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
   VkRenderPass getRenderPass() { return renderPass; }
+  // Same attachments, but loads what the first pass left instead of clearing, for drawing more into a frame
+  VkRenderPass getLoadRenderPass() { return loadRenderPass; }
+  VkImage getImage(int index) { return swapChainImages[index]; }
   VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+  // Stored and left readable by shaders after each pass, eg. to build a Hi-Z pyramid from
+  VkImage getDepthImage(int index) { return depthImages[index]; }
+  VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
+  VkFormat getSwapChainDepthFormat() { return swapChainDepthFormat; }
+  // Images can be copied from (TRANSFER_SRC usage)
+  bool isReadbackSupported() { return readbackSupported; }
+  // Images can be blitted to, and images of the same format blitted from with linear filtering
+  bool isUpscaleSupported() { return upscaleSupported; }
   size_t imageCount() { return swapChainImages.size(); }
+  bool isOffscreen() { return offscreen; }
+  // Layout frames are left in at the end, PRESENT_SRC_KHR, or TRANSFER_SRC_OPTIMAL for offscreen images
+  VkImageLayout getPresentLayout() { return presentLayout; }
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
   VkExtent2D getSwapChainExtent() { return swapChainExtent; }
   uint32_t width() { return swapChainExtent.width; }
@@ -48,9 +65,11 @@ class LveSwapChain {
  private:
   void init();
   void createSwapChain();
+  void createOffscreenImages();
   void createImageViews();
   void createDepthResources();
   void createRenderPass();
+  VkRenderPass createRenderPass(bool loadContents);
   void createFramebuffers();
   void createSyncObjects();
 
@@ -64,20 +83,26 @@ class LveSwapChain {
   VkFormat swapChainImageFormat;
   VkFormat swapChainDepthFormat;
   VkExtent2D swapChainExtent;
+  bool readbackSupported = false;
+  bool upscaleSupported = false;
+  bool offscreen = false;
+  VkImageLayout presentLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
   std::vector<VkFramebuffer> swapChainFramebuffers;
   VkRenderPass renderPass;
+  VkRenderPass loadRenderPass;
 
   std::vector<VkImage> depthImages;
   std::vector<VkDeviceMemory> depthImageMemorys;
   std::vector<VkImageView> depthImageViews;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
+  std::vector<VkDeviceMemory> offscreenImageMemorys; // offscreen only, swap chain images belong to the swap chain
 
   LveDevice &device;
   VkExtent2D windowExtent;
 
-  VkSwapchainKHR swapChain;
+  VkSwapchainKHR swapChain = VK_NULL_HANDLE;
   std::shared_ptr<LveSwapChain> oldSwapChain;
 
   std::vector<VkSemaphore> imageAvailableSemaphores;
@@ -0,0 +1,283 @@
+#include "lve_transform_batch.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LVE_TRANSFORM_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#define LVE_TRANSFORM_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LVE_TRANSFORM_NEON
+#endif
+
+//std
+#include <cmath>
+
+namespace lve {
+
+    namespace {
+        // Rotation convention is Y(1) X(2) Z(3), so c1/s1 belong to rotation.y, c2/s2 to rotation.x, c3/s3 to rotation.z
+        // Columns of Ry * Rx * Rz:
+        //   (c1c3 + s1s2s3, c2s3, c1s2s3 - c3s1)
+        //   (c3s1s2 - c1s3, c2c3, c1c3s2 + s1s3)
+        //   (c2s1,          -s2,  c1c2)
+        // each then multiplied by the scale along that axis
+
+#if defined(LVE_TRANSFORM_AVX2) || defined(LVE_TRANSFORM_SSE2) || defined(LVE_TRANSFORM_NEON)
+        // sin and cos on the lanes, Cephes' single precision polynomials
+        // The angle is reduced to [-pi/4, pi/4] around the nearest multiple of pi/2 (the quadrant), in three steps
+        // so the subtraction stays exact, then the quadrant decides which polynomial is the sine and the signs
+        // Within a couple of ulps of std::sin/std::cos for angles up to a few thousand radians
+        constexpr float TWO_OVER_PI = 0.636619772367581343f;
+        constexpr float HALF_PI_1 = 1.5703125f; // few enough bits that multiples of it are exact
+        constexpr float HALF_PI_2 = 4.837512969970703125e-4f;
+        constexpr float HALF_PI_3 = 7.54978995489188216e-8f;
+        constexpr float SIN_1 = -1.9515295891e-4f, SIN_2 = 8.3321608736e-3f, SIN_3 = -1.6666654611e-1f;
+        constexpr float COS_1 = 2.443315711809948e-5f, COS_2 = -1.388731625493765e-3f, COS_3 = 4.166664568298827e-2f;
+#endif
+
+        // Each instruction set below provides the same few lane operations, computeBlock and sinCos are written once on top
+#if defined(LVE_TRANSFORM_AVX2)
+        constexpr uint32_t LANES = 8;
+        using Lanes = __m256;
+        using LaneInts = __m256i;
+
+        inline Lanes splat(float value) { return _mm256_set1_ps(value); }
+        inline Lanes add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+        inline Lanes sub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+        inline Lanes mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+        // Lanes of a where mask is set, b elsewhere
+        inline Lanes select(Lanes mask, Lanes a, Lanes b) { return _mm256_blendv_ps(b, a, mask); }
+        inline Lanes negate(Lanes a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.f)); }
+
+        inline LaneInts roundToInt(Lanes a) { return _mm256_cvtps_epi32(a); }
+        inline Lanes toFloat(LaneInts a) { return _mm256_cvtepi32_ps(a); }
+        // All bits set in the lanes where (a + offset) has bit set
+        inline Lanes bitSet(LaneInts a, int32_t offset, int32_t bit) {
+            LaneInts masked = _mm256_and_si256(_mm256_add_epi32(a, _mm256_set1_epi32(offset)), _mm256_set1_epi32(bit));
+            return _mm256_castsi256_ps(_mm256_cmpeq_epi32(masked, _mm256_set1_epi32(bit)));
+        }
+#elif defined(LVE_TRANSFORM_SSE2)
+        constexpr uint32_t LANES = 4;
+        using Lanes = __m128;
+        using LaneInts = __m128i;
+
+        inline Lanes splat(float value) { return _mm_set1_ps(value); }
+        inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+        inline Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+        inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+        inline Lanes select(Lanes mask, Lanes a, Lanes b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        inline Lanes negate(Lanes a) { return _mm_xor_ps(a, _mm_set1_ps(-0.f)); }
+
+        inline LaneInts roundToInt(Lanes a) { return _mm_cvtps_epi32(a); }
+        inline Lanes toFloat(LaneInts a) { return _mm_cvtepi32_ps(a); }
+        inline Lanes bitSet(LaneInts a, int32_t offset, int32_t bit) {
+            LaneInts masked = _mm_and_si128(_mm_add_epi32(a, _mm_set1_epi32(offset)), _mm_set1_epi32(bit));
+            return _mm_castsi128_ps(_mm_cmpeq_epi32(masked, _mm_set1_epi32(bit)));
+        }
+#elif defined(LVE_TRANSFORM_NEON)
+        constexpr uint32_t LANES = 4;
+        using Lanes = float32x4_t;
+        using LaneInts = int32x4_t;
+
+        inline Lanes splat(float value) { return vdupq_n_f32(value); }
+        inline Lanes add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+        inline Lanes sub(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+        inline Lanes mul(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+        inline Lanes select(Lanes mask, Lanes a, Lanes b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+        inline Lanes negate(Lanes a) { return vnegq_f32(a); }
+
+        inline LaneInts roundToInt(Lanes a) {
+#if defined(__aarch64__)
+            return vcvtnq_s32_f32(a);
+#else
+            // Only truncating conversions on 32 bit ARM, push away from zero by a half first
+            Lanes half = vbslq_f32(vcltq_f32(a, vdupq_n_f32(0.f)), vdupq_n_f32(-.5f), vdupq_n_f32(.5f));
+            return vcvtq_s32_f32(vaddq_f32(a, half));
+#endif
+        }
+        inline Lanes toFloat(LaneInts a) { return vcvtq_f32_s32(a); }
+        inline Lanes bitSet(LaneInts a, int32_t offset, int32_t bit) {
+            int32x4_t masked = vandq_s32(vaddq_s32(a, vdupq_n_s32(offset)), vdupq_n_s32(bit));
+            return vreinterpretq_f32_u32(vceqq_s32(masked, vdupq_n_s32(bit)));
+        }
+#endif
+
+#if defined(LVE_TRANSFORM_AVX2) || defined(LVE_TRANSFORM_SSE2)
+        // 4 vec3s are 3 registers of interleaved xyz, shuffled apart into one register per component
+        inline void loadVec3s(const glm::vec3 *v, __m128 &x, __m128 &y, __m128 &z) {
+            const float *f = &v[0].x;
+            __m128 a = _mm_loadu_ps(f); // x0 y0 z0 x1
+            __m128 b = _mm_loadu_ps(f + 4); // y1 z1 x2 y2
+            __m128 c = _mm_loadu_ps(f + 8); // z2 x3 y3 z3
+            x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+            y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+                               _MM_SHUFFLE(2, 0, 2, 0));
+            z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+                               _MM_SHUFFLE(2, 0, 2, 0));
+        }
+
+        // x, y, z, w each hold one row of a column for 4 objects, transposing turns them into that column of each object
+        inline void storeColumn(__m128 x, __m128 y, __m128 z, __m128 w, int column, glm::mat4 *matrices) {
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            _mm_storeu_ps(&matrices[0][column][0], x);
+            _mm_storeu_ps(&matrices[1][column][0], y);
+            _mm_storeu_ps(&matrices[2][column][0], z);
+            _mm_storeu_ps(&matrices[3][column][0], w);
+        }
+#endif
+
+#if defined(LVE_TRANSFORM_AVX2)
+        inline void loadVec3s(const glm::vec3 *v, __m256 &x, __m256 &y, __m256 &z) {
+            __m128 lowX, lowY, lowZ, highX, highY, highZ;
+            loadVec3s(v, lowX, lowY, lowZ);
+            loadVec3s(v + 4, highX, highY, highZ);
+            x = _mm256_insertf128_ps(_mm256_castps128_ps256(lowX), highX, 1);
+            y = _mm256_insertf128_ps(_mm256_castps128_ps256(lowY), highY, 1);
+            z = _mm256_insertf128_ps(_mm256_castps128_ps256(lowZ), highZ, 1);
+        }
+
+        inline void storeColumn(__m256 x, __m256 y, __m256 z, __m256 w, int column, glm::mat4 *matrices) {
+            storeColumn(_mm256_castps256_ps128(x), _mm256_castps256_ps128(y),
+                        _mm256_castps256_ps128(z), _mm256_castps256_ps128(w), column, matrices);
+            storeColumn(_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1),
+                        _mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1), column, matrices + 4);
+        }
+#elif defined(LVE_TRANSFORM_NEON)
+        // vld3q splits interleaved xyz into one register per component by itself
+        inline void loadVec3s(const glm::vec3 *v, float32x4_t &x, float32x4_t &y, float32x4_t &z) {
+            float32x4x3_t components = vld3q_f32(&v[0].x);
+            x = components.val[0];
+            y = components.val[1];
+            z = components.val[2];
+        }
+
+        // vst4q_lane picks one lane out of each of the 4 rows, which is exactly that object's column
+        inline void storeColumn(float32x4_t x, float32x4_t y, float32x4_t z, float32x4_t w, int column, glm::mat4 *matrices) {
+            float32x4x4_t rows = {{x, y, z, w}};
+            vst4q_lane_f32(&matrices[0][column][0], rows, 0);
+            vst4q_lane_f32(&matrices[1][column][0], rows, 1);
+            vst4q_lane_f32(&matrices[2][column][0], rows, 2);
+            vst4q_lane_f32(&matrices[3][column][0], rows, 3);
+        }
+#endif
+
+#if defined(LVE_TRANSFORM_AVX2) || defined(LVE_TRANSFORM_SSE2) || defined(LVE_TRANSFORM_NEON)
+        inline void sinCos(Lanes angle, Lanes &sine, Lanes &cosine) {
+            LaneInts quadrant = roundToInt(mul(angle, splat(TWO_OVER_PI)));
+            Lanes multiple = toFloat(quadrant);
+            Lanes x = sub(sub(sub(angle, mul(multiple, splat(HALF_PI_1))), mul(multiple, splat(HALF_PI_2))), mul(multiple, splat(HALF_PI_3)));
+            Lanes z = mul(x, x);
+
+            Lanes sinPolynomial = add(mul(mul(add(mul(add(mul(splat(SIN_1), z), splat(SIN_2)), z), splat(SIN_3)), z), x), x);
+            Lanes cosPolynomial = add(sub(mul(mul(add(mul(add(mul(splat(COS_1), z), splat(COS_2)), z), splat(COS_3)), z), z),
+                                          mul(splat(.5f), z)),
+                                      splat(1.f));
+
+            // Odd quadrants swap sine and cosine, sine is negative in quadrants 2 and 3, cosine in 1 and 2
+            Lanes swap = bitSet(quadrant, 0, 1);
+            sine = select(swap, cosPolynomial, sinPolynomial);
+            cosine = select(swap, sinPolynomial, cosPolynomial);
+            sine = select(bitSet(quadrant, 0, 2), negate(sine), sine);
+            cosine = select(bitSet(quadrant, 1, 2), negate(cosine), cosine);
+        }
+
+        // LANES objects straight from the component arrays
+        void computeBlock(const glm::vec3 *translations, const glm::vec3 *rotations, const glm::vec3 *scales, glm::mat4 *matrices) {
+            Lanes rx, ry, rz, sx, sy, sz, tx, ty, tz;
+            loadVec3s(rotations, rx, ry, rz);
+            loadVec3s(scales, sx, sy, sz);
+            loadVec3s(translations, tx, ty, tz);
+
+            Lanes c1, s1, c2, s2, c3, s3;
+            sinCos(ry, s1, c1);
+            sinCos(rx, s2, c2);
+            sinCos(rz, s3, c3);
+            Lanes zero = splat(0.f);
+            Lanes one = splat(1.f);
+
+            Lanes s2s3 = mul(s2, s3);
+            Lanes c3s2 = mul(c3, s2);
+
+            storeColumn(mul(sx, add(mul(c1, c3), mul(s1, s2s3))),
+                        mul(sx, mul(c2, s3)),
+                        mul(sx, sub(mul(c1, s2s3), mul(c3, s1))),
+                        zero, 0, matrices);
+            storeColumn(mul(sy, sub(mul(s1, c3s2), mul(c1, s3))),
+                        mul(sy, mul(c2, c3)),
+                        mul(sy, add(mul(c1, c3s2), mul(s1, s3))),
+                        zero, 1, matrices);
+            storeColumn(mul(sz, mul(c2, s1)),
+                        mul(sz, negate(s2)),
+                        mul(sz, mul(c1, c2)),
+                        zero, 2, matrices);
+            storeColumn(tx, ty, tz, one, 3, matrices);
+        }
+#endif
+    }
+
+    void LveTransformBatch::computeMatrices(const glm::vec3 *translations,
+                                            const glm::vec3 *rotations,
+                                            const glm::vec3 *scales,
+                                            uint32_t count,
+                                            glm::mat4 *matrices) {
+        uint32_t i = 0;
+#if defined(LVE_TRANSFORM_AVX2) || defined(LVE_TRANSFORM_SSE2) || defined(LVE_TRANSFORM_NEON)
+        for (; i + LANES <= count; i += LANES) {
+            computeBlock(translations + i, rotations + i, scales + i, matrices + i);
+        }
+#endif
+        computeMatricesScalar(translations + i, rotations + i, scales + i, count - i, matrices + i);
+    }
+
+    void LveTransformBatch::computeMatricesScalar(const glm::vec3 *translations,
+                                                  const glm::vec3 *rotations,
+                                                  const glm::vec3 *scales,
+                                                  uint32_t count,
+                                                  glm::mat4 *matrices) {
+        for (uint32_t i = 0; i < count; i++) {
+            const float c1 = std::cos(rotations[i].y);
+            const float s1 = std::sin(rotations[i].y);
+            const float c2 = std::cos(rotations[i].x);
+            const float s2 = std::sin(rotations[i].x);
+            const float c3 = std::cos(rotations[i].z);
+            const float s3 = std::sin(rotations[i].z);
+            const glm::vec3 &scale = scales[i];
+
+            matrices[i] = glm::mat4{
+                {
+                    scale.x * (c1 * c3 + s1 * (s2 * s3)),
+                    scale.x * (c2 * s3),
+                    scale.x * (c1 * (s2 * s3) - c3 * s1),
+                    0.f,
+                },
+                {
+                    scale.y * (s1 * (c3 * s2) - c1 * s3),
+                    scale.y * (c2 * c3),
+                    scale.y * (c1 * (c3 * s2) + s1 * s3),
+                    0.f,
+                },
+                {
+                    scale.z * (c2 * s1),
+                    scale.z * (-s2),
+                    scale.z * (c1 * c2),
+                    0.f,
+                },
+                {translations[i].x, translations[i].y, translations[i].z, 1.f}};
+        }
+    }
+
+    const char *LveTransformBatch::getBackendName() {
+#if defined(LVE_TRANSFORM_AVX2)
+        return "avx2";
+#elif defined(LVE_TRANSFORM_SSE2)
+        return "sse2";
+#elif defined(LVE_TRANSFORM_NEON)
+        return "neon";
+#else
+        return "scalar";
+#endif
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Libs
+#include <glm/glm.hpp>
+
+//std
+#include <cstdint>
+
+namespace lve {
+    // Builds model matrices for whole arrays of objects at once
+    // Same result as TransformComponent::mat4 (translate * Ry * Rx * Rz * scale), but written out in closed form
+    // instead of a translate, three rotates and a scale, which are each a full 4x4 multiply
+    //
+    // Inputs are the registry's component arrays, several objects go through the SIMD lanes together:
+    // each block loads its lanes straight from the arrays and takes sin and cos with a polynomial on the lanes
+    // The instruction set is picked at compile time: AVX2 (build with -mavx2), SSE2, NEON, or plain scalar
+    //
+    // Not bit for bit the same as mat4, GLM's chain of multiplies rounds differently, within a few ulps
+    // of each column's scale (checked by --benchmark-transforms)
+    struct LveTransformBatch {
+        static void computeMatrices(const glm::vec3 *translations,
+                                    const glm::vec3 *rotations,
+                                    const glm::vec3 *scales,
+                                    uint32_t count,
+                                    glm::mat4 *matrices);
+
+        // Always available, used for the leftover objects that don't fill a whole SIMD block
+        static void computeMatricesScalar(const glm::vec3 *translations,
+                                          const glm::vec3 *rotations,
+                                          const glm::vec3 *scales,
+                                          uint32_t count,
+                                          glm::mat4 *matrices);
+
+        // Name of the instruction set computeMatrices was compiled for, eg. for the profiler
+        static const char *getBackendName();
+    };
+}
@@ -1,14 +1,10 @@
 #pragma once
 
-#include "lve_model.hpp"
-
 // Libs
 #include <glm/gtc/matrix_transform.hpp>
 
-//std lib
-#include <memory>
-
 namespace lve {
+    // One object's position, scale and rotation, how LveRegistry hands out and takes a whole transform at once
     struct TransformComponent { // structs can have functions in c++
         glm::vec3 translation{}; // (position offest)
         glm::vec3 scale{1.f, 1.f, 1.f}; // (scale coefficient)
@@ -30,33 +26,10 @@ namespace lve {
             transform = glm::scale(transform, scale); // transform * scale
             return transform;
         }
-    };
-
-    class LveGameObject {
-        public:
-        using id_t = unsigned int;
-
-        static LveGameObject createGameObject() {
-            static id_t currentId = 0;
-            return LveGameObject{currentId++}; // incrementing ID every time it is created
-        };
-
-        LveGameObject(const LveGameObject &) = delete;
-        LveGameObject &operator=(const LveGameObject &) = delete;
-        LveGameObject(LveGameObject &&) = default; // For move to work correclty // using rvalue reference
-        LveGameObject &operator=(LveGameObject &&) = default; // rvalue reference can be bound to a temporary
 
-        const id_t getId() { return id; }
-
-        std::shared_ptr<LveModel> model{};
-        glm::vec3 color{1.f, 1.f, 1.f};
-        TransformComponent transform{};
-
-        private:
-        LveGameObject(id_t objId) : id{objId} {}
-
-        id_t id;
-
-        
+        // Normals need the inverse transpose, otherwise non uniform scale bends them off the surface
+        glm::mat3 normalMatrix() {
+            return glm::transpose(glm::inverse(glm::mat3{mat4()}));
+        }
     };
-} // namespace lve
\ No newline at end of file
+} // namespace lve
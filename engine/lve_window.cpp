@@ -1,14 +1,21 @@
 #include "lve_window.hpp"
 
+#include <cassert>
 #include <stdexcept>
 
 namespace lve {
     // Learning: things that go after colon are argument intializations
-    LveWindow::LveWindow(int w, int h, std::string name) : width{w}, height{h}, windowName{name} {
-        initWindow();
+    LveWindow::LveWindow(int w, int h, std::string name, bool headless) : width{w}, height{h}, headless{headless}, windowName{name} {
+        // GLFW would need a display even for a hidden window
+        if (!headless) {
+            initWindow();
+        }
     }
 
     LveWindow::~LveWindow() {
+        if (headless) {
+            return;
+        }
         glfwDestroyWindow(window);
         glfwTerminate();
     }
@@ -27,11 +34,21 @@ namespace lve {
     }
 
     void LveWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface){
+        if (headless) {
+            throw std::runtime_error("a headless window has no surface");
+        }
         if (glfwCreateWindowSurface(instance, window, nullptr, surface) != VK_SUCCESS){
             throw std::runtime_error("failed to create window surface");
         }
     }
 
+    void LveWindow::setExtent(VkExtent2D extent) {
+        assert(headless && "Only a headless window can be resized by the app");
+        width = static_cast<int>(extent.width);
+        height = static_cast<int>(extent.height);
+        framebufferResized = true;
+    }
+
     void LveWindow::framebufferResizedCallback(GLFWwindow *window, int width, int height) {
         auto lveWindow = reinterpret_cast<LveWindow *>(glfwGetWindowUserPointer(window));
         lveWindow->framebufferResized = true;
@@ -9,14 +9,17 @@ namespace lve {
 
     class LveWindow {
         public:
-            LveWindow(int w, int h, std::string name);
+            // A headless window is only a size, there is no GLFW window or surface and frames are drawn
+            // into offscreen images instead of a swap chain (see LveSwapChain), eg. on a server without a display
+            LveWindow(int w, int h, std::string name, bool headless = false);
             ~LveWindow();
 
             // Ensures that no copy of LveWindow isn't accidentally created
             LveWindow(const LveWindow &) = delete;
             LveWindow &operator=(const LveWindow &) = delete;
 
-            bool shouldClose() {return glfwWindowShouldClose(window);}
+            bool shouldClose() {return !headless && glfwWindowShouldClose(window);}
+            bool isHeadless() const { return headless; }
 
             VkExtent2D getExtent() { return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};}
 
@@ -24,6 +27,9 @@ namespace lve {
 
             bool wasWindowResized() { return framebufferResized; }
             void resetWindowResizedFlag() { framebufferResized = false; }
+            // Headless only, a real window's size is whatever the user makes it
+            // Reported like a resize, so the swap chain is recreated at the end of the next frame
+            void setExtent(VkExtent2D extent);
 
         private:
             static void framebufferResizedCallback(GLFWwindow *winddow, int width, int height);
@@ -32,8 +38,9 @@ namespace lve {
             int width; // Is resizeable
             int height; // Is resizable
             bool framebufferResized = false;
+            bool headless;
 
             std::string windowName;
-            GLFWwindow *window;
+            GLFWwindow *window = nullptr; // stays null when headless
     };
 }
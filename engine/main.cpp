@@ -1,13 +1,75 @@
 #include "first_app.hpp"
+#include "lve_cpu_benchmark.hpp"
 
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
-int main() {
-    lve::FirstApp app{};
+// Usage: a.out [--server [socket path] [shared memory name]]
+//        a.out --benchmark-prepass [frames per mode]
+//        a.out --benchmark-lights [frames per mode]
+//        a.out --benchmark-occlusion [frames per mode]
+//        a.out --benchmark-readback [frames per mode]
+//        a.out --benchmark-registry [entities]
+//        a.out --benchmark-transforms [objects]
+//        a.out --benchmark-hierarchy [nodes]
+//        a.out --benchmark-bvh [max objects]
+//        a.out --benchmark-churn [operations]
+int main(int argc, char **argv) {
+    // CPU benchmarks need no window or GPU, they run instead of the app
+    std::string mode = argc > 1 ? argv[1] : "";
+    auto countArgument = [&](uint32_t defaultCount) {
+        return argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : defaultCount;
+    };
+    if (mode == "--benchmark-registry") {
+        return lve::benchmarkRegistry(countArgument(1000000)) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (mode == "--benchmark-transforms") {
+        return lve::benchmarkTransforms(countArgument(2000000)) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (mode == "--benchmark-hierarchy") {
+        return lve::benchmarkHierarchy(countArgument(100000)) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (mode == "--benchmark-bvh") {
+        return lve::benchmarkBvh(countArgument(1000000)) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (mode == "--benchmark-churn") {
+        return lve::benchmarkChurn(countArgument(4000000)) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    lve::LveRenderServer::Options serverOptions{};
+    std::string benchmark;
+    uint32_t benchmarkFrames = 300;
+    if (mode == "--benchmark-prepass" || mode == "--benchmark-lights" || mode == "--benchmark-occlusion" ||
+        mode == "--benchmark-readback") {
+        benchmark = argv[1];
+        if (argc > 2) {
+            benchmarkFrames = static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10));
+        }
+    } else if (argc > 1 && std::string{argv[1]} == "--server") {
+        serverOptions.enabled = true;
+        if (argc > 2) {
+            serverOptions.socketPath = argv[2];
+        }
+        if (argc > 3) {
+            serverOptions.frameRingName = argv[3];
+        }
+    }
+
+    // Reading frames back is measured offscreen, at sizes no window has to fit on the screen
+    lve::FirstApp app{serverOptions, benchmark == "--benchmark-readback"};
 
     try {
+        if (benchmark == "--benchmark-prepass") {
+            app.benchmarkDepthPrepass(benchmarkFrames);
+        } else if (benchmark == "--benchmark-lights") {
+            app.benchmarkLights(benchmarkFrames);
+        } else if (benchmark == "--benchmark-occlusion") {
+            app.benchmarkOcclusionCulling(benchmarkFrames);
+        } else if (benchmark == "--benchmark-readback") {
+            app.benchmarkReadback(benchmarkFrames);
+        }
         app.run();
     } catch (const std::exception &e) {
         std::cerr << e.what() << '\n';
@@ -0,0 +1,27 @@
+//VERTEX SHADER
+#version 450
+
+// Depth pre pass, only the position stream is bound and there is no fragment shader
+// The math has to stay the same as simple_shader.vert, the color pass tests EQUAL against this depth
+layout(location = 0) in vec3 position;
+
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform FrameUbo {
+    mat4 projectionView;
+} frame;
+
+// Has to match simple_shader.vert, the pre pass reads the same array
+struct ObjectData {
+    mat4 transform;
+    mat4 normalMatrix;
+    vec4 color;
+};
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
+
+void main() {
+    ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+    gl_Position = frame.projectionView * object.transform * vec4(position, 1.0);
+}
@@ -0,0 +1,47 @@
+//VERTEX SHADER
+#version 450
+
+// Vertex shader for the GPU driven path
+// Per object data isn't in vertex attributes, it is looked up through the
+// visible list the culling compute pass wrote for this frame
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+
+layout(location = 0) out vec3 fragColor;
+
+struct ObjectData {
+    mat4 transform;
+    vec4 color;
+    vec4 boundingSphere;
+    uint drawIndex;
+    uint instanceBase;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer VisibleBuffer {
+    uint visibleObjects[];
+};
+
+layout(std430, set = 0, binding = 5) readonly buffer CameraBuffer {
+    mat4 projectionView;
+    vec4 frustumPlanes[6];
+} camera;
+
+layout(push_constant) uniform Push {
+    uint objectCount;
+    uint modelCount;
+    uint instanceBase; // only used when the device can't offset instances through firstInstance
+    uint phase;
+    uint pyramidWidth;
+    uint pyramidHeight;
+} push;
+
+void main() {
+    // gl_InstanceIndex already includes the firstInstance of the indirect command
+    ObjectData object = objects[visibleObjects[push.instanceBase + gl_InstanceIndex]];
+    gl_Position = camera.projectionView * object.transform * vec4(position, 1.0);
+    fragColor = color * object.color.rgb;
+}
@@ -0,0 +1,190 @@
+#version 450
+
+// simple_shader.frag with clustered point lights: the fragment finds its cluster from its screen
+// position and view depth and only loops over the lights binned into it by light_cull.comp
+// On top of those a sun and a few spot and point lights cast shadows, from the tiles of LveShadowMaps' atlas
+// The material comes out of LveBindlessHeap's storage buffers, picked by the index SimpleRenderSystem pushes
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragWorldPosition;
+layout(location = 2) in vec3 fragNormal;
+
+layout(location = 0) out vec4 outColor;
+
+// Has to match LveClusteredLights
+const uint CLUSTER_X = 16;
+const uint CLUSTER_Y = 9;
+const uint CLUSTER_Z = 24;
+const uint MAX_LIGHTS_PER_CLUSTER = 127;
+const uint CLUSTER_STRIDE = MAX_LIGHTS_PER_CLUSTER + 1;
+
+struct PointLight {
+    vec4 positionRadius;
+    vec4 color;
+};
+
+layout(set = 1, binding = 0) uniform ClusterUbo {
+    mat4 view;
+    vec4 cameraPosition;
+    vec4 ambient;
+    vec2 projectionScale;
+    vec2 screenSize;
+    float nearPlane;
+    float farPlane;
+    float sliceScale;
+    float sliceBias;
+    uint lightCount;
+    uint firstLight;
+} clusters;
+
+layout(std430, set = 1, binding = 1) readonly buffer LightBuffer {
+    PointLight lights[];
+};
+
+layout(std430, set = 1, binding = 2) readonly buffer ClusterBuffer {
+    uint clusterData[];
+};
+
+// Has to match LveShadowMaps
+const uint MAX_CASCADES = 4;
+const uint MAX_LOCAL_LIGHTS = 4;
+const uint MAX_SHADOW_VIEWS = MAX_CASCADES + 6 * MAX_LOCAL_LIGHTS;
+const uint LIGHT_SPOT = 0;
+const uint LIGHT_POINT = 1;
+// World units the shadow lookup moves off the surface, along with the casters' depth bias against acne
+const float NORMAL_OFFSET = 0.02;
+
+struct LocalLight {
+    vec4 positionRadius;
+    vec4 directionCosOuter;
+    vec4 colorCosInner;
+    uvec4 info; // type, first view, views
+};
+
+layout(set = 2, binding = 0) uniform ShadowUbo {
+    vec4 sunDirection; // towards the sun, w is 1 when it shines
+    vec4 sunColor;
+    vec4 cascadeSplits; // view depth each cascade ends at
+    uvec4 counts; // cascades, local lights
+    mat4 viewMatrices[MAX_SHADOW_VIEWS];
+    vec4 viewRects[MAX_SHADOW_VIEWS]; // atlas uv offset and scale, 0 without a tile
+    LocalLight localLights[MAX_LOCAL_LIGHTS];
+} shadows;
+
+layout(set = 2, binding = 1) uniform sampler2DShadow shadowAtlas;
+
+// Has to match SimpleRenderSystem, sized rather than runtime sized so the per frame fallback sets work too
+const uint SHADER_STORAGE_BUFFERS = 16;
+
+struct Material {
+    vec4 baseColor;
+};
+
+// The bindless heap's storage buffer array, the pushed index is the same for the whole draw
+layout(std430, set = 3, binding = 2) readonly buffer MaterialBuffer {
+    Material material;
+} bindlessBuffers[SHADER_STORAGE_BUFFERS];
+
+layout(push_constant) uniform Push {
+    uint materialBuffer;
+} push;
+
+// Inverse square falloff, windowed so it reaches exactly 0 at the radius
+float attenuate(float distanceSquared, float radius) {
+    float ratio = distanceSquared / (radius * radius);
+    float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+    return window * window / (distanceSquared + 1.0);
+}
+
+// 1 where nothing is between the view's light and the position, 0 in its shadow
+float sampleShadow(uint view, vec3 worldPosition) {
+    vec4 rect = shadows.viewRects[view];
+    if (rect.z == 0.0) {
+        return 1.0; // no tile this frame
+    }
+    vec4 clip = shadows.viewMatrices[view] * vec4(worldPosition, 1.0);
+    vec3 ndc = clip.xyz / clip.w;
+    if (clip.w <= 0.0 || ndc.z <= 0.0 || ndc.z >= 1.0) {
+        return 1.0;
+    }
+    // 4 filtered compares half a texel apart, clamped inside the tile so they never reach into a neighbour
+    vec2 texel = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    vec2 uv = rect.xy + (ndc.xy * 0.5 + 0.5) * rect.zw;
+    vec2 low = rect.xy + 1.5 * texel;
+    vec2 high = rect.xy + rect.zw - 1.5 * texel;
+    float lit = 0.0;
+    for (int i = 0; i < 4; i++) {
+        vec2 offset = vec2((i & 1) == 0 ? -0.5 : 0.5, (i & 2) == 0 ? -0.5 : 0.5) * texel;
+        lit += texture(shadowAtlas, vec3(clamp(uv + offset, low, high), ndc.z));
+    }
+    return lit * 0.25;
+}
+
+void main() {
+    // Faces aren't culled, so light whichever side is turned towards the camera
+    vec3 normal = normalize(fragNormal);
+    if (dot(normal, clusters.cameraPosition.xyz - fragWorldPosition) < 0.0) {
+        normal = -normal;
+    }
+
+    float viewDepth = (clusters.view * vec4(fragWorldPosition, 1.0)).z;
+    uvec3 cluster = uvec3(
+        clamp(uvec2(gl_FragCoord.xy / clusters.screenSize * vec2(CLUSTER_X, CLUSTER_Y)), uvec2(0), uvec2(CLUSTER_X - 1, CLUSTER_Y - 1)),
+        uint(clamp(log(max(viewDepth, clusters.nearPlane)) * clusters.sliceScale + clusters.sliceBias, 0.0, float(CLUSTER_Z - 1))));
+    uint base = ((cluster.z * CLUSTER_Y + cluster.y) * CLUSTER_X + cluster.x) * CLUSTER_STRIDE;
+
+    vec3 light = clusters.ambient.rgb;
+    uint count = clusterData[base];
+    for (uint i = 0; i < count; i++) {
+        PointLight pointLight = lights[clusters.firstLight + clusterData[base + 1 + i]];
+        vec3 toLight = pointLight.positionRadius.xyz - fragWorldPosition;
+        float distanceSquared = dot(toLight, toLight);
+        // Reaches 0 at the radius the light was binned with
+        float attenuation = attenuate(distanceSquared, pointLight.positionRadius.w);
+        float lambert = max(dot(normal, toLight * inversesqrt(max(distanceSquared, 1e-8))), 0.0);
+        light += pointLight.color.rgb * pointLight.color.w * attenuation * lambert;
+    }
+
+    vec3 shadowPosition = fragWorldPosition + normal * NORMAL_OFFSET;
+
+    // The sun, from the first cascade that reaches this far
+    if (shadows.sunDirection.w > 0.0) {
+        float lambert = max(dot(normal, shadows.sunDirection.xyz), 0.0);
+        float shadow = 1.0;
+        for (uint i = 0; i < shadows.counts.x && lambert > 0.0; i++) {
+            if (viewDepth < shadows.cascadeSplits[i]) {
+                shadow = sampleShadow(i, shadowPosition);
+                break;
+            }
+        }
+        light += shadows.sunColor.rgb * lambert * shadow;
+    }
+
+    for (uint i = 0; i < shadows.counts.y; i++) {
+        LocalLight local = shadows.localLights[i];
+        vec3 toLight = local.positionRadius.xyz - fragWorldPosition;
+        float distanceSquared = dot(toLight, toLight);
+        vec3 direction = toLight * inversesqrt(max(distanceSquared, 1e-8));
+        float intensity = attenuate(distanceSquared, local.positionRadius.w) * max(dot(normal, direction), 0.0);
+        uint view = local.info.y;
+        if (local.info.x == LIGHT_SPOT) {
+            intensity *= smoothstep(local.directionCosOuter.w, local.colorCosInner.w, dot(-direction, local.directionCosOuter.xyz));
+        } else {
+            // The cube face looking along the major axis of the way from the light, ordered +x -x +y -y +z -z
+            vec3 away = abs(toLight);
+            if (away.x >= away.y && away.x >= away.z) {
+                view += toLight.x <= 0.0 ? 0u : 1u;
+            } else if (away.y >= away.z) {
+                view += toLight.y <= 0.0 ? 2u : 3u;
+            } else {
+                view += toLight.z <= 0.0 ? 4u : 5u;
+            }
+        }
+        if (intensity > 0.0) {
+            light += local.colorCosInner.rgb * intensity * sampleShadow(view, shadowPosition);
+        }
+    }
+
+    Material material = bindlessBuffers[push.materialBuffer].material;
+    outColor = vec4(fragColor * material.baseColor.rgb * light, 1.0);
+}
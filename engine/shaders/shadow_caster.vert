@@ -0,0 +1,18 @@
+//VERTEX SHADER
+#version 450
+
+// Shadow casters, only the position stream is bound and there is no fragment shader
+// Every view of LveShadowMaps draws with the same object array, only the pushed matrix changes
+layout(location = 0) in vec3 position;
+
+layout(push_constant) uniform Push {
+    mat4 projectionView; // world space to the shadow view's clip space
+} push;
+
+layout(std430, set = 0, binding = 0) readonly buffer CasterBuffer {
+    mat4 transforms[];
+} casters;
+
+void main() {
+    gl_Position = push.projectionView * casters.transforms[gl_InstanceIndex] * vec4(position, 1.0);
+}
@@ -14,13 +14,6 @@ layout(location = 0) out vec4 outColor;
 // vec4 type
 // Name is outColor
 
-// Shader expects to receive push constant data
-// NOTE: Only one push constant can be used per shader block
-layout(push_constant) uniform Push {
-    mat2 transform; // mat2 is a built in 2x2 matrix
-    vec3 color;
-} push;
-
 void main() {
     // Colour is 4 output, R G B Alpha channnels
     // Colour is only run on the per fragment basis, which is determined later
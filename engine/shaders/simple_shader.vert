@@ -7,16 +7,31 @@
 //     - location specifies the storage location of where the variable value will come from
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color; // loation is the state machine location of the input
+layout(location = 2) in vec3 normal;
 
 // No association in input locations and output locations
 layout(location = 0) out vec3 fragColor;
+// World space, for the lighting in lit_shader.frag
+layout(location = 1) out vec3 fragWorldPosition;
+layout(location = 2) out vec3 fragNormal;
 
-// Shader expects to receive push constant data
-// NOTE: Only one push constant can be used per shader block
-layout(push_constant) uniform Push {
+// Computed exactly like depth_prepass.vert, so the depth it tests EQUAL against matches bit for bit
+invariant gl_Position;
+
+// Same for every object in the frame, world space to the canonical view volume
+layout(set = 0, binding = 0) uniform FrameUbo {
+    mat4 projectionView;
+} frame;
+
+// Every drawn object of the frame, draws start at their first object so gl_InstanceIndex picks the right one
+struct ObjectData {
     mat4 transform;
-    vec3 color;
-} push;
+    mat4 normalMatrix; // inverse transpose of the transform, built once per object on the CPU
+    vec4 color;
+};
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
 
 // Will be executed once for each vertex we have
 // Input will get input vertex from input assembler stage
@@ -29,6 +44,10 @@ void main() {
     //      z: 0 is front most layer stacks of layers 1 is the back
     //      normalization coef: normalizes vector, all the vectors are divided by this component to normalize
     // Mat2 is not commutative
-    gl_Position = push.transform * vec4(position, 1.0); // vec4 is homogeneous coordinate
-    fragColor = color;
+    ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+    gl_Position = frame.projectionView * object.transform * vec4(position, 1.0); // vec4 is homogeneous coordinate
+    fragColor = color * object.color.rgb; // Objects default to white, which leaves the vertex colour as is
+    fragWorldPosition = (object.transform * vec4(position, 1.0)).xyz;
+    // Inverse transpose keeps normals perpendicular to the surface under non uniform scale
+    fragNormal = mat3(object.normalMatrix) * normal;
 }
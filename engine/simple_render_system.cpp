@@ -3,50 +3,60 @@
 #define GLM_FORCE_RADIANS // Radians must be radians
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE // Expect depth values to 0 - 1
 #include <glm/glm.hpp>
-#include <glm/gtc/constants.hpp>
 
+#include <cassert>
 #include <stdexcept>
 
 namespace lve {
 
-    // In implementation because it's temporary
-    struct SimplePushConstantData {
-        glm::mat4 transform{1.f}; // Default initialized to identity matrix, basically no change
-        alignas(16) glm::vec3 color; // Alignment issue with glfw struct, needs to align by 4 bytes
-    };
-
-    SimpleRenderSystem::SimpleRenderSystem(LveDevice &device, VkRenderPass renderPass) : lveDevice{device} {
-        createPipelineLayout();
+    SimpleRenderSystem::SimpleRenderSystem(LveDevice &device, VkRenderPass renderPass, LveDescriptorLayoutCache &layoutCache,
+                                           LveClusteredLights &lights, LveShadowMaps &shadows, LveBindlessHeap &bindless)
+        : lveDevice{device}, clusteredLights{lights}, shadowMaps{shadows}, bindlessHeap{bindless} {
+        createMaterial();
+        createPipelineLayout(layoutCache);
         createPipeline(renderPass);
     }
 
+    // The layouts belong to the cache, the device is idle by the time the system goes
     SimpleRenderSystem::~SimpleRenderSystem() {
-        vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
-        // command buffer is automatically destroyed
+        bindlessHeap.removeStorageBuffer(materialBufferIndex);
+    }
+
+    // Written once, so host visible memory the GPU reads from directly is good enough
+    void SimpleRenderSystem::createMaterial() {
+        if (bindlessHeap.getCapacities().storageBuffers < SHADER_STORAGE_BUFFERS) {
+            throw std::runtime_error("bindless heap has fewer storage buffers than the lit shader declares!");
+        }
+        Material material{};
+        materialBuffer = std::make_unique<LveBuffer>(
+            lveDevice,
+            sizeof(Material),
+            1,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        materialBuffer->map();
+        materialBuffer->writeToBuffer(&material);
+        materialBufferIndex = bindlessHeap.addStorageBuffer(materialBuffer->descriptorInfo());
+        if (materialBufferIndex >= SHADER_STORAGE_BUFFERS) {
+            throw std::runtime_error("material buffer index is past the lit shader's bindless array!");
+        }
     }
 
-    // Creates a pipeline layout with defaults set and assigns it to the pipelineLayout pointer
-    void SimpleRenderSystem::createPipelineLayout(){
+    // The camera and every object's data come in through one descriptor set
+    // Both live in the frame ring buffer, the dynamic offsets pick this frame's allocations at bind time
+    // The lights are a second set, owned and written by LveClusteredLights, and the shadows a third from LveShadowMaps
+    // The fourth is the bindless heap, the material's index into it is the only thing pushed
+    void SimpleRenderSystem::createPipelineLayout(LveDescriptorLayoutCache &layoutCache){
+        descriptorSetLayout = layoutCache.getSetLayout({
+            LveDescriptorLayoutCache::binding(FRAME_UBO_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT),
+            LveDescriptorLayoutCache::binding(OBJECT_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT),
+        });
         VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT; // Want fragment and vertex shader to access push constants
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
         pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(SimplePushConstantData);
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 0;
-        // used to pass data other than vertex data to vertex shaders
-        pipelineLayoutInfo.pSetLayouts = nullptr;
-        // Push constants are way to efficiently send small amount of data to shaders 
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-        if (vkCreatePipelineLayout(lveDevice.device(),
-                                   &pipelineLayoutInfo,
-                                   nullptr,
-                                   &pipelineLayout) != VK_SUCCESS){
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
+        pushConstantRange.size = sizeof(PushConstantData);
+        pipelineLayout = layoutCache.getPipelineLayout(
+            {descriptorSetLayout, clusteredLights.getSetLayout(), shadowMaps.getSetLayout(), bindlessHeap.getSetLayout()}, {pushConstantRange});
     }
 
     void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
@@ -61,32 +71,202 @@ namespace lve {
         lvePipeline = std::make_unique<LvePipeline>( // using smart pointers
             lveDevice,
             "shaders/simple_shader.vert.spv",
-            "shaders/simple_shader.frag.spv",
+            "shaders/lit_shader.frag.spv",
             pipelineConfig
         );
-        
+
+        // Same shaders behind a depth pre pass, only the fragments that won the pre pass pass the test
+        PipelineConfigInfo equalConfig{};
+        LvePipeline::defaultPipelineConfigInfo(equalConfig);
+        equalConfig.renderPass = renderPass;
+        equalConfig.pipelineLayout = pipelineLayout;
+        equalConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        equalConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+        depthEqualPipeline = std::make_unique<LvePipeline>(
+            lveDevice,
+            "shaders/simple_shader.vert.spv",
+            "shaders/lit_shader.frag.spv",
+            equalConfig
+        );
     }
 
-    void SimpleRenderSystem::renderGameObjects(VkCommandBuffer commandBuffer, std::vector<LveGameObject> &gameObjects) {
-        lvePipeline->bind(commandBuffer);
+    void SimpleRenderSystem::createDepthPrepassPipeline(VkRenderPass renderPass) {
+        assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+        if (depthPrepassPipeline && depthPrepassRenderPass == renderPass) {
+            return;
+        }
+        PipelineConfigInfo pipelineConfig{};
+        LvePipeline::depthOnlyPipelineConfigInfo(pipelineConfig);
+        pipelineConfig.renderPass = renderPass;
+        pipelineConfig.pipelineLayout = pipelineLayout; // same set as the color pass, the objects are uploaded once
+        depthPrepassPipeline = std::make_unique<LvePipeline>(
+            lveDevice,
+            "shaders/depth_prepass.vert.spv",
+            "", // no fragment shader
+            pipelineConfig
+        );
+        depthPrepassRenderPass = renderPass;
+    }
 
-        for (auto& obj: gameObjects){
-            obj.transform.rotation.y = glm::mod(obj.transform.rotation.y + 0.01f, glm::two_pi<float>()); // rotates along y axis
-            obj.transform.rotation.x = glm::mod(obj.transform.rotation.x + 0.005f, glm::two_pi<float>()); // rotates along y axis
-            SimplePushConstantData push{};
-            push.color = obj.color;
-            push.transform = obj.transform.mat4();
+    void SimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo, LveRegistry &registry, bool depthPrepassed) {
+        auto bindLighting = [&]() {
+            return clusteredLights.bind(frameInfo, pipelineLayout, LIGHTS_SET) && shadowMaps.bind(frameInfo, pipelineLayout, SHADOWS_SET);
+        };
+        if (depthPrepassed) {
+            // Culled, sorted and uploaded by the pre pass already
+            if (prepared.valid && bindLighting()) {
+                drawPrepared(frameInfo, registry, *depthEqualPipeline);
+            }
+            return;
+        }
+        if (prepareFrame(frameInfo, registry) && bindLighting()) {
+            drawPrepared(frameInfo, registry, *lvePipeline);
+        }
+    }
 
-            vkCmdPushConstants(commandBuffer,
-                               pipelineLayout,
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                               0, // offset
-                               sizeof(SimplePushConstantData),
-                               &push);
+    void SimpleRenderSystem::renderDepthPrepass(FrameInfo &frameInfo, LveRegistry &registry) {
+        assert(depthPrepassPipeline && "Cannot render a depth pre pass without its pipeline");
+        if (prepareFrame(frameInfo, registry)) {
+            drawPrepared(frameInfo, registry, *depthPrepassPipeline);
+        }
+    }
+
+    bool SimpleRenderSystem::prepareFrame(FrameInfo &frameInfo, LveRegistry &registry) {
+        prepared.valid = false;
+        // Each pass below only walks the component arrays it needs
+        auto &colors = registry.getColors();
+        auto &models = registry.getModels();
 
-            obj.model->bind(commandBuffer);
-            obj.model->draw(commandBuffer); 
+        // Only the objects whose transform changed get new matrices
+        registry.updateMatrices(&frameInfo.jobSystem);
+        auto &matrices = registry.getMatrices();
+        auto &normalMatrices = registry.getNormalMatrices();
 
+        // Only what the camera can see goes on to sorting and recording
+        frustumCuller.cull(frameInfo.camera.getFrustum(), registry, frameInfo.assets, &frameInfo.jobSystem, visibleObjects);
+        auto &cullStats = frustumCuller.getStats();
+        frameInfo.profiler.setCounter("cull.visible", cullStats.visibleCount);
+        frameInfo.profiler.setCounter("cull.culled", cullStats.culledCount);
+        frameInfo.profiler.setCounter("cull.box_tests", cullStats.boxTestCount);
+        frameInfo.profiler.setCounter("cull.bvh_reinserts", cullStats.bvhReinsertCount);
+
+        glm::mat4 projectionView = frameInfo.camera.getProjectionView();
+
+        renderQueue.clear();
+        renderQueue.reserve(visibleObjects.size());
+        for (uint32_t i : visibleObjects){
+            // Depth of the object's origin in the 0 to 1 range of the view volume
+            glm::vec4 clip = projectionView * matrices[i][3];
+            float depth = clip.w > 0.f ? clip.z / clip.w : 0.f;
+            // The handle's slot is small and unique among loaded models, enough to group draws by
+            renderQueue.push(LveRenderQueue::makeKey(PIPELINE_ID, MATERIAL_ID, LveHandle::slotOf(models[i]), depth), i);
+        }
+        if (renderQueue.size() == 0) {
+            frameInfo.profiler.setCounter("simple.objects", 0);
+            return false;
+        }
+        renderQueue.sort(&frameInfo.jobSystem);
+        auto &items = renderQueue.getItems();
+
+        // Camera and objects both come out of the frame ring buffer
+        auto &frameRing = frameInfo.frameRing;
+        auto frameUbo = frameRing.allocateUniform(sizeof(FrameUbo));
+        auto objectArray = frameRing.allocateArray(sizeof(ObjectData), static_cast<uint32_t>(items.size()));
+        if (!frameUbo || !objectArray) {
+            // Drawing some objects with stale data would be worse than skipping a frame, the ring grows before the next one
+            frameInfo.profiler.setCounter("simple.objects", 0);
+            return false;
+        }
+        static_cast<FrameUbo *>(frameUbo.data)->projectionView = projectionView;
+        // A fresh set every frame from the frame's allocator, so it always points at the ring's current buffer
+        VkDescriptorSet descriptorSet = descriptorWriter.clear()
+            .writeBuffer(FRAME_UBO_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, frameRing.descriptorInfo(sizeof(FrameUbo)))
+            .writeBuffer(OBJECT_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, frameRing.regionDescriptorInfo())
+            .build(frameInfo.descriptorAllocator, descriptorSetLayout);
+
+        // Objects are written in sorted order, so every run of one model is contiguous in the array
+        auto *objects = static_cast<ObjectData *>(objectArray.data);
+        // Each slot still holds what was written the last time this frame index came around, as long as the array
+        // landed at the same place in the same buffer, so an object only needs writing if a different object
+        // landed there or the object changed since
+        auto &upload = objectUploads[frameInfo.frameIndex];
+        if (upload.ringGeneration != frameRing.getGeneration() || upload.regionOffset != objectArray.regionOffset) {
+            upload.entities.clear();
+            upload.ringGeneration = frameRing.getGeneration();
+            upload.regionOffset = objectArray.regionOffset;
+        }
+        auto &entities = registry.getEntities();
+        upload.entities.resize(items.size(), LveRegistry::INVALID_ENTITY);
+        uint32_t uploadCount = 0;
+        for (size_t i = 0; i < items.size(); i++){
+            uint32_t index = items[i].payload;
+            if (upload.entities[i] == entities[index] && !registry.hasChangedSince(index, upload.version)) {
+                continue;
+            }
+            objects[i].transform = matrices[index];
+            objects[i].normalMatrix = normalMatrices[index];
+            objects[i].color = glm::vec4{colors[index], 1.f};
+            upload.entities[i] = entities[index];
+            uploadCount++;
         }
+        upload.version = registry.getVersion();
+
+        prepared.valid = true;
+        prepared.descriptorSet = descriptorSet;
+        // The object buffer covers this frame's whole region, the array is indexed from where it starts in it
+        prepared.dynamicOffsets[0] = frameUbo.offset;
+        prepared.dynamicOffsets[1] = frameRing.getRegionOffset();
+        prepared.firstObject = objectArray.regionOffset / static_cast<uint32_t>(sizeof(ObjectData));
+
+        frameInfo.profiler.setCounter("simple.objects", items.size());
+        frameInfo.profiler.setCounter("simple.object_uploads", uploadCount);
+        frameInfo.profiler.setCounter("simple.matrix_updates", registry.getLastMatrixUpdateCount());
+        return true;
+    }
+
+    void SimpleRenderSystem::drawPrepared(FrameInfo &frameInfo, LveRegistry &registry, LvePipeline &pipeline) {
+        auto &models = registry.getModels();
+        auto &items = renderQueue.getItems();
+        uint32_t firstObject = prepared.firstObject;
+
+        auto &recorder = frameInfo.recorder;
+        pipeline.bind(recorder);
+        recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &prepared.descriptorSet, 2, prepared.dynamicOffsets);
+        VkDescriptorSet bindlessSet = frameInfo.bindless.getDescriptorSet(frameInfo.frameIndex);
+        recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, BINDLESS_SET, 1, &bindlessSet);
+        // Every run shares the one material, so it is pushed once for all of them
+        PushConstantData push{materialBufferIndex};
+        recorder.pushConstants(pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &push);
+
+        uint32_t drawCount = 0;
+        // What the draws themselves change, whether or not the recorder had to emit it
+        uint32_t stateChanges = 1; // the pipeline
+        LveGeometryArena *lastArena = nullptr;
+
+        // One draw per run of equal state bits instead of one per object
+        uint32_t runStart = 0;
+        for (uint32_t i = 1; i <= items.size(); i++){
+            if (i < items.size() && LveRenderQueue::getStateBits(items[i].key) == LveRenderQueue::getStateBits(items[runStart].key)) {
+                continue;
+            }
+
+            // Every model lives in a shared geometry arena, the recorder drops the bind
+            // unless a run comes from a different arena
+            LveModel &model = frameInfo.assets.getModel(models[items[runStart].payload]);
+            if (lastArena != &model.getArena()) {
+                lastArena = &model.getArena();
+                stateChanges++;
+            }
+            model.bind(recorder);
+            // gl_InstanceIndex starts at firstInstance, so it indexes the object array directly
+            model.drawInstanced(recorder.getCommandBuffer(), i - runStart, firstObject + runStart);
+            stateChanges++; // switching model means new draw parameters
+            drawCount++;
+            runStart = i;
+        }
+
+        // Summed over the pre pass and the color pass
+        frameInfo.profiler.addCounter("simple.draws", drawCount);
+        frameInfo.profiler.addCounter("simple.state_changes", stateChanges);
     }
 }
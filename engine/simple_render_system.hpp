@@ -2,32 +2,130 @@
 
 #include "lve_pipeline.hpp"
 #include "lve_device.hpp"
-#include "lve_game_object.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_registry.hpp"
+#include "lve_buffer.hpp"
+#include "lve_clustered_lights.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_frame_ring_buffer.hpp"
+#include "lve_frustum_culler.hpp"
+#include "lve_render_queue.hpp"
+#include "lve_shadow_maps.hpp"
+#include "lve_swap_chain.hpp"
 
 //std
+#include <array>
 #include <memory>
 #include <vector>
 
 namespace lve {
     class SimpleRenderSystem {
         public:
-            SimpleRenderSystem(LveDevice &device, VkRenderPass renderPass);
+            // Per object data, an array in the frame ring buffer indexed by gl_InstanceIndex (std430 layout)
+            struct ObjectData {
+                glm::mat4 transform{1.f};
+                // From LveRegistry::getNormalMatrices, so the vertex shader doesn't invert a matrix per vertex
+                glm::mat4 normalMatrix{1.f};
+                glm::vec4 color{1.f}; // vec4 so every object stays 16 byte aligned
+            };
+
+            // Same for every object, a uniform block in the frame ring buffer
+            struct FrameUbo {
+                glm::mat4 projectionView{1.f};
+            };
+
+            // Shading parameters of a material, a storage buffer registered in the bindless heap (std430 layout)
+            struct Material {
+                glm::vec4 baseColor{1.f}; // multiplies the vertex and object colors
+            };
+
+            // Pushed per draw, which of the bindless heap's storage buffers holds the run's material
+            struct PushConstantData {
+                uint32_t materialBuffer;
+            };
+
+            static constexpr uint32_t FRAME_UBO_BINDING = 0;
+            static constexpr uint32_t OBJECT_BUFFER_BINDING = 1;
+            static constexpr uint32_t LIGHTS_SET = 1; // set 0 is the camera and objects
+            static constexpr uint32_t SHADOWS_SET = 2;
+            static constexpr uint32_t BINDLESS_SET = 3;
+            // Length of bindlessBuffers in lit_shader.frag, the heap has to have at least that many
+            // Fixed, the per frame fallback sets have no runtime sized arrays
+            static constexpr uint32_t SHADER_STORAGE_BUFFERS = 16;
+
+            // Objects are shaded with the lights binned by lights.cull and the shadows drawn by shadows.update earlier in the frame
+            // Materials are looked up in bindless, which has to outlive the system
+            SimpleRenderSystem(LveDevice &device, VkRenderPass renderPass, LveDescriptorLayoutCache &layoutCache,
+                               LveClusteredLights &lights, LveShadowMaps &shadows, LveBindlessHeap &bindless);
             ~SimpleRenderSystem();
 
             // Delete copy functions because using vulkan calls to make sure we don't have dangling pointers
             SimpleRenderSystem(const SimpleRenderSystem &) = delete;
             SimpleRenderSystem &operator=(const SimpleRenderSystem &) = delete;
 
-            void renderGameObjects(VkCommandBuffer commandBuffer, std::vector<LveGameObject> &gameObjects);
+            // Objects outside the camera's frustum are dropped first, the rest are sorted by pipeline,
+            // material and model, and each run sharing a model is drawn with a single instanced draw
+            // If the frame ring buffer overflows nothing is drawn this frame, the ring has grown by the next one
+            // After renderDepthPrepass in the same frame, pass depthPrepassed: the objects it prepared are drawn again
+            // testing EQUAL against its depth without writing it, so every pixel is shaded once
+            void renderGameObjects(FrameInfo &frameInfo, LveRegistry &registry, bool depthPrepassed = false);
+            // Culls, sorts and uploads like renderGameObjects, but only writes depth, from the position stream
+            // Needs createDepthPrepassPipeline for the render pass it records into
+            void renderDepthPrepass(FrameInfo &frameInfo, LveRegistry &registry);
+            // Depth only render passes have no color attachment, so it can't share the main pipeline's render pass
+            // Nothing happens if the pipeline already exists for renderPass
+            void createDepthPrepassPipeline(VkRenderPass renderPass);
 
         private:
+            // This system only has one pipeline and one material, so they are constant in its sort keys
+            static constexpr uint32_t PIPELINE_ID = 0;
+            static constexpr uint32_t MATERIAL_ID = 0;
+
             std::vector<LveModel::Vertex> draw_triangles(std::vector<LveModel::Vertex> input, unsigned int depth);
-            void createPipelineLayout();
+            void createMaterial();
+            void createPipelineLayout(LveDescriptorLayoutCache &layoutCache);
             void createPipeline(VkRenderPass renderPass); // Not storing render pass, because render system lifecycle is not tied
+            // Culls, sorts and uploads the frame's objects and writes their descriptor set, false if there is nothing to draw
+            bool prepareFrame(FrameInfo &frameInfo, LveRegistry &registry);
+            // One instanced draw per run of the prepared objects
+            void drawPrepared(FrameInfo &frameInfo, LveRegistry &registry, LvePipeline &pipeline);
 
             // Learning constructed here, that means that object will construct and deconstruct with the app
             LveDevice &lveDevice;
+            LveClusteredLights &clusteredLights;
+            LveShadowMaps &shadowMaps;
+            LveBindlessHeap &bindlessHeap;
+            std::unique_ptr<LveBuffer> materialBuffer;
+            LveBindlessHeap::index_t materialBufferIndex = LveBindlessHeap::DEFAULT_INDEX;
             std::unique_ptr<LvePipeline> lvePipeline;
-            VkPipelineLayout pipelineLayout;
+            std::unique_ptr<LvePipeline> depthEqualPipeline; // the color pass after a depth pre pass
+            std::unique_ptr<LvePipeline> depthPrepassPipeline; // made when the first pre pass is declared
+            VkRenderPass depthPrepassRenderPass = VK_NULL_HANDLE; // what depthPrepassPipeline was made for
+            VkPipelineLayout pipelineLayout; // owned by the layout cache
+            VkDescriptorSetLayout descriptorSetLayout; // owned by the layout cache
+            LveDescriptorWriter descriptorWriter{lveDevice}; // reused so writing the frame's set doesn't allocate
+
+            // What each frame's region of the ring still holds from the last time that frame came around,
+            // so unchanged objects aren't written again as long as their array lands at the same place
+            struct ObjectUploadState {
+                std::vector<LveRegistry::entity_t> entities; // entity written at each object slot
+                uint64_t version = 0; // registry version when the array was last written
+                uint64_t ringGeneration = 0;
+                uint32_t regionOffset = 0;
+            };
+            std::array<ObjectUploadState, LveSwapChain::MAX_FRAMES_IN_FLIGHT> objectUploads;
+            // Reused every frame so culling and sorting don't allocate
+            LveFrustumCuller frustumCuller;
+            std::vector<uint32_t> visibleObjects;
+            LveRenderQueue renderQueue;
+
+            // What prepareFrame left for the draws of the frame
+            struct PreparedFrame {
+                bool valid = false;
+                VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+                uint32_t dynamicOffsets[2] = {0, 0};
+                uint32_t firstObject = 0; // of the sorted array in the object buffer
+            };
+            PreparedFrame prepared;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,225 @@
+// Test client for the render server (a.out --server): drives a scene and reads the frames back
+// Measures how long an update takes to show up in a frame the client can read, and frames per second
+//
+// Usage: render_client [socket path] [shared memory name] [seconds] [objects] [--shutdown]
+#include "../lve_scene_protocol.hpp"
+#include "../lve_shared_frame_ring.hpp"
+
+//posix
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+//std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    // Updates are sent at a fixed rate, faster than frames come, so some frames show several at once
+    constexpr auto UPDATE_INTERVAL = std::chrono::microseconds{4000};
+
+    int connectToServer(const std::string &socketPath) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+        // The server may still be starting up
+        for (int attempt = 0; attempt < 100; attempt++) {
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0) {
+                throw std::runtime_error("failed to create socket!");
+            }
+            if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0) {
+                return fd;
+            }
+            close(fd);
+            std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        }
+        throw std::runtime_error("failed to connect to the render server!");
+    }
+
+    void receiveAll(int fd, void *data, size_t size) {
+        auto bytes = static_cast<char *>(data);
+        while (size > 0) {
+            ssize_t received = recv(fd, bytes, size, 0);
+            if (received <= 0) {
+                throw std::runtime_error("lost the connection to the render server!");
+            }
+            bytes += received;
+            size -= static_cast<size_t>(received);
+        }
+    }
+
+    void sendAll(int fd, const void *data, size_t size) {
+        auto bytes = static_cast<const char *>(data);
+        while (size > 0) {
+            ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+            if (sent < 0) {
+                throw std::runtime_error("lost the connection to the render server!");
+            }
+            bytes += sent;
+            size -= static_cast<size_t>(sent);
+        }
+    }
+
+    double percentile(std::vector<double> &values, double fraction) {
+        if (values.empty()) {
+            return 0.0;
+        }
+        size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * static_cast<double>(values.size())));
+        std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+        return values[index];
+    }
+}
+
+int main(int argc, char **argv) {
+    std::string socketPath = argc > 1 ? argv[1] : "/tmp/lve_render.sock";
+    std::string frameRingName = argc > 2 ? argv[2] : "/lve_frames";
+    double seconds = argc > 3 ? std::atof(argv[3]) : 10.0;
+    uint32_t objectCount = argc > 4 ? static_cast<uint32_t>(std::atoi(argv[4])) : 100;
+    bool shutdown = argc > 5 && std::string{argv[5]} == "--shutdown";
+
+    try {
+        int fd = connectToServer(socketPath);
+        // Frames list every client's sequence under its id
+        lve::LveSceneWelcome welcome{};
+        receiveAll(fd, &welcome, sizeof(welcome));
+        if (welcome.clientId == 0) {
+            throw std::runtime_error("render server has no room for another client!");
+        }
+
+        std::vector<lve::LveSceneMessage> messages(objectCount);
+        uint64_t sequence = 0;
+        std::deque<std::pair<uint64_t, clock_type::time_point>> inFlight; // sent, not seen in a frame yet
+        std::vector<double> latencies; // milliseconds
+        std::unique_ptr<lve::LveSharedFrameReader> reader;
+        uint64_t frames = 0;
+        uint64_t tornFrames = 0;
+        uint64_t checksum = 0;
+
+        auto start = clock_type::now();
+        auto end = start + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(seconds));
+        auto nextUpdate = start;
+        clock_type::time_point firstFrame{};
+        clock_type::time_point lastFrame{};
+
+        while (clock_type::now() < end) {
+            auto now = clock_type::now();
+            if (now >= nextUpdate) {
+                // A ring of cubes in front of the camera, turning a little more every update
+                sequence++;
+                float time = std::chrono::duration<float>(now - start).count();
+                for (uint32_t i = 0; i < objectCount; i++) {
+                    float angle = time + 6.2831853f * static_cast<float>(i) / static_cast<float>(objectCount);
+                    auto &message = messages[i];
+                    message = {};
+                    message.type = lve::LveSceneMessage::UPDATE_OBJECT;
+                    message.objectId = i;
+                    message.sequence = sequence;
+                    message.translation[0] = 1.5f * std::cos(angle);
+                    message.translation[1] = 1.5f * std::sin(angle);
+                    message.translation[2] = 5.f;
+                    message.rotation[1] = angle;
+                    message.scale[0] = message.scale[1] = message.scale[2] = .2f;
+                    message.color[0] = .5f + .5f * std::cos(angle);
+                    message.color[1] = .5f + .5f * std::sin(angle);
+                    message.color[2] = 1.f;
+                }
+                sendAll(fd, messages.data(), messages.size() * sizeof(lve::LveSceneMessage));
+                inFlight.emplace_back(sequence, now);
+                nextUpdate += UPDATE_INTERVAL;
+            }
+
+            // The ring only exists once the server read back its first frame
+            if (!reader) {
+                try {
+                    reader = std::make_unique<lve::LveSharedFrameReader>(frameRingName);
+                } catch (const std::runtime_error &) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                    continue;
+                }
+            }
+            // The server resized its ring (or went away), the new one is under the same name
+            if (reader->isClosed()) {
+                reader.reset();
+                continue;
+            }
+
+            lve::LveSharedFrameReader::FrameView view;
+            if (reader->acquireLatest(view)) {
+                // The header comes from another process, a corrupt one must not send the loop below out of the slot
+                if (static_cast<uint64_t>(view.rowPitch) * view.height > reader->getMaxFrameBytes() ||
+                    static_cast<uint64_t>(view.width) * 4 > view.rowPitch) {
+                    tornFrames++;
+                    continue;
+                }
+                uint64_t shown = reader->getClientSequence(view, welcome.clientId);
+                // Read the pixels in place, as a real consumer would, then make sure they weren't overwritten meanwhile
+                uint64_t sum = 0;
+                for (uint32_t y = 0; y < view.height; y += 16) {
+                    const uint8_t *row = view.pixels + static_cast<size_t>(y) * view.rowPitch;
+                    for (uint32_t x = 0; x < view.width; x += 16) {
+                        sum += row[x * 4];
+                    }
+                }
+                if (!reader->validate(view)) {
+                    tornFrames++;
+                    continue;
+                }
+                checksum += sum;
+
+                auto seen = clock_type::now();
+                while (!inFlight.empty() && inFlight.front().first <= shown) {
+                    latencies.push_back(std::chrono::duration<double, std::milli>(seen - inFlight.front().second).count());
+                    inFlight.pop_front();
+                }
+                if (frames == 0) {
+                    firstFrame = seen;
+                }
+                lastFrame = seen;
+                frames++;
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds{200});
+            }
+        }
+
+        if (shutdown) {
+            lve::LveSceneMessage message{};
+            message.type = lve::LveSceneMessage::SHUTDOWN;
+            message.sequence = ++sequence;
+            sendAll(fd, &message, sizeof(message));
+        }
+        close(fd);
+
+        double frameSeconds = std::chrono::duration<double>(lastFrame - firstFrame).count();
+        double average = 0.0;
+        for (double latency : latencies) {
+            average += latency;
+        }
+        average = latencies.empty() ? 0.0 : average / static_cast<double>(latencies.size());
+
+        std::cout << "frames read:       " << frames << " (" << (frameSeconds > 0.0 ? static_cast<double>(frames - 1) / frameSeconds : 0.0) << " frames/s)\n";
+        std::cout << "frames skipped:    " << (reader ? reader->getSkippedFrames() : 0) << ", torn: " << tornFrames << "\n";
+        std::cout << "updates sent:      " << sequence << ", seen in a frame: " << latencies.size() << "\n";
+        std::cout << "update to frame:   avg " << average << " ms, p50 " << percentile(latencies, .5)
+                  << " ms, p95 " << percentile(latencies, .95) << " ms, p99 " << percentile(latencies, .99)
+                  << " ms, max " << percentile(latencies, 1.0) << " ms\n";
+        std::cout << "checksum:          " << checksum << "\n";
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}